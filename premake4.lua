@@ -9,6 +9,21 @@ includeDirList = {
 
 buildOptions = {"-std=c++11"}
 
+-- Compiles in the PROFILE_SCOPE zones of the CPU profiler. Pass the same
+-- option to both builds, e.g. "premake4 --profile gmake".
+newoption {
+    trigger = "profile",
+    description = "Record CPU profiler zones (CS488_PROFILE)"
+}
+
+-- Overrides the GL error checking level, 0 to 2, described in
+-- shared/cs488-framework/GlDebug.hpp. Pass the same option to both builds.
+newoption {
+    trigger = "gl-debug",
+    value = "LEVEL",
+    description = "GL error checking level (CS488_GL_DEBUG_LEVEL)"
+}
+
 -- Get the current OS platform
 PLATFORM = os.get()
 
@@ -54,6 +69,15 @@ solution "BuildStaticLibs"
         defines { "NDEBUG" }
         flags { "Optimize" }
 
+    configuration "profile"
+        defines { "CS488_PROFILE" }
+
+    configuration {}
+
+    if _OPTIONS["gl-debug"] then
+        defines { "CS488_GL_DEBUG_LEVEL=" .. _OPTIONS["gl-debug"] }
+    end
+
     -- Builds cs488-framework static library
     project "cs488-framework"
         kind "StaticLib"
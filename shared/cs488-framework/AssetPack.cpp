@@ -0,0 +1,324 @@
+#include "AssetPack.hpp"
+#include "Exception.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+namespace {
+
+const char MAGIC[4] = { 'S', 'P', 'A', 'K' };
+const uint32_t VERSION = 1;
+
+// Asset data starts on this boundary, so it can be read in place with any
+// alignment up to a cache line.
+const uint64_t ALIGNMENT = 64;
+
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t assetCount;
+    uint32_t reserved;
+    uint64_t indexOffset;
+    uint64_t namesOffset;
+    uint64_t namesSize;
+    uint8_t padding[24];
+};
+
+static_assert(sizeof(Header) == 64, "Pack header must be 64 bytes");
+
+uint64_t alignUp(uint64_t offset) {
+    return (offset + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+}
+
+// The pack mounted with AssetPack::mount(), and the directory it stands in
+// for, with a trailing '/'.
+AssetPack mounted;
+string mountedDirectory;
+
+}
+
+//------------------------------------------------------------------------------------
+AssetPack::Asset::Asset()
+    : data(nullptr),
+      size(0),
+      hash(0)
+{
+
+}
+
+//------------------------------------------------------------------------------------
+AssetPack::AssetPack()
+    : data(nullptr),
+      size(0),
+      entries(nullptr),
+      entryCount(0),
+      names(nullptr)
+{
+
+}
+
+//------------------------------------------------------------------------------------
+AssetPack::~AssetPack() {
+    close();
+}
+
+//------------------------------------------------------------------------------------
+bool AssetPack::open(const string & packPath) {
+    close();
+
+    if (!file.open(packPath) || file.getSize() < sizeof(Header)) {
+        file.close();
+        return false;
+    }
+
+    data = file.getData();
+    size = file.getSize();
+
+    Header header;
+    memcpy(&header, data, sizeof(Header));
+
+    bool valid = memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 && header.version == VERSION &&
+            header.indexOffset <= size &&
+            uint64_t(header.assetCount) * sizeof(Entry) <= size - header.indexOffset &&
+            header.namesOffset <= size && header.namesSize <= size - header.namesOffset &&
+            header.indexOffset % alignof(Entry) == 0;
+
+    if (valid) {
+        entries = (const Entry *) (data + header.indexOffset);
+        entryCount = header.assetCount;
+        names = (const char *) (data + header.namesOffset);
+
+        for (uint32_t idx = 0; idx < entryCount && valid; ++idx) {
+            const Entry & entry = entries[idx];
+            valid = uint64_t(entry.nameOffset) + entry.nameLength <= header.namesSize &&
+                    entry.offset <= size && entry.size <= size - entry.offset;
+        }
+    }
+
+    if (!valid) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------------
+void AssetPack::close() {
+    file.close();
+    data = nullptr;
+    size = 0;
+    entries = nullptr;
+    entryCount = 0;
+    names = nullptr;
+}
+
+//------------------------------------------------------------------------------------
+bool AssetPack::isOpen() const {
+    return data != nullptr;
+}
+
+//------------------------------------------------------------------------------------
+bool AssetPack::find(const char * name, Asset & asset) const {
+    size_t length = strlen(name);
+
+    // Entries are sorted by name, compared as bytes.
+    uint32_t low = 0, high = entryCount;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        const Entry & entry = entries[middle];
+
+        int order = memcmp(names + entry.nameOffset, name, min(size_t(entry.nameLength), length));
+        if (order == 0) {
+            order = entry.nameLength < length ? -1 : (entry.nameLength > length ? 1 : 0);
+        }
+
+        if (order == 0) {
+            asset.data = data + entry.offset;
+            asset.size = size_t(entry.size);
+            asset.hash = entry.hash;
+            return true;
+        }
+
+        if (order < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------------
+size_t AssetPack::getAssetCount() const {
+    return entryCount;
+}
+
+//------------------------------------------------------------------------------------
+string AssetPack::getAssetName(size_t index) const {
+    const Entry & entry = entries[index];
+    return string(names + entry.nameOffset, entry.nameLength);
+}
+
+//------------------------------------------------------------------------------------
+bool AssetPack::verify(const Asset & asset) {
+    return hash(asset.data, asset.size) == asset.hash;
+}
+
+//------------------------------------------------------------------------------------
+// FNV-1a.
+uint64_t AssetPack::hash(const uint8_t * data, size_t size) {
+    uint64_t result = 14695981039346656037ull;
+    for (size_t idx = 0; idx < size; ++idx) {
+        result ^= data[idx];
+        result *= 1099511628211ull;
+    }
+    return result;
+}
+
+//------------------------------------------------------------------------------------
+void AssetPack::write(const string & packPath, const vector<string> & names,
+        const vector<string> & filePaths) {
+    if (names.size() != filePaths.size()) {
+        throw Exception("Error -- Asset pack needs one name per file");
+    }
+
+    vector<size_t> order(names.size());
+    for (size_t idx = 0; idx < order.size(); ++idx) {
+        order[idx] = idx;
+    }
+    sort(order.begin(), order.end(), [&names](size_t a, size_t b) {
+        return names[a] < names[b];
+    });
+
+    for (size_t idx = 1; idx < order.size(); ++idx) {
+        if (names[order[idx]] == names[order[idx - 1]]) {
+            throw Exception("Error -- Asset packed twice: " + names[order[idx]]);
+        }
+    }
+
+    Header header;
+    memset(&header, 0, sizeof(Header));
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.assetCount = uint32_t(names.size());
+    header.indexOffset = sizeof(Header);
+
+    vector<Entry> index(names.size());
+    string nameTable;
+    for (size_t idx = 0; idx < order.size(); ++idx) {
+        const string & name = names[order[idx]];
+        index[idx].nameOffset = uint32_t(nameTable.size());
+        index[idx].nameLength = uint32_t(name.size());
+        nameTable += name;
+    }
+
+    header.namesOffset = header.indexOffset + index.size() * sizeof(Entry);
+    header.namesSize = nameTable.size();
+
+    // Written to a temporary file first, so a running Stack never maps half a
+    // pack.
+    string tempPath = packPath + ".tmp";
+    ofstream pack(tempPath.c_str(), ios::binary | ios::trunc);
+    if (!pack) {
+        throw Exception("Error -- Failed to create asset pack: " + tempPath);
+    }
+
+    // Leave room for the header and index, which are written once the data
+    // offsets and hashes are known.
+    uint64_t offset = header.namesOffset + header.namesSize;
+    vector<char> zeros(ALIGNMENT, 0);
+    pack.write(zeros.data(), streamsize(sizeof(Header)));
+    for (size_t idx = 0; idx < index.size(); ++idx) {
+        pack.write((const char *) &index[idx], sizeof(Entry));
+    }
+    pack.write(nameTable.data(), streamsize(nameTable.size()));
+
+    for (size_t idx = 0; idx < order.size(); ++idx) {
+        const string & filePath = filePaths[order[idx]];
+        ifstream file(filePath.c_str(), ios::binary);
+        if (!file) {
+            pack.close();
+            remove(tempPath.c_str());
+            throw Exception("Error -- Failed to open file: " + filePath);
+        }
+        vector<uint8_t> contents((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+
+        uint64_t aligned = alignUp(offset);
+        pack.write(zeros.data(), streamsize(aligned - offset));
+
+        index[idx].offset = aligned;
+        index[idx].size = contents.size();
+        index[idx].hash = hash(contents.data(), contents.size());
+        pack.write((const char *) contents.data(), streamsize(contents.size()));
+        offset = aligned + contents.size();
+    }
+
+    pack.seekp(0);
+    pack.write((const char *) &header, sizeof(Header));
+    for (size_t idx = 0; idx < index.size(); ++idx) {
+        pack.write((const char *) &index[idx], sizeof(Entry));
+    }
+    pack.close();
+
+    if (!pack || rename(tempPath.c_str(), packPath.c_str()) != 0) {
+        remove(tempPath.c_str());
+        throw Exception("Error -- Failed to write asset pack: " + packPath);
+    }
+}
+
+//------------------------------------------------------------------------------------
+bool AssetPack::mount(const string & packPath, const string & directory) {
+    unmount();
+    if (!mounted.open(packPath)) {
+        return false;
+    }
+
+    mountedDirectory = directory;
+    if (mountedDirectory.empty() || mountedDirectory.back() != '/') {
+        mountedDirectory += '/';
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------------
+void AssetPack::unmount() {
+    mounted.close();
+    mountedDirectory.clear();
+}
+
+//------------------------------------------------------------------------------------
+bool AssetPack::isMounted() {
+    return mounted.isOpen();
+}
+
+//------------------------------------------------------------------------------------
+bool AssetPack::findFile(const string & filePath, Asset & asset) {
+    if (!mounted.isOpen() || filePath.compare(0, mountedDirectory.size(), mountedDirectory) != 0) {
+        return false;
+    }
+    return mounted.find(filePath.c_str() + mountedDirectory.size(), asset);
+}
+
+//------------------------------------------------------------------------------------
+bool AssetPack::readFile(const string & filePath, string & contents) {
+    Asset asset;
+    if (findFile(filePath, asset)) {
+        contents.assign((const char *) asset.data, asset.size);
+        return true;
+    }
+
+    ifstream file(filePath.c_str(), ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    stringstream stream;
+    stream << file.rdbuf();
+    contents = stream.str();
+    return true;
+}
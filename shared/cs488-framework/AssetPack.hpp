@@ -0,0 +1,106 @@
+/*
+ * AssetPack
+ */
+
+#pragma once
+
+#include "MappedFile.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+/*
+ * A read only archive of asset files, mapped into memory in one piece.
+ *
+ * Opening a pack is one open() and one mmap(); pages are read in by the OS
+ * as assets are first touched, and asset data is used where it lies,
+ * without copying.
+ *
+ * The file is a 64 byte header (magic "SPAK", version, asset count, and the
+ * offsets of the index and of the names), an index of 32 byte entries sorted
+ * by name (name offset and length, data offset, size, FNV-1a hash of the
+ * data), the names, then the data of each asset starting on a 64 byte
+ * boundary. Values are little endian.
+ *
+ * A pack can be mounted over a directory, so readFile() serves the files
+ * below that directory from the pack.
+ */
+class AssetPack {
+public:
+    struct Asset {
+        const uint8_t * data;
+        size_t size;
+        uint64_t hash;
+
+        Asset();
+    };
+
+    AssetPack();
+
+    ~AssetPack();
+
+    // Maps a pack. Returns false if it cannot be read or is not a valid pack.
+    bool open(const std::string & packPath);
+
+    void close();
+
+    bool isOpen() const;
+
+    // Finds an asset by its name, its path relative to the packed directory.
+    // The data is valid until the pack is closed.
+    bool find(const char * name, Asset & asset) const;
+
+    size_t getAssetCount() const;
+
+    std::string getAssetName(size_t index) const;
+
+    // True if an asset's data still matches its hash. Reads all of it.
+    static bool verify(const Asset & asset);
+
+    static uint64_t hash(const uint8_t * data, size_t size);
+
+    // Packs the files at 'filePaths' as 'names'. Throws an Exception if a
+    // file cannot be read or the pack cannot be written.
+    static void write(const std::string & packPath, const std::vector<std::string> & names,
+            const std::vector<std::string> & filePaths);
+
+    // Serves the files below 'directory' from a pack. Returns false, and
+    // mounts nothing, if the pack cannot be opened.
+    static bool mount(const std::string & packPath, const std::string & directory);
+
+    static void unmount();
+
+    static bool isMounted();
+
+    // Finds a file in the mounted pack. Returns false if it is not below the
+    // mounted directory or not in the pack.
+    static bool findFile(const std::string & filePath, Asset & asset);
+
+    // Reads a file from the mounted pack, or from disk if the pack does not
+    // have it. Returns false if neither does.
+    static bool readFile(const std::string & filePath, std::string & contents);
+
+
+private:
+    AssetPack(const AssetPack &);
+    AssetPack & operator = (const AssetPack &);
+
+    struct Entry {
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        uint64_t offset;
+        uint64_t size;
+        uint64_t hash;
+    };
+
+    MappedFile file;
+    const uint8_t * data;
+    size_t size;
+
+    const Entry * entries;
+    uint32_t entryCount;
+    const char * names;
+};
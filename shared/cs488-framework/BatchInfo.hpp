@@ -1,18 +1,22 @@
 #pragma once
 
 // Class for encapsulating index offset and number of indices to be rendered
-// for a batch of vertices.  It is assumed that there is a vertex buffer
-// setup so that all batch vertices are contiguous in memory and can be rendered
-// all at once given a start index offset into the vertex buffer, and a number
-// of indices to be rendered.
+// for a batch of vertices.  It is assumed that there is an index buffer setup
+// so that all batch indices are contiguous in memory and can be rendered all
+// at once given a start index offset into the index buffer, a number of
+// indices to be rendered, and the vertex the batch's indices count from, e.g.
+// with glDrawElementsBaseVertex().
 struct BatchInfo {
 
-	// Starting index within an associated vertex buffer denoting the start
-	// of this batch's vertex data.
+	// Starting index within an associated index buffer denoting the start
+	// of this batch's index data.
 	unsigned int startIndex;
 
 	// Number of indices to be rendered for this batch.
 	unsigned int numIndices;
 
-};
+	// Vertex within the associated vertex buffer that this batch's indices
+	// are relative to.
+	unsigned int baseVertex;
 
+};
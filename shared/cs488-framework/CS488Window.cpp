@@ -1,7 +1,17 @@
 #include "CS488Window.hpp"
+#include "cs488-framework/AssetPack.hpp"
 #include "cs488-framework/Exception.hpp"
+#include "cs488-framework/GlCounters.hpp"
+#include "cs488-framework/GlDebug.hpp"
 #include "cs488-framework/OpenGLImport.hpp"
-
+#include "cs488-framework/GpuProfiler.hpp"
+#include "cs488-framework/HeadlessContext.hpp"
+#include "cs488-framework/Profiler.hpp"
+#include "cs488-framework/TraceExporter.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <sstream>
 #include <iostream>
 #include <thread>
@@ -24,6 +34,22 @@ shared_ptr<CS488Window> CS488Window::m_instance = nullptr;
 
 static void printGLInfo();
 
+//----------------------------------------------------------------------------------------
+static InputLog::Event makeEvent (
+		InputLog::EventType type,
+		int a = 0,
+		int b = 0,
+		int c = 0,
+		int d = 0
+) {
+	InputLog::Event event(type);
+	event.values[0] = a;
+	event.values[1] = b;
+	event.values[2] = c;
+	event.values[3] = d;
+	return event;
+}
+
 
 //----------------------------------------------------------------------------------------
 // Constructor
@@ -36,8 +62,20 @@ CS488Window::CS488Window()
    m_framebufferWidth(0),
    m_framebufferHeight(0),
    m_paused(false),
-   m_fullScreen(false)
+   m_fullScreen(false),
+   m_offscreen(false),
+   m_uncapped(false),
+   m_closeRequested(false),
+   m_dispatchingReplay(false),
+   m_replayCursorInside(true),
+   m_replayCursorX(-1.0),
+   m_replayCursorY(-1.0),
+   m_replayWheel(0.0f)
 {
+	for (int idx = 0; idx < 3; ++idx) {
+		m_replayMouseDown[idx] = false;
+		m_replayMousePressed[idx] = false;
+	}
 
 }
 
@@ -71,6 +109,14 @@ void CS488Window::windowResizeCallBack (
 		int width,
 		int height
 ) {
+	InputLog::Event event = makeEvent(InputLog::EVENT_RESIZE, width, height);
+	if (window != nullptr) {
+		glfwGetFramebufferSize(window, &event.values[2], &event.values[3]);
+	}
+	if (getInstance()->filterEvent(event)) {
+		return;
+	}
+
 	getInstance()->CS488Window::windowResizeEvent(width, height);
 	getInstance()->windowResizeEvent(width, height);
 }
@@ -86,6 +132,10 @@ void CS488Window::keyInputCallBack (
 		int action,
 		int mods
 ) {
+	if (getInstance()->filterEvent(makeEvent(InputLog::EVENT_KEY, key, scancode, action, mods))) {
+		return;
+	}
+
 	if(!getInstance()->keyInputEvent(key, action, mods)) {
 		// Send event to parent class for processing.
 		getInstance()->CS488Window::keyInputEvent(key, action, mods);
@@ -101,6 +151,13 @@ void CS488Window::mouseScrollCallBack (
 		double xOffSet,
 		double yOffSet
 ) {
+	InputLog::Event event(InputLog::EVENT_SCROLL);
+	event.x = xOffSet;
+	event.y = yOffSet;
+	if (getInstance()->filterEvent(event)) {
+		return;
+	}
+
 	getInstance()->mouseScrollEvent(xOffSet, yOffSet);
 }
 
@@ -115,6 +172,10 @@ void CS488Window::mouseButtonCallBack (
 		int actions,
 		int mods
 ) {
+	if (getInstance()->filterEvent(makeEvent(InputLog::EVENT_MOUSE_BUTTON, button, actions, mods))) {
+		return;
+	}
+
 	getInstance()->mouseButtonInputEvent(button, actions, mods);
 }
 
@@ -127,6 +188,13 @@ void CS488Window::mouseMoveCallBack (
 		double xPos,
 		double yPos
 ) {
+	InputLog::Event event(InputLog::EVENT_MOUSE_MOVE);
+	event.x = xPos;
+	event.y = yPos;
+	if (getInstance()->filterEvent(event)) {
+		return;
+	}
+
 	getInstance()->mouseMoveEvent(xPos, yPos);
 }
 
@@ -138,6 +206,10 @@ void CS488Window::cursorEnterWindowCallBack (
 		GLFWwindow * window,
 		int entered
 ) {
+	if (getInstance()->filterEvent(makeEvent(InputLog::EVENT_CURSOR_ENTER, entered))) {
+		return;
+	}
+
 	getInstance()->cursorEnterWindowEvent(entered);
 }
 
@@ -169,7 +241,7 @@ bool CS488Window::keyInputEvent (
 
 	if (action == GLFW_PRESS) {
 		if (key == GLFW_KEY_ESCAPE) {
-			glfwSetWindowShouldClose(m_window, GL_TRUE);
+			requestClose();
 			eventHandled = true;
 
 		} else if (key == GLFW_KEY_P) {
@@ -185,9 +257,14 @@ bool CS488Window::keyInputEvent (
 				ImGui::Text("Press P to continue...");
 				ImGui::End();
 				renderImGui(m_framebufferWidth, m_framebufferHeight);
-				glfwSwapBuffers(m_window);
+				swapBuffers();
 			}
 			eventHandled = true;
+
+		} else if (key == GLFW_KEY_F12) {
+			// Capture a trace of the next frames.
+			TraceExporter::start("");
+			eventHandled = true;
 		}
 	}
 
@@ -295,19 +372,32 @@ void CS488Window::launch (
 		const std::string& title, 
 		float fps
 ) {
-	char * slash = strrchr( argv[0], '/' );
-	if( slash == nullptr ) {
-		m_exec_dir = ".";
-	} else {
-		m_exec_dir = string( argv[0], slash );
-	}
+	setExecutablePath( argv[0] );
 
 	if( m_instance == nullptr ) {
         m_instance = shared_ptr<CS488Window>(window);
+		if( !m_instance->parseArguments( argc, argv ) ) {
+			return;
+		}
 		m_instance->run( width, height, title, fps );
 	}
 }
 
+//----------------------------------------------------------------------------------------
+void CS488Window::setExecutablePath (
+		const char *argv0
+) {
+	const char * slash = strrchr( argv0, '/' );
+	if( slash == nullptr ) {
+		m_exec_dir = ".";
+	} else {
+		m_exec_dir = string( argv0, slash );
+	}
+
+	// Assets.pack next to the executable stands in for Assets/.
+	AssetPack::mount( m_exec_dir + "/Assets.pack", m_exec_dir + "/Assets/" );
+}
+
 //----------------------------------------------------------------------------------------
 static void renderImGui (
 		int framebufferWidth,
@@ -319,15 +409,71 @@ static void renderImGui (
 }
 
 //----------------------------------------------------------------------------------------
-void CS488Window::run (
+void CS488Window::requestClose() {
+	m_closeRequested = true;
+	if (m_window != nullptr) {
+		glfwSetWindowShouldClose(m_window, GL_TRUE);
+	}
+}
+
+//----------------------------------------------------------------------------------------
+bool CS488Window::shouldClose() const {
+	return m_closeRequested || (m_window != nullptr && glfwWindowShouldClose(m_window));
+}
+
+//----------------------------------------------------------------------------------------
+/*
+ * Presents the frame.  Without a window, waits for the frame to finish
+ * instead, so frames are timed as if they were presented.
+ */
+void CS488Window::swapBuffers() {
+	if (m_window != nullptr) {
+		glfwSwapBuffers(m_window);
+	} else {
+		glFinish();
+	}
+}
+
+//----------------------------------------------------------------------------------------
+bool CS488Window::parseArguments (
+		int argc,
+		char **argv
+) {
+	for (int idx = 1; idx < argc; ++idx) {
+		if (strcmp(argv[idx], "--record") == 0 && idx + 1 < argc) {
+			m_recordFilePath = argv[++idx];
+		} else if (strcmp(argv[idx], "--replay") == 0 && idx + 1 < argc) {
+			m_replayFilePath = argv[++idx];
+		} else if (strcmp(argv[idx], "--offscreen") == 0) {
+			m_offscreen = true;
+		} else if (strcmp(argv[idx], "--uncapped") == 0) {
+			m_uncapped = true;
+		}
+	}
+
+	if (!m_replayFilePath.empty()) {
+		if (!m_inputLog.load(m_replayFilePath)) {
+			cerr << "Unable to read input log " << m_replayFilePath << endl;
+			return false;
+		}
+		if (!m_recordFilePath.empty()) {
+			cerr << "--record and --replay cannot be used together" << endl;
+			return false;
+		}
+	} else if (m_offscreen) {
+		cerr << "--offscreen needs an input log to --replay" << endl;
+		return false;
+	}
+
+	return true;
+}
+
+//----------------------------------------------------------------------------------------
+void CS488Window::createWindow (
 		int width,
 		int height,
-		const string &windowTitle,
-		float desiredFramesPerSecond
+		const string & windowTitle
 ) {
-	m_windowTitle = windowTitle;
-    m_windowWidth = width;
-    m_windowHeight = height;
 	glfwSetErrorCallback(errorCallback);
 
     if (glfwInit() == GL_FALSE) {
@@ -339,6 +485,7 @@ void CS488Window::run (
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, CS488_GL_DEBUG_LEVEL > 0 ? GL_TRUE : GL_FALSE);
     glfwWindowHint(GLFW_VISIBLE, GL_TRUE);
     glfwWindowHint(GLFW_SAMPLES, 0);
     glfwWindowHint(GLFW_RED_BITS, 8);
@@ -346,11 +493,9 @@ void CS488Window::run (
     glfwWindowHint(GLFW_BLUE_BITS, 8);
     glfwWindowHint(GLFW_ALPHA_BITS, 8);
 
+    // The primary monitor is only used to center the window, so a missing
+    // one is not an error.
     m_monitor = glfwGetPrimaryMonitor();
-    if (m_monitor == NULL) {
-        glfwTerminate();
-        throw Exception("Error retrieving primary m_monitor.");
-    }
 
     m_window = glfwCreateWindow(width, height, windowTitle.c_str(), NULL, NULL);
     if (m_window == NULL) {
@@ -365,14 +510,173 @@ void CS488Window::run (
     centerWindow();
     glfwMakeContextCurrent(m_window);
 	gl3wInit();
+}
+
+//----------------------------------------------------------------------------------------
+/*
+ * Creates a context for replaying without a window.  Its pbuffer is sized
+ * for the largest framebuffer of the replay, and each frame draws into the
+ * corner of it the recorded size covers.
+ */
+void CS488Window::createOffscreenContext() {
+	const InputLog::Header & header = m_inputLog.getHeader();
+	m_windowWidth = header.windowWidth;
+	m_windowHeight = header.windowHeight;
+	m_framebufferWidth = header.framebufferWidth;
+	m_framebufferHeight = header.framebufferHeight;
+
+	int width, height;
+	m_inputLog.getMaxFramebufferSize(width, height);
+
+	m_headlessContext.reset(new HeadlessContext());
+	m_headlessContext->create(std::max(width, 1), std::max(height, 1));
+}
+
+//----------------------------------------------------------------------------------------
+bool CS488Window::filterEvent (
+		const InputLog::Event & event
+) {
+	if (m_inputLog.isReplaying()) {
+		return !m_dispatchingReplay;
+	}
+
+	m_inputLog.record(event);
+	return false;
+}
+
+//----------------------------------------------------------------------------------------
+void CS488Window::dispatchReplayEvent (
+		const InputLog::Event & event
+) {
+	const int * values = event.values;
+	m_dispatchingReplay = true;
+
+	switch (event.type) {
+	case InputLog::EVENT_KEY:
+		keyInputCallBack(m_window, values[0], values[1], values[2], values[3]);
+		break;
+
+	case InputLog::EVENT_MOUSE_BUTTON:
+		if (values[0] >= 0 && values[0] < 3) {
+			m_replayMouseDown[values[0]] = values[1] == GLFW_PRESS;
+			m_replayMousePressed[values[0]] |= values[1] == GLFW_PRESS;
+		}
+		mouseButtonCallBack(m_window, values[0], values[1], values[2]);
+		break;
+
+	case InputLog::EVENT_MOUSE_MOVE:
+		m_replayCursorX = event.x;
+		m_replayCursorY = event.y;
+		mouseMoveCallBack(m_window, event.x, event.y);
+		break;
+
+	case InputLog::EVENT_SCROLL:
+		m_replayWheel += float(event.y);
+		mouseScrollCallBack(m_window, event.x, event.y);
+		break;
+
+	case InputLog::EVENT_RESIZE:
+		// Keep the recorded size, whatever size the window is now.
+		if (m_window != nullptr) {
+			glfwSetWindowSize(m_window, values[0], values[1]);
+		}
+		m_framebufferWidth = values[2];
+		m_framebufferHeight = values[3];
+		windowResizeCallBack(m_window, values[0], values[1]);
+		break;
+
+	case InputLog::EVENT_CURSOR_ENTER:
+		m_replayCursorInside = values[0] != 0;
+		cursorEnterWindowCallBack(m_window, values[0]);
+		break;
+
+	default:
+		break;
+	}
+
+	m_dispatchingReplay = false;
+}
+
+//----------------------------------------------------------------------------------------
+/*
+ * Replaces ImGui_ImplGlfwGL3_NewFrame() during a replay, feeding ImGui the
+ * replayed input and a fixed time step rather than polling GLFW.
+ */
+bool CS488Window::replayFrame() {
+	if (!m_inputLog.nextFrame(m_replayEvents)) {
+		return false;
+	}
+
+	for (const InputLog::Event & event : m_replayEvents) {
+		dispatchReplayEvent(event);
+	}
+
+	ImGuiIO & io = ImGui::GetIO();
+	if (io.Fonts->TexID == 0) {
+		ImGui_ImplGlfwGL3_CreateDeviceObjects();
+	}
+
+	io.DisplaySize = ImVec2(float(m_windowWidth), float(m_windowHeight));
+	io.DisplayFramebufferScale = ImVec2(
+			m_windowWidth > 0 ? float(m_framebufferWidth) / m_windowWidth : 1.0f,
+			m_windowHeight > 0 ? float(m_framebufferHeight) / m_windowHeight : 1.0f);
+	io.DeltaTime = 1.0f / m_inputLog.getHeader().framesPerSecond;
+
+	io.MousePos = m_replayCursorInside ?
+			ImVec2(float(m_replayCursorX), float(m_replayCursorY)) : ImVec2(-1.0f, -1.0f);
+
+	// Presses shorter than a frame still count as held for that frame.
+	for (int idx = 0; idx < 3; ++idx) {
+		io.MouseDown[idx] = m_replayMouseDown[idx] || m_replayMousePressed[idx];
+		m_replayMousePressed[idx] = false;
+	}
+
+	io.MouseWheel = m_replayWheel;
+	m_replayWheel = 0.0f;
+
+	ImGui::NewFrame();
+	return true;
+}
+
+//----------------------------------------------------------------------------------------
+void CS488Window::run (
+		int width,
+		int height,
+		const string &windowTitle,
+		float desiredFramesPerSecond
+) {
+	m_windowTitle = windowTitle;
+    m_windowWidth = width;
+    m_windowHeight = height;
+
+    // A replay starts at the size it was recorded at.
+    bool replaying = m_inputLog.isReplaying();
+    if (replaying) {
+        m_windowWidth = m_inputLog.getHeader().windowWidth;
+        m_windowHeight = m_inputLog.getHeader().windowHeight;
+    }
+
+    if (m_offscreen) {
+        createOffscreenContext();
+    } else {
+        createWindow(m_windowWidth, m_windowHeight, windowTitle);
+        if (replaying) {
+            m_framebufferWidth = m_inputLog.getHeader().framebufferWidth;
+            m_framebufferHeight = m_inputLog.getHeader().framebufferHeight;
+        }
+    }
+	GlCounters::install();
+    GlDebug::init();
     
 #ifdef DEBUG_GL
     printGLInfo();
 #endif
 
-    glfwSetInputMode(m_window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+    if (m_window != nullptr) {
+        glfwSetInputMode(m_window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
 
-    registerGlfwCallBacks();
+        registerGlfwCallBacks();
+    }
 
 	// Setup ImGui binding.  Tell the ImGui subsystem not to
 	// bother setting up its callbacks -- ours will do just fine here.
@@ -381,40 +685,118 @@ void CS488Window::run (
     // Clear error buffer.
     while(glGetError() != GL_NO_ERROR);
 
+    // A replay runs each recorded frame once, at the recorded rate unless
+    // uncapped.
+    typedef chrono::steady_clock Clock;
+    Clock::duration framePeriod = chrono::duration_cast<Clock::duration>(
+            chrono::duration<double>(1.0 / m_inputLog.getHeader().framesPerSecond));
+    Clock::time_point replayStart = Clock::now();
+
     try {
         // Wait until m_monitor refreshes before swapping front and back buffers.
         // To prevent tearing artifacts.
-        glfwSwapInterval(1);
+        if (m_window != nullptr) {
+            glfwSwapInterval(replaying && m_uncapped ? 0 : 1);
+        }
 
 		// Call client-defined startup code.
         init();
 
         // steady_clock::time_point frameStartTime;
 
+        Profiler::setThreadName("Main");
+        GpuProfiler::init();
+        TraceExporter::startFromEnvironment();
+
+        if (!m_recordFilePath.empty()) {
+            InputLog::Header header;
+            header.windowWidth = m_windowWidth;
+            header.windowHeight = m_windowHeight;
+            header.framebufferWidth = m_framebufferWidth;
+            header.framebufferHeight = m_framebufferHeight;
+            header.framesPerSecond = desiredFramesPerSecond;
+            if (!m_inputLog.startRecording(m_recordFilePath, header)) {
+                std::cerr << "Unable to record input to " << m_recordFilePath << endl;
+            }
+        }
+
+        Clock::time_point nextFrameTime = Clock::now();
+        replayStart = nextFrameTime;
+
         // Main Program Loop:
-        while (!glfwWindowShouldClose(m_window)) {
-            glfwPollEvents();
-			ImGui_ImplGlfwGL3_NewFrame();
+        while (!shouldClose()) {
+            PROFILE_FRAME();
+            GPU_PROFILE_FRAME();
+            TraceExporter::update();
+            GlCounters::beginFrame();
+            m_frameStats.beginFrame();
+            m_inputLog.beginFrame();
+
+            {
+                PROFILE_SCOPE("Poll");
+                if (m_window != nullptr) {
+                    glfwPollEvents();
+                }
+                if (!replaying) {
+                    ImGui_ImplGlfwGL3_NewFrame();
+                } else if (!replayFrame()) {
+                    break;
+                }
+            }
+            m_frameStats.endPhase(FrameStats::PHASE_POLL);
 
             if (!m_paused) {
 				// Apply application-specific logic
-	            appLogic();
-
-	            guiLogic();
+                {
+                    PROFILE_SCOPE("appLogic");
+                    appLogic();
+                }
+                m_frameStats.endPhase(FrameStats::PHASE_APP_LOGIC);
+
+                {
+                    PROFILE_SCOPE("guiLogic");
+                    guiLogic();
+                }
+                m_frameStats.endPhase(FrameStats::PHASE_GUI_LOGIC);
 
 				// Ask the derived class to do the actual OpenGL drawing.
-                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-                draw();
+                {
+                    PROFILE_SCOPE("draw");
+                    GPU_PROFILE_SCOPE("draw");
+                    GL_DEBUG_SCOPE("draw");
+                    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                    draw();
+                }
+                m_frameStats.endPhase(FrameStats::PHASE_DRAW);
 
 	            // In case of a window resize, get new framebuffer dimensions.
-	            glfwGetFramebufferSize(m_window, &m_framebufferWidth,
-			            &m_framebufferHeight);
+	            // A replay keeps the recorded dimensions.
+	            if (!replaying) {
+	                glfwGetFramebufferSize(m_window, &m_framebufferWidth,
+			                &m_framebufferHeight);
+	            }
 
 	            // Draw any UI controls specified in guiLogic() by derived class.
-	            renderImGui(m_framebufferWidth, m_framebufferHeight);
+                {
+                    PROFILE_SCOPE("ImGui render");
+                    GPU_PROFILE_SCOPE("ImGui");
+                    GL_DEBUG_SCOPE("ImGui");
+                    renderImGui(m_framebufferWidth, m_framebufferHeight);
+                }
+                m_frameStats.endPhase(FrameStats::PHASE_IMGUI);
 
 				// Finally, blast everything to the screen.
-                glfwSwapBuffers(m_window);
+                {
+                    PROFILE_SCOPE("Swap");
+                    swapBuffers();
+                }
+                m_frameStats.endPhase(FrameStats::PHASE_SWAP);
+                m_frameStats.endFrame();
+            }
+
+            if (replaying && !m_uncapped) {
+                nextFrameTime += framePeriod;
+                this_thread::sleep_until(nextFrameTime);
             }
 
         }
@@ -426,8 +808,34 @@ void CS488Window::run (
         std::cerr << "Uncaught exception thrown!  Terminating Program." << endl;
     }
 
+    if (replaying) {
+        double seconds = chrono::duration<double>(Clock::now() - replayStart).count();
+        cout << "Replayed " << m_inputLog.getFrame() << " of " << m_inputLog.getFrameCount()
+             << " frames in " << seconds << " s (" << m_inputLog.getFrame() / seconds << " fps)" << endl;
+    }
+    if (!m_inputLog.stopRecording()) {
+        std::cerr << "Unable to write input log " << m_recordFilePath << endl;
+    }
+
     cleanup();
-    glfwDestroyWindow(m_window);
+    TraceExporter::shutdown();
+
+    // Summarise the session so long runs can be checked for regressions.
+    const char * statsFile = getenv("CS488_FRAME_STATS_FILE");
+    if (statsFile == nullptr) {
+        statsFile = "frame-stats.json";
+    }
+    if (m_frameStats.getHistogram(FrameStats::PHASE_FRAME).count() > 0 &&
+            !m_frameStats.writeSummary(statsFile)) {
+        std::cerr << "Unable to write frame statistics to " << statsFile << endl;
+    }
+
+    GpuProfiler::destroy();
+    GlDebug::shutdown();
+    if (m_window != nullptr) {
+        glfwDestroyWindow(m_window);
+    }
+    m_headlessContext.reset();
 }
 
 
@@ -4,8 +4,14 @@
 #define GLFW_INCLUDE_GLCOREARB
 #include <GLFW/glfw3.h>
 
+#include "cs488-framework/FrameStats.hpp"
+#include "cs488-framework/InputLog.hpp"
+
 #include <string>
 #include <memory>
+#include <vector>
+
+class HeadlessContext;
 
 /*
  * Singleton base class for creating a GLFW window and OpenGL context.
@@ -15,6 +21,12 @@ class CS488Window {
 public:
     virtual ~CS488Window();
 
+	// Besides the window, launch() takes these options from the command line:
+	//   --record <file>  records the input of the session to a log
+	//   --replay <file>  replays a log, one recorded frame per frame
+	//   --offscreen      replays without a window, on an EGL pbuffer
+	//   --uncapped       replays as fast as possible instead of at the
+	//                    recorded frame rate
 	static void launch (
 			int argc,
 			char **argv,
@@ -25,11 +37,16 @@ public:
 			float fps = 60.0f
 	);
 
-protected:
-    CS488Window(); // Prevent direct construction.
+	// Sets the directory assets are loaded from, relative to the executable
+	// path given in argv[0], and mounts Assets.pack from there if it exists.
+	// Called by launch().
+	static void setExecutablePath(const char *argv0);
 
 	static std::string getAssetFilePath(const char *base);
 
+protected:
+    CS488Window(); // Prevent direct construction.
+
     // Virtual methods.
     // Override these within derived classes.
     virtual void init();
@@ -47,6 +64,10 @@ protected:
     virtual bool windowResizeEvent(int width, int height);
     virtual bool keyInputEvent(int key, int action, int mods);
 
+	// Ends the main loop after this frame. Use in place of
+	// glfwSetWindowShouldClose(), as a replay may run without a window.
+	void requestClose();
+
 	GLFWwindow * m_window;
 	std::string m_windowTitle;
 	int m_windowWidth;
@@ -56,6 +77,12 @@ protected:
 	bool m_paused;
 	bool m_fullScreen;
 
+	// Frame and phase time percentiles, written to a summary file on exit.
+	FrameStats m_frameStats;
+
+	// Input of the session being recorded or replayed.
+	InputLog m_inputLog;
+
 private:
 	static std::shared_ptr<CS488Window> m_instance;
 
@@ -63,6 +90,27 @@ private:
     
     GLFWmonitor * m_monitor;
 
+	// Set from the command line by launch().
+	std::string m_recordFilePath;
+	std::string m_replayFilePath;
+	bool m_offscreen;
+	bool m_uncapped;
+
+	bool m_closeRequested;
+
+	// Context of an offscreen replay, used instead of m_window.
+	std::unique_ptr<HeadlessContext> m_headlessContext;
+
+	// Input state of a replay, which ImGui would otherwise poll from GLFW.
+	std::vector<InputLog::Event> m_replayEvents;
+	bool m_dispatchingReplay;
+	bool m_replayCursorInside;
+	double m_replayCursorX;
+	double m_replayCursorY;
+	bool m_replayMouseDown[3];
+	bool m_replayMousePressed[3];
+	float m_replayWheel;
+
 	static std::shared_ptr<CS488Window> getInstance();
 
 	void run (
@@ -83,5 +131,22 @@ private:
 
 	void registerGlfwCallBacks();
 
+	bool parseArguments(int argc, char **argv);
+
+	void createWindow(int width, int height, const std::string & windowTitle);
+	void createOffscreenContext();
+
+	bool shouldClose() const;
+	void swapBuffers();
+
+	// Records an event from GLFW. Returns true if it should be ignored
+	// because a replay is driving the window.
+	bool filterEvent(const InputLog::Event & event);
+
+	// Delivers the next frame's events and starts the ImGui frame. Returns
+	// false once the replay has ended.
+	bool replayFrame();
+	void dispatchReplayEvent(const InputLog::Event & event);
+
 	void centerWindow();
 };
@@ -0,0 +1,103 @@
+#include "FileWatcher.hpp"
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+//------------------------------------------------------------------------------------
+FileWatcher::FileWatcher()
+    : fd(-1)
+{
+
+}
+
+//------------------------------------------------------------------------------------
+FileWatcher::~FileWatcher() {
+    close();
+}
+
+//------------------------------------------------------------------------------------
+bool FileWatcher::watch(const string & directory) {
+#ifdef __linux__
+    if (fd < 0) {
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+    }
+
+    int handle = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (handle < 0) {
+        return false;
+    }
+
+    Directory watched;
+    watched.handle = handle;
+    watched.path = directory;
+    directories.push_back(watched);
+    return true;
+#else
+    return false;
+#endif
+}
+
+//------------------------------------------------------------------------------------
+bool FileWatcher::isWatching() const {
+    return !directories.empty();
+}
+
+//------------------------------------------------------------------------------------
+void FileWatcher::poll(vector<string> & changedPaths) {
+    changedPaths.clear();
+
+#ifdef __linux__
+    if (fd < 0) {
+        return;
+    }
+
+    // Events are variable length, so read into a buffer aligned for them.
+    alignas(inotify_event) char buffer[4096];
+    for (;;) {
+        ssize_t length = read(fd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;
+        }
+
+        for (char * next = buffer; next < buffer + length; ) {
+            const inotify_event * event = reinterpret_cast<const inotify_event *>(next);
+            next += sizeof(inotify_event) + event->len;
+
+            if (event->len == 0 || (event->mask & IN_ISDIR) != 0) {
+                continue;
+            }
+
+            for (const Directory & directory : directories) {
+                if (directory.handle != event->wd) {
+                    continue;
+                }
+
+                string path = directory.path + "/" + event->name;
+                if (find(changedPaths.begin(), changedPaths.end(), path) == changedPaths.end()) {
+                    changedPaths.push_back(path);
+                }
+            }
+        }
+    }
+#endif
+}
+
+//------------------------------------------------------------------------------------
+void FileWatcher::close() {
+#ifdef __linux__
+    if (fd >= 0) {
+        ::close(fd);
+    }
+#endif
+    fd = -1;
+    directories.clear();
+}
@@ -0,0 +1,52 @@
+/*
+ * FileWatcher
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+
+/*
+ * Reports files written in a set of directories, without blocking.
+ *
+ * On Linux this uses inotify, so polling costs one read() of a non-blocking
+ * descriptor and nothing when no file has changed. Files count as changed
+ * once they are closed after writing or renamed into a watched directory,
+ * which covers editors that save in place and ones that replace the file.
+ * Other platforms watch nothing.
+ */
+class FileWatcher {
+public:
+    FileWatcher();
+
+    ~FileWatcher();
+
+    // Watches the files directly inside a directory. Returns false if it
+    // cannot be watched.
+    bool watch(const std::string & directory);
+
+    bool isWatching() const;
+
+    // Gets the paths written since the last poll, each listed once, as the
+    // watched directory joined with the file name.
+    void poll(std::vector<std::string> & changedPaths);
+
+    // Stops watching every directory.
+    void close();
+
+
+private:
+    FileWatcher(const FileWatcher &);
+    FileWatcher & operator = (const FileWatcher &);
+
+    int fd;
+
+    struct Directory {
+        int handle;
+        std::string path;
+    };
+
+    std::vector<Directory> directories;
+};
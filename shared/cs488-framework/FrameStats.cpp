@@ -0,0 +1,127 @@
+#include "FrameStats.hpp"
+
+#include <imgui/imgui.h>
+
+#include <cstdio>
+
+using namespace std;
+
+namespace {
+
+// Longest time tracked at full precision, one minute in microseconds.
+const uint64_t HIGHEST_TRACKABLE_US = 60 * 1000 * 1000;
+
+// Percentiles reported in the table and the summary.
+const int NUM_PERCENTILES = 4;
+const double PERCENTILES[NUM_PERCENTILES] = { 50.0, 90.0, 99.0, 99.9 };
+const char * const PERCENTILE_NAMES[NUM_PERCENTILES] = { "p50", "p90", "p99", "p99.9" };
+
+const char * const PHASE_NAMES[FrameStats::NUM_PHASES] = {
+    "poll", "appLogic", "guiLogic", "draw", "imgui", "swap", "frame"
+};
+
+double toMilliseconds(uint64_t microseconds) {
+    return double(microseconds) * 1.0e-3;
+}
+
+}
+
+//------------------------------------------------------------------------------------
+FrameStats::FrameStats()
+    : histograms(NUM_PHASES, HdrHistogram(HIGHEST_TRACKABLE_US)),
+      frameComplete(false)
+{
+
+}
+
+//------------------------------------------------------------------------------------
+void FrameStats::beginFrame() {
+    Clock::time_point now = Clock::now();
+
+    if (frameComplete) {
+        histograms[PHASE_FRAME].record(uint64_t(
+                chrono::duration_cast<chrono::microseconds>(now - frameStart).count()));
+    }
+
+    frameStart = now;
+    phaseStart = now;
+    frameComplete = false;
+}
+
+//------------------------------------------------------------------------------------
+void FrameStats::endPhase(Phase phase) {
+    Clock::time_point now = Clock::now();
+    histograms[phase].record(uint64_t(
+            chrono::duration_cast<chrono::microseconds>(now - phaseStart).count()));
+    phaseStart = now;
+}
+
+//------------------------------------------------------------------------------------
+void FrameStats::endFrame() {
+    frameComplete = true;
+}
+
+//------------------------------------------------------------------------------------
+void FrameStats::reset() {
+    for (HdrHistogram & histogram : histograms) {
+        histogram.reset();
+    }
+    frameComplete = false;
+}
+
+//------------------------------------------------------------------------------------
+const HdrHistogram & FrameStats::getHistogram(Phase phase) const {
+    return histograms[phase];
+}
+
+//------------------------------------------------------------------------------------
+const char * FrameStats::getPhaseName(Phase phase) {
+    return PHASE_NAMES[phase];
+}
+
+//------------------------------------------------------------------------------------
+void FrameStats::drawTable() const {
+    ImGui::Text("%-9s %8s %8s %8s %8s %8s", "ms", "p50", "p90", "p99", "p99.9", "max");
+
+    for (int phase = NUM_PHASES - 1; phase >= 0; --phase) {
+        const HdrHistogram & histogram = histograms[phase];
+        uint64_t values[NUM_PERCENTILES];
+        histogram.valuesAtPercentiles(PERCENTILES, NUM_PERCENTILES, values);
+
+        ImGui::Text("%-9s %8.2f %8.2f %8.2f %8.2f %8.2f", PHASE_NAMES[phase],
+                toMilliseconds(values[0]), toMilliseconds(values[1]),
+                toMilliseconds(values[2]), toMilliseconds(values[3]),
+                toMilliseconds(histogram.max()));
+    }
+
+    ImGui::Text("%llu frames", (unsigned long long) histograms[PHASE_FRAME].count());
+}
+
+//------------------------------------------------------------------------------------
+bool FrameStats::writeSummary(const char * filePath) const {
+    FILE * file = fopen(filePath, "w");
+    if (file == nullptr) {
+        return false;
+    }
+
+    fprintf(file, "{\n  \"unit\": \"ms\",\n  \"phases\": {");
+
+    for (int phase = 0; phase < NUM_PHASES; ++phase) {
+        const HdrHistogram & histogram = histograms[phase];
+        uint64_t values[NUM_PERCENTILES];
+        histogram.valuesAtPercentiles(PERCENTILES, NUM_PERCENTILES, values);
+
+        fprintf(file, "%s\n    \"%s\": { \"count\": %llu, \"mean\": %.3f",
+                phase == 0 ? "" : ",", PHASE_NAMES[phase],
+                (unsigned long long) histogram.count(), histogram.mean() * 1.0e-3);
+        for (int idx = 0; idx < NUM_PERCENTILES; ++idx) {
+            fprintf(file, ", \"%s\": %.3f", PERCENTILE_NAMES[idx], toMilliseconds(values[idx]));
+        }
+        fprintf(file, ", \"max\": %.3f }", toMilliseconds(histogram.max()));
+    }
+
+    fprintf(file, "\n  }\n}\n");
+
+    bool ok = !ferror(file);
+    return fclose(file) == 0 && ok;
+}
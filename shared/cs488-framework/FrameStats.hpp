@@ -0,0 +1,68 @@
+/*
+ * FrameStats
+ */
+
+#pragma once
+
+#include "HdrHistogram.hpp"
+
+#include <chrono>
+#include <vector>
+
+
+/*
+ * Distribution of frame times and of the time spent in each phase of a
+ * frame, kept in HDR histograms at microsecond resolution so stutters show
+ * up in the high percentiles rather than being averaged away.
+ *
+ * CS488Window calls beginFrame() at the top of each frame, endPhase() after
+ * each phase and endFrame() once the frame has been swapped. The frame time
+ * is the interval between the starts of consecutive complete frames, so it
+ * includes waiting on vsync; frames that do not complete, such as while
+ * paused, are not counted.
+ */
+class FrameStats {
+public:
+    enum Phase {
+        PHASE_POLL,
+        PHASE_APP_LOGIC,
+        PHASE_GUI_LOGIC,
+        PHASE_DRAW,
+        PHASE_IMGUI,
+        PHASE_SWAP,
+        PHASE_FRAME,
+        NUM_PHASES
+    };
+
+    FrameStats();
+
+    void beginFrame();
+
+    // Records the time since the previous phase ended, or the frame began.
+    void endPhase(Phase phase);
+
+    void endFrame();
+
+    void reset();
+
+    const HdrHistogram & getHistogram(Phase phase) const;
+
+    static const char * getPhaseName(Phase phase);
+
+    // Draws a table of percentiles into the current ImGui window.
+    void drawTable() const;
+
+    // Writes the count, mean, p50, p90, p99, p99.9 and max of each phase
+    // in milliseconds as JSON. Returns false if the file cannot be written.
+    bool writeSummary(const char * filePath) const;
+
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    std::vector<HdrHistogram> histograms;
+
+    Clock::time_point frameStart;
+    Clock::time_point phaseStart;
+    bool frameComplete;
+};
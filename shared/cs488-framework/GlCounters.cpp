@@ -0,0 +1,692 @@
+#include "GlCounters.hpp"
+#include "Profiler.hpp"
+
+#include <imgui/imgui.h>
+
+#include <map>
+
+using namespace std;
+
+namespace {
+
+bool installed = false;
+
+GlCounters::Frame current;
+GlCounters::Frame lastFrame;
+
+/*
+ * A live buffer, texture or renderbuffer. Textures hold a size per mip level.
+ */
+struct Resource {
+    GLenum type;
+    uint64_t levels[16];
+    string label;
+
+    Resource() : type(0) {
+        for (uint64_t & bytes : levels) {
+            bytes = 0;
+        }
+    }
+
+    uint64_t bytes() const {
+        uint64_t total = 0;
+        for (uint64_t size : levels) {
+            total += size;
+        }
+        return total;
+    }
+};
+
+map<uint64_t, Resource> resources;
+
+uint64_t resourceKey(GLenum type, GLuint name) {
+    return (uint64_t(type) << 32) | name;
+}
+
+Resource & getResource(GLenum type, GLuint name) {
+    Resource & resource = resources[resourceKey(type, name)];
+    resource.type = type;
+    return resource;
+}
+
+void releaseResources(GLenum type, GLsizei count, const GLuint * names) {
+    for (GLsizei idx = 0; idx < count; ++idx) {
+        resources.erase(resourceKey(type, names[idx]));
+    }
+}
+
+void countDraw(GLenum mode, GLsizei count, GLsizei instances) {
+    uint64_t vertices = uint64_t(count) * uint64_t(instances);
+
+    ++current.drawCalls;
+    switch (mode) {
+    case GL_TRIANGLES:
+        current.triangles += vertices / 3;
+        break;
+    case GL_TRIANGLE_STRIP:
+    case GL_TRIANGLE_FAN:
+        current.triangles += count > 2 ? uint64_t(count - 2) * instances : 0;
+        break;
+    case GL_LINES:
+        current.lines += vertices / 2;
+        break;
+    case GL_LINE_STRIP:
+        current.lines += count > 1 ? uint64_t(count - 1) * instances : 0;
+        break;
+    case GL_LINE_LOOP:
+        current.lines += vertices;
+        break;
+    default:
+        break;
+    }
+}
+
+// Bytes per pixel of client pixel data.
+uint64_t pixelBytes(GLenum format, GLenum type) {
+    switch (type) {
+    case GL_UNSIGNED_INT_24_8:
+    case GL_UNSIGNED_INT_8_8_8_8:
+    case GL_UNSIGNED_INT_8_8_8_8_REV:
+    case GL_UNSIGNED_INT_2_10_10_10_REV:
+        return 4;
+    case GL_UNSIGNED_SHORT_5_6_5:
+    case GL_UNSIGNED_SHORT_4_4_4_4:
+    case GL_UNSIGNED_SHORT_5_5_5_1:
+        return 2;
+    default:
+        break;
+    }
+
+    uint64_t components = 4;
+    switch (format) {
+    case GL_RED:
+    case GL_DEPTH_COMPONENT:
+    case GL_STENCIL_INDEX:
+        components = 1;
+        break;
+    case GL_RG:
+    case GL_DEPTH_STENCIL:
+        components = 2;
+        break;
+    case GL_RGB:
+    case GL_BGR:
+        components = 3;
+        break;
+    default:
+        break;
+    }
+
+    uint64_t size = 1;
+    switch (type) {
+    case GL_SHORT:
+    case GL_UNSIGNED_SHORT:
+    case GL_HALF_FLOAT:
+        size = 2;
+        break;
+    case GL_INT:
+    case GL_UNSIGNED_INT:
+    case GL_FLOAT:
+        size = 4;
+        break;
+    default:
+        break;
+    }
+
+    return components * size;
+}
+
+// Approximate bytes per pixel the GPU stores for an internal format.
+uint64_t internalFormatBytes(GLenum internalFormat) {
+    switch (internalFormat) {
+    case GL_R8:
+    case GL_RED:
+    case GL_STENCIL_INDEX8:
+        return 1;
+    case GL_RG8:
+    case GL_RG:
+    case GL_R16F:
+    case GL_DEPTH_COMPONENT16:
+        return 2;
+    case GL_RGBA16F:
+    case GL_RG32F:
+        return 8;
+    case GL_RGBA32F:
+        return 16;
+    case GL_RGB32F:
+        return 12;
+    default:
+        // RGB8 is padded to four bytes by most drivers, as are depth formats.
+        return 4;
+    }
+}
+
+#ifdef __linux__
+
+// The real entry points, saved when they are hooked.
+#define REAL(function) real_##function
+#define DECLARE_REAL(function, type) type REAL(function) = nullptr
+
+DECLARE_REAL(DrawArrays, PFNGLDRAWARRAYSPROC);
+DECLARE_REAL(DrawElements, PFNGLDRAWELEMENTSPROC);
+DECLARE_REAL(DrawArraysInstanced, PFNGLDRAWARRAYSINSTANCEDPROC);
+DECLARE_REAL(DrawElementsInstanced, PFNGLDRAWELEMENTSINSTANCEDPROC);
+DECLARE_REAL(DrawElementsBaseVertex, PFNGLDRAWELEMENTSBASEVERTEXPROC);
+DECLARE_REAL(DrawRangeElements, PFNGLDRAWRANGEELEMENTSPROC);
+DECLARE_REAL(Enable, PFNGLENABLEPROC);
+DECLARE_REAL(Disable, PFNGLDISABLEPROC);
+DECLARE_REAL(UseProgram, PFNGLUSEPROGRAMPROC);
+DECLARE_REAL(BindVertexArray, PFNGLBINDVERTEXARRAYPROC);
+DECLARE_REAL(BindBuffer, PFNGLBINDBUFFERPROC);
+DECLARE_REAL(BindTexture, PFNGLBINDTEXTUREPROC);
+DECLARE_REAL(ActiveTexture, PFNGLACTIVETEXTUREPROC);
+DECLARE_REAL(BindFramebuffer, PFNGLBINDFRAMEBUFFERPROC);
+DECLARE_REAL(BindRenderbuffer, PFNGLBINDRENDERBUFFERPROC);
+DECLARE_REAL(PolygonMode, PFNGLPOLYGONMODEPROC);
+DECLARE_REAL(BlendFunc, PFNGLBLENDFUNCPROC);
+DECLARE_REAL(BlendEquation, PFNGLBLENDEQUATIONPROC);
+DECLARE_REAL(DepthFunc, PFNGLDEPTHFUNCPROC);
+DECLARE_REAL(DepthMask, PFNGLDEPTHMASKPROC);
+DECLARE_REAL(CullFace, PFNGLCULLFACEPROC);
+DECLARE_REAL(Viewport, PFNGLVIEWPORTPROC);
+DECLARE_REAL(Scissor, PFNGLSCISSORPROC);
+DECLARE_REAL(Uniform1i, PFNGLUNIFORM1IPROC);
+DECLARE_REAL(Uniform1f, PFNGLUNIFORM1FPROC);
+DECLARE_REAL(Uniform3f, PFNGLUNIFORM3FPROC);
+DECLARE_REAL(Uniform4f, PFNGLUNIFORM4FPROC);
+DECLARE_REAL(Uniform3fv, PFNGLUNIFORM3FVPROC);
+DECLARE_REAL(Uniform4fv, PFNGLUNIFORM4FVPROC);
+DECLARE_REAL(UniformMatrix3fv, PFNGLUNIFORMMATRIX3FVPROC);
+DECLARE_REAL(UniformMatrix4fv, PFNGLUNIFORMMATRIX4FVPROC);
+DECLARE_REAL(BufferData, PFNGLBUFFERDATAPROC);
+DECLARE_REAL(BufferSubData, PFNGLBUFFERSUBDATAPROC);
+DECLARE_REAL(DeleteBuffers, PFNGLDELETEBUFFERSPROC);
+DECLARE_REAL(TexImage2D, PFNGLTEXIMAGE2DPROC);
+DECLARE_REAL(TexSubImage2D, PFNGLTEXSUBIMAGE2DPROC);
+DECLARE_REAL(DeleteTextures, PFNGLDELETETEXTURESPROC);
+DECLARE_REAL(RenderbufferStorage, PFNGLRENDERBUFFERSTORAGEPROC);
+DECLARE_REAL(RenderbufferStorageMultisample, PFNGLRENDERBUFFERSTORAGEMULTISAMPLEPROC);
+DECLARE_REAL(DeleteRenderbuffers, PFNGLDELETERENDERBUFFERSPROC);
+DECLARE_REAL(ObjectLabel, PFNGLOBJECTLABELPROC);
+DECLARE_REAL(GetError, PFNGLGETERRORPROC);
+DECLARE_REAL(GetIntegerv, PFNGLGETINTEGERVPROC);
+DECLARE_REAL(GetInteger64v, PFNGLGETINTEGER64VPROC);
+DECLARE_REAL(GetFloatv, PFNGLGETFLOATVPROC);
+DECLARE_REAL(GetBooleanv, PFNGLGETBOOLEANVPROC);
+DECLARE_REAL(GetString, PFNGLGETSTRINGPROC);
+DECLARE_REAL(GetUniformLocation, PFNGLGETUNIFORMLOCATIONPROC);
+DECLARE_REAL(GetAttribLocation, PFNGLGETATTRIBLOCATIONPROC);
+DECLARE_REAL(GetShaderiv, PFNGLGETSHADERIVPROC);
+DECLARE_REAL(GetProgramiv, PFNGLGETPROGRAMIVPROC);
+DECLARE_REAL(GetQueryObjectiv, PFNGLGETQUERYOBJECTIVPROC);
+DECLARE_REAL(GetQueryObjectui64v, PFNGLGETQUERYOBJECTUI64VPROC);
+
+// Gets the buffer bound to a target without counting the query.
+GLuint boundBuffer(GLenum target) {
+    GLenum binding = 0;
+    switch (target) {
+    case GL_ARRAY_BUFFER: binding = GL_ARRAY_BUFFER_BINDING; break;
+    case GL_ELEMENT_ARRAY_BUFFER: binding = GL_ELEMENT_ARRAY_BUFFER_BINDING; break;
+    case GL_UNIFORM_BUFFER: binding = GL_UNIFORM_BUFFER_BINDING; break;
+    case GL_PIXEL_PACK_BUFFER: binding = GL_PIXEL_PACK_BUFFER_BINDING; break;
+    case GL_PIXEL_UNPACK_BUFFER: binding = GL_PIXEL_UNPACK_BUFFER_BINDING; break;
+    case GL_COPY_READ_BUFFER: binding = GL_COPY_READ_BUFFER_BINDING; break;
+    case GL_COPY_WRITE_BUFFER: binding = GL_COPY_WRITE_BUFFER_BINDING; break;
+    case GL_TEXTURE_BUFFER: binding = GL_TEXTURE_BINDING_BUFFER; break;
+    default: return 0;
+    }
+
+    GLint name = 0;
+    REAL(GetIntegerv)(binding, &name);
+    return GLuint(name);
+}
+
+GLuint boundTexture2D() {
+    GLint name = 0;
+    REAL(GetIntegerv)(GL_TEXTURE_BINDING_2D, &name);
+    return GLuint(name);
+}
+
+GLuint boundRenderbuffer() {
+    GLint name = 0;
+    REAL(GetIntegerv)(GL_RENDERBUFFER_BINDING, &name);
+    return GLuint(name);
+}
+
+//-- Draws
+void APIENTRY hookDrawArrays(GLenum mode, GLint first, GLsizei count) {
+    countDraw(mode, count, 1);
+    REAL(DrawArrays)(mode, first, count);
+}
+
+void APIENTRY hookDrawElements(GLenum mode, GLsizei count, GLenum type, const void * indices) {
+    countDraw(mode, count, 1);
+    REAL(DrawElements)(mode, count, type, indices);
+}
+
+void APIENTRY hookDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instances) {
+    countDraw(mode, count, instances);
+    REAL(DrawArraysInstanced)(mode, first, count, instances);
+}
+
+void APIENTRY hookDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void * indices, GLsizei instances) {
+    countDraw(mode, count, instances);
+    REAL(DrawElementsInstanced)(mode, count, type, indices, instances);
+}
+
+void APIENTRY hookDrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type, const void * indices, GLint baseVertex) {
+    countDraw(mode, count, 1);
+    REAL(DrawElementsBaseVertex)(mode, count, type, indices, baseVertex);
+}
+
+void APIENTRY hookDrawRangeElements(GLenum mode, GLuint start, GLuint end, GLsizei count, GLenum type, const void * indices) {
+    countDraw(mode, count, 1);
+    REAL(DrawRangeElements)(mode, start, end, count, type, indices);
+}
+
+//-- State changes
+void APIENTRY hookEnable(GLenum cap) { ++current.stateChanges; REAL(Enable)(cap); }
+void APIENTRY hookDisable(GLenum cap) { ++current.stateChanges; REAL(Disable)(cap); }
+void APIENTRY hookUseProgram(GLuint program) { ++current.stateChanges; REAL(UseProgram)(program); }
+void APIENTRY hookBindVertexArray(GLuint array) { ++current.stateChanges; REAL(BindVertexArray)(array); }
+void APIENTRY hookBindBuffer(GLenum target, GLuint buffer) { ++current.stateChanges; REAL(BindBuffer)(target, buffer); }
+void APIENTRY hookBindTexture(GLenum target, GLuint texture) { ++current.stateChanges; REAL(BindTexture)(target, texture); }
+void APIENTRY hookActiveTexture(GLenum texture) { ++current.stateChanges; REAL(ActiveTexture)(texture); }
+void APIENTRY hookBindFramebuffer(GLenum target, GLuint framebuffer) { ++current.stateChanges; REAL(BindFramebuffer)(target, framebuffer); }
+void APIENTRY hookBindRenderbuffer(GLenum target, GLuint renderbuffer) { ++current.stateChanges; REAL(BindRenderbuffer)(target, renderbuffer); }
+void APIENTRY hookPolygonMode(GLenum face, GLenum mode) { ++current.stateChanges; REAL(PolygonMode)(face, mode); }
+void APIENTRY hookBlendFunc(GLenum source, GLenum destination) { ++current.stateChanges; REAL(BlendFunc)(source, destination); }
+void APIENTRY hookBlendEquation(GLenum mode) { ++current.stateChanges; REAL(BlendEquation)(mode); }
+void APIENTRY hookDepthFunc(GLenum func) { ++current.stateChanges; REAL(DepthFunc)(func); }
+void APIENTRY hookDepthMask(GLboolean flag) { ++current.stateChanges; REAL(DepthMask)(flag); }
+void APIENTRY hookCullFace(GLenum mode) { ++current.stateChanges; REAL(CullFace)(mode); }
+void APIENTRY hookViewport(GLint x, GLint y, GLsizei width, GLsizei height) { ++current.stateChanges; REAL(Viewport)(x, y, width, height); }
+void APIENTRY hookScissor(GLint x, GLint y, GLsizei width, GLsizei height) { ++current.stateChanges; REAL(Scissor)(x, y, width, height); }
+
+//-- Uniforms
+void countUniform(uint64_t bytes) {
+    ++current.uniformUpdates;
+    current.uniformBytes += bytes;
+}
+
+void APIENTRY hookUniform1i(GLint location, GLint v0) {
+    countUniform(sizeof(GLint));
+    REAL(Uniform1i)(location, v0);
+}
+
+void APIENTRY hookUniform1f(GLint location, GLfloat v0) {
+    countUniform(sizeof(GLfloat));
+    REAL(Uniform1f)(location, v0);
+}
+
+void APIENTRY hookUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2) {
+    countUniform(3 * sizeof(GLfloat));
+    REAL(Uniform3f)(location, v0, v1, v2);
+}
+
+void APIENTRY hookUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) {
+    countUniform(4 * sizeof(GLfloat));
+    REAL(Uniform4f)(location, v0, v1, v2, v3);
+}
+
+void APIENTRY hookUniform3fv(GLint location, GLsizei count, const GLfloat * value) {
+    countUniform(uint64_t(count) * 3 * sizeof(GLfloat));
+    REAL(Uniform3fv)(location, count, value);
+}
+
+void APIENTRY hookUniform4fv(GLint location, GLsizei count, const GLfloat * value) {
+    countUniform(uint64_t(count) * 4 * sizeof(GLfloat));
+    REAL(Uniform4fv)(location, count, value);
+}
+
+void APIENTRY hookUniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat * value) {
+    countUniform(uint64_t(count) * 9 * sizeof(GLfloat));
+    REAL(UniformMatrix3fv)(location, count, transpose, value);
+}
+
+void APIENTRY hookUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat * value) {
+    countUniform(uint64_t(count) * 16 * sizeof(GLfloat));
+    REAL(UniformMatrix4fv)(location, count, transpose, value);
+}
+
+//-- Buffers
+void APIENTRY hookBufferData(GLenum target, GLsizeiptr size, const void * data, GLenum usage) {
+    ++current.bufferUploads;
+    current.bufferUploadBytes += data != nullptr ? uint64_t(size) : 0;
+
+    GLuint buffer = boundBuffer(target);
+    if (buffer != 0) {
+        getResource(GL_BUFFER, buffer).levels[0] = uint64_t(size);
+    }
+
+    REAL(BufferData)(target, size, data, usage);
+}
+
+void APIENTRY hookBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void * data) {
+    ++current.bufferUploads;
+    current.bufferUploadBytes += uint64_t(size);
+    REAL(BufferSubData)(target, offset, size, data);
+}
+
+void APIENTRY hookDeleteBuffers(GLsizei count, const GLuint * buffers) {
+    releaseResources(GL_BUFFER, count, buffers);
+    REAL(DeleteBuffers)(count, buffers);
+}
+
+//-- Textures
+void APIENTRY hookTexImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height,
+        GLint border, GLenum format, GLenum type, const void * pixels) {
+    uint64_t texels = uint64_t(width) * uint64_t(height);
+    if (pixels != nullptr) {
+        ++current.textureUploads;
+        current.textureUploadBytes += texels * pixelBytes(format, type);
+    }
+
+    GLuint texture = target == GL_TEXTURE_2D ? boundTexture2D() : 0;
+    if (texture != 0 && level >= 0 && level < 16) {
+        getResource(GL_TEXTURE, texture).levels[level] = texels * internalFormatBytes(GLenum(internalFormat));
+    }
+
+    REAL(TexImage2D)(target, level, internalFormat, width, height, border, format, type, pixels);
+}
+
+void APIENTRY hookTexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height,
+        GLenum format, GLenum type, const void * pixels) {
+    ++current.textureUploads;
+    current.textureUploadBytes += uint64_t(width) * uint64_t(height) * pixelBytes(format, type);
+    REAL(TexSubImage2D)(target, level, x, y, width, height, format, type, pixels);
+}
+
+void APIENTRY hookDeleteTextures(GLsizei count, const GLuint * textures) {
+    releaseResources(GL_TEXTURE, count, textures);
+    REAL(DeleteTextures)(count, textures);
+}
+
+//-- Renderbuffers
+void APIENTRY hookRenderbufferStorage(GLenum target, GLenum internalFormat, GLsizei width, GLsizei height) {
+    GLuint renderbuffer = boundRenderbuffer();
+    if (renderbuffer != 0) {
+        getResource(GL_RENDERBUFFER, renderbuffer).levels[0] =
+                uint64_t(width) * uint64_t(height) * internalFormatBytes(internalFormat);
+    }
+    REAL(RenderbufferStorage)(target, internalFormat, width, height);
+}
+
+void APIENTRY hookRenderbufferStorageMultisample(GLenum target, GLsizei samples, GLenum internalFormat,
+        GLsizei width, GLsizei height) {
+    GLuint renderbuffer = boundRenderbuffer();
+    if (renderbuffer != 0) {
+        getResource(GL_RENDERBUFFER, renderbuffer).levels[0] =
+                uint64_t(width) * uint64_t(height) * uint64_t(samples > 0 ? samples : 1) *
+                internalFormatBytes(internalFormat);
+    }
+    REAL(RenderbufferStorageMultisample)(target, samples, internalFormat, width, height);
+}
+
+void APIENTRY hookDeleteRenderbuffers(GLsizei count, const GLuint * renderbuffers) {
+    releaseResources(GL_RENDERBUFFER, count, renderbuffers);
+    REAL(DeleteRenderbuffers)(count, renderbuffers);
+}
+
+void APIENTRY hookObjectLabel(GLenum identifier, GLuint name, GLsizei length, const GLchar * label) {
+    if (identifier == GL_BUFFER || identifier == GL_TEXTURE || identifier == GL_RENDERBUFFER) {
+        getResource(identifier, name).label = length < 0 ? string(label) : string(label, size_t(length));
+    }
+    REAL(ObjectLabel)(identifier, name, length, label);
+}
+
+//-- Queries
+GLenum APIENTRY hookGetError() {
+    ++current.getQueries;
+    return REAL(GetError)();
+}
+
+void APIENTRY hookGetIntegerv(GLenum pname, GLint * data) { ++current.getQueries; REAL(GetIntegerv)(pname, data); }
+void APIENTRY hookGetInteger64v(GLenum pname, GLint64 * data) { ++current.getQueries; REAL(GetInteger64v)(pname, data); }
+void APIENTRY hookGetFloatv(GLenum pname, GLfloat * data) { ++current.getQueries; REAL(GetFloatv)(pname, data); }
+void APIENTRY hookGetBooleanv(GLenum pname, GLboolean * data) { ++current.getQueries; REAL(GetBooleanv)(pname, data); }
+
+const GLubyte * APIENTRY hookGetString(GLenum name) {
+    ++current.getQueries;
+    return REAL(GetString)(name);
+}
+
+GLint APIENTRY hookGetUniformLocation(GLuint program, const GLchar * name) {
+    ++current.getQueries;
+    return REAL(GetUniformLocation)(program, name);
+}
+
+GLint APIENTRY hookGetAttribLocation(GLuint program, const GLchar * name) {
+    ++current.getQueries;
+    return REAL(GetAttribLocation)(program, name);
+}
+
+void APIENTRY hookGetShaderiv(GLuint shader, GLenum pname, GLint * params) {
+    ++current.getQueries;
+    REAL(GetShaderiv)(shader, pname, params);
+}
+
+void APIENTRY hookGetProgramiv(GLuint program, GLenum pname, GLint * params) {
+    ++current.getQueries;
+    REAL(GetProgramiv)(program, pname, params);
+}
+
+void APIENTRY hookGetQueryObjectiv(GLuint id, GLenum pname, GLint * params) {
+    ++current.getQueries;
+    REAL(GetQueryObjectiv)(id, pname, params);
+}
+
+void APIENTRY hookGetQueryObjectui64v(GLuint id, GLenum pname, GLuint64 * params) {
+    ++current.getQueries;
+    REAL(GetQueryObjectui64v)(id, pname, params);
+}
+
+// Saves gl3w's pointer and replaces it with the hook, if the driver
+// provided the entry point.
+#define HOOK(function) \
+    if (gl3w##function != nullptr) { \
+        REAL(function) = gl3w##function; \
+        gl3w##function = hook##function; \
+    }
+
+#endif
+
+}
+
+//------------------------------------------------------------------------------------
+GlCounters::Frame::Frame()
+    : drawCalls(0),
+      triangles(0),
+      lines(0),
+      stateChanges(0),
+      uniformUpdates(0),
+      uniformBytes(0),
+      bufferUploads(0),
+      bufferUploadBytes(0),
+      textureUploads(0),
+      textureUploadBytes(0),
+      getQueries(0)
+{
+
+}
+
+//------------------------------------------------------------------------------------
+bool GlCounters::install() {
+#ifdef __linux__
+    if (installed) {
+        return true;
+    }
+
+    // The memory tracking hooks query bindings through this.
+    if (gl3wGetIntegerv == nullptr) {
+        return false;
+    }
+
+    HOOK(DrawArrays);
+    HOOK(DrawElements);
+    HOOK(DrawArraysInstanced);
+    HOOK(DrawElementsInstanced);
+    HOOK(DrawElementsBaseVertex);
+    HOOK(DrawRangeElements);
+    HOOK(Enable);
+    HOOK(Disable);
+    HOOK(UseProgram);
+    HOOK(BindVertexArray);
+    HOOK(BindBuffer);
+    HOOK(BindTexture);
+    HOOK(ActiveTexture);
+    HOOK(BindFramebuffer);
+    HOOK(BindRenderbuffer);
+    HOOK(PolygonMode);
+    HOOK(BlendFunc);
+    HOOK(BlendEquation);
+    HOOK(DepthFunc);
+    HOOK(DepthMask);
+    HOOK(CullFace);
+    HOOK(Viewport);
+    HOOK(Scissor);
+    HOOK(Uniform1i);
+    HOOK(Uniform1f);
+    HOOK(Uniform3f);
+    HOOK(Uniform4f);
+    HOOK(Uniform3fv);
+    HOOK(Uniform4fv);
+    HOOK(UniformMatrix3fv);
+    HOOK(UniformMatrix4fv);
+    HOOK(BufferData);
+    HOOK(BufferSubData);
+    HOOK(DeleteBuffers);
+    HOOK(TexImage2D);
+    HOOK(TexSubImage2D);
+    HOOK(DeleteTextures);
+    HOOK(RenderbufferStorage);
+    HOOK(RenderbufferStorageMultisample);
+    HOOK(DeleteRenderbuffers);
+    HOOK(ObjectLabel);
+    HOOK(GetError);
+    HOOK(GetIntegerv);
+    HOOK(GetInteger64v);
+    HOOK(GetFloatv);
+    HOOK(GetBooleanv);
+    HOOK(GetString);
+    HOOK(GetUniformLocation);
+    HOOK(GetAttribLocation);
+    HOOK(GetShaderiv);
+    HOOK(GetProgramiv);
+    HOOK(GetQueryObjectiv);
+    HOOK(GetQueryObjectui64v);
+
+    installed = true;
+    return true;
+#else
+    return false;
+#endif
+}
+
+//------------------------------------------------------------------------------------
+bool GlCounters::isInstalled() {
+    return installed;
+}
+
+//------------------------------------------------------------------------------------
+void GlCounters::beginFrame() {
+    lastFrame = current;
+    current = Frame();
+
+    PROFILE_COUNTER("Draw calls", double(lastFrame.drawCalls));
+    PROFILE_COUNTER("Triangles", double(lastFrame.triangles));
+    PROFILE_COUNTER("State changes", double(lastFrame.stateChanges));
+    PROFILE_COUNTER("Uniform bytes", double(lastFrame.uniformBytes));
+    PROFILE_COUNTER("Buffer upload bytes", double(lastFrame.bufferUploadBytes));
+    PROFILE_COUNTER("Texture upload bytes", double(lastFrame.textureUploadBytes));
+    PROFILE_COUNTER("glGet queries", double(lastFrame.getQueries));
+}
+
+//------------------------------------------------------------------------------------
+const GlCounters::Frame & GlCounters::getLastFrame() {
+    return lastFrame;
+}
+
+//------------------------------------------------------------------------------------
+const GlCounters::Frame & GlCounters::getCurrent() {
+    return current;
+}
+
+//------------------------------------------------------------------------------------
+void GlCounters::resetCurrent() {
+    current = Frame();
+}
+
+//------------------------------------------------------------------------------------
+void GlCounters::setLabel(GLenum type, GLuint name, const char * label) {
+    // Without the hooks nothing would remove the entry again.
+    if (!installed) {
+        return;
+    }
+
+    getResource(type, name).label = label;
+}
+
+//------------------------------------------------------------------------------------
+void GlCounters::getAllocations(vector<Allocation> & allocations) {
+    map<string, Allocation> byLabel;
+
+    for (const pair<const uint64_t, Resource> & entry : resources) {
+        const Resource & resource = entry.second;
+
+        string label = resource.label;
+        if (label.empty()) {
+            label = resource.type == GL_BUFFER ? "Unlabelled buffers" :
+                    resource.type == GL_TEXTURE ? "Unlabelled textures" : "Unlabelled renderbuffers";
+        }
+
+        Allocation & allocation = byLabel[label];
+        allocation.label = label;
+        allocation.objects += 1;
+        allocation.bytes += resource.bytes();
+    }
+
+    allocations.clear();
+    for (const pair<const string, Allocation> & entry : byLabel) {
+        allocations.push_back(entry.second);
+    }
+}
+
+//------------------------------------------------------------------------------------
+uint64_t GlCounters::getTotalBytes() {
+    uint64_t total = 0;
+    for (const pair<const uint64_t, Resource> & entry : resources) {
+        total += entry.second.bytes();
+    }
+    return total;
+}
+
+//------------------------------------------------------------------------------------
+void GlCounters::drawTable() {
+    if (!installed) {
+        ImGui::Text("GL calls are not counted on this platform.");
+        return;
+    }
+
+    const Frame & frame = lastFrame;
+    ImGui::Text("Draw calls     %10llu", (unsigned long long) frame.drawCalls);
+    ImGui::Text("Triangles      %10llu", (unsigned long long) frame.triangles);
+    ImGui::Text("Lines          %10llu", (unsigned long long) frame.lines);
+    ImGui::Text("State changes  %10llu", (unsigned long long) frame.stateChanges);
+    ImGui::Text("Uniforms       %10llu (%llu bytes)",
+            (unsigned long long) frame.uniformUpdates, (unsigned long long) frame.uniformBytes);
+    ImGui::Text("Buffer uploads %10llu (%llu bytes)",
+            (unsigned long long) frame.bufferUploads, (unsigned long long) frame.bufferUploadBytes);
+    ImGui::Text("Tex uploads    %10llu (%llu bytes)",
+            (unsigned long long) frame.textureUploads, (unsigned long long) frame.textureUploadBytes);
+    ImGui::Text("glGet queries  %10llu", (unsigned long long) frame.getQueries);
+
+    vector<Allocation> allocations;
+    getAllocations(allocations);
+
+    ImGui::Separator();
+    ImGui::Text("GPU memory %.2f MB", double(getTotalBytes()) / (1024.0 * 1024.0));
+    for (const Allocation & allocation : allocations) {
+        ImGui::Text("  %-24s %3u %10.1f KB", allocation.label.c_str(), allocation.objects,
+                double(allocation.bytes) / 1024.0);
+    }
+}
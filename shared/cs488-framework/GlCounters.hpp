@@ -0,0 +1,90 @@
+/*
+ * GlCounters
+ */
+
+#pragma once
+
+#include "OpenGLImport.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Object type of glObjectLabel, missing from GL 3.3 headers.
+#ifndef GL_BUFFER
+    #define GL_BUFFER 0x82E0
+#endif
+
+
+/*
+ * Counts the GL calls made each frame and tracks the GPU memory held by
+ * buffers, textures and renderbuffers.
+ *
+ * install() replaces gl3w's entry points with wrappers that count each call
+ * and forward it, so every caller is covered, including ImGui. Memory is
+ * tracked from the sizes passed to glBufferData, glTexImage2D and
+ * glRenderbufferStorage, grouped by the label given to setLabel() or
+ * glObjectLabel. Counters are only updated on the thread that owns the
+ * context. Where gl3w is not used (macOS), install() returns false and the
+ * counters stay at zero.
+ */
+class GlCounters {
+public:
+    struct Frame {
+        uint64_t drawCalls;
+        uint64_t triangles;
+        uint64_t lines;
+
+        // Binds, enables and other fixed function state changes.
+        uint64_t stateChanges;
+
+        uint64_t uniformUpdates;
+        uint64_t uniformBytes;
+
+        uint64_t bufferUploads;
+        uint64_t bufferUploadBytes;
+
+        uint64_t textureUploads;
+        uint64_t textureUploadBytes;
+
+        // glGet*, including glGetError, which may stall the pipeline.
+        uint64_t getQueries;
+
+        Frame();
+    };
+
+    struct Allocation {
+        std::string label;
+        unsigned objects;
+        uint64_t bytes;
+
+        Allocation() : objects(0), bytes(0) { }
+    };
+
+    // Hooks the entry points. Call after gl3wInit(). Returns false if they
+    // cannot be hooked on this platform.
+    static bool install();
+
+    static bool isInstalled();
+
+    // Ends the current frame, making it available from getLastFrame().
+    static void beginFrame();
+
+    static const Frame & getLastFrame();
+
+    // Gets the counts since the frame began, or since resetCurrent().
+    static const Frame & getCurrent();
+    static void resetCurrent();
+
+    // Names a GL_BUFFER, GL_TEXTURE or GL_RENDERBUFFER for getAllocations().
+    static void setLabel(GLenum type, GLuint name, const char * label);
+
+    // Gets the memory held by live objects, summed per label. Unlabelled
+    // objects are grouped by type.
+    static void getAllocations(std::vector<Allocation> & allocations);
+    static uint64_t getTotalBytes();
+
+    // Draws the counters of the last frame and the allocations into the
+    // current ImGui window.
+    static void drawTable();
+};
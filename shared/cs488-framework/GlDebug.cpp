@@ -0,0 +1,355 @@
+#include "GlDebug.hpp"
+#include "Exception.hpp"
+#include "GlErrorCheck.hpp"
+#include "OpenGLImport.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+// Deepest scope tracked. Deeper scopes are counted but not named.
+const int MAX_DEPTH = 16;
+
+/*
+ * A distinct message, printed the first time it is seen.
+ */
+struct Message {
+    string text;
+    unsigned count;
+
+    Message() : count(0) { }
+};
+
+// Guards everything below, as the driver may call back on its own thread.
+mutex stateLock;
+
+bool enabled = false;
+GlDebug::Severity minSeverity = GlDebug::SEVERITY_MEDIUM;
+
+const char * scopes[MAX_DEPTH];
+int depth = 0;
+
+map<uint64_t, Message> seenMessages;
+unsigned repeats = 0;
+
+// First error since the last check, with the scopes it arrived in.
+bool errorPending = false;
+string pendingError;
+
+// The callback and what it needs, only built when it can be installed.
+#if CS488_GL_DEBUG_LEVEL > 0 && defined(__linux__)
+const char * getSourceName(GLenum source) {
+    switch (source) {
+    case GL_DEBUG_SOURCE_API:             return "API";
+    case GL_DEBUG_SOURCE_WINDOW_SYSTEM:   return "window system";
+    case GL_DEBUG_SOURCE_SHADER_COMPILER: return "shader compiler";
+    case GL_DEBUG_SOURCE_THIRD_PARTY:     return "third party";
+    case GL_DEBUG_SOURCE_APPLICATION:     return "application";
+    default:                              return "other";
+    }
+}
+
+const char * getTypeName(GLenum type) {
+    switch (type) {
+    case GL_DEBUG_TYPE_ERROR:               return "error";
+    case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "deprecated";
+    case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:  return "undefined behaviour";
+    case GL_DEBUG_TYPE_PORTABILITY:         return "portability";
+    case GL_DEBUG_TYPE_PERFORMANCE:         return "performance";
+    case GL_DEBUG_TYPE_MARKER:              return "marker";
+    default:                                return "other";
+    }
+}
+
+GlDebug::Severity toSeverity(GLenum severity) {
+    switch (severity) {
+    case GL_DEBUG_SEVERITY_HIGH:   return GlDebug::SEVERITY_HIGH;
+    case GL_DEBUG_SEVERITY_MEDIUM: return GlDebug::SEVERITY_MEDIUM;
+    case GL_DEBUG_SEVERITY_LOW:    return GlDebug::SEVERITY_LOW;
+    default:                       return GlDebug::SEVERITY_NOTIFICATION;
+    }
+}
+
+const char * getSeverityName(GlDebug::Severity severity) {
+    switch (severity) {
+    case GlDebug::SEVERITY_HIGH:   return "high";
+    case GlDebug::SEVERITY_MEDIUM: return "medium";
+    case GlDebug::SEVERITY_LOW:    return "low";
+    default:                       return "notification";
+    }
+}
+
+// Open scopes as "outer > inner". Call with the lock held.
+string getScopePath() {
+    if (depth == 0) {
+        return "no scope";
+    }
+
+    string path;
+    for (int idx = 0; idx < depth && idx < MAX_DEPTH; ++idx) {
+        if (idx > 0) {
+            path += " > ";
+        }
+        path += scopes[idx];
+    }
+    if (depth > MAX_DEPTH) {
+        path += " > ...";
+    }
+    return path;
+}
+
+// FNV-1a over the fields that identify a message.
+uint64_t getMessageKey(GLenum source, GLenum type, GLuint id, const char * text) {
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](uint64_t value) {
+        hash ^= value;
+        hash *= 1099511628211ull;
+    };
+
+    mix(source);
+    mix(type);
+    mix(id);
+    for (const char * c = text; *c != '\0'; ++c) {
+        mix(uint8_t(*c));
+    }
+    return hash;
+}
+
+void APIENTRY onMessage(GLenum source, GLenum type, GLuint id, GLenum severity,
+        GLsizei length, const GLchar * text, GLvoid * userParam) {
+    // Our own scopes come back as notifications.
+    if (type == GL_DEBUG_TYPE_PUSH_GROUP || type == GL_DEBUG_TYPE_POP_GROUP) {
+        return;
+    }
+
+    GlDebug::Severity level = toSeverity(severity);
+
+    lock_guard<mutex> guard(stateLock);
+    if (level < minSeverity) {
+        return;
+    }
+
+    string scopePath = getScopePath();
+    if (type == GL_DEBUG_TYPE_ERROR && !errorPending) {
+        errorPending = true;
+        pendingError = string(text) + " (in " + scopePath + ")";
+    }
+
+    Message & message = seenMessages[getMessageKey(source, type, id, text)];
+    if (++message.count > 1) {
+        ++repeats;
+        return;
+    }
+
+    stringstream line;
+    line << "[GL " << getSeverityName(level) << " " << getSourceName(source) << " "
+         << getTypeName(type) << " 0x" << hex << id << dec << "] " << text << " (in " << scopePath << ")";
+    message.text = line.str();
+    cerr << message.text << endl;
+}
+
+// KHR_debug is core from GL 4.3.
+bool hasDebugOutput() {
+    if (gl3wDebugMessageCallback == nullptr) {
+        return false;
+    }
+
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if (major > 4 || (major == 4 && minor >= 3)) {
+        return true;
+    }
+
+    GLint extensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensions);
+    for (GLint idx = 0; idx < extensions; ++idx) {
+        const GLubyte * name = glGetStringi(GL_EXTENSIONS, GLuint(idx));
+        if (name != nullptr && strcmp((const char *) name, "GL_KHR_debug") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+#endif
+
+#ifdef __linux__
+// Enables the messages at or above minSeverity in the driver.
+void applyMinSeverity() {
+    static const GLenum SEVERITIES[4] = {
+        GL_DEBUG_SEVERITY_NOTIFICATION, GL_DEBUG_SEVERITY_LOW,
+        GL_DEBUG_SEVERITY_MEDIUM, GL_DEBUG_SEVERITY_HIGH
+    };
+
+    for (int idx = 0; idx < 4; ++idx) {
+        glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, SEVERITIES[idx], 0, nullptr,
+                idx >= int(minSeverity) ? GL_TRUE : GL_FALSE);
+    }
+}
+#endif
+
+}
+
+//------------------------------------------------------------------------------------
+bool GlDebug::init() {
+#if CS488_GL_DEBUG_LEVEL > 0 && defined(__linux__)
+    if (enabled) {
+        return true;
+    }
+
+    const char * severity = getenv("CS488_GL_DEBUG_SEVERITY");
+    if (severity != nullptr) {
+        for (int level = SEVERITY_NOTIFICATION; level <= SEVERITY_HIGH; ++level) {
+            if (strcmp(severity, getSeverityName(Severity(level))) == 0) {
+                minSeverity = Severity(level);
+            }
+        }
+    }
+
+    if (!hasDebugOutput()) {
+        return false;
+    }
+
+    glEnable(GL_DEBUG_OUTPUT);
+#if CS488_GL_DEBUG_LEVEL > 1
+    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+#endif
+    glDebugMessageCallback(onMessage, nullptr);
+    applyMinSeverity();
+
+    // Errors from before the callback are only visible to glGetError.
+    while (glGetError() != GL_NO_ERROR);
+
+    enabled = true;
+    return true;
+#else
+    return false;
+#endif
+}
+
+//------------------------------------------------------------------------------------
+void GlDebug::shutdown() {
+#ifdef __linux__
+    if (!enabled) {
+        return;
+    }
+
+    glDebugMessageCallback(nullptr, nullptr);
+    glDisable(GL_DEBUG_OUTPUT);
+
+    lock_guard<mutex> guard(stateLock);
+    for (const auto & entry : seenMessages) {
+        if (entry.second.count > 1) {
+            cerr << entry.second.text << " was repeated " << entry.second.count - 1 << " times" << endl;
+        }
+    }
+    seenMessages.clear();
+    repeats = 0;
+    enabled = false;
+#endif
+}
+
+//------------------------------------------------------------------------------------
+bool GlDebug::isEnabled() {
+    return enabled;
+}
+
+//------------------------------------------------------------------------------------
+void GlDebug::setMinSeverity(Severity severity) {
+    lock_guard<mutex> guard(stateLock);
+    minSeverity = severity;
+#ifdef __linux__
+    if (enabled) {
+        applyMinSeverity();
+    }
+#endif
+}
+
+//------------------------------------------------------------------------------------
+GlDebug::Severity GlDebug::getMinSeverity() {
+    lock_guard<mutex> guard(stateLock);
+    return minSeverity;
+}
+
+//------------------------------------------------------------------------------------
+void GlDebug::check(const char * fileName, int lineNumber) {
+    string error;
+    if (enabled) {
+        lock_guard<mutex> guard(stateLock);
+        if (errorPending) {
+            error = pendingError;
+            errorPending = false;
+        }
+    }
+
+    if (error.empty()) {
+        if (!enabled || CS488_GL_DEBUG_LEVEL > 1) {
+            checkGLErrors(fileName, lineNumber);
+        }
+        return;
+    }
+
+#if CS488_GL_DEBUG_LEVEL > 1
+    // The callback has described the error, so only clear it.
+    while (glGetError() != GL_NO_ERROR);
+#endif
+
+    stringstream message;
+    message << "[GL error " << error << " found by " << fileName << ":" << lineNumber << "]";
+    throw Exception(message.str());
+}
+
+//------------------------------------------------------------------------------------
+void GlDebug::pushScope(const char * name) {
+    if (!enabled) {
+        return;
+    }
+
+    {
+        lock_guard<mutex> guard(stateLock);
+        if (depth < MAX_DEPTH) {
+            scopes[depth] = name;
+        }
+        ++depth;
+    }
+
+#ifdef __linux__
+    glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+#endif
+}
+
+//------------------------------------------------------------------------------------
+void GlDebug::popScope() {
+    if (!enabled) {
+        return;
+    }
+
+#ifdef __linux__
+    glPopDebugGroup();
+#endif
+
+    lock_guard<mutex> guard(stateLock);
+    if (depth > 0) {
+        --depth;
+    }
+}
+
+//------------------------------------------------------------------------------------
+unsigned GlDebug::getMessageCount() {
+    lock_guard<mutex> guard(stateLock);
+    return unsigned(seenMessages.size());
+}
+
+//------------------------------------------------------------------------------------
+unsigned GlDebug::getRepeatCount() {
+    lock_guard<mutex> guard(stateLock);
+    return repeats;
+}
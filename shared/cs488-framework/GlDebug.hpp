@@ -0,0 +1,105 @@
+/*
+ * GlDebug
+ */
+
+#pragma once
+
+// How much GL error checking is compiled in:
+//   0  none; CHECK_GL_ERRORS and GL_DEBUG_SCOPE compile to nothing.
+//   1  driver messages through KHR_debug. CHECK_GL_ERRORS throws any error
+//      the driver has reported without calling into GL, so it does not
+//      synchronise with the driver. Contexts without KHR_debug fall back to
+//      glGetError.
+//   2  as 1, but messages are synchronous, so they are reported inside the
+//      call that caused them, and CHECK_GL_ERRORS also polls glGetError.
+// Debug builds default to 1 and release builds to 0. premake's --gl-debug
+// option overrides the level.
+#ifndef CS488_GL_DEBUG_LEVEL
+    #if(DEBUG)
+        #define CS488_GL_DEBUG_LEVEL 1
+    #else
+        #define CS488_GL_DEBUG_LEVEL 0
+    #endif
+#endif
+
+
+/*
+ * GL debug layer built on glDebugMessageCallback.
+ *
+ * Messages below the minimum severity are dropped by the driver. The rest
+ * are printed to stderr once each, with the annotation scopes that were open
+ * when they arrived, e.g. "draw > Scene > Cubes"; repeats are counted and
+ * summarised by shutdown(). Errors are also kept for CHECK_GL_ERRORS, which
+ * throws an Exception naming the error, its scopes and the check that found
+ * it.
+ *
+ * Scopes are also pushed as KHR_debug groups, so they show up in GL
+ * debuggers. At level 1 messages may arrive on a driver thread after the
+ * call that caused them, so their scopes are approximate.
+ */
+class GlDebug {
+public:
+    enum Severity {
+        SEVERITY_NOTIFICATION,
+        SEVERITY_LOW,
+        SEVERITY_MEDIUM,
+        SEVERITY_HIGH
+    };
+
+    // Installs the callback on the current context. The minimum severity is
+    // taken from CS488_GL_DEBUG_SEVERITY (notification, low, medium or
+    // high), defaulting to medium. Returns false if the context has no
+    // KHR_debug or the level is 0.
+    static bool init();
+
+    // Prints how often repeated messages were seen and removes the callback.
+    static void shutdown();
+
+    static bool isEnabled();
+
+    static void setMinSeverity(Severity severity);
+    static Severity getMinSeverity();
+
+    // Throws an Exception if GL has reported an error since the last check.
+    static void check(const char * fileName, int lineNumber);
+
+    // Names the GL work that follows until the matching popScope(). Names
+    // must outlive the scope.
+    static void pushScope(const char * name);
+    static void popScope();
+
+    // Messages printed, and repeats of them that were not.
+    static unsigned getMessageCount();
+    static unsigned getRepeatCount();
+};
+
+/*
+ * Opens an annotation scope for the rest of the enclosing block.
+ */
+class GlDebugScope {
+public:
+    explicit GlDebugScope(const char * name) {
+        GlDebug::pushScope(name);
+    }
+
+    ~GlDebugScope() {
+        GlDebug::popScope();
+    }
+
+private:
+    GlDebugScope(const GlDebugScope &);
+    GlDebugScope & operator = (const GlDebugScope &);
+};
+
+#define GL_DEBUG_CONCAT_(a, b) a##b
+#define GL_DEBUG_CONCAT(a, b) GL_DEBUG_CONCAT_(a, b)
+
+#if CS488_GL_DEBUG_LEVEL > 0
+    #define GL_DEBUG_SCOPE(name) GlDebugScope GL_DEBUG_CONCAT(glDebugScope, __LINE__)(name)
+    #define GL_DEBUG_PUSH(name) GlDebug::pushScope(name)
+    #define GL_DEBUG_POP() GlDebug::popScope()
+#else
+    #define GL_DEBUG_SCOPE(name) do { } while (0)
+    #define GL_DEBUG_PUSH(name) do { } while (0)
+    #define GL_DEBUG_POP() do { } while (0)
+#endif
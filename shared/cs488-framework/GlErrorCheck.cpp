@@ -93,7 +93,6 @@ void checkGLErrors(const string &currentFileName, int currentLine) {
       
       errorFound = true;
     }
-    errorCode = glGetError();
   } while (errorCode != GL_NO_ERROR);
   
   if (errorFound) {
@@ -4,11 +4,13 @@
 
 #pragma once
 
+#include "GlDebug.hpp"
+
 #include <string>
 
-// Helper Macros
-#if(DEBUG)
-	#define CHECK_GL_ERRORS checkGLErrors(__FILE__, __LINE__)
+// Helper Macros. CS488_GL_DEBUG_LEVEL is described in GlDebug.hpp.
+#if CS488_GL_DEBUG_LEVEL > 0
+	#define CHECK_GL_ERRORS GlDebug::check(__FILE__, __LINE__)
 	#define CHECK_FRAMEBUFFER_COMPLETENESS checkFramebufferCompleteness()
 #else
 	#define CHECK_GL_ERRORS
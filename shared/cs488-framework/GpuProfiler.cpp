@@ -0,0 +1,241 @@
+#include "GpuProfiler.hpp"
+#include "OpenGLImport.hpp"
+
+#include <cstdint>
+
+using namespace std;
+
+namespace {
+
+// Frames of queries in flight before frames are dropped.
+const int NUM_FRAMES = 4;
+
+// Zones recorded per frame, and how deeply they may nest. Zones beyond
+// either limit are ignored.
+const int MAX_ZONES = 32;
+const int MAX_DEPTH = 16;
+
+// Frames between re-measuring the offset from GPU to CPU time.
+const int SYNC_INTERVAL = 256;
+
+/*
+ * Queries of one frame. Zone i is timed by queries 2i (start) and 2i + 1
+ * (end). Zones are recorded into the Profiler in the order they ended.
+ */
+struct FrameQueries {
+    GLuint queries[2 * MAX_ZONES];
+    const char * names[MAX_ZONES];
+    unsigned depths[MAX_ZONES];
+    int endOrder[MAX_ZONES];
+    bool ended[MAX_ZONES];
+    int zoneCount;
+    int endCount;
+    bool pending;
+};
+
+bool supported = false;
+
+FrameQueries frames[NUM_FRAMES];
+int nextFrame = 0;
+int oldestFrame = 0;
+
+// Frame being recorded, or -1 if this frame is dropped.
+int currentFrame = -1;
+
+// Zones entered but not yet left; -1 marks an ignored zone.
+int zoneStack[MAX_DEPTH];
+int depth = 0;
+
+size_t track = 0;
+int64_t gpuToCpu = 0;
+int framesSinceSync = 0;
+
+vector<GpuProfiler::Result> lastResults;
+
+void syncClocks() {
+    GLint64 gpuTime = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+    gpuToCpu = int64_t(Profiler::now()) - int64_t(gpuTime);
+    framesSinceSync = 0;
+}
+
+// Reads back every finished frame, oldest first.
+void readFrames() {
+    while (frames[oldestFrame].pending) {
+        FrameQueries & frame = frames[oldestFrame];
+
+        // Queries complete in order, and the last zone to end was the last
+        // query issued.
+        GLuint last = frame.queries[2 * frame.endOrder[frame.endCount - 1] + 1];
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(last, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == GL_FALSE) {
+            break;
+        }
+
+        // Zones still open at the end of the frame never issued their end
+        // query, so only those that ended are read.
+        GLuint64 times[2 * MAX_ZONES];
+        for (int idx = 0; idx < frame.endCount; ++idx) {
+            int zone = frame.endOrder[idx];
+            glGetQueryObjectui64v(frame.queries[2 * zone], GL_QUERY_RESULT, &times[2 * zone]);
+            glGetQueryObjectui64v(frame.queries[2 * zone + 1], GL_QUERY_RESULT, &times[2 * zone + 1]);
+            Profiler::recordZone(track, frame.names[zone],
+                    uint64_t(int64_t(times[2 * zone]) + gpuToCpu),
+                    uint64_t(int64_t(times[2 * zone + 1]) + gpuToCpu),
+                    frame.depths[zone]);
+        }
+
+        lastResults.clear();
+        for (int zone = 0; zone < frame.zoneCount; ++zone) {
+            if (!frame.ended[zone]) {
+                continue;
+            }
+
+            GpuProfiler::Result result;
+            result.name = frame.names[zone];
+            result.depth = frame.depths[zone];
+            result.milliseconds = float(times[2 * zone + 1] - times[2 * zone]) * 1.0e-6f;
+            lastResults.push_back(result);
+        }
+
+        frame.pending = false;
+        oldestFrame = (oldestFrame + 1) % NUM_FRAMES;
+    }
+}
+
+}
+
+//------------------------------------------------------------------------------------
+void GpuProfiler::init() {
+    if (supported || !Profiler::isEnabled()) {
+        return;
+    }
+
+    // Contexts without a timestamp counter report zero bits.
+    while (glGetError() != GL_NO_ERROR);
+    GLint bits = 0;
+    glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+    if (glGetError() != GL_NO_ERROR || bits == 0) {
+        return;
+    }
+
+    for (int idx = 0; idx < NUM_FRAMES; ++idx) {
+        glGenQueries(2 * MAX_ZONES, frames[idx].queries);
+        frames[idx].zoneCount = 0;
+        frames[idx].endCount = 0;
+        frames[idx].pending = false;
+    }
+
+    if (glGetError() != GL_NO_ERROR) {
+        for (int idx = 0; idx < NUM_FRAMES; ++idx) {
+            glDeleteQueries(2 * MAX_ZONES, frames[idx].queries);
+        }
+        return;
+    }
+
+    // The track outlives destroy(), so a later init() reuses it.
+    static size_t gpuTrack = Profiler::addTrack("GPU");
+    track = gpuTrack;
+
+    nextFrame = 0;
+    oldestFrame = 0;
+    currentFrame = -1;
+    depth = 0;
+    syncClocks();
+    supported = true;
+}
+
+//------------------------------------------------------------------------------------
+void GpuProfiler::destroy() {
+    if (!supported) {
+        return;
+    }
+
+    for (int idx = 0; idx < NUM_FRAMES; ++idx) {
+        glDeleteQueries(2 * MAX_ZONES, frames[idx].queries);
+    }
+
+    lastResults.clear();
+    supported = false;
+}
+
+//------------------------------------------------------------------------------------
+bool GpuProfiler::isSupported() {
+    return supported;
+}
+
+//------------------------------------------------------------------------------------
+void GpuProfiler::beginFrame() {
+    if (!supported) {
+        return;
+    }
+
+    // Submit the frame just recorded, unless it timed nothing.
+    if (currentFrame >= 0 && frames[currentFrame].endCount > 0) {
+        frames[currentFrame].pending = true;
+        nextFrame = (nextFrame + 1) % NUM_FRAMES;
+    }
+
+    readFrames();
+
+    if (++framesSinceSync >= SYNC_INTERVAL) {
+        syncClocks();
+    }
+
+    // Skip this frame if every set of queries is still waiting on the GPU.
+    depth = 0;
+    if (frames[nextFrame].pending) {
+        currentFrame = -1;
+        return;
+    }
+
+    currentFrame = nextFrame;
+    frames[currentFrame].zoneCount = 0;
+    frames[currentFrame].endCount = 0;
+}
+
+//------------------------------------------------------------------------------------
+void GpuProfiler::enterZone(const char * name) {
+    if (currentFrame < 0) {
+        return;
+    }
+
+    int zone = -1;
+    FrameQueries & frame = frames[currentFrame];
+    if (depth < MAX_DEPTH && frame.zoneCount < MAX_ZONES) {
+        zone = frame.zoneCount++;
+        frame.names[zone] = name;
+        frame.depths[zone] = unsigned(depth);
+        frame.ended[zone] = false;
+        glQueryCounter(frame.queries[2 * zone], GL_TIMESTAMP);
+    }
+
+    if (depth < MAX_DEPTH) {
+        zoneStack[depth] = zone;
+    }
+    ++depth;
+}
+
+//------------------------------------------------------------------------------------
+void GpuProfiler::leaveZone() {
+    if (currentFrame < 0 || depth == 0) {
+        return;
+    }
+
+    --depth;
+    if (depth >= MAX_DEPTH || zoneStack[depth] < 0) {
+        return;
+    }
+
+    FrameQueries & frame = frames[currentFrame];
+    int zone = zoneStack[depth];
+    glQueryCounter(frame.queries[2 * zone + 1], GL_TIMESTAMP);
+    frame.endOrder[frame.endCount++] = zone;
+    frame.ended[zone] = true;
+}
+
+//------------------------------------------------------------------------------------
+void GpuProfiler::getResults(vector<Result> & results) {
+    results = lastResults;
+}
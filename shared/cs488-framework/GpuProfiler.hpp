@@ -0,0 +1,85 @@
+/*
+ * GpuProfiler
+ */
+
+#pragma once
+
+#include "Profiler.hpp"
+
+#include <vector>
+
+
+/*
+ * Nested GPU timing zones measured with GL_TIMESTAMP queries.
+ *
+ * GPU_PROFILE_SCOPE("name") times the GL commands issued in the enclosing
+ * block; GPU_PROFILE_ENTER/GPU_PROFILE_LEAVE do the same for spans that do
+ * not map onto a block. GPU_PROFILE_FRAME() must be called once per frame
+ * on the thread that owns the context. Results are read back a few frames
+ * later, once available, so the CPU never waits on a query. They are
+ * converted to the CPU clock and recorded into a "GPU" track of the
+ * Profiler, so they show up on the same timeline as the CPU zones.
+ *
+ * Like PROFILE_SCOPE, the macros compile to nothing unless CS488_PROFILE is
+ * defined. If the context has no timestamp counter, init() leaves the
+ * profiler disabled and every call returns immediately.
+ */
+class GpuProfiler {
+public:
+    struct Result {
+        const char * name;
+        unsigned depth;
+        float milliseconds;
+    };
+
+    // Creates the queries. Requires a current context.
+    static void init();
+
+    static void destroy();
+
+    // Returns true if init() found timer query support.
+    static bool isSupported();
+
+    // Reads back finished frames and starts recording the next one. Frames
+    // are dropped while every set of queries is still in flight.
+    static void beginFrame();
+
+    static void enterZone(const char * name);
+    static void leaveZone();
+
+    // Copies the zones of the most recently read back frame, in the order
+    // they were entered.
+    static void getResults(std::vector<Result> & results);
+};
+
+
+/*
+ * Times the GL commands issued during the lifetime of the object.
+ */
+class GpuProfileScope {
+public:
+    explicit GpuProfileScope(const char * name) {
+        GpuProfiler::enterZone(name);
+    }
+
+    ~GpuProfileScope() {
+        GpuProfiler::leaveZone();
+    }
+
+private:
+    GpuProfileScope(const GpuProfileScope &);
+    GpuProfileScope & operator=(const GpuProfileScope &);
+};
+
+
+#ifdef CS488_PROFILE
+    #define GPU_PROFILE_SCOPE(name) GpuProfileScope PROFILE_CONCAT(gpuProfileScope, __LINE__)(name)
+    #define GPU_PROFILE_ENTER(name) GpuProfiler::enterZone(name)
+    #define GPU_PROFILE_LEAVE() GpuProfiler::leaveZone()
+    #define GPU_PROFILE_FRAME() GpuProfiler::beginFrame()
+#else
+    #define GPU_PROFILE_SCOPE(name) do { } while (0)
+    #define GPU_PROFILE_ENTER(name) do { } while (0)
+    #define GPU_PROFILE_LEAVE() do { } while (0)
+    #define GPU_PROFILE_FRAME() do { } while (0)
+#endif
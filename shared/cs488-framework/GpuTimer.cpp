@@ -0,0 +1,91 @@
+#include "GpuTimer.hpp"
+#include "GlErrorCheck.hpp"
+
+//------------------------------------------------------------------------------------
+GpuTimer::GpuTimer()
+    : nextQuery(0),
+      oldestQuery(0),
+      timing(false)
+{
+    for (int i = 0; i < NUM_QUERIES; ++i) {
+        queries[i] = 0;
+        pending[i] = false;
+    }
+}
+
+//------------------------------------------------------------------------------------
+GpuTimer::~GpuTimer() {
+    destroy();
+}
+
+//------------------------------------------------------------------------------------
+void GpuTimer::init() {
+    if (queries[0] == 0) {
+        glGenQueries(NUM_QUERIES, queries);
+        CHECK_GL_ERRORS;
+    }
+}
+
+//------------------------------------------------------------------------------------
+void GpuTimer::destroy() {
+    if (queries[0] != 0) {
+        glDeleteQueries(NUM_QUERIES, queries);
+    }
+
+    for (int i = 0; i < NUM_QUERIES; ++i) {
+        queries[i] = 0;
+        pending[i] = false;
+    }
+    nextQuery = 0;
+    oldestQuery = 0;
+    timing = false;
+}
+
+//------------------------------------------------------------------------------------
+void GpuTimer::begin() {
+    // Skip this measurement if every query is still waiting on the GPU.
+    if (queries[0] == 0 || pending[nextQuery]) {
+        return;
+    }
+
+    glBeginQuery(GL_TIME_ELAPSED, queries[nextQuery]);
+    timing = true;
+}
+
+//------------------------------------------------------------------------------------
+void GpuTimer::end() {
+    if (!timing) {
+        return;
+    }
+
+    glEndQuery(GL_TIME_ELAPSED);
+    pending[nextQuery] = true;
+    nextQuery = (nextQuery + 1) % NUM_QUERIES;
+    timing = false;
+}
+
+//------------------------------------------------------------------------------------
+bool GpuTimer::poll (
+        float & milliseconds
+) {
+    bool found = false;
+
+    // Queries complete in order, so stop at the first one still in flight.
+    while (pending[oldestQuery]) {
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(queries[oldestQuery], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == GL_FALSE) {
+            break;
+        }
+
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(queries[oldestQuery], GL_QUERY_RESULT, &nanoseconds);
+        milliseconds = float(nanoseconds) * 1.0e-6f;
+        found = true;
+
+        pending[oldestQuery] = false;
+        oldestQuery = (oldestQuery + 1) % NUM_QUERIES;
+    }
+
+    return found;
+}
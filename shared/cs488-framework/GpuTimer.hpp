@@ -0,0 +1,44 @@
+/*
+ * GpuTimer
+ */
+
+#pragma once
+
+#include "OpenGLImport.hpp"
+
+
+/*
+ * Measures GPU time between begin() and end() with GL_TIME_ELAPSED queries.
+ * Results are read back a few frames later, once available, so the CPU never
+ * waits on the GPU.  Measurements are dropped while all queries are in flight.
+ */
+class GpuTimer {
+public:
+    GpuTimer();
+
+    ~GpuTimer();
+
+    void init();
+
+    void destroy();
+
+    void begin();
+
+    void end();
+
+    // Returns true and sets 'milliseconds' to the most recent completed
+    // measurement, if one became available since the last call.
+    bool poll(float & milliseconds);
+
+
+private:
+    static const int NUM_QUERIES = 4;
+
+    GLuint queries[NUM_QUERIES];
+    bool pending[NUM_QUERIES];
+
+    int nextQuery;
+    int oldestQuery;
+    bool timing;
+};
+
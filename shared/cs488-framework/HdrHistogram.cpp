@@ -0,0 +1,125 @@
+#include "HdrHistogram.hpp"
+
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+namespace {
+
+// Position of the highest set bit, plus one.
+int bitLength(uint64_t value) {
+    int length = 0;
+    while (value != 0) {
+        value >>= 1;
+        ++length;
+    }
+    return length;
+}
+
+}
+
+//------------------------------------------------------------------------------------
+HdrHistogram::HdrHistogram(uint64_t highestTrackableValue)
+    : highestTrackableValue(std::max<uint64_t>(highestTrackableValue, 2 * SUB_BUCKET_HALF_COUNT))
+{
+    counts.resize(countsIndex(this->highestTrackableValue) + 1);
+    reset();
+}
+
+//------------------------------------------------------------------------------------
+size_t HdrHistogram::countsIndex(uint64_t value) const {
+    // Bucket 0 covers [0, 2048) exactly; each later bucket covers twice the
+    // range of the one before at half the resolution.
+    int bucket = bitLength(value | SUB_BUCKET_MASK) - (SUB_BUCKET_HALF_COUNT_MAGNITUDE + 1);
+    uint64_t subBucket = value >> bucket;
+    return size_t((uint64_t(bucket + 1) << SUB_BUCKET_HALF_COUNT_MAGNITUDE) + (subBucket - SUB_BUCKET_HALF_COUNT));
+}
+
+//------------------------------------------------------------------------------------
+uint64_t HdrHistogram::highestEquivalentValue(size_t index) const {
+    int bucket = int(index >> SUB_BUCKET_HALF_COUNT_MAGNITUDE) - 1;
+    uint64_t subBucket = (index & (SUB_BUCKET_HALF_COUNT - 1)) + SUB_BUCKET_HALF_COUNT;
+    if (bucket < 0) {
+        subBucket -= SUB_BUCKET_HALF_COUNT;
+        bucket = 0;
+    }
+
+    uint64_t lowest = subBucket << bucket;
+    return lowest + (uint64_t(1) << bucket) - 1;
+}
+
+//------------------------------------------------------------------------------------
+void HdrHistogram::record(uint64_t value) {
+    counts[countsIndex(std::min(value, highestTrackableValue))] += 1;
+
+    ++totalCount;
+    minValue = std::min(minValue, value);
+    maxValue = std::max(maxValue, value);
+    sum += double(value);
+}
+
+//------------------------------------------------------------------------------------
+void HdrHistogram::reset() {
+    fill(counts.begin(), counts.end(), 0);
+    totalCount = 0;
+    minValue = numeric_limits<uint64_t>::max();
+    maxValue = 0;
+    sum = 0.0;
+}
+
+//------------------------------------------------------------------------------------
+uint64_t HdrHistogram::count() const {
+    return totalCount;
+}
+
+//------------------------------------------------------------------------------------
+uint64_t HdrHistogram::min() const {
+    return totalCount == 0 ? 0 : minValue;
+}
+
+//------------------------------------------------------------------------------------
+uint64_t HdrHistogram::max() const {
+    return maxValue;
+}
+
+//------------------------------------------------------------------------------------
+double HdrHistogram::mean() const {
+    return totalCount == 0 ? 0.0 : sum / double(totalCount);
+}
+
+//------------------------------------------------------------------------------------
+uint64_t HdrHistogram::valueAtPercentile(double percentile) const {
+    uint64_t value = 0;
+    valuesAtPercentiles(&percentile, 1, &value);
+    return value;
+}
+
+//------------------------------------------------------------------------------------
+void HdrHistogram::valuesAtPercentiles (
+        const double * percentiles,
+        size_t count,
+        uint64_t * values
+) const {
+    size_t next = 0;
+    uint64_t seen = 0;
+
+    for (size_t index = 0; index < counts.size() && next < count; ++index) {
+        seen += counts[index];
+
+        // Every percentile whose rank has been reached by this bucket.
+        while (next < count) {
+            double fraction = std::min(std::max(percentiles[next], 0.0), 100.0) / 100.0;
+            uint64_t rank = std::max<uint64_t>(1, uint64_t(fraction * double(totalCount) + 0.5));
+            if (seen < rank) {
+                break;
+            }
+            values[next++] = rank == totalCount ? maxValue : std::min(highestEquivalentValue(index), maxValue);
+        }
+    }
+
+    // Nothing recorded.
+    for (; next < count; ++next) {
+        values[next] = 0;
+    }
+}
@@ -0,0 +1,59 @@
+/*
+ * HdrHistogram
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+/*
+ * Fixed memory histogram of integer values with three significant decimal
+ * digits of precision at any magnitude, after Gil Tene's HdrHistogram.
+ *
+ * Values are grouped into buckets that double in size: bucket n holds values
+ * up to 2^(n + 11), split into 1024 equal sub-buckets (2048 for bucket 0).
+ * Recording is a few shifts and an increment, and memory does not grow with
+ * the number of values recorded. Values above the highest trackable value
+ * are clamped to it, although max() is always exact.
+ */
+class HdrHistogram {
+public:
+    // Tracks values from 0 to 'highestTrackableValue'.
+    explicit HdrHistogram(uint64_t highestTrackableValue);
+
+    void record(uint64_t value);
+
+    void reset();
+
+    uint64_t count() const;
+    uint64_t min() const;
+    uint64_t max() const;
+    double mean() const;
+
+    // Gets the value at a percentile in [0, 100]. Reported values are the
+    // highest value equivalent to the recorded ones.
+    uint64_t valueAtPercentile(double percentile) const;
+
+    // Gets several percentiles, in ascending order, in a single pass.
+    void valuesAtPercentiles(const double * percentiles, size_t count, uint64_t * values) const;
+
+
+private:
+    size_t countsIndex(uint64_t value) const;
+    uint64_t highestEquivalentValue(size_t index) const;
+
+    static const int SUB_BUCKET_HALF_COUNT_MAGNITUDE = 10;
+    static const uint64_t SUB_BUCKET_HALF_COUNT = 1 << SUB_BUCKET_HALF_COUNT_MAGNITUDE;
+    static const uint64_t SUB_BUCKET_MASK = 2 * SUB_BUCKET_HALF_COUNT - 1;
+
+    uint64_t highestTrackableValue;
+    std::vector<uint32_t> counts;
+
+    uint64_t totalCount;
+    uint64_t minValue;
+    uint64_t maxValue;
+    double sum;
+};
@@ -0,0 +1,179 @@
+#include "HeadlessContext.hpp"
+#include "cs488-framework/Exception.hpp"
+#include "cs488-framework/GlDebug.hpp"
+#include "cs488-framework/OpenGLImport.hpp"
+
+#include <sstream>
+
+#ifdef __linux__
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+using namespace std;
+
+//-- Forward Declarations:
+extern "C" {
+	int gl3wInit(void);
+}
+
+#ifdef __linux__
+//----------------------------------------------------------------------------------------
+static void throwEglError(const char * call) {
+	stringstream msg;
+	msg << "Headless context: " << call << " failed with EGL error 0x"
+		<< hex << eglGetError();
+	throw Exception(msg.str());
+}
+
+//----------------------------------------------------------------------------------------
+/*
+ * Returns Mesa's surfaceless display if available, which renders without any
+ * window system or GPU device, otherwise the default display.
+ */
+static EGLDisplay getHeadlessDisplay() {
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+	if (getPlatformDisplay != nullptr) {
+		EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+				EGL_DEFAULT_DISPLAY, nullptr);
+		if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr)) {
+			return display;
+		}
+	}
+
+	EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+		throwEglError("eglInitialize");
+	}
+	return display;
+}
+#endif
+
+//----------------------------------------------------------------------------------------
+// Constructor
+HeadlessContext::HeadlessContext()
+	: m_display(nullptr),
+	  m_context(nullptr),
+	  m_surface(nullptr)
+{
+
+}
+
+//----------------------------------------------------------------------------------------
+// Destructor
+HeadlessContext::~HeadlessContext() {
+	destroy();
+}
+
+//----------------------------------------------------------------------------------------
+void HeadlessContext::create(int width, int height) {
+#ifdef __linux__
+	EGLDisplay display = getHeadlessDisplay();
+	m_display = display;
+
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		throwEglError("eglBindAPI");
+	}
+
+	// A pbuffer config is only needed when surfaceless contexts are not, or
+	// a default framebuffer was asked for.
+	const char * extensions = eglQueryString(display, EGL_EXTENSIONS);
+	bool surfaceless = width <= 0 && height <= 0 && extensions != nullptr &&
+		string(extensions).find("EGL_KHR_surfaceless_context") != string::npos;
+
+	const EGLint configAttribs[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_ALPHA_SIZE, 8,
+		EGL_DEPTH_SIZE, 24,
+		EGL_NONE
+	};
+
+	EGLConfig config = nullptr;
+	EGLint numConfigs = 0;
+	eglChooseConfig(display, configAttribs, &config, 1, &numConfigs);
+	if (numConfigs == 0 && !surfaceless) {
+		throwEglError("eglChooseConfig");
+	}
+
+	const EGLint contextAttribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_CONTEXT_OPENGL_DEBUG, CS488_GL_DEBUG_LEVEL > 0 ? EGL_TRUE : EGL_FALSE,
+		EGL_NONE
+	};
+
+	EGLContext context = eglCreateContext(display, numConfigs > 0 ? config : EGL_NO_CONFIG_KHR,
+			EGL_NO_CONTEXT, contextAttribs);
+	if (context == EGL_NO_CONTEXT) {
+		throwEglError("eglCreateContext");
+	}
+	m_context = context;
+
+	EGLSurface surface = EGL_NO_SURFACE;
+	if (!surfaceless) {
+		const EGLint pbufferAttribs[] = {
+			EGL_WIDTH, width > 0 ? width : 1,
+			EGL_HEIGHT, height > 0 ? height : 1,
+			EGL_NONE
+		};
+		surface = eglCreatePbufferSurface(display, config, pbufferAttribs);
+		if (surface == EGL_NO_SURFACE) {
+			throwEglError("eglCreatePbufferSurface");
+		}
+		m_surface = surface;
+	}
+
+	if (!eglMakeCurrent(display, surface, surface, context)) {
+		throwEglError("eglMakeCurrent");
+	}
+
+	gl3wInit();
+#else
+	throw Exception("Headless rendering is only supported on Linux.");
+#endif
+}
+
+//----------------------------------------------------------------------------------------
+void HeadlessContext::destroy() {
+#ifdef __linux__
+	if (m_display == nullptr) {
+		return;
+	}
+
+	eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+	if (m_surface != nullptr) {
+		eglDestroySurface(m_display, m_surface);
+	}
+	if (m_context != nullptr) {
+		eglDestroyContext(m_display, m_context);
+	}
+	eglTerminate(m_display);
+#endif
+
+	m_display = nullptr;
+	m_context = nullptr;
+	m_surface = nullptr;
+}
+
+//----------------------------------------------------------------------------------------
+bool HeadlessContext::isCurrent() const {
+#ifdef __linux__
+	return m_context != nullptr && eglGetCurrentContext() == m_context;
+#else
+	return false;
+#endif
+}
+
+//----------------------------------------------------------------------------------------
+const char * HeadlessContext::getRenderer() {
+	const GLubyte * renderer = glGetString(GL_RENDERER);
+	return renderer ? (const char *) renderer : "unknown";
+}
@@ -0,0 +1,43 @@
+/*
+ * HeadlessContext
+ */
+
+#pragma once
+
+/*
+ * OpenGL 3.3 core context that is not attached to any window or window
+ * system.  On Linux it is created through EGL, preferring Mesa's surfaceless
+ * platform so no display server is needed, and falling back to the default
+ * EGL display.  Unless it is created with a size, rendering must go to
+ * framebuffer objects.
+ *
+ * Throws an Exception if no context can be created.
+ */
+class HeadlessContext {
+public:
+	HeadlessContext();
+
+	~HeadlessContext();
+
+	// Creates the context, makes it current and loads GL entry points. When
+	// a size is given the context also gets a pbuffer of that size, so the
+	// default framebuffer can be drawn to as a window's would be.
+	void create(int width = 0, int height = 0);
+
+	void destroy();
+
+	bool isCurrent() const;
+
+	// Returns a description of the GL renderer, e.g. "llvmpipe (LLVM 15.0.6)".
+	static const char * getRenderer();
+
+
+private:
+	HeadlessContext(const HeadlessContext &);
+	HeadlessContext & operator = (const HeadlessContext &);
+
+	void * m_display;
+	void * m_context;
+	void * m_surface;
+};
+
@@ -0,0 +1,52 @@
+#include "ImageWriter.hpp"
+#include "cs488-framework/Exception.hpp"
+#include "cs488-framework/OpenGLImport.hpp"
+
+#include <cstdio>
+#include <sstream>
+using namespace std;
+
+//---------------------------------------------------------------------------------------
+void ImageWriter::writePPM(
+		const char * filePath,
+		int width,
+		int height,
+		const unsigned char * rgb,
+		bool bottomUp
+) {
+	FILE * file = fopen(filePath, "wb");
+	if (file == nullptr) {
+		stringstream errorMessage;
+		errorMessage << "Unable to open image file " << filePath
+			<< " within method ImageWriter::writePPM" << endl;
+		throw Exception(errorMessage.str());
+	}
+
+	fprintf(file, "P6\n%d %d\n255\n", width, height);
+
+	const size_t rowBytes = size_t(width) * 3;
+	bool ok = true;
+	for (int row = 0; row < height && ok; ++row) {
+		int src = bottomUp ? height - 1 - row : row;
+		ok = fwrite(rgb + size_t(src) * rowBytes, 1, rowBytes, file) == rowBytes;
+	}
+
+	if (fclose(file) != 0 || !ok) {
+		stringstream errorMessage;
+		errorMessage << "Error writing image file " << filePath << endl;
+		throw Exception(errorMessage.str());
+	}
+}
+
+//---------------------------------------------------------------------------------------
+void ImageWriter::readFramebuffer(
+		int width,
+		int height,
+		std::vector<unsigned char> & rgb
+) {
+	rgb.resize(size_t(width) * height * 3);
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, rgb.data());
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+}
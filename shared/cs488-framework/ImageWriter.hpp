@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+
+class ImageWriter {
+public:
+
+	/**
+	* Writes 8-bit RGB pixels to a binary PPM (P6) file.
+	* Throws an Exception if the file cannot be written.
+	*
+	* [in] filePath - path of the image to write.
+	* [in] width, height - image dimensions in pixels.
+	* [in] rgb - width * height * 3 bytes, rows stored top to bottom unless
+	*            bottomUp is set (as returned by glReadPixels).
+	*/
+	static void writePPM(
+			const char * filePath,
+			int width,
+			int height,
+			const unsigned char * rgb,
+			bool bottomUp = false
+	);
+
+	/**
+	* Reads the colour buffer of the currently bound read framebuffer.
+	*
+	* [out] rgb - width * height * 3 bytes, rows stored bottom to top.
+	*/
+	static void readFramebuffer(
+			int width,
+			int height,
+			std::vector<unsigned char> & rgb
+	);
+
+};
+
@@ -0,0 +1,390 @@
+#include "InputLog.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+const char MAGIC[4] = { 'S', 'I', 'N', 'P' };
+const uint32_t VERSION = 1;
+
+// Events are buffered and written in blocks of about this size.
+const size_t FLUSH_BYTES = 64 * 1024;
+
+uint64_t nowMicroseconds() {
+    return uint64_t(chrono::duration_cast<chrono::microseconds>(
+            chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/*
+ * Reads the values written by InputLog from a file loaded into memory.
+ * Reads past the end set 'failed' and return zero.
+ */
+struct Reader {
+    const uint8_t * data;
+    size_t size;
+    size_t offset;
+    bool failed;
+
+    Reader(const uint8_t * data, size_t size)
+        : data(data), size(size), offset(0), failed(false) { }
+
+    bool atEnd() const {
+        return offset >= size;
+    }
+
+    uint8_t readByte() {
+        if (offset >= size) {
+            failed = true;
+            return 0;
+        }
+        return data[offset++];
+    }
+
+    uint64_t readVarint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t byte = readByte();
+            value |= uint64_t(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+        failed = true;
+        return 0;
+    }
+
+    int readInt() {
+        uint64_t zigzag = readVarint();
+        return int(int64_t(zigzag >> 1) ^ -int64_t(zigzag & 1));
+    }
+
+    double readDouble() {
+        uint64_t bits = 0;
+        for (int idx = 0; idx < 8; ++idx) {
+            bits |= uint64_t(readByte()) << (idx * 8);
+        }
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+};
+
+}
+
+//------------------------------------------------------------------------------------
+InputLog::Event::Event(EventType type)
+    : type(type), frame(0), microseconds(0), x(0.0), y(0.0)
+{
+    values[0] = values[1] = values[2] = values[3] = 0;
+}
+
+//------------------------------------------------------------------------------------
+InputLog::Header::Header()
+    : windowWidth(0),
+      windowHeight(0),
+      framebufferWidth(0),
+      framebufferHeight(0),
+      framesPerSecond(60.0f)
+{
+
+}
+
+//------------------------------------------------------------------------------------
+InputLog::InputLog()
+    : file(nullptr),
+      writeFailed(false),
+      frame(0),
+      lastFrame(0),
+      frameStart(0),
+      nextEvent(0),
+      replaying(false)
+{
+
+}
+
+//------------------------------------------------------------------------------------
+InputLog::~InputLog() {
+    stopRecording();
+}
+
+//------------------------------------------------------------------------------------
+void InputLog::writeVarint(Buffer & buffer, uint64_t value) {
+    while (value >= 0x80) {
+        buffer.push_back(uint8_t(value | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back(uint8_t(value));
+}
+
+//------------------------------------------------------------------------------------
+void InputLog::writeInt(Buffer & buffer, int value) {
+    int64_t wide = value;
+    writeVarint(buffer, uint64_t((wide << 1) ^ (wide >> 63)));
+}
+
+//------------------------------------------------------------------------------------
+void InputLog::writeDouble(Buffer & buffer, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    for (int idx = 0; idx < 8; ++idx) {
+        buffer.push_back(uint8_t(bits >> (idx * 8)));
+    }
+}
+
+//------------------------------------------------------------------------------------
+bool InputLog::flush() {
+    if (file != nullptr && !pending.empty()) {
+        if (fwrite(pending.data(), 1, pending.size(), file) != pending.size()) {
+            writeFailed = true;
+        }
+    }
+    pending.clear();
+    return !writeFailed;
+}
+
+//------------------------------------------------------------------------------------
+bool InputLog::startRecording(const string & filePath, const Header & header) {
+    stopRecording();
+
+    file = fopen(filePath.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    this->header = header;
+    writeFailed = false;
+    frame = 0;
+    lastFrame = 0;
+    frameStart = nowMicroseconds();
+
+    pending.assign(MAGIC, MAGIC + sizeof(MAGIC));
+    writeVarint(pending, VERSION);
+    writeInt(pending, header.windowWidth);
+    writeInt(pending, header.windowHeight);
+    writeInt(pending, header.framebufferWidth);
+    writeInt(pending, header.framebufferHeight);
+    writeDouble(pending, header.framesPerSecond);
+
+    return flush();
+}
+
+//------------------------------------------------------------------------------------
+bool InputLog::isRecording() const {
+    return file != nullptr;
+}
+
+//------------------------------------------------------------------------------------
+void InputLog::beginFrame() {
+    if (file == nullptr) {
+        return;
+    }
+
+    ++frame;
+    frameStart = nowMicroseconds();
+
+    if (pending.size() >= FLUSH_BYTES) {
+        flush();
+    }
+}
+
+//------------------------------------------------------------------------------------
+void InputLog::record(const Event & event) {
+    if (file == nullptr) {
+        return;
+    }
+
+    pending.push_back(uint8_t(event.type));
+    writeVarint(pending, frame - lastFrame);
+    writeVarint(pending, nowMicroseconds() - frameStart);
+    lastFrame = frame;
+
+    switch (event.type) {
+    case EVENT_KEY:
+        writeInt(pending, event.values[0]);
+        writeInt(pending, event.values[1]);
+        writeInt(pending, event.values[2]);
+        writeInt(pending, event.values[3]);
+        break;
+    case EVENT_MOUSE_BUTTON:
+        writeInt(pending, event.values[0]);
+        writeInt(pending, event.values[1]);
+        writeInt(pending, event.values[2]);
+        break;
+    case EVENT_MOUSE_MOVE:
+    case EVENT_SCROLL:
+        writeDouble(pending, event.x);
+        writeDouble(pending, event.y);
+        break;
+    case EVENT_RESIZE:
+        writeInt(pending, event.values[0]);
+        writeInt(pending, event.values[1]);
+        writeInt(pending, event.values[2]);
+        writeInt(pending, event.values[3]);
+        break;
+    case EVENT_CURSOR_ENTER:
+        writeInt(pending, event.values[0]);
+        break;
+    default:
+        break;
+    }
+}
+
+//------------------------------------------------------------------------------------
+bool InputLog::stopRecording() {
+    if (file == nullptr) {
+        return true;
+    }
+
+    record(Event(EVENT_END));
+    bool ok = flush();
+    ok = fclose(file) == 0 && ok;
+    file = nullptr;
+    return ok;
+}
+
+//------------------------------------------------------------------------------------
+bool InputLog::load(const string & filePath) {
+    replaying = false;
+    events.clear();
+    nextEvent = 0;
+    frame = 0;
+
+    FILE * input = fopen(filePath.c_str(), "rb");
+    if (input == nullptr) {
+        return false;
+    }
+
+    Buffer data;
+    uint8_t block[FLUSH_BYTES];
+    size_t count;
+    while ((count = fread(block, 1, sizeof(block), input)) > 0) {
+        data.insert(data.end(), block, block + count);
+    }
+    bool readFailed = ferror(input) != 0;
+    fclose(input);
+
+    if (readFailed || data.size() < sizeof(MAGIC) || memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0) {
+        return false;
+    }
+
+    Reader reader(data.data() + sizeof(MAGIC), data.size() - sizeof(MAGIC));
+    if (reader.readVarint() != VERSION) {
+        return false;
+    }
+
+    header.windowWidth = reader.readInt();
+    header.windowHeight = reader.readInt();
+    header.framebufferWidth = reader.readInt();
+    header.framebufferHeight = reader.readInt();
+    header.framesPerSecond = float(reader.readDouble());
+
+    uint32_t eventFrame = 0;
+    while (!reader.atEnd() && !reader.failed) {
+        uint8_t type = reader.readByte();
+        if (type >= NUM_EVENT_TYPES) {
+            return false;
+        }
+
+        Event event = Event(EventType(type));
+        eventFrame += uint32_t(reader.readVarint());
+        event.frame = eventFrame;
+        event.microseconds = uint32_t(reader.readVarint());
+
+        switch (event.type) {
+        case EVENT_KEY:
+        case EVENT_RESIZE:
+            for (int idx = 0; idx < 4; ++idx) {
+                event.values[idx] = reader.readInt();
+            }
+            break;
+        case EVENT_MOUSE_BUTTON:
+            for (int idx = 0; idx < 3; ++idx) {
+                event.values[idx] = reader.readInt();
+            }
+            break;
+        case EVENT_MOUSE_MOVE:
+        case EVENT_SCROLL:
+            event.x = reader.readDouble();
+            event.y = reader.readDouble();
+            break;
+        case EVENT_CURSOR_ENTER:
+            event.values[0] = reader.readInt();
+            break;
+        default:
+            break;
+        }
+
+        if (reader.failed) {
+            break;
+        }
+
+        events.push_back(event);
+        if (event.type == EVENT_END) {
+            break;
+        }
+    }
+
+    // A log cut short, e.g. by a crash, has no end marker and may end part
+    // way through an event, so end on the last frame read in full.
+    if (events.empty() || events.back().type != EVENT_END) {
+        Event end = Event(EVENT_END);
+        end.frame = events.empty() ? 0 : events.back().frame;
+        events.push_back(end);
+    }
+
+    replaying = header.framesPerSecond > 0.0f;
+    return replaying;
+}
+
+//------------------------------------------------------------------------------------
+bool InputLog::isReplaying() const {
+    return replaying;
+}
+
+//------------------------------------------------------------------------------------
+const InputLog::Header & InputLog::getHeader() const {
+    return header;
+}
+
+//------------------------------------------------------------------------------------
+void InputLog::getMaxFramebufferSize(int & width, int & height) const {
+    width = header.framebufferWidth;
+    height = header.framebufferHeight;
+    for (const Event & event : events) {
+        if (event.type == EVENT_RESIZE) {
+            width = max(width, event.values[2]);
+            height = max(height, event.values[3]);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------
+bool InputLog::nextFrame(vector<Event> & frameEvents) {
+    frameEvents.clear();
+    if (!replaying || frame >= getFrameCount()) {
+        return false;
+    }
+
+    // Recorded frames are counted from one, after the first beginFrame(),
+    // so events from before the first frame are delivered with it.
+    ++frame;
+    while (nextEvent < events.size() && events[nextEvent].frame <= frame &&
+            events[nextEvent].type != EVENT_END) {
+        frameEvents.push_back(events[nextEvent++]);
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------------
+uint32_t InputLog::getFrame() const {
+    return frame;
+}
+
+//------------------------------------------------------------------------------------
+uint32_t InputLog::getFrameCount() const {
+    return events.empty() ? 0 : events.back().frame;
+}
@@ -0,0 +1,136 @@
+/*
+ * InputLog
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+
+/*
+ * Records the window events of a session to a compact binary log and plays
+ * them back a frame at a time.
+ *
+ * Each event is stored with the index of the frame it was delivered in and
+ * the time since that frame began. A replay delivers all of the events of a
+ * frame before the frame runs, so the application sees the same input on the
+ * same frames however long each frame takes.
+ *
+ * The file is a header (magic, version, window and framebuffer size, frame
+ * rate) followed by the events: a type byte, the frame as a delta from the
+ * previous event and the time in microseconds as LEB128 varints, then the
+ * payload. Integers are zigzag varints and positions 8 byte doubles, all
+ * little endian. The last event is EVENT_END on the frame the session ended.
+ */
+class InputLog {
+public:
+    enum EventType {
+        EVENT_KEY,
+        EVENT_MOUSE_BUTTON,
+        EVENT_MOUSE_MOVE,
+        EVENT_SCROLL,
+        EVENT_RESIZE,
+        EVENT_CURSOR_ENTER,
+        EVENT_END,
+        NUM_EVENT_TYPES
+    };
+
+    struct Event {
+        EventType type;
+        uint32_t frame;
+        uint32_t microseconds;
+
+        // EVENT_KEY: key, scancode, action, mods.
+        // EVENT_MOUSE_BUTTON: button, action, mods.
+        // EVENT_RESIZE: window width, height, framebuffer width, height.
+        // EVENT_CURSOR_ENTER: entered.
+        int values[4];
+
+        // Cursor position or scroll offset.
+        double x;
+        double y;
+
+        Event(EventType type = EVENT_END);
+    };
+
+    struct Header {
+        int windowWidth;
+        int windowHeight;
+        int framebufferWidth;
+        int framebufferHeight;
+        float framesPerSecond;
+
+        Header();
+    };
+
+    InputLog();
+
+    ~InputLog();
+
+    // Opens the file and writes the header. Returns false if it cannot be
+    // written.
+    bool startRecording(const std::string & filePath, const Header & header);
+
+    bool isRecording() const;
+
+    // Starts the next frame of a recording.
+    void beginFrame();
+
+    // Appends an event to the current frame of a recording.
+    void record(const Event & event);
+
+    // Writes the end marker and closes the file. Returns false if any of the
+    // log could not be written.
+    bool stopRecording();
+
+    // Reads a log for replay. Returns false if the file cannot be read or is
+    // not a valid log.
+    bool load(const std::string & filePath);
+
+    bool isReplaying() const;
+
+    const Header & getHeader() const;
+
+    // Gets the largest framebuffer of a replay, from the header and the
+    // resize events.
+    void getMaxFramebufferSize(int & width, int & height) const;
+
+    // Gets the events of the next frame of a replay. Returns false once the
+    // frame the session ended on has been reached.
+    bool nextFrame(std::vector<Event> & events);
+
+    // Frames replayed so far, and the length of the session.
+    uint32_t getFrame() const;
+    uint32_t getFrameCount() const;
+
+
+private:
+    InputLog(const InputLog &);
+    InputLog & operator = (const InputLog &);
+
+    typedef std::vector<uint8_t> Buffer;
+
+    static void writeVarint(Buffer & buffer, uint64_t value);
+    static void writeInt(Buffer & buffer, int value);
+    static void writeDouble(Buffer & buffer, double value);
+
+    bool flush();
+
+    Header header;
+
+    // Recording
+    FILE * file;
+    Buffer pending;
+    bool writeFailed;
+    uint32_t frame;
+    uint32_t lastFrame;
+    uint64_t frameStart;
+
+    // Replay
+    std::vector<Event> events;
+    size_t nextEvent;
+    bool replaying;
+};
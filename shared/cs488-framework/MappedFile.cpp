@@ -0,0 +1,103 @@
+#include "MappedFile.hpp"
+
+#include <fstream>
+#include <iterator>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAPPED_FILE_MMAP 1
+#endif
+
+using namespace std;
+
+//------------------------------------------------------------------------------------
+MappedFile::MappedFile()
+    : data(nullptr),
+      size(0),
+      opened(false),
+      mapped(false)
+{
+
+}
+
+//------------------------------------------------------------------------------------
+MappedFile::~MappedFile() {
+    close();
+}
+
+//------------------------------------------------------------------------------------
+bool MappedFile::open(const string & filePath, Access access) {
+    close();
+
+#ifdef MAPPED_FILE_MMAP
+    int fd = ::open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) != 0 || !S_ISREG(status.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+
+    // Empty files cannot be mapped, but are valid.
+    if (status.st_size > 0) {
+        void * mapping = mmap(nullptr, size_t(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            ::close(fd);
+            return false;
+        }
+
+        madvise(mapping, size_t(status.st_size), access == ACCESS_SEQUENTIAL ? MADV_SEQUENTIAL : MADV_RANDOM);
+        data = (const uint8_t *) mapping;
+        size = size_t(status.st_size);
+        mapped = true;
+    }
+    ::close(fd);
+#else
+    ifstream file(filePath.c_str(), ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    buffer.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+    data = buffer.data();
+    size = buffer.size();
+#endif
+
+    opened = true;
+    return true;
+}
+
+//------------------------------------------------------------------------------------
+void MappedFile::close() {
+#ifdef MAPPED_FILE_MMAP
+    if (mapped) {
+        munmap((void *) data, size);
+    }
+#endif
+    buffer.clear();
+    data = nullptr;
+    size = 0;
+    opened = false;
+    mapped = false;
+}
+
+//------------------------------------------------------------------------------------
+bool MappedFile::isOpen() const {
+    return opened;
+}
+
+//------------------------------------------------------------------------------------
+const uint8_t * MappedFile::getData() const {
+    return data;
+}
+
+//------------------------------------------------------------------------------------
+size_t MappedFile::getSize() const {
+    return size;
+}
@@ -0,0 +1,52 @@
+/*
+ * MappedFile
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+/*
+ * A file mapped read only into memory. Pages are read in by the OS as they
+ * are first touched. Platforms without mmap() read the whole file instead.
+ */
+class MappedFile {
+public:
+    enum Access {
+        ACCESS_RANDOM,
+        ACCESS_SEQUENTIAL
+    };
+
+    MappedFile();
+
+    ~MappedFile();
+
+    // Maps a file. 'access' tells the OS how it will be read, so sequential
+    // reads can be read ahead. Returns false if the file cannot be read.
+    bool open(const std::string & filePath, Access access = ACCESS_RANDOM);
+
+    void close();
+
+    bool isOpen() const;
+
+    // Valid until the file is closed. Not null terminated.
+    const uint8_t * getData() const;
+
+    size_t getSize() const;
+
+private:
+    MappedFile(const MappedFile &);
+    MappedFile & operator = (const MappedFile &);
+
+    const uint8_t * data;
+    size_t size;
+    bool opened;
+    bool mapped;
+
+    // Read into memory where the file cannot be mapped.
+    std::vector<uint8_t> buffer;
+};
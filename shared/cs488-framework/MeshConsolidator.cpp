@@ -2,9 +2,281 @@
 using namespace glm;
 using namespace std;
 
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include <sys/stat.h>
+
+#include "cs488-framework/AssetPack.hpp"
 #include "cs488-framework/Exception.hpp"
+#include "cs488-framework/MappedFile.hpp"
 #include "cs488-framework/ObjFileDecoder.hpp"
 
+namespace {
+
+/*
+* Decoded meshes are cached next to their .obj file, in "<file>.meshcache":
+* a 64 byte CacheHeader, then the batch table, the mesh names, the positions,
+* the normals and the indices, each starting on a 64 byte boundary. Indices
+* are 16 bit if the vertices allow it. The header records the size,
+* modification time and FNV-1a hash of the source, so edited sources are
+* decoded again.
+*/
+const char CACHE_MAGIC[4] = { 'S', 'P', 'M', 'C' };
+const uint32_t CACHE_VERSION = 1;
+const size_t CACHE_ALIGNMENT = 64;
+
+struct CacheHeader {
+	char magic[4];
+	uint32_t version;
+	uint64_t sourceSize;
+	// Nanoseconds since the epoch, or 0 for sources in an AssetPack.
+	int64_t sourceTime;
+	uint64_t sourceHash;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t indexSize;
+	uint32_t batchCount;
+	uint32_t namesSize;
+	uint32_t reserved[3];
+};
+
+static_assert(sizeof(CacheHeader) == 64, "Mesh cache header must be 64 bytes");
+
+struct CacheBatch {
+	uint32_t nameOffset;
+	uint32_t nameLength;
+	uint32_t startIndex;
+	uint32_t numIndices;
+	uint32_t baseVertex;
+	uint32_t reserved;
+};
+
+// Where each section of a cache file starts, and its total size.
+struct CacheLayout {
+	size_t batches;
+	size_t names;
+	size_t positions;
+	size_t normals;
+	size_t indices;
+	size_t size;
+
+	explicit CacheLayout(const CacheHeader & header) {
+		batches = align(sizeof(CacheHeader));
+		names = align(batches + size_t(header.batchCount) * sizeof(CacheBatch));
+		positions = align(names + header.namesSize);
+		normals = align(positions + size_t(header.vertexCount) * sizeof(vec3));
+		indices = align(normals + size_t(header.vertexCount) * sizeof(vec3));
+		size = indices + size_t(header.indexCount) * header.indexSize;
+	}
+
+	static size_t align(size_t offset) {
+		return (offset + CACHE_ALIGNMENT - 1) & ~(CACHE_ALIGNMENT - 1);
+	}
+};
+
+/*
+* What a cache file was made from.
+*/
+struct SourceInfo {
+	uint64_t size;
+	int64_t time;
+	uint64_t hash;
+	bool hashed;
+};
+
+bool & cacheEnabled() {
+	static bool enabled = getenv("CS488_MESH_CACHE") == nullptr ||
+			strcmp(getenv("CS488_MESH_CACHE"), "0") != 0;
+	return enabled;
+}
+
+string getCachePath(const ObjFilePath & objFile) {
+	return objFile + ".meshcache";
+}
+
+// Returns false if the source cannot be found. Sources on disk are only
+// hashed when needed, as that reads all of them.
+bool getSourceInfo(const ObjFilePath & objFile, SourceInfo & info) {
+	AssetPack::Asset asset;
+	if (AssetPack::findFile(objFile, asset)) {
+		info.size = asset.size;
+		info.time = 0;
+		info.hash = asset.hash;
+		info.hashed = true;
+		return true;
+	}
+
+	struct stat status;
+	if (stat(objFile.c_str(), &status) != 0) {
+		return false;
+	}
+
+	info.size = uint64_t(status.st_size);
+#ifdef __APPLE__
+	info.time = int64_t(status.st_mtimespec.tv_sec) * 1000000000 + status.st_mtimespec.tv_nsec;
+#else
+	info.time = int64_t(status.st_mtim.tv_sec) * 1000000000 + status.st_mtim.tv_nsec;
+#endif
+	info.hashed = false;
+	return true;
+}
+
+bool hashSource(const ObjFilePath & objFile, SourceInfo & info) {
+	if (!info.hashed) {
+		MappedFile source;
+		if (!source.open(objFile, MappedFile::ACCESS_SEQUENTIAL)) {
+			return false;
+		}
+		info.hash = AssetPack::hash(source.getData(), source.getSize());
+		info.hashed = true;
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------------------
+/*
+* Writes a decoded mesh to its cache file. The file is renamed into place so
+* other processes never read part of it.
+*/
+void saveMeshCache (
+		const ObjFilePath & objFile,
+		SourceInfo & source,
+		const MeshId & meshId,
+		const vector<vec3> & positions,
+		const vector<vec3> & normals,
+		const vector<uint32_t> & indices
+) {
+	if (!hashSource(objFile, source)) {
+		return;
+	}
+
+	CacheHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	header.version = CACHE_VERSION;
+	header.sourceSize = source.size;
+	header.sourceTime = source.time;
+	header.sourceHash = source.hash;
+	header.vertexCount = uint32_t(positions.size());
+	header.indexCount = uint32_t(indices.size());
+	header.indexSize = positions.size() <= 65536 ? sizeof(uint16_t) : sizeof(uint32_t);
+	header.batchCount = 1;
+	header.namesSize = uint32_t(meshId.size());
+
+	CacheBatch batch;
+	memset(&batch, 0, sizeof(batch));
+	batch.nameLength = uint32_t(meshId.size());
+	batch.numIndices = uint32_t(indices.size());
+
+	CacheLayout layout(header);
+	vector<uint8_t> contents(layout.size, 0);
+	memcpy(&contents[0], &header, sizeof(header));
+	memcpy(&contents[layout.batches], &batch, sizeof(batch));
+	memcpy(&contents[layout.names], meshId.data(), meshId.size());
+	memcpy(&contents[layout.positions], positions.data(), positions.size() * sizeof(vec3));
+	memcpy(&contents[layout.normals], normals.data(), normals.size() * sizeof(vec3));
+	if (header.indexSize == sizeof(uint16_t)) {
+		uint16_t * shortIndices = (uint16_t *) &contents[layout.indices];
+		for (size_t idx = 0; idx < indices.size(); ++idx) {
+			shortIndices[idx] = uint16_t(indices[idx]);
+		}
+	} else {
+		memcpy(&contents[layout.indices], indices.data(), indices.size() * sizeof(uint32_t));
+	}
+
+	string cachePath = getCachePath(objFile);
+	string tempPath = cachePath + ".tmp";
+	FILE * file = fopen(tempPath.c_str(), "wb");
+	bool saved = file != nullptr && fwrite(contents.data(), 1, contents.size(), file) == contents.size();
+	if (file != nullptr) {
+		saved = fclose(file) == 0 && saved;
+	}
+
+	if (!saved || rename(tempPath.c_str(), cachePath.c_str()) != 0) {
+		remove(tempPath.c_str());
+		cerr << "Unable to write mesh cache " << cachePath << endl;
+	}
+}
+
+//----------------------------------------------------------------------------------------
+/*
+* Reads a mesh from its cache file, if there is one made from the current
+* source. A source with a new modification time but the same contents still
+* uses the cache, which is then rewritten with the new time.
+*/
+bool loadMeshCache (
+		const ObjFilePath & objFile,
+		SourceInfo & source,
+		MeshId & meshId,
+		vector<vec3> & positions,
+		vector<vec3> & normals,
+		vector<uint32_t> & indices
+) {
+	MappedFile cache;
+	if (!cache.open(getCachePath(objFile), MappedFile::ACCESS_SEQUENTIAL) ||
+			cache.getSize() < sizeof(CacheHeader)) {
+		return false;
+	}
+
+	const uint8_t * data = cache.getData();
+	CacheHeader header;
+	memcpy(&header, data, sizeof(header));
+	if (memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != CACHE_VERSION ||
+			header.batchCount != 1 || (header.indexSize != 2 && header.indexSize != 4) ||
+			header.sourceSize != source.size) {
+		return false;
+	}
+
+	CacheLayout layout(header);
+	if (cache.getSize() < layout.size) {
+		return false;
+	}
+
+	// Packed sources have no modification time, but their hash is free, so
+	// always compare it. On disk an unchanged time spares hashing the source.
+	bool touched = !source.hashed && header.sourceTime != source.time;
+	if ((source.hashed || touched) && (!hashSource(objFile, source) || header.sourceHash != source.hash)) {
+		return false;
+	}
+
+	CacheBatch batch;
+	memcpy(&batch, data + layout.batches, sizeof(batch));
+	if (uint64_t(batch.nameOffset) + batch.nameLength > header.namesSize) {
+		return false;
+	}
+
+	meshId.assign((const char *) data + layout.names + batch.nameOffset, batch.nameLength);
+	positions.resize(header.vertexCount);
+	normals.resize(header.vertexCount);
+	indices.resize(header.indexCount);
+	memcpy(positions.data(), data + layout.positions, positions.size() * sizeof(vec3));
+	memcpy(normals.data(), data + layout.normals, normals.size() * sizeof(vec3));
+	if (header.indexSize == sizeof(uint16_t)) {
+		const uint16_t * shortIndices = (const uint16_t *) (data + layout.indices);
+		copy(shortIndices, shortIndices + header.indexCount, indices.begin());
+	} else {
+		memcpy(indices.data(), data + layout.indices, indices.size() * sizeof(uint32_t));
+	}
+
+	for (uint32_t index : indices) {
+		if (index >= header.vertexCount) {
+			return false;
+		}
+	}
+
+	if (touched) {
+		cache.close();
+		saveMeshCache(objFile, source, meshId, positions, normals, indices);
+	}
+	return true;
+}
+
+}
+
 
 //----------------------------------------------------------------------------------------
 // Default constructor
@@ -41,30 +313,46 @@ MeshConsolidator::MeshConsolidator(
 	MeshId meshId;
 	vector<vec3> positions;
 	vector<vec3> normals;
+	vector<vec2> uvCoords;
+	vector<uint32_t> indices;
 	BatchInfo batchInfo;
-	unsigned long indexOffset(0);
+	size_t maxVertices(0);
 
     for(const ObjFilePath & objFile : objFileList) {
-	    ObjFileDecoder::decode(objFile.c_str(), meshId, positions, normals);
-
-	    uint numIndices = positions.size();
+	    // Decoded once, then read from the cache until the source changes.
+	    SourceInfo source;
+	    bool cached = cacheEnabled() && getSourceInfo(objFile, source);
+	    if (!cached || !loadMeshCache(objFile, source, meshId, positions, normals, indices)) {
+		    ObjFileDecoder::decodeIndexed(objFile.c_str(), meshId, positions, normals, uvCoords, indices);
+		    if (cached) {
+			    saveMeshCache(objFile, source, meshId, positions, normals, indices);
+		    }
+	    }
 
-	    if (numIndices != normals.size()) {
+	    if (positions.size() != normals.size()) {
 		    throw Exception("Error within MeshConsolidator: "
 					"positions.size() != normals.size()\n");
 	    }
 
-	    batchInfo.startIndex = indexOffset;
-	    batchInfo.numIndices = numIndices;
+	    batchInfo.startIndex = m_indexData32.size();
+	    batchInfo.numIndices = indices.size();
+	    batchInfo.baseVertex = m_vertexPositionData.size();
 
 	    m_batchInfoMap[meshId] = batchInfo;
 
 	    appendVector(m_vertexPositionData, positions);
 	    appendVector(m_vertexNormalData, normals);
+	    appendVector(m_indexData32, indices);
 
-	    indexOffset += numIndices;
+	    maxVertices = std::max(maxVertices, positions.size());
     }
 
+	// Indices are relative to each mesh's base vertex, so small meshes fit in
+	// 16 bits however many there are.
+	if (maxVertices <= 65536) {
+		m_indexData16.assign(m_indexData32.begin(), m_indexData32.end());
+		vector<uint32_t>().swap(m_indexData32);
+	}
 }
 
 //----------------------------------------------------------------------------------------
@@ -97,3 +385,31 @@ size_t MeshConsolidator::getNumVertexPositionBytes() const {
 size_t MeshConsolidator::getNumVertexNormalBytes() const {
 	return m_vertexNormalData.size() * sizeof(vec3);
 }
+
+//----------------------------------------------------------------------------------------
+// Returns the starting memory location for index data.
+const void * MeshConsolidator::getIndexDataPtr() const {
+	return m_indexData32.empty() ? (const void *) m_indexData16.data() : (const void *) m_indexData32.data();
+}
+
+//----------------------------------------------------------------------------------------
+// Returns the total number of bytes of all index data.
+size_t MeshConsolidator::getNumIndexBytes() const {
+	return m_indexData16.size() * sizeof(uint16_t) + m_indexData32.size() * sizeof(uint32_t);
+}
+
+//----------------------------------------------------------------------------------------
+// Returns the number of bytes per index.
+size_t MeshConsolidator::getIndexSize() const {
+	return m_indexData32.empty() ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+//----------------------------------------------------------------------------------------
+void MeshConsolidator::setCacheEnabled(bool enabled) {
+	cacheEnabled() = enabled;
+}
+
+//----------------------------------------------------------------------------------------
+bool MeshConsolidator::isCacheEnabled() {
+	return cacheEnabled();
+}
@@ -4,6 +4,7 @@
 
 #include <glm/glm.hpp>
 
+#include <cstdint>
 #include <initializer_list>
 #include <vector>
 #include <unordered_map>
@@ -19,13 +20,21 @@ typedef std::string ObjFilePath;
 
 
 // BatchInfoMap is an associative container that maps a unique MeshId to a BatchInfo
-// object. Each BatchInfo object contains an index offset and the number of indices
-// required to render the mesh with identifier MeshId.
+// object. Each BatchInfo object contains an index offset, the number of indices
+// and the base vertex required to render the mesh with identifier MeshId.
 typedef std::unordered_map<MeshId, BatchInfo>  BatchInfoMap;
 
 
 /*
 * Class for consolidating all vertex data within a list of .obj files.
+* Vertices shared between faces are stored once, and faces are given by an
+* index buffer. Indices are 16 bit if no mesh has more than 65536 vertices,
+* and 32 bit otherwise.
+*
+* Each decoded .obj file is cached in a binary "<file>.meshcache" next to it,
+* which later runs map and read instead of parsing the text. The cache is
+* decoded again when the source's size, or its modification time and
+* contents, change.
 */
 class MeshConsolidator {
 public:
@@ -43,13 +52,30 @@ public:
 
 	size_t getNumVertexNormalBytes() const;
 
+	const void * getIndexDataPtr() const;
+
+	size_t getNumIndexBytes() const;
+
+	// Bytes per index, 2 or 4.
+	size_t getIndexSize() const;
+
 	void getBatchInfoMap(BatchInfoMap & batchInfoMap) const;
 
+	// Enables the mesh cache. Defaults to on, unless the CS488_MESH_CACHE
+	// environment variable is "0".
+	static void setCacheEnabled(bool enabled);
+
+	static bool isCacheEnabled();
+
 
 private:
 	std::vector<glm::vec3> m_vertexPositionData;
 	std::vector<glm::vec3> m_vertexNormalData;
 
+	// Only one of these is used, depending on the index size.
+	std::vector<uint16_t> m_indexData16;
+	std::vector<uint32_t> m_indexData32;
+
 	BatchInfoMap m_batchInfoMap;
 };
 
@@ -1,158 +1,754 @@
 #include "ObjFileDecoder.hpp"
 using namespace glm;
 
-#include <fstream>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <exception>
+#include <functional>
 #include <sstream>
-#include <iostream>
 #include <string>
 #include <cstring>
+#include <thread>
 using namespace std;
 
+#include "cs488-framework/AssetPack.hpp"
 #include "cs488-framework/Exception.hpp"
+#include "cs488-framework/MappedFile.hpp"
 
+namespace {
 
-//---------------------------------------------------------------------------------------
-void ObjFileDecoder::decode(
-		const char * objFilePath,
-		std::string & objectName,
-        std::vector<vec3> & positions,
-        std::vector<vec3> & normals,
-        std::vector<vec2> & uvCoords
+// Marks a face corner without a texture coordinate or normal.
+const int32_t NO_INDEX = INT32_MIN;
+
+// Marks an empty slot of a VertexTable.
+const uint32_t NO_VERTEX = UINT32_MAX;
+
+// Smallest part of a file given its own thread.
+const size_t MIN_CHUNK_BYTES = 4 * 1024 * 1024;
+
+// Threads decode() uses, 0 for one per hardware thread.
+unsigned threadCount = 0;
+
+// Exact powers of ten; products and quotients with them are correctly
+// rounded.
+const double POWERS_OF_TEN[23] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+const float FLOAT_POWERS_OF_TEN[11] = {
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+
+/*
+ * The indices of one face corner, from 0.
+ */
+struct Corner {
+    int32_t position;
+    int32_t uvCoord;
+    int32_t normal;
+};
+
+static_assert(sizeof(Corner) == 3 * sizeof(int32_t), "Corner indices must be contiguous");
+
+// Bits of a corner's indices that counted back from the end of the records
+// before them.
+enum {
+    RELATIVE_POSITION = 1,
+    RELATIVE_UV_COORD = 2,
+    RELATIVE_NORMAL = 4
+};
+
+/*
+ * Everything read from a range of lines of an .obj file, before faces are
+ * expanded. Faces index the records of the whole file, except for relative
+ * indices, which count from the start of the range until fixed up.
+ */
+struct ObjData {
+    vector<vec3> positions;
+    vector<vec3> normals;
+    vector<vec2> uvCoords;
+
+    // Three per triangle. Larger faces are split into fans.
+    vector<Corner> corners;
+
+    // Indices of relative corner indices, counting the indices of each
+    // corner in order.
+    vector<size_t> relativeIndices;
+
+    // Triangles with texture coordinates.
+    size_t uvTriangles;
+
+    string objectName;
+
+    ObjData() : uvTriangles(0) { }
+};
+
+/*
+ * Where the records of a range start in the arrays of the whole file.
+ */
+struct ObjBase {
+    size_t position;
+    size_t normal;
+    size_t uvCoord;
+    size_t corner;
+    size_t uvCorner;
+};
+
+/*
+ * Reads the records of an .obj file held in memory, without allocating per
+ * line. Lines other than o, v, vn, vt and f are skipped.
+ */
+class Parser {
+public:
+    // Reads the lines in [begin, end) of the file starting at 'file'.
+    Parser(const char * filePath, const char * file, const char * begin, const char * end)
+        : filePath(filePath),
+          file(file),
+          end(end),
+          p(begin)
+    {
+
+    }
+
+    void parse(ObjData & data) {
+        reserve(data);
+
+        while (p < end) {
+            skipBlanks();
+            if (p < end) {
+                parseRecord(data);
+            }
+            skipLine();
+        }
+    }
+
+private:
+    // Sizes the arrays from a count of the records, so they are not copied
+    // as they grow. Faces are assumed to be triangles.
+    void reserve(ObjData & data) const {
+        size_t positions = 0, normals = 0, uvCoords = 0, faces = 0;
+        for (const char * line = p; line < end; ) {
+            if (end - line > 2) {
+                if (line[0] == 'v') {
+                    positions += line[1] == ' ';
+                    normals += line[1] == 'n';
+                    uvCoords += line[1] == 't';
+                } else {
+                    faces += line[0] == 'f';
+                }
+            }
+
+            const void * newline = memchr(line, '\n', size_t(end - line));
+            line = newline == nullptr ? end : (const char *) newline + 1;
+        }
+
+        data.positions.reserve(positions);
+        data.normals.reserve(normals);
+        data.uvCoords.reserve(uvCoords);
+        data.corners.reserve(faces * 3);
+    }
+
+    bool isBlank(char c) const {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    bool isLineEnd() const {
+        return p == end || *p == '\n' || *p == '#';
+    }
+
+    void skipBlanks() {
+        while (p < end && isBlank(*p)) {
+            ++p;
+        }
+    }
+
+    void skipLine() {
+        // Records usually end where they were read to.
+        skipBlanks();
+        if (p < end && *p == '\n') {
+            ++p;
+            return;
+        }
+
+        const void * newline = memchr(p, '\n', size_t(end - p));
+        p = newline == nullptr ? end : (const char *) newline + 1;
+    }
+
+    // True if the record's keyword is 'keyword', followed by a blank. Moves
+    // past both.
+    bool isKeyword(char first, char second) {
+        if (second == '\0') {
+            if (end - p < 2 || p[0] != first || !isBlank(p[1])) {
+                return false;
+            }
+            p += 2;
+            return true;
+        }
+
+        if (end - p < 3 || p[0] != first || p[1] != second || !isBlank(p[2])) {
+            return false;
+        }
+        p += 3;
+        return true;
+    }
+
+    void parseRecord(ObjData & data) {
+        if (isKeyword('v', '\0')) {
+            vec3 position;
+            position.x = parseFloat();
+            position.y = parseFloat();
+            position.z = parseFloat();
+            data.positions.push_back(position);
+
+        } else if (isKeyword('v', 'n')) {
+            vec3 normal;
+            normal.x = parseFloat();
+            normal.y = parseFloat();
+            normal.z = parseFloat();
+            data.normals.push_back(normal);
+
+        } else if (isKeyword('v', 't')) {
+            vec2 uvCoord;
+            uvCoord.s = parseFloat();
+            uvCoord.t = parseFloat();
+            data.uvCoords.push_back(uvCoord);
+
+        } else if (isKeyword('f', '\0')) {
+            parseFace(data);
+
+        } else if (isKeyword('o', '\0')) {
+            skipBlanks();
+            const char * name = p;
+            while (p < end && !isBlank(*p) && *p != '\n') {
+                ++p;
+            }
+            if (p > name) {
+                data.objectName.assign(name, p);
+            }
+        }
+    }
+
+    // Reads a number as istream's operator >> does, i.e. rounded as strtof()
+    // would.
+    float parseFloat() {
+        skipBlanks();
+        const char * start = p;
+
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+')) {
+            negative = *p == '-';
+            ++p;
+        }
+
+        // Digits past the 18th significant one only round, so they are
+        // dropped and the number is left to strtof().
+        const uint64_t MANTISSA_LIMIT = 100000000000000000ull;
+        uint64_t mantissa = 0;
+        int exponent = 0;
+        bool truncated = false;
+
+        const char * digits = p;
+        for (; p < end && unsigned(*p - '0') < 10; ++p) {
+            if (mantissa < MANTISSA_LIMIT) {
+                mantissa = mantissa * 10 + unsigned(*p - '0');
+            } else {
+                ++exponent;
+                truncated = true;
+            }
+        }
+        bool anyDigits = p > digits;
+
+        if (p < end && *p == '.') {
+            digits = ++p;
+            for (; p < end && unsigned(*p - '0') < 10; ++p) {
+                if (mantissa < MANTISSA_LIMIT) {
+                    mantissa = mantissa * 10 + unsigned(*p - '0');
+                    --exponent;
+                } else {
+                    truncated = truncated || *p != '0';
+                }
+            }
+            anyDigits = anyDigits || p > digits;
+        }
+        if (!anyDigits) {
+            fail("Expected a number");
+        }
+
+        if (p + 1 < end && (*p == 'e' || *p == 'E')) {
+            const char * e = p + 1;
+            bool negativeExponent = false;
+            if (*e == '-' || *e == '+') {
+                negativeExponent = *e == '-';
+                ++e;
+            }
+            if (e < end && unsigned(*e - '0') < 10) {
+                int value = 0;
+                for (; e < end && unsigned(*e - '0') < 10; ++e) {
+                    value = std::min(value * 10 + (*e - '0'), 100000);
+                }
+                exponent += negativeExponent ? -value : value;
+                p = e;
+            }
+        }
+
+        // A product or quotient of exact floats is correctly rounded. This
+        // covers most numbers written with up to 7 digits.
+        if (mantissa <= (1u << 24) && exponent >= -10 && exponent <= 10 && !truncated) {
+            float value = float(mantissa);
+            value = exponent < 0 ? value / FLOAT_POWERS_OF_TEN[-exponent] : value * FLOAT_POWERS_OF_TEN[exponent];
+            return negative ? -value : value;
+        }
+
+        // The same with doubles gives the correctly rounded double, which
+        // rounds to the correct float unless it lies exactly half way between
+        // two floats.
+        if (!truncated && mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+            double value = double(mantissa);
+            value = exponent < 0 ? value / POWERS_OF_TEN[-exponent] : value * POWERS_OF_TEN[exponent];
+
+            float result = float(value);
+            bool exact = !std::isinf(result);
+            if (exact && double(result) != value) {
+                float neighbour = nextafterf(result, value > double(result) ? INFINITY : -INFINITY);
+                exact = (double(result) + double(neighbour)) * 0.5 != value;
+            }
+            if (exact) {
+                return negative ? -result : result;
+            }
+        }
+
+        // Hard cases go through strtof(), which needs a terminated copy.
+        string number(start, p);
+        return strtof(number.c_str(), nullptr);
+    }
+
+    int32_t parseIndex() {
+        bool negative = false;
+        if (p < end && *p == '-') {
+            negative = true;
+            ++p;
+        }
+
+        if (p == end || unsigned(*p - '0') >= 10) {
+            fail("Expected an index");
+        }
+
+        // Ten digits cannot overflow, and are more than an index can have,
+        // so stop at the eleventh.
+        const char * digits = p;
+        int64_t value = 0;
+        for (; p < end && unsigned(*p - '0') < 10; ++p) {
+            if (p - digits == 10) {
+                fail("Index out of range");
+            }
+            value = value * 10 + (*p - '0');
+        }
+        if (value > INT32_MAX) {
+            fail("Index out of range");
+        }
+        if (value == 0) {
+            fail("Indices start at 1");
+        }
+        return int32_t(negative ? -value : value);
+    }
+
+    // Converts an index from 1, or counting back from -1, to one from 0.
+    int32_t toOffset(int32_t index, size_t count, unsigned bit, unsigned & relative) {
+        if (index > 0) {
+            return index - 1;
+        }
+        relative |= bit;
+        return int32_t(count) + index;
+    }
+
+    void parseCorner(const ObjData & data, Corner & corner, unsigned & relative) {
+        relative = 0;
+        corner.position = toOffset(parseIndex(), data.positions.size(), RELATIVE_POSITION, relative);
+        corner.uvCoord = NO_INDEX;
+        corner.normal = NO_INDEX;
+
+        if (p < end && *p == '/') {
+            ++p;
+            if (p < end && *p != '/') {
+                corner.uvCoord = toOffset(parseIndex(), data.uvCoords.size(), RELATIVE_UV_COORD, relative);
+            }
+            if (p < end && *p == '/') {
+                ++p;
+                corner.normal = toOffset(parseIndex(), data.normals.size(), RELATIVE_NORMAL, relative);
+            }
+        }
+
+        if (p < end && !isBlank(*p) && *p != '\n') {
+            fail("Malformed face");
+        }
+    }
+
+    void addCorner(ObjData & data, const Corner & corner, unsigned relative) {
+        if (relative != 0) {
+            size_t index = data.corners.size() * 3;
+            for (unsigned bit = 0; bit < 3; ++bit) {
+                if (relative & (1u << bit)) {
+                    data.relativeIndices.push_back(index + bit);
+                }
+            }
+        }
+        data.corners.push_back(corner);
+    }
+
+    void parseFace(ObjData & data) {
+        Corner first, previous, corner;
+        unsigned firstRelative = 0, previousRelative = 0, relative;
+        int count = 0;
+
+        for (skipBlanks(); !isLineEnd(); skipBlanks()) {
+            parseCorner(data, corner, relative);
+            if (count == 0) {
+                first = corner;
+                firstRelative = relative;
+            } else if (count >= 2) {
+                addCorner(data, first, firstRelative);
+                addCorner(data, previous, previousRelative);
+                addCorner(data, corner, relative);
+                bool uvCoords = first.uvCoord != NO_INDEX && previous.uvCoord != NO_INDEX &&
+                        corner.uvCoord != NO_INDEX;
+                data.uvTriangles += uvCoords;
+            }
+            previous = corner;
+            previousRelative = relative;
+            ++count;
+        }
+
+        if (count < 3) {
+            fail("Faces need at least 3 vertices");
+        }
+    }
+
+    void fail(const char * error) const {
+        stringstream errorMessage;
+        errorMessage << error << " at " << filePath << ":" << 1 + count(file, p, '\n')
+            << " within method ObjFileDecoder::decode" << endl;
+        throw Exception(errorMessage.str());
+    }
+
+    const char * filePath;
+    const char * file;
+    const char * end;
+    const char * p;
+};
+
+// Runs task(i) for every i in [0, count), one thread each, and rethrows the
+// exception of the first task that threw.
+void runChunks(size_t count, const function<void(size_t)> & task) {
+    vector<exception_ptr> errors(count);
+    auto run = [&task, &errors](size_t idx) {
+        try {
+            task(idx);
+        } catch (...) {
+            errors[idx] = current_exception();
+        }
+    };
+
+    vector<thread> pool;
+    for (size_t idx = 1; idx < count; ++idx) {
+        pool.push_back(thread(run, idx));
+    }
+    run(0);
+    for (thread & worker : pool) {
+        worker.join();
+    }
+
+    for (const exception_ptr & error : errors) {
+        if (error) {
+            rethrow_exception(error);
+        }
+    }
+}
+
+// Splits [begin, end) into up to 'count' ranges of whole lines.
+vector<const char *> splitLines(const char * begin, const char * end, size_t count) {
+    vector<const char *> bounds(1, begin);
+    for (size_t idx = 1; idx < count; ++idx) {
+        const char * split = std::max(bounds.back(), begin + (end - begin) * idx / count);
+        const void * newline = memchr(split, '\n', size_t(end - split));
+        if (newline == nullptr) {
+            break;
+        }
+        bounds.push_back((const char *) newline + 1);
+    }
+    bounds.push_back(end);
+    return bounds;
+}
+
+// Copies the records of every range into the arrays of the whole file, and
+// makes relative indices absolute.
+void mergeChunks(
+        vector<ObjData> & chunks,
+        const vector<ObjBase> & bases,
+        ObjData & merged
 ) {
+    const ObjBase & total = bases.back();
+    merged.positions.resize(total.position);
+    merged.normals.resize(total.normal);
+    merged.uvCoords.resize(total.uvCoord);
 
-	// Empty containers, and start fresh before inserting data from .obj file
-	positions.clear();
-	normals.clear();
-	uvCoords.clear();
+    runChunks(chunks.size(), [&](size_t idx) {
+        ObjData & chunk = chunks[idx];
+        const ObjBase & base = bases[idx];
 
-    ifstream in(objFilePath, std::ios::in);
-    in.exceptions(std::ifstream::badbit);
+        copy(chunk.positions.begin(), chunk.positions.end(), merged.positions.begin() + base.position);
+        copy(chunk.normals.begin(), chunk.normals.end(), merged.normals.begin() + base.normal);
+        copy(chunk.uvCoords.begin(), chunk.uvCoords.end(), merged.uvCoords.begin() + base.uvCoord);
 
-    if (!in) {
+        const int32_t offsets[3] = { int32_t(base.position), int32_t(base.uvCoord), int32_t(base.normal) };
+        for (size_t index : chunk.relativeIndices) {
+            int32_t * indices = &chunk.corners[index / 3].position;
+            indices[index % 3] += offsets[index % 3];
+        }
+    });
+}
+
+// Throws unless a corner of triangle 'triangle' only indexes records that
+// exist, and has a normal.
+void checkCorner(const char * objFilePath, const Corner & corner, const ObjData & records, size_t triangle) {
+    bool valid = corner.position >= 0 && corner.position < int32_t(records.positions.size()) &&
+            corner.normal >= 0 && corner.normal < int32_t(records.normals.size()) &&
+            (corner.uvCoord == NO_INDEX ||
+             (corner.uvCoord >= 0 && corner.uvCoord < int32_t(records.uvCoords.size())));
+    if (!valid) {
         stringstream errorMessage;
-        errorMessage << "Unable to open .obj file " << objFilePath
+        errorMessage << "Face " << triangle + 1 << " of " << objFilePath
+            << (corner.normal == NO_INDEX ? " has no normals" : " has an index out of range")
             << " within method ObjFileDecoder::decode" << endl;
+        throw Exception(errorMessage.str());
+    }
+}
+
+// Expands the corners of a range's triangles into the output arrays, at
+// 'base'. 'records' holds the vertex records of the whole file.
+void expandFaces(
+        const char * objFilePath,
+        const ObjData & chunk,
+        const ObjData & records,
+        const ObjBase & base,
+        vector<vec3> & positions,
+        vector<vec3> & normals,
+        vector<vec2> & uvCoords
+) {
+    size_t cornerCount = chunk.corners.size();
+    size_t uvCorner = base.uvCorner;
+
+    for (size_t idx = 0; idx < cornerCount; idx += 3) {
+        const Corner * triangle = &chunk.corners[idx];
+        size_t corner = base.corner + idx;
+
+        // Faces keep texture coordinates only if all their corners have one.
+        int uvCorners = 0;
+        for (int vertex = 0; vertex < 3; ++vertex) {
+            const Corner & c = triangle[vertex];
+            checkCorner(objFilePath, c, records, corner / 3);
 
-        throw Exception(errorMessage.str().c_str());
+            positions[corner + vertex] = records.positions[c.position];
+            normals[corner + vertex] = records.normals[c.normal];
+            uvCorners += c.uvCoord != NO_INDEX;
+        }
+
+        if (uvCorners == 3) {
+            for (int vertex = 0; vertex < 3; ++vertex) {
+                uvCoords[uvCorner++] = records.uvCoords[triangle[vertex].uvCoord];
+            }
+        }
     }
+}
 
-    string currentLine;
-    int positionIndexA, positionIndexB, positionIndexC;
-    int normalIndexA, normalIndexB, normalIndexC;
-    int uvCoordIndexA, uvCoordIndexB, uvCoordIndexC;
-    vector<vec3> temp_positions;
-    vector<vec3> temp_normals;
-    vector<vec2> temp_uvCoords;
+/*
+ * Numbers the distinct corners of a mesh in the order they are first seen,
+ * in an open addressed hash table of corner indices.
+ */
+class VertexTable {
+public:
+    explicit VertexTable(size_t expected) {
+        size_t capacity = 16;
+        while (capacity < expected * 2) {
+            capacity *= 2;
+        }
+        slots.assign(capacity, NO_VERTEX);
+        vertices.reserve(expected);
+    }
 
-	objectName = "";
+    uint32_t add(const Corner & corner) {
+        // Kept at most half full, so probes stay short.
+        if (vertices.size() * 2 >= slots.size()) {
+            grow();
+        }
 
-    while (!in.eof()) {
-        try {
-            getline(in, currentLine);
-        } catch (const ifstream::failure &e) {
-            in.close();
-            stringstream errorMessage;
-            errorMessage << "Error calling getline() -- " << e.what() << endl;
-            throw Exception(errorMessage.str());
-        }
-	    if (currentLine.substr(0, 2) == "o ") {
-		    // Get entire line excluding first 2 chars.
-		    istringstream s(currentLine.substr(2));
-		    s >> objectName;
-
-
-	    } else if (currentLine.substr(0, 2) == "v ") {
-            // Vertex data on this line.
-            // Get entire line excluding first 2 chars.
-            istringstream s(currentLine.substr(2));
-            glm::vec3 vertex;
-            s >> vertex.x;
-            s >> vertex.y;
-            s >> vertex.z;
-            temp_positions.push_back(vertex);
-
-        } else if (currentLine.substr(0, 3) == "vn ") {
-            // Normal data on this line.
-            // Get entire line excluding first 2 chars.
-            istringstream s(currentLine.substr(2));
-            vec3 normal;
-            s >> normal.x;
-            s >> normal.y;
-            s >> normal.z;
-            temp_normals.push_back(normal);
-
-        } else if (currentLine.substr(0, 3) == "vt ") {
-            // Texture coordinate data on this line.
-            // Get entire line excluding first 2 chars.
-            istringstream s(currentLine.substr(2));
-            vec2 textureCoord;
-            s >> textureCoord.s;
-            s >> textureCoord.t;
-            temp_uvCoords.push_back(textureCoord);
-
-        } else if (currentLine.substr(0, 2) == "f ") {
-            // Face index data on this line.
-
-            int index;
-
-            // sscanf will return the number of matched index values it found
-            // from the pattern.
-            int numberOfIndexMatches = sscanf(currentLine.c_str(), "f %d/%d/%d",
-                                              &index, &index, &index);
-
-            if (numberOfIndexMatches == 3) {
-                // Line contains indices of the pattern vertex/uv-cord/normal.
-                sscanf(currentLine.c_str(), "f %d/%d/%d %d/%d/%d %d/%d/%d",
-                       &positionIndexA, &uvCoordIndexA, &normalIndexA,
-                       &positionIndexB, &uvCoordIndexB, &normalIndexB,
-                       &positionIndexC, &uvCoordIndexC, &normalIndexC);
-
-                // .obj file uses indices that start at 1, so subtract 1 so they start at 0.
-                uvCoordIndexA--;
-                uvCoordIndexB--;
-                uvCoordIndexC--;
-
-                uvCoords.push_back(temp_uvCoords[uvCoordIndexA]);
-                uvCoords.push_back(temp_uvCoords[uvCoordIndexB]);
-                uvCoords.push_back(temp_uvCoords[uvCoordIndexC]);
+        size_t mask = slots.size() - 1;
+        for (size_t slot = hash(corner) & mask; ; slot = (slot + 1) & mask) {
+            uint32_t vertex = slots[slot];
+            if (vertex == NO_VERTEX) {
+                slots[slot] = uint32_t(vertices.size());
+                vertices.push_back(corner);
+                return slots[slot];
+            }
 
-            } else {
-                // Line contains indices of the pattern vertex//normal.
-                sscanf(currentLine.c_str(), "f %d//%d %d//%d %d//%d",
-		               &positionIndexA, &normalIndexA,
-                       &positionIndexB, &normalIndexB,
-                       &positionIndexC, &normalIndexC);
+            const Corner & existing = vertices[vertex];
+            if (existing.position == corner.position && existing.normal == corner.normal &&
+                    existing.uvCoord == corner.uvCoord) {
+                return vertex;
+            }
+        }
+    }
+
+    const vector<Corner> & getVertices() const {
+        return vertices;
+    }
+
+private:
+    static size_t hash(const Corner & corner) {
+        uint64_t key = uint64_t(uint32_t(corner.position)) * 0x9E3779B97F4A7C15ull;
+        key ^= uint64_t(uint32_t(corner.normal)) * 0xC2B2AE3D27D4EB4Full;
+        key ^= uint64_t(uint32_t(corner.uvCoord)) * 0x165667B19E3779F9ull;
+        return size_t(key ^ (key >> 29));
+    }
+
+    void grow() {
+        slots.assign(slots.size() * 2, NO_VERTEX);
+        size_t mask = slots.size() - 1;
+        for (size_t vertex = 0; vertex < vertices.size(); ++vertex) {
+            size_t slot = hash(vertices[vertex]) & mask;
+            while (slots[slot] != NO_VERTEX) {
+                slot = (slot + 1) & mask;
             }
+            slots[slot] = uint32_t(vertex);
+        }
+    }
 
-            positionIndexA--;
-            positionIndexB--;
-            positionIndexC--;
-            normalIndexA--;
-            normalIndexB--;
-            normalIndexC--;
+    vector<uint32_t> slots;
+    vector<Corner> vertices;
+};
 
-            positions.push_back(temp_positions[positionIndexA]);
-            positions.push_back(temp_positions[positionIndexB]);
-            positions.push_back(temp_positions[positionIndexC]);
+/*
+ * A parsed .obj file.
+ */
+struct ObjFile {
+    // The records and faces of each range of lines.
+    vector<ObjData> chunks;
+
+    // Where each range starts in the whole file's arrays, then the totals.
+    vector<ObjBase> bases;
+
+    // The records of all ranges, when there is more than one.
+    ObjData merged;
+
+    string objectName;
+
+    const ObjData & getRecords() const {
+        return chunks.size() > 1 ? merged : chunks[0];
+    }
+};
+
+// Parses a file from the mounted asset pack or a mapping of it. Large files
+// are split into ranges of lines, parsed in parallel.
+void readObjFile(const char * objFilePath, ObjFile & obj) {
+    MappedFile file;
+    AssetPack::Asset asset;
+    if (!AssetPack::findFile(objFilePath, asset)) {
+        if (!file.open(objFilePath, MappedFile::ACCESS_SEQUENTIAL)) {
+            stringstream errorMessage;
+            errorMessage << "Unable to open .obj file " << objFilePath
+                << " within method ObjFileDecoder::decode" << endl;
 
-            normals.push_back(temp_normals[normalIndexA]);
-            normals.push_back(temp_normals[normalIndexB]);
-            normals.push_back(temp_normals[normalIndexC]);
+            throw Exception(errorMessage.str().c_str());
         }
+        asset.data = file.getData();
+        asset.size = file.getSize();
     }
 
-    in.close();
+    unsigned threads = threadCount != 0 ? threadCount : std::max(thread::hardware_concurrency(), 1u);
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threads, asset.size / MIN_CHUNK_BYTES));
 
-	if (objectName.compare("") == 0) {
+    const char * begin = (const char *) asset.data;
+    vector<const char *> bounds = splitLines(begin, begin + asset.size, chunkCount);
+    chunkCount = bounds.size() - 1;
+
+    vector<ObjData> & chunks = obj.chunks;
+    chunks.resize(chunkCount);
+    runChunks(chunkCount, [&](size_t idx) {
+        Parser(objFilePath, begin, bounds[idx], bounds[idx + 1]).parse(chunks[idx]);
+    });
+
+    vector<ObjBase> & bases = obj.bases;
+    bases.resize(chunkCount + 1);
+    bases[0] = ObjBase();
+    for (size_t idx = 0; idx < chunkCount; ++idx) {
+        const ObjData & chunk = chunks[idx];
+        ObjBase & next = bases[idx + 1];
+        next.position = bases[idx].position + chunk.positions.size();
+        next.normal = bases[idx].normal + chunk.normals.size();
+        next.uvCoord = bases[idx].uvCoord + chunk.uvCoords.size();
+        next.corner = bases[idx].corner + chunk.corners.size();
+        next.uvCorner = bases[idx].uvCorner + chunk.uvTriangles * 3;
+
+        if (!chunk.objectName.empty()) {
+            obj.objectName = chunk.objectName;
+        }
+    }
+
+    if (bases.back().position > size_t(INT32_MAX) || bases.back().normal > size_t(INT32_MAX) ||
+            bases.back().uvCoord > size_t(INT32_MAX)) {
+        throw Exception(string("Too many vertices in ") + objFilePath + " within method ObjFileDecoder::decode");
+    }
+
+    if (chunkCount > 1) {
+        mergeChunks(chunks, bases, obj.merged);
+    }
+
+	if (obj.objectName.compare("") == 0) {
 		// No 'o' object name tag defined in .obj file, so use the file name
 		// minus the '.obj' ending as the objectName.
 		const char * ptr = strrchr(objFilePath, '/');
-		objectName.assign(ptr+1);
-		size_t pos = objectName.find('.');
-		objectName.resize(pos);
+		obj.objectName.assign(ptr == nullptr ? objFilePath : ptr + 1);
+		size_t pos = obj.objectName.find('.');
+		if (pos != string::npos) {
+			obj.objectName.resize(pos);
+		}
 	}
 }
 
+}
+
+
+//---------------------------------------------------------------------------------------
+void ObjFileDecoder::decode(
+		const char * objFilePath,
+		std::string & objectName,
+        std::vector<vec3> & positions,
+        std::vector<vec3> & normals,
+        std::vector<vec2> & uvCoords
+) {
+
+	// Empty containers, and start fresh before inserting data from .obj file
+	positions.clear();
+	normals.clear();
+	uvCoords.clear();
+
+    ObjFile obj;
+    readObjFile(objFilePath, obj);
+
+    const ObjBase & total = obj.bases.back();
+    positions.resize(total.corner);
+    normals.resize(total.corner);
+    uvCoords.resize(total.uvCorner);
+
+    runChunks(obj.chunks.size(), [&](size_t idx) {
+        expandFaces(objFilePath, obj.chunks[idx], obj.getRecords(), obj.bases[idx], positions, normals, uvCoords);
+    });
+
+    objectName = obj.objectName;
+}
+
 //---------------------------------------------------------------------------------------
 void ObjFileDecoder::decode(
 		const char * objFilePath,
@@ -163,3 +759,62 @@ void ObjFileDecoder::decode(
     std::vector<vec2> uvCoords;
     decode(objFilePath, objectName, positions, normals, uvCoords);
 }
+
+//---------------------------------------------------------------------------------------
+void ObjFileDecoder::decodeIndexed(
+		const char * objFilePath,
+		std::string & objectName,
+        std::vector<vec3> & positions,
+        std::vector<vec3> & normals,
+        std::vector<vec2> & uvCoords,
+        std::vector<uint32_t> & indices
+) {
+	positions.clear();
+	normals.clear();
+	uvCoords.clear();
+	indices.clear();
+
+    ObjFile obj;
+    readObjFile(objFilePath, obj);
+    const ObjData & records = obj.getRecords();
+
+    // Meshes usually share each position between a few corners.
+    indices.resize(obj.bases.back().corner);
+    VertexTable table(records.positions.size() + records.positions.size() / 4);
+
+    size_t index = 0;
+    for (const ObjData & chunk : obj.chunks) {
+        for (const Corner & corner : chunk.corners) {
+            checkCorner(objFilePath, corner, records, index / 3);
+            indices[index++] = table.add(corner);
+        }
+    }
+
+    const vector<Corner> & vertices = table.getVertices();
+    positions.resize(vertices.size());
+    normals.resize(vertices.size());
+    for (size_t vertex = 0; vertex < vertices.size(); ++vertex) {
+        positions[vertex] = records.positions[vertices[vertex].position];
+        normals[vertex] = records.normals[vertices[vertex].normal];
+    }
+
+    if (obj.bases.back().uvCorner > 0) {
+        uvCoords.resize(vertices.size());
+        for (size_t vertex = 0; vertex < vertices.size(); ++vertex) {
+            int32_t uvCoord = vertices[vertex].uvCoord;
+            uvCoords[vertex] = uvCoord == NO_INDEX ? vec2(0.0f) : records.uvCoords[uvCoord];
+        }
+    }
+
+    objectName = obj.objectName;
+}
+
+//---------------------------------------------------------------------------------------
+void ObjFileDecoder::setThreadCount(unsigned threads) {
+    threadCount = threads;
+}
+
+//---------------------------------------------------------------------------------------
+unsigned ObjFileDecoder::getThreadCount() {
+    return threadCount;
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <cstring>
@@ -12,6 +13,9 @@ public:
 	* Extracts vertex data from a Wavefront .obj file
 	* If an object name parameter is present in the .obj file, objectName is set to that,
 	* otherwise objectName is set to the name of the .obj file.
+	* Faces with more than 3 vertices are split into triangle fans. The file is parsed
+	* in place from the mounted AssetPack, or from a memory mapping of it. Throws an
+	* Exception naming the line if the file is malformed.
 	*
 	* [in] objFilePath - path to .obj file
 	* [out] objectName - name given to object.
@@ -45,6 +49,38 @@ public:
             std::vector<glm::vec3> & normals
     );
 
+	/**
+	* Extracts indexed vertex data from a Wavefront .obj file.
+	* Each distinct combination of position, normal and texture coordinate used by a
+	* face corner becomes one vertex, numbered in the order first used, and indices
+	* lists three vertices per triangle.
+	*
+	* [in] objFilePath - path to .obj file
+	* [out] objectName - name given to object.
+	* [out] positions - positions given in (x,y,z) model space, one per vertex.
+	* [out] normals - normals given in (x,y,z) model space, one per vertex.
+	* [out] uvCoords - texture coordinates in (u,v) parameter space, one per vertex, or
+	*       empty if no face has them. Vertices without one get (0,0).
+	* [out] indices - vertex indices, three per triangle.
+	*/
+    static void decodeIndexed(
+		    const char * objFilePath,
+			std::string & objectName,
+            std::vector<glm::vec3> & positions,
+            std::vector<glm::vec3> & normals,
+            std::vector<glm::vec2> & uvCoords,
+            std::vector<uint32_t> & indices
+    );
+
+	/**
+	* Sets how many threads decode() splits large files between, 0 for one per
+	* hardware thread. Files are split at line boundaries, at least 4 MB apart, and
+	* decode to the same output whatever the count.
+	*/
+	static void setThreadCount(unsigned threads);
+
+	static unsigned getThreadCount();
+
 };
 
 
@@ -0,0 +1,397 @@
+#include "Profiler.hpp"
+#include "GpuProfiler.hpp"
+
+#include <imgui/imgui.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+using namespace std;
+
+namespace {
+
+// Zones kept per thread before the oldest are overwritten.
+const size_t ZONES_PER_THREAD = 1 << 14;
+
+// Frame start times kept.
+const size_t MAX_FRAMES = 256;
+
+// Counter samples kept before the oldest are overwritten.
+const size_t MAX_COUNTERS = 1 << 14;
+
+// Frames the timeline can show at once.
+const int MAX_TIMELINE_FRAMES = 16;
+
+/*
+ * Ring buffer of the zones of one thread. Only the owning thread writes;
+ * readers copy the zones, then re-read 'written' to discard any that were
+ * overwritten while copying.
+ */
+struct ThreadBuffer {
+    Profiler::Zone zones[ZONES_PER_THREAD];
+    atomic<uint64_t> written;
+    atomic<bool> inUse;
+    unsigned depth;
+    uint16_t index;
+    char name[32];
+};
+
+// Buffers are never freed, so readers can always walk them. Buffers of
+// threads that have exited are reused by new ones.
+mutex registryLock;
+vector<ThreadBuffer *> registry;
+
+uint64_t frameStarts[MAX_FRAMES];
+atomic<uint64_t> frameCount(0);
+
+// Ring buffer of counter samples, written by a single thread.
+Profiler::Counter counters[MAX_COUNTERS];
+atomic<uint64_t> countersWritten(0);
+
+ThreadBuffer * acquireBuffer() {
+    lock_guard<mutex> guard(registryLock);
+
+    for (ThreadBuffer * buffer : registry) {
+        bool expected = false;
+        if (buffer->inUse.compare_exchange_strong(expected, true)) {
+            buffer->depth = 0;
+            snprintf(buffer->name, sizeof(buffer->name), "Thread %u", unsigned(buffer->index));
+            return buffer;
+        }
+    }
+
+    ThreadBuffer * buffer = new ThreadBuffer();
+    buffer->written = 0;
+    buffer->inUse = true;
+    buffer->depth = 0;
+    buffer->index = uint16_t(registry.size());
+    snprintf(buffer->name, sizeof(buffer->name), "Thread %u", unsigned(buffer->index));
+    registry.push_back(buffer);
+    return buffer;
+}
+
+/*
+ * Hands the buffer of a thread back when the thread exits.
+ */
+struct ThreadBufferOwner {
+    ThreadBuffer * buffer;
+
+    ThreadBufferOwner() : buffer(acquireBuffer()) { }
+    ~ThreadBufferOwner() { buffer->inUse = false; }
+};
+
+void writeZone(ThreadBuffer & buffer, const char * name, uint64_t start, uint64_t end, unsigned depth) {
+    uint64_t written = buffer.written.load(memory_order_relaxed);
+    Profiler::Zone & zone = buffer.zones[written % ZONES_PER_THREAD];
+    zone.name = name;
+    zone.start = start;
+    zone.end = end;
+    zone.depth = uint16_t(depth);
+    zone.thread = buffer.index;
+
+    buffer.written.store(written + 1, memory_order_release);
+}
+
+ThreadBuffer & threadBuffer() {
+    static thread_local ThreadBufferOwner owner;
+    return *owner.buffer;
+}
+
+// Stable colour for a zone name.
+ImU32 zoneColour(const char * name) {
+    uint32_t hash = 2166136261u;
+    for (const char * c = name; *c != '\0'; ++c) {
+        hash = (hash ^ uint8_t(*c)) * 16777619u;
+    }
+
+    float r, g, b;
+    ImGui::ColorConvertHSVtoRGB(float(hash % 360) / 360.0f, 0.55f, 0.8f, r, g, b);
+    return ImGui::ColorConvertFloat4ToU32(ImVec4(r, g, b, 1.0f));
+}
+
+}
+
+//----------------------------------------------------------------------------------------
+bool Profiler::isEnabled() {
+#ifdef CS488_PROFILE
+    return true;
+#else
+    return false;
+#endif
+}
+
+//----------------------------------------------------------------------------------------
+uint64_t Profiler::now() {
+    return uint64_t(chrono::duration_cast<chrono::nanoseconds>(
+            chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+//----------------------------------------------------------------------------------------
+void Profiler::beginFrame() {
+    uint64_t frame = frameCount.load(memory_order_relaxed);
+    frameStarts[frame % MAX_FRAMES] = now();
+    frameCount.store(frame + 1, memory_order_release);
+}
+
+//----------------------------------------------------------------------------------------
+void Profiler::setThreadName(const char * name) {
+    ThreadBuffer & buffer = threadBuffer();
+    lock_guard<mutex> guard(registryLock);
+    snprintf(buffer.name, sizeof(buffer.name), "%s", name);
+}
+
+//----------------------------------------------------------------------------------------
+unsigned Profiler::enterZone() {
+    return threadBuffer().depth++;
+}
+
+//----------------------------------------------------------------------------------------
+void Profiler::leaveZone(const char * name, uint64_t start, unsigned depth) {
+    uint64_t end = now();
+
+    ThreadBuffer & buffer = threadBuffer();
+    buffer.depth = depth;
+    writeZone(buffer, name, start, end, depth);
+}
+
+//----------------------------------------------------------------------------------------
+size_t Profiler::addTrack(const char * name) {
+    // Tracks keep their buffer for good, as no thread ever hands it back.
+    ThreadBuffer & buffer = *acquireBuffer();
+    lock_guard<mutex> guard(registryLock);
+    snprintf(buffer.name, sizeof(buffer.name), "%s", name);
+    return buffer.index;
+}
+
+//----------------------------------------------------------------------------------------
+void Profiler::recordZone(size_t track, const char * name, uint64_t start, uint64_t end, unsigned depth) {
+    ThreadBuffer * buffer;
+    {
+        lock_guard<mutex> guard(registryLock);
+        buffer = registry[track];
+    }
+    writeZone(*buffer, name, start, end, depth);
+}
+
+//----------------------------------------------------------------------------------------
+void Profiler::recordCounter(const char * name, double value) {
+    uint64_t written = countersWritten.load(memory_order_relaxed);
+    Counter & counter = counters[written % MAX_COUNTERS];
+    counter.name = name;
+    counter.time = now();
+    counter.value = value;
+
+    countersWritten.store(written + 1, memory_order_release);
+}
+
+//----------------------------------------------------------------------------------------
+void Profiler::collect(uint64_t since, vector<Zone> & zones) {
+    zones.clear();
+
+    vector<ThreadBuffer *> buffers;
+    {
+        lock_guard<mutex> guard(registryLock);
+        buffers = registry;
+    }
+
+    for (ThreadBuffer * buffer : buffers) {
+        size_t first = zones.size();
+
+        uint64_t written = buffer->written.load(memory_order_acquire);
+        uint64_t oldest = written > ZONES_PER_THREAD ? written - ZONES_PER_THREAD : 0;
+
+        // Newest first, stopping at the first zone that ended too early.
+        // Zones end in order within a thread, so the rest are older.
+        for (uint64_t idx = written; idx > oldest; --idx) {
+            const Zone & zone = buffer->zones[(idx - 1) % ZONES_PER_THREAD];
+            if (zone.end < since) {
+                break;
+            }
+            zones.push_back(zone);
+        }
+
+        // Drop anything the thread overwrote while it was being copied.
+        uint64_t after = buffer->written.load(memory_order_acquire);
+        if (after > ZONES_PER_THREAD) {
+            uint64_t overwritten = after - ZONES_PER_THREAD;
+            uint64_t valid = written > overwritten ? written - overwritten : 0;
+            zones.resize(first + size_t(min<uint64_t>(valid, zones.size() - first)));
+        }
+    }
+}
+
+//----------------------------------------------------------------------------------------
+void Profiler::collectCounters(uint64_t since, vector<Counter> & samples) {
+    samples.clear();
+
+    uint64_t written = countersWritten.load(memory_order_acquire);
+    uint64_t oldest = written > MAX_COUNTERS ? written - MAX_COUNTERS : 0;
+
+    uint64_t first = written;
+    while (first > oldest && counters[(first - 1) % MAX_COUNTERS].time >= since) {
+        --first;
+    }
+
+    for (uint64_t idx = first; idx < written; ++idx) {
+        samples.push_back(counters[idx % MAX_COUNTERS]);
+    }
+
+    // Drop anything overwritten while it was being copied, as collect() does.
+    uint64_t after = countersWritten.load(memory_order_acquire);
+    if (after > MAX_COUNTERS && after - MAX_COUNTERS > first) {
+        size_t lost = size_t(min<uint64_t>(after - MAX_COUNTERS - first, samples.size()));
+        samples.erase(samples.begin(), samples.begin() + lost);
+    }
+}
+
+//----------------------------------------------------------------------------------------
+void Profiler::getFrameStarts(size_t count, vector<uint64_t> & starts) {
+    uint64_t frames = frameCount.load(memory_order_acquire);
+    count = size_t(min<uint64_t>(min<uint64_t>(count, frames), MAX_FRAMES - 1));
+
+    starts.resize(count);
+    for (size_t idx = 0; idx < count; ++idx) {
+        starts[idx] = frameStarts[(frames - count + idx) % MAX_FRAMES];
+    }
+}
+
+//----------------------------------------------------------------------------------------
+size_t Profiler::getThreadCount() {
+    lock_guard<mutex> guard(registryLock);
+    return registry.size();
+}
+
+//----------------------------------------------------------------------------------------
+const char * Profiler::getThreadName(size_t thread) {
+    lock_guard<mutex> guard(registryLock);
+    return thread < registry.size() ? registry[thread]->name : "";
+}
+
+//----------------------------------------------------------------------------------------
+void Profiler::drawWindow(bool * open) {
+    static int frameCountShown = 3;
+    static bool paused = false;
+    static vector<Zone> zones;
+    static vector<uint64_t> starts;
+
+    ImGui::SetNextWindowSize(ImVec2(720, 280), ImGuiSetCond_FirstUseEver);
+    if (!ImGui::Begin("Profiler", open)) {
+        ImGui::End();
+        return;
+    }
+
+    if (!isEnabled()) {
+        ImGui::Text("Built without CS488_PROFILE, no zones are recorded.");
+        ImGui::End();
+        return;
+    }
+
+    ImGui::SliderInt("Frames", &frameCountShown, 1, MAX_TIMELINE_FRAMES);
+    ImGui::SameLine();
+    ImGui::Checkbox("Pause", &paused);
+
+    // The frame in progress is incomplete, so show the ones before it.
+    if (!paused || starts.empty()) {
+        getFrameStarts(size_t(frameCountShown) + 1, starts);
+        if (starts.size() < 2) {
+            ImGui::End();
+            return;
+        }
+        collect(starts.front(), zones);
+    }
+
+    const uint64_t rangeStart = starts.front();
+    const uint64_t rangeEnd = starts.back();
+    const double rangeMs = double(rangeEnd - rangeStart) * 1e-6;
+    ImGui::Text("%zu frame(s), %.2f ms", starts.size() - 1, rangeMs);
+
+    // One row per nesting depth of each thread.
+    size_t threads = getThreadCount();
+    vector<int> depths(threads, -1);
+    for (const Zone & zone : zones) {
+        if (zone.end >= rangeStart && zone.start <= rangeEnd) {
+            depths[zone.thread] = max(depths[zone.thread], int(zone.depth));
+        }
+    }
+
+    vector<float> rowOffsets(threads, 0.0f);
+    const float rowHeight = ImGui::GetTextLineHeight() + 4.0f;
+    const float labelWidth = 90.0f;
+    float height = 0.0f;
+    for (size_t idx = 0; idx < threads; ++idx) {
+        rowOffsets[idx] = height;
+        if (depths[idx] >= 0) {
+            height += (depths[idx] + 1) * rowHeight + 4.0f;
+        }
+    }
+
+    ImDrawList * drawList = ImGui::GetWindowDrawList();
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    float width = max(ImGui::GetContentRegionAvailWidth() - labelWidth, 50.0f);
+    float scale = width / float(rangeEnd - rangeStart);
+    float left = origin.x + labelWidth;
+
+    const ImU32 textColour = ImGui::ColorConvertFloat4ToU32(ImVec4(1, 1, 1, 1));
+    const ImU32 lineColour = ImGui::ColorConvertFloat4ToU32(ImVec4(1, 1, 1, 0.35f));
+
+    for (size_t idx = 0; idx < threads; ++idx) {
+        if (depths[idx] >= 0) {
+            drawList->AddText(ImVec2(origin.x, origin.y + rowOffsets[idx]), textColour, getThreadName(idx));
+        }
+    }
+
+    const Zone * hovered = nullptr;
+    for (const Zone & zone : zones) {
+        if (zone.end < rangeStart || zone.start > rangeEnd) {
+            continue;
+        }
+
+        float x0 = left + float(double(max(zone.start, rangeStart) - rangeStart) * scale);
+        float x1 = left + float(double(min(zone.end, rangeEnd) - rangeStart) * scale);
+        x1 = max(x1, x0 + 1.0f);
+        float y0 = origin.y + rowOffsets[zone.thread] + zone.depth * rowHeight;
+        ImVec2 a(x0, y0), b(x1, y0 + rowHeight - 1.0f);
+
+        drawList->AddRectFilled(a, b, zoneColour(zone.name));
+
+        // Label zones wide enough to hold their name.
+        if (x1 - x0 > ImGui::CalcTextSize(zone.name).x + 4.0f) {
+            drawList->AddText(ImVec2(x0 + 2.0f, y0 + 2.0f), textColour, zone.name);
+        }
+
+        if (ImGui::IsMouseHoveringRect(a, b)) {
+            hovered = &zone;
+        }
+    }
+
+    // Frame boundaries.
+    for (uint64_t start : starts) {
+        float x = left + float(double(start - rangeStart) * scale);
+        drawList->AddLine(ImVec2(x, origin.y), ImVec2(x, origin.y + height), lineColour);
+    }
+
+    if (hovered != nullptr) {
+        ImGui::SetTooltip("%s: %.3f ms", hovered->name, double(hovered->end - hovered->start) * 1e-6);
+    }
+
+    ImGui::Dummy(ImVec2(width + labelWidth, height));
+
+    // GPU zones of the last frame read back, which lags a few frames behind.
+    if (ImGui::CollapsingHeader("GPU")) {
+        if (GpuProfiler::isSupported()) {
+            vector<GpuProfiler::Result> results;
+            GpuProfiler::getResults(results);
+            for (const GpuProfiler::Result & result : results) {
+                ImGui::Text("%*s%-16s %7.3f ms", int(result.depth) * 2, "", result.name, result.milliseconds);
+            }
+        } else {
+            ImGui::Text("Timer queries are unavailable, no GPU zones are recorded.");
+        }
+    }
+
+    ImGui::End();
+}
@@ -0,0 +1,125 @@
+/*
+ * Profiler
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+/*
+ * Scoped CPU timing zones.
+ *
+ * PROFILE_SCOPE("name") times the enclosing block. Each thread writes its
+ * zones into its own fixed size ring buffer, so recording takes no locks;
+ * older zones are overwritten once the buffer wraps. PROFILE_FRAME() marks
+ * the start of a frame on the main thread, and PROFILE_COUNTER("name", value)
+ * samples a counter. drawWindow() shows the last few
+ * frames as a flame style timeline in an ImGui window.
+ *
+ * The macros compile to nothing unless CS488_PROFILE is defined. Zone names
+ * must be string literals, as only the pointer is stored.
+ */
+class Profiler {
+public:
+    struct Zone {
+        const char * name;
+
+        // Nanoseconds, see now().
+        uint64_t start;
+        uint64_t end;
+
+        // Nesting depth within the thread, and the index of the thread.
+        uint16_t depth;
+        uint16_t thread;
+    };
+
+    struct Counter {
+        const char * name;
+        uint64_t time;
+        double value;
+    };
+
+    // Returns true if the PROFILE_* macros were compiled in.
+    static bool isEnabled();
+
+    // Monotonic time in nanoseconds.
+    static uint64_t now();
+
+    static void beginFrame();
+
+    // Names the calling thread in the timeline.
+    static void setThreadName(const char * name);
+
+    // Used by ProfileScope.
+    static unsigned enterZone();
+    static void leaveZone(const char * name, uint64_t start, unsigned depth);
+
+    // Adds a timeline row for zones that are not timed on a CPU thread, such
+    // as GPU queries, and returns its index for recordZone(). Only one
+    // thread may record into a track. Zones must be recorded in the order
+    // they end.
+    static size_t addTrack(const char * name);
+    static void recordZone(size_t track, const char * name, uint64_t start, uint64_t end, unsigned depth);
+
+    // Records a sample of a counter, such as draw calls per frame. Unlike
+    // zones, counters must all be recorded from the same thread.
+    static void recordCounter(const char * name, double value);
+
+    // Copies the zones of every thread that end at or after 'since'.
+    static void collect(uint64_t since, std::vector<Zone> & zones);
+
+    // Copies the counter samples taken at or after 'since', oldest first.
+    static void collectCounters(uint64_t since, std::vector<Counter> & counters);
+
+    // Copies the start times of the 'count' most recent frames, oldest
+    // first. Fewer are returned if fewer frames have started.
+    static void getFrameStarts(size_t count, std::vector<uint64_t> & starts);
+
+    static size_t getThreadCount();
+    static const char * getThreadName(size_t thread);
+
+    // Draws the timeline window. 'open' is cleared when it is closed.
+    static void drawWindow(bool * open);
+};
+
+
+/*
+ * Times the lifetime of the object as a zone.
+ */
+class ProfileScope {
+public:
+    explicit ProfileScope(const char * name)
+        : name(name),
+          depth(Profiler::enterZone()),
+          start(Profiler::now())
+    { }
+
+    ~ProfileScope() {
+        Profiler::leaveZone(name, start, depth);
+    }
+
+private:
+    ProfileScope(const ProfileScope &);
+    ProfileScope & operator=(const ProfileScope &);
+
+    const char * name;
+    unsigned depth;
+    uint64_t start;
+};
+
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#ifdef CS488_PROFILE
+    #define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+    #define PROFILE_FRAME() Profiler::beginFrame()
+    #define PROFILE_COUNTER(name, value) Profiler::recordCounter(name, value)
+#else
+    #define PROFILE_SCOPE(name) do { } while (0)
+    #define PROFILE_FRAME() do { } while (0)
+    #define PROFILE_COUNTER(name, value) do { } while (0)
+#endif
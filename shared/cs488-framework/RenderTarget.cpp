@@ -0,0 +1,131 @@
+#include "RenderTarget.hpp"
+#include "GlErrorCheck.hpp"
+#include "GlCounters.hpp"
+
+//------------------------------------------------------------------------------------
+RenderTarget::RenderTarget()
+    : framebufferObject(0),
+      colourTexture(0),
+      depthRenderbuffer(0),
+      width(0),
+      height(0)
+{
+
+}
+
+//------------------------------------------------------------------------------------
+RenderTarget::~RenderTarget() {
+    destroy();
+}
+
+//------------------------------------------------------------------------------------
+bool RenderTarget::resize (
+        int newWidth,
+        int newHeight
+) {
+    if (isValid() && newWidth == width && newHeight == height) {
+        return false;
+    }
+
+    destroy();
+
+    width = newWidth;
+    height = newHeight;
+
+    glGenTextures(1, &colourTexture);
+    glBindTexture(GL_TEXTURE_2D, colourTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenRenderbuffers(1, &depthRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &framebufferObject);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebufferObject);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colourTexture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+
+    CHECK_FRAMEBUFFER_COMPLETENESS;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    GlCounters::setLabel(GL_TEXTURE, colourTexture, "Render target colour");
+    GlCounters::setLabel(GL_RENDERBUFFER, depthRenderbuffer, "Render target depth");
+
+    CHECK_GL_ERRORS;
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------
+void RenderTarget::destroy() {
+    if (framebufferObject != 0) {
+        glDeleteFramebuffers(1, &framebufferObject);
+        framebufferObject = 0;
+    }
+
+    if (colourTexture != 0) {
+        glDeleteTextures(1, &colourTexture);
+        colourTexture = 0;
+    }
+
+    if (depthRenderbuffer != 0) {
+        glDeleteRenderbuffers(1, &depthRenderbuffer);
+        depthRenderbuffer = 0;
+    }
+
+    width = 0;
+    height = 0;
+}
+
+//------------------------------------------------------------------------------------
+void RenderTarget::bind() const {
+    glBindFramebuffer(GL_FRAMEBUFFER, framebufferObject);
+    glViewport(0, 0, width, height);
+}
+
+//------------------------------------------------------------------------------------
+void RenderTarget::blitTo (
+        GLuint framebuffer,
+        int dstWidth,
+        int dstHeight,
+        GLenum filter
+) const {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebufferObject);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, dstWidth, dstHeight,
+            GL_COLOR_BUFFER_BIT, filter);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    CHECK_GL_ERRORS;
+}
+
+//------------------------------------------------------------------------------------
+GLuint RenderTarget::getFramebufferObject() const {
+    return framebufferObject;
+}
+
+//------------------------------------------------------------------------------------
+GLuint RenderTarget::getColourTexture() const {
+    return colourTexture;
+}
+
+//------------------------------------------------------------------------------------
+int RenderTarget::getWidth() const {
+    return width;
+}
+
+//------------------------------------------------------------------------------------
+int RenderTarget::getHeight() const {
+    return height;
+}
+
+//------------------------------------------------------------------------------------
+bool RenderTarget::isValid() const {
+    return framebufferObject != 0;
+}
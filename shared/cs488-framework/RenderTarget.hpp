@@ -0,0 +1,56 @@
+/*
+ * RenderTarget
+ */
+
+#pragma once
+
+#include "OpenGLImport.hpp"
+
+
+/*
+ * Offscreen framebuffer with a colour texture and a depth renderbuffer.
+ * GL objects are created lazily by resize() and must be released with
+ * destroy() while the context is still current.
+ */
+class RenderTarget {
+public:
+    RenderTarget();
+
+    ~RenderTarget();
+
+    // Allocates attachments of the given size.  Returns true if the target
+    // was (re)allocated, in which case its contents are undefined.
+    bool resize(int width, int height);
+
+    void destroy();
+
+    // Binds the target for drawing and sets the viewport to cover it.
+    void bind() const;
+
+    // Copies the colour attachment into the given framebuffer, stretching it
+    // to width x height.
+    void blitTo(GLuint framebuffer, int width, int height, GLenum filter = GL_NEAREST) const;
+
+    GLuint getFramebufferObject() const;
+
+    GLuint getColourTexture() const;
+
+    int getWidth() const;
+
+    int getHeight() const;
+
+    bool isValid() const;
+
+
+private:
+    RenderTarget(const RenderTarget &);
+    RenderTarget & operator = (const RenderTarget &);
+
+    GLuint framebufferObject;
+    GLuint colourTexture;
+    GLuint depthRenderbuffer;
+
+    int width;
+    int height;
+};
+
@@ -0,0 +1,157 @@
+#include "ShaderPermutations.hpp"
+
+#include <algorithm>
+#include <exception>
+
+using namespace std;
+
+//------------------------------------------------------------------------------------
+ShaderPermutations::ShaderPermutations() {
+
+}
+
+//------------------------------------------------------------------------------------
+void ShaderPermutations::setSources (
+		const string & vertexShaderPath,
+		const string & fragmentShaderPath
+) {
+    clear();
+    this->vertexShaderPath = vertexShaderPath;
+    this->fragmentShaderPath = fragmentShaderPath;
+}
+
+//------------------------------------------------------------------------------------
+string ShaderPermutations::getKey(const Defines & defines) {
+    Defines sorted = defines;
+    sort(sorted.begin(), sorted.end());
+
+    string key;
+    for (const string & define : sorted) {
+        key += define;
+        key += ';';
+    }
+    return key;
+}
+
+//------------------------------------------------------------------------------------
+/*
+* Creates a variant and starts building it. It is only kept once it has built.
+*/
+ShaderProgram * ShaderPermutations::create (
+		const string & key,
+		const Defines & defines
+) {
+    unique_ptr<ShaderProgram> program(new ShaderProgram());
+    program->generateProgramObject();
+    program->setDefines(defines);
+    program->attachVertexShader(vertexShaderPath.c_str());
+    program->attachFragmentShader(fragmentShaderPath.c_str());
+    program->beginLink();
+
+    ShaderProgram * created = program.get();
+    programs[key] = move(program);
+    return created;
+}
+
+//------------------------------------------------------------------------------------
+ShaderProgram & ShaderPermutations::get (
+		const Defines & defines
+) {
+    string key = getKey(defines);
+    auto found = programs.find(key);
+    if (found != programs.end()) {
+        return *found->second;
+    }
+
+    ShaderProgram * program = create(key, defines);
+    try {
+        program->finishLink();
+    } catch (...) {
+        programs.erase(key);
+        throw;
+    }
+    return *program;
+}
+
+//------------------------------------------------------------------------------------
+void ShaderPermutations::prewarm (
+		const vector<Defines> & defineSets
+) {
+    vector<string> started;
+    for (const Defines & defines : defineSets) {
+        string key = getKey(defines);
+        if (programs.find(key) == programs.end()) {
+            create(key, defines);
+            started.push_back(key);
+        }
+    }
+
+    // Only now wait for each, so the driver can work on all of them.
+    exception_ptr error;
+    for (const string & key : started) {
+        try {
+            programs[key]->finishLink();
+        } catch (...) {
+            programs.erase(key);
+            if (!error) {
+                error = current_exception();
+            }
+        }
+    }
+
+    if (error) {
+        rethrow_exception(error);
+    }
+}
+
+//------------------------------------------------------------------------------------
+size_t ShaderPermutations::size() const {
+    return programs.size();
+}
+
+//------------------------------------------------------------------------------------
+bool ShaderPermutations::recompile (
+		const string & filePath,
+		string & log
+) {
+    bool started = false;
+    log.clear();
+    for (auto & entry : programs) {
+        if (!entry.second->usesFile(filePath)) {
+            continue;
+        }
+
+        if (entry.second->recompileShaders()) {
+            started = true;
+        } else {
+            log += entry.second->getRecompileLog();
+        }
+    }
+    return started;
+}
+
+//------------------------------------------------------------------------------------
+bool ShaderPermutations::pollRecompile (
+		string & log
+) {
+    bool replaced = false;
+    log.clear();
+    for (auto & entry : programs) {
+        switch (entry.second->pollRecompile()) {
+        case ShaderProgram::RECOMPILE_DONE:
+            replaced = true;
+            break;
+        case ShaderProgram::RECOMPILE_FAILED:
+            log += entry.second->getRecompileLog();
+            break;
+        default:
+            break;
+        }
+    }
+    return replaced;
+}
+
+//------------------------------------------------------------------------------------
+void ShaderPermutations::clear() {
+    programs.clear();
+}
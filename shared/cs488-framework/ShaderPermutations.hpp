@@ -0,0 +1,70 @@
+/*
+ * ShaderPermutations
+ */
+
+#pragma once
+
+#include "ShaderProgram.hpp"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+/*
+ * The variants of one vertex and fragment shader pair, each compiled with a
+ * different set of #defines, so features can be specialised at compile time
+ * instead of branched on at run time.
+ *
+ * A variant is built the first time it is asked for. prewarm() builds a list
+ * of them ahead of time, issuing every compile before waiting on any, so
+ * drivers with KHR_parallel_shader_compile build them in parallel. Variants
+ * are keyed by their sorted defines, so the order they are given in does not
+ * matter.
+ */
+class ShaderPermutations {
+public:
+    typedef std::vector<std::string> Defines;
+
+    ShaderPermutations();
+
+    void setSources(const std::string & vertexShaderPath, const std::string & fragmentShaderPath);
+
+    // Gets the variant for a set of defines, building it if need be. Throws
+    // a ShaderException if it does not build.
+    ShaderProgram & get(const Defines & defines);
+
+    // Builds the variants not built yet. Throws a ShaderException if any
+    // does not build.
+    void prewarm(const std::vector<Defines> & defineSets);
+
+    // Number of variants built.
+    size_t size() const;
+
+    // Starts rebuilding the variants that use a file, as
+    // ShaderProgram::recompileShaders() does. Returns true if any started.
+    // Files that could not be read are described in 'log'.
+    bool recompile(const std::string & filePath, std::string & log);
+
+    // Polls the rebuilds and returns true if any variant was replaced.
+    // Failures are described in 'log'.
+    bool pollRecompile(std::string & log);
+
+    // Destroys every variant.
+    void clear();
+
+
+private:
+    ShaderPermutations(const ShaderPermutations &);
+    ShaderPermutations & operator = (const ShaderPermutations &);
+
+    static std::string getKey(const Defines & defines);
+
+    ShaderProgram * create(const std::string & key, const Defines & defines);
+
+    std::string vertexShaderPath;
+    std::string fragmentShaderPath;
+
+    std::map<std::string, std::unique_ptr<ShaderProgram>> programs;
+};
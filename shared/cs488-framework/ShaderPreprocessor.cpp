@@ -0,0 +1,157 @@
+#include "ShaderPreprocessor.hpp"
+#include "AssetPack.hpp"
+#include "ShaderException.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+using namespace std;
+
+namespace {
+
+// Skips spaces and tabs from 'offset'.
+size_t skipBlanks(const string & line, size_t offset) {
+    while (offset < line.size() && (line[offset] == ' ' || line[offset] == '\t')) {
+        ++offset;
+    }
+    return offset;
+}
+
+// True if the line is the preprocessor directive 'name', e.g. "include".
+// Sets 'offset' to just past the name.
+bool isDirective(const string & line, const char * name, size_t & offset) {
+    offset = skipBlanks(line, 0);
+    if (offset >= line.size() || line[offset] != '#') {
+        return false;
+    }
+
+    offset = skipBlanks(line, offset + 1);
+    size_t length = char_traits<char>::length(name);
+    if (line.compare(offset, length, name) != 0) {
+        return false;
+    }
+
+    offset += length;
+    return offset == line.size() || line[offset] == ' ' || line[offset] == '\t' || line[offset] == '"';
+}
+
+string getDirectory(const string & filePath) {
+    size_t slash = filePath.find_last_of('/');
+    return slash == string::npos ? string() : filePath.substr(0, slash + 1);
+}
+
+}
+
+//------------------------------------------------------------------------------------
+ShaderPreprocessor::ShaderPreprocessor()
+{
+
+}
+
+//------------------------------------------------------------------------------------
+void ShaderPreprocessor::setDefines(const vector<string> & defines) {
+    this->defines = defines;
+}
+
+//------------------------------------------------------------------------------------
+const vector<string> & ShaderPreprocessor::getDefines() const {
+    return defines;
+}
+
+//------------------------------------------------------------------------------------
+string ShaderPreprocessor::process(const string & filePath) {
+    files.clear();
+    includeStack.clear();
+
+    string output;
+    expand(filePath, output);
+    return output;
+}
+
+//------------------------------------------------------------------------------------
+const vector<string> & ShaderPreprocessor::getFiles() const {
+    return files;
+}
+
+//------------------------------------------------------------------------------------
+void ShaderPreprocessor::expand(const string & filePath, string & output) {
+    if (find(includeStack.begin(), includeStack.end(), filePath) != includeStack.end()) {
+        throw ShaderException("Error -- Shader includes itself: " + filePath);
+    }
+
+    // From the mounted asset pack if it has the file.
+    string source;
+    if (!AssetPack::readFile(filePath, source)) {
+        stringstream strStream;
+        strStream << "Error -- Failed to open file: " << filePath << endl;
+        throw ShaderException(strStream.str());
+    }
+    source.erase(remove(source.begin(), source.end(), '\r'), source.end());
+
+    int fileIndex = int(files.size());
+    files.push_back(filePath);
+    includeStack.push_back(filePath);
+
+    bool outermost = includeStack.size() == 1;
+    bool definesAdded = !outermost;
+
+    istringstream lines(source);
+    string line;
+    int lineNumber = 0;
+    while (getline(lines, line)) {
+        ++lineNumber;
+
+        size_t offset;
+        if (isDirective(line, "include", offset)) {
+            size_t open = line.find('"', offset);
+            size_t close = open == string::npos ? string::npos : line.find('"', open + 1);
+            if (close == string::npos) {
+                stringstream error;
+                error << "Error -- Malformed #include at " << filePath << ":" << lineNumber;
+                throw ShaderException(error.str());
+            }
+
+            if (!definesAdded) {
+                appendDefines(output);
+                definesAdded = true;
+            }
+
+            string includePath = getDirectory(filePath) + line.substr(open + 1, close - open - 1);
+            output += "#line 1 " + to_string(files.size()) + "\n";
+            expand(includePath, output);
+            output += "#line " + to_string(lineNumber + 1) + " " + to_string(fileIndex) + "\n";
+            continue;
+        }
+
+        output += line;
+        output += '\n';
+
+        // The #version line must come first, so defines follow it.
+        if (!definesAdded && isDirective(line, "version", offset)) {
+            appendDefines(output);
+            output += "#line " + to_string(lineNumber + 1) + " " + to_string(fileIndex) + "\n";
+            definesAdded = true;
+        }
+    }
+
+    if (!definesAdded) {
+        string body;
+        body.swap(output);
+        appendDefines(output);
+        output += body;
+    }
+
+    includeStack.pop_back();
+}
+
+//------------------------------------------------------------------------------------
+void ShaderPreprocessor::appendDefines(string & output) const {
+    for (const string & define : defines) {
+        size_t equals = define.find('=');
+        if (equals == string::npos) {
+            output += "#define " + define + "\n";
+        } else {
+            output += "#define " + define.substr(0, equals) + " " + define.substr(equals + 1) + "\n";
+        }
+    }
+}
@@ -0,0 +1,47 @@
+/*
+ * ShaderPreprocessor
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+
+/*
+ * Prepares GLSL files for compiling: expands #include "file" directives,
+ * resolved relative to the including file, and adds a #define for each of a
+ * set of defines straight after the #version line.
+ *
+ * #line directives keep compiler errors pointing at the right line. Their
+ * source string numbers index getFiles(), so an error in "1:12" is on line
+ * 12 of the first file included.
+ */
+class ShaderPreprocessor {
+public:
+    ShaderPreprocessor();
+
+    // Each define is "NAME" or "NAME=VALUE".
+    void setDefines(const std::vector<std::string> & defines);
+
+    const std::vector<std::string> & getDefines() const;
+
+    // Returns the expanded source of a file. Throws a ShaderException if a
+    // file cannot be read or includes itself.
+    std::string process(const std::string & filePath);
+
+    // The files read by the last process(), starting with the one processed.
+    const std::vector<std::string> & getFiles() const;
+
+
+private:
+    void expand(const std::string & filePath, std::string & output);
+
+    void appendDefines(std::string & output) const;
+
+    std::vector<std::string> defines;
+    std::vector<std::string> files;
+
+    // Files being expanded, outermost first, to catch include cycles.
+    std::vector<std::string> includeStack;
+};
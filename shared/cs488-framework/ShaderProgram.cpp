@@ -1,20 +1,161 @@
 #include "ShaderProgram.hpp"
 #include "ShaderException.hpp"
+#include "ShaderPreprocessor.hpp"
 #include "GlErrorCheck.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 using glm::value_ptr;
 
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <vector>
 using namespace std;
 
+#include <sys/stat.h>
+
+// KHR_parallel_shader_compile is newer than the gl3w headers.
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace {
+
+const char BINARY_MAGIC[4] = { 'S', 'P', 'B', 'C' };
+const uint32_t BINARY_VERSION = 1;
+
+/*
+ * Precedes the driver's binary in a cache file. Cache files are only read
+ * back by the machine that wrote them, so the header is in native byte order.
+ */
+struct BinaryHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint32_t format;
+    uint32_t length;
+};
+
+string & binaryCacheDirectory() {
+    static string directory;
+    static bool initialised = false;
+    if (!initialised) {
+        const char * environment = getenv("CS488_SHADER_CACHE");
+        directory = environment != nullptr ? environment : "shader-cache";
+        initialised = true;
+    }
+    return directory;
+}
+
+// Program binaries are core from GL 4.1 and need at least one format.
+bool supportsProgramBinary() {
+    static int supported = -1;
+    if (supported < 0) {
+        GLint major = 0, minor = 0, formats = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        if (major > 4 || (major == 4 && minor >= 1)) {
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        }
+        supported = formats > 0 ? 1 : 0;
+    }
+    return supported == 1;
+}
+
+// glProgramBinary raises an error for formats the driver does not list.
+bool isBinaryFormatSupported(GLenum format) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &count);
+    vector<GLint> formats(size_t(max(count, 0)));
+    if (count > 0) {
+        glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, formats.data());
+    }
+    for (GLint supported : formats) {
+        if (GLenum(supported) == format) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool hasExtension(const char * name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint idx = 0; idx < count; ++idx) {
+        const GLubyte * extension = glGetStringi(GL_EXTENSIONS, GLuint(idx));
+        if (extension != nullptr && strcmp((const char *)extension, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Lets the driver compile on its own threads, so the completion status can
+// be polled. Without the extension, compiles may block the first status
+// query.
+bool supportsParallelCompile() {
+    static int supported = -1;
+    if (supported < 0) {
+        supported = 0;
+#ifdef __linux__
+        typedef void (APIENTRYP MaxThreadsProc)(GLuint count);
+        MaxThreadsProc maxThreads = nullptr;
+        if (hasExtension("GL_KHR_parallel_shader_compile")) {
+            maxThreads = (MaxThreadsProc)gl3wGetProcAddress("glMaxShaderCompilerThreadsKHR");
+        } else if (hasExtension("GL_ARB_parallel_shader_compile")) {
+            maxThreads = (MaxThreadsProc)gl3wGetProcAddress("glMaxShaderCompilerThreadsARB");
+        }
+        if (maxThreads != nullptr) {
+            // Let the driver pick the number of threads.
+            maxThreads(0xFFFFFFFF);
+            supported = 1;
+        }
+#endif
+    }
+    return supported == 1;
+}
+
+// FNV-1a, with a terminator so adjacent strings cannot run together.
+void hashString(uint64_t & hash, const char * text) {
+    for (const char * c = text != nullptr ? text : ""; ; ++c) {
+        hash ^= uint8_t(*c);
+        hash *= 1099511628211ull;
+        if (*c == '\0') {
+            break;
+        }
+    }
+}
+
+uint64_t hashName(const char * name) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const char * c = name; *c != '\0'; ++c) {
+        hash ^= uint8_t(*c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+void makeDirectory(const string & path) {
+#ifdef _WIN32
+    mkdir(path.c_str());
+#else
+    mkdir(path.c_str(), 0755);
+#endif
+}
+
+}
+
 //------------------------------------------------------------------------------------
 ShaderProgram::Shader::Shader()
     : shaderObject(0),
-      filePath()
+      type(0),
+      filePath(),
+      source()
 {
 
 }
@@ -23,7 +164,14 @@ ShaderProgram::Shader::Shader()
 ShaderProgram::ShaderProgram()
         : programObject(0),
           prevProgramObject(0),
-          activeProgram(0)
+          activeProgram(0),
+          loadedFromCache(false),
+          linkPending(false),
+          saveBinary(false),
+          binaryKey(0),
+          nextProgramObject(0),
+          recompilePolls(0),
+          skippedUploads(0)
 {
 
 }
@@ -38,79 +186,341 @@ void ShaderProgram::generateProgramObject() {
 void ShaderProgram::attachVertexShader (
 		const char * filePath
 ) {
-    vertexShader.shaderObject = createShader(GL_VERTEX_SHADER);
-    vertexShader.filePath = filePath;
-
-    extractSourceCodeAndCompile(vertexShader);
+    attachShader(vertexShader, GL_VERTEX_SHADER, filePath);
 }
 
 //------------------------------------------------------------------------------------
 void ShaderProgram::attachFragmentShader (
 		const char * filePath
 ) {
-    fragmentShader.shaderObject = createShader(GL_FRAGMENT_SHADER);
-    fragmentShader.filePath = filePath;
-
-    extractSourceCodeAndCompile(fragmentShader);
+    attachShader(fragmentShader, GL_FRAGMENT_SHADER, filePath);
 }
 
 //------------------------------------------------------------------------------------
 void ShaderProgram::attachGeometryShader (
 		const char * filePath
 ) {
-    geometryShader.shaderObject = createShader(GL_GEOMETRY_SHADER);
-    geometryShader.filePath = filePath;
-
-    extractSourceCodeAndCompile(geometryShader);
+    attachShader(geometryShader, GL_GEOMETRY_SHADER, filePath);
 }
 
 //------------------------------------------------------------------------------------
-void ShaderProgram::extractSourceCodeAndCompile (
-		const Shader & shader
+/*
+* Reads the source of a shader. It is compiled by link(), unless the program is
+* in the binary cache.
+*/
+void ShaderProgram::attachShader (
+		Shader & shader,
+		GLenum shaderType,
+		const char * filePath
 ) {
-    string shaderSourceCode;
-    extractSourceCode(shaderSourceCode, shader.filePath);
+    if (shader.shaderObject == 0) {
+        shader.shaderObject = createShader(shaderType);
+    }
+    shader.type = shaderType;
+    shader.filePath = filePath;
 
-    compileShader(shader.shaderObject, shaderSourceCode);
+    readSource(shader);
 }
 
 //------------------------------------------------------------------------------------
-void ShaderProgram::recompileShaders() {
-    extractSourceCodeAndCompile(vertexShader);
-    extractSourceCodeAndCompile(fragmentShader);
-    extractSourceCodeAndCompile(geometryShader);
+/*
+* Issues the compile and link of a new program and returns without checking
+* on them, so the driver can work while frames are drawn with the old one.
+*/
+bool ShaderProgram::recompileShaders() {
+    discardRecompile();
+
+    Shader * shaders[] = { &vertexShader, &fragmentShader, &geometryShader };
+    for (int idx = 0; idx < 3; ++idx) {
+        nextShaders[idx] = Shader();
+        if (shaders[idx]->shaderObject == 0) {
+            continue;
+        }
+
+        nextShaders[idx].type = shaders[idx]->type;
+        nextShaders[idx].filePath = shaders[idx]->filePath;
+        try {
+            readSource(nextShaders[idx]);
+        } catch (const ShaderException & e) {
+            recompileLog = e.what();
+            return false;
+        }
+    }
+
+    supportsParallelCompile();
+
+    nextProgramObject = glCreateProgram();
+    for (Shader & shader : nextShaders) {
+        if (shader.type == 0) {
+            continue;
+        }
+
+        shader.shaderObject = glCreateShader(shader.type);
+        compileShader(shader.shaderObject, shader.source);
+        glAttachShader(nextProgramObject, shader.shaderObject);
+    }
+
+    bindAttribLocations(nextProgramObject);
+    if (!getBinaryCacheDirectory().empty() && supportsProgramBinary()) {
+        glProgramParameteri(nextProgramObject, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glLinkProgram(nextProgramObject);
+    recompilePolls = 0;
+
+    CHECK_GL_ERRORS;
+    return true;
 }
 
 //------------------------------------------------------------------------------------
 /*
-* Extracts source code from file located at 'filePath' and places contents into
-* 'shaderSource'.
+* Swaps in the recompiled program once the driver has finished with it.
 */
-void ShaderProgram::extractSourceCode (
-		string & shaderSource,
+ShaderProgram::RecompileStatus ShaderProgram::pollRecompile() {
+    if (nextProgramObject == 0) {
+        return RECOMPILE_IDLE;
+    }
+
+    // Without the completion status, give the driver a frame before asking.
+    if (supportsParallelCompile()) {
+        GLint complete = GL_FALSE;
+        glGetProgramiv(nextProgramObject, GL_COMPLETION_STATUS_KHR, &complete);
+        if (complete == GL_FALSE) {
+            return RECOMPILE_PENDING;
+        }
+    } else if (recompilePolls++ == 0) {
+        return RECOMPILE_PENDING;
+    }
+
+    try {
+        for (const Shader & shader : nextShaders) {
+            if (shader.shaderObject != 0) {
+                checkCompilationStatus(shader);
+            }
+        }
+        checkLinkStatus(nextProgramObject);
+    } catch (const ShaderException & e) {
+        recompileLog = e.what();
+        discardRecompile();
+        return RECOMPILE_FAILED;
+    }
+
+    // Programs still bound are deleted by GL once they are unbound.
+    glDeleteShader(vertexShader.shaderObject);
+    glDeleteShader(fragmentShader.shaderObject);
+    glDeleteShader(geometryShader.shaderObject);
+    glDeleteProgram(programObject);
+
+    programObject = nextProgramObject;
+    vertexShader = nextShaders[0];
+    fragmentShader = nextShaders[1];
+    geometryShader = nextShaders[2];
+    nextProgramObject = 0;
+    loadedFromCache = false;
+    recompileLog.clear();
+    reflect();
+
+    if (!getBinaryCacheDirectory().empty() && supportsProgramBinary()) {
+        uint64_t key = getBinaryKey();
+        saveProgramBinary(getBinaryCachePath(key), key);
+    }
+
+    CHECK_GL_ERRORS;
+    return RECOMPILE_DONE;
+}
+
+//------------------------------------------------------------------------------------
+const string & ShaderProgram::getRecompileLog() const {
+    return recompileLog;
+}
+
+//------------------------------------------------------------------------------------
+bool ShaderProgram::usesFile (
 		const string & filePath
+) const {
+    const Shader * shaders[] = { &vertexShader, &fragmentShader, &geometryShader };
+    for (const Shader * shader : shaders) {
+        if (shader->shaderObject != 0 &&
+                find(shader->files.begin(), shader->files.end(), filePath) != shader->files.end()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------------
+/*
+* Gives a new program the attribute locations of the current one, so vertex
+* arrays set up for the current program work with it.
+*/
+void ShaderProgram::bindAttribLocations (
+		GLuint program
+) const {
+    for (const Variable & attribute : attributes.variables) {
+        glBindAttribLocation(program, GLuint(attribute.location), attribute.name.c_str());
+    }
+}
+
+//------------------------------------------------------------------------------------
+/*
+* Reads the active variables of the linked program into the lookup tables and
+* forgets the uniform values set on the previous one.
+*/
+void ShaderProgram::reflect() {
+    uniforms.clear();
+    uniformElements.clear();
+    uniformBlocks.clear();
+    attributes.clear();
+    uniformValues.clear();
+    skippedUploads = 0;
+
+    GLint count = 0, maxLength = 0;
+    vector<GLchar> name;
+
+    glGetProgramiv(programObject, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(programObject, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    name.assign(size_t(max(maxLength, 1)), '\0');
+    for (GLint idx = 0; idx < count; ++idx) {
+        GLint size;
+        GLenum type;
+        glGetActiveUniform(programObject, GLuint(idx), GLsizei(name.size()), NULL, &size, &type, name.data());
+
+        // Members of uniform blocks have no location.
+        GLint location = glGetUniformLocation(programObject, name.data());
+        if (location < 0) {
+            continue;
+        }
+
+        // Arrays are reported as "name[0]", and can be found by either name.
+        string uniformName = name.data();
+        uniforms.add(uniformName, location, type, size);
+        if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0) {
+            uniforms.add(uniformName.substr(0, uniformName.size() - 3), location, type, size);
+        }
+
+        if (uniformValues.size() < size_t(location + size)) {
+            UniformValue unknown = UniformValue();
+            uniformValues.resize(size_t(location + size), unknown);
+        }
+        uniformValues[location].tracked = size == 1;
+    }
+
+    glGetProgramiv(programObject, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+    glGetProgramiv(programObject, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+    name.assign(size_t(max(maxLength, 1)), '\0');
+    for (GLint idx = 0; idx < count; ++idx) {
+        GLint dataSize = 0;
+        glGetActiveUniformBlockName(programObject, GLuint(idx), GLsizei(name.size()), NULL, name.data());
+        glGetActiveUniformBlockiv(programObject, GLuint(idx), GL_UNIFORM_BLOCK_DATA_SIZE, &dataSize);
+        uniformBlocks.add(name.data(), idx, 0, dataSize);
+    }
+
+    glGetProgramiv(programObject, GL_ACTIVE_ATTRIBUTES, &count);
+    glGetProgramiv(programObject, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength);
+    name.assign(size_t(max(maxLength, 1)), '\0');
+    for (GLint idx = 0; idx < count; ++idx) {
+        GLint size;
+        GLenum type;
+        glGetActiveAttrib(programObject, GLuint(idx), GLsizei(name.size()), NULL, &size, &type, name.data());
+
+        // Built in attributes have no location.
+        GLint location = glGetAttribLocation(programObject, name.data());
+        if (location >= 0) {
+            attributes.add(name.data(), location, type, size);
+        }
+    }
+
+    uniforms.build();
+    uniformBlocks.build();
+    attributes.build();
+}
+
+//------------------------------------------------------------------------------------
+void ShaderProgram::VariableTable::clear() {
+    variables.clear();
+    slots.clear();
+}
+
+//------------------------------------------------------------------------------------
+void ShaderProgram::VariableTable::add (
+		const string & name,
+		GLint location,
+		GLenum type,
+		GLint size
 ) {
-    ifstream file;
+    Variable variable;
+    variable.name = name;
+    variable.hash = hashName(name.c_str());
+    variable.location = location;
+    variable.type = type;
+    variable.size = size;
+    variables.push_back(variable);
+}
 
-    file.open(filePath.c_str());
-    if (!file) {
-        stringstream strStream;
-        strStream << "Error -- Failed to open file: " << filePath << endl;
-        throw ShaderException(strStream.str());
+//------------------------------------------------------------------------------------
+/*
+* Sizes the table to a power of two at most half full, so probes are short.
+*/
+void ShaderProgram::VariableTable::build() {
+    size_t capacity = 8;
+    while (capacity < variables.size() * 2) {
+        capacity *= 2;
+    }
+
+    slots.assign(capacity, -1);
+    for (size_t idx = 0; idx < variables.size(); ++idx) {
+        size_t slot = size_t(variables[idx].hash) & (capacity - 1);
+        while (slots[slot] >= 0) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        slots[slot] = int32_t(idx);
+    }
+}
+
+//------------------------------------------------------------------------------------
+const ShaderProgram::Variable * ShaderProgram::VariableTable::find (
+		const char * name
+) const {
+    if (slots.empty()) {
+        return nullptr;
+    }
+
+    uint64_t hash = hashName(name);
+    size_t mask = slots.size() - 1;
+    for (size_t slot = size_t(hash) & mask; slots[slot] >= 0; slot = (slot + 1) & mask) {
+        const Variable & variable = variables[slots[slot]];
+        if (variable.hash == hash && variable.name == name) {
+            return &variable;
+        }
     }
+    return nullptr;
+}
 
-    stringstream strBuffer;
-    string str;
+//------------------------------------------------------------------------------------
+void ShaderProgram::discardRecompile() {
+    if (nextProgramObject == 0) {
+        return;
+    }
 
-    while(file.good()) {
-        getline(file, str, '\r');
-        strBuffer << str;
+    for (Shader & shader : nextShaders) {
+        glDeleteShader(shader.shaderObject);
+        shader = Shader();
     }
-    file.close();
+    glDeleteProgram(nextProgramObject);
+    nextProgramObject = 0;
+}
 
-    strBuffer << '\0';  // Append null terminator.
+//------------------------------------------------------------------------------------
+/*
+* Reads a shader's file through the preprocessor, with the program's defines.
+*/
+void ShaderProgram::readSource (
+		Shader & shader
+) const {
+    ShaderPreprocessor preprocessor;
+    preprocessor.setDefines(defines);
 
-    shaderSource = strBuffer.str();
+    shader.source = preprocessor.process(shader.filePath);
+    shader.files = preprocessor.getFiles();
 }
 
 //------------------------------------------------------------------------------------
@@ -119,6 +529,38 @@ void ShaderProgram::extractSourceCode (
 * Note: This method must be called once before calling ShaderProgram::enable().
 */
 void ShaderProgram::link() {
+    beginLink();
+    finishLink();
+}
+
+//------------------------------------------------------------------------------------
+/*
+* Loads the program from the binary cache, or issues its compile and link
+* without waiting for them.
+*/
+void ShaderProgram::beginLink() {
+    loadedFromCache = false;
+    linkPending = false;
+
+    saveBinary = !getBinaryCacheDirectory().empty() && supportsProgramBinary();
+    if (saveBinary) {
+        binaryKey = getBinaryKey();
+        if (loadProgramBinary(getBinaryCachePath(binaryKey), binaryKey)) {
+            loadedFromCache = true;
+            saveBinary = false;
+            reflect();
+            return;
+        }
+        glProgramParameteri(programObject, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    Shader * shaders[] = { &vertexShader, &fragmentShader, &geometryShader };
+    for (Shader * shader : shaders) {
+        if (shader->shaderObject != 0) {
+            compileShader(shader->shaderObject, shader->source);
+        }
+    }
+
     if(vertexShader.shaderObject != 0) {
         glAttachShader(programObject, vertexShader.shaderObject);
     }
@@ -132,9 +574,152 @@ void ShaderProgram::link() {
     }
 
     glLinkProgram(programObject);
-    checkLinkStatus();
+    linkPending = true;
+
+    CHECK_GL_ERRORS;
+}
+
+//------------------------------------------------------------------------------------
+/*
+* Waits for the link started by beginLink() and checks that it succeeded.
+*/
+void ShaderProgram::finishLink() {
+    if (!linkPending) {
+        return;
+    }
+    linkPending = false;
+
+    Shader * shaders[] = { &vertexShader, &fragmentShader, &geometryShader };
+    for (Shader * shader : shaders) {
+        if (shader->shaderObject != 0) {
+            checkCompilationStatus(*shader);
+        }
+    }
+    checkLinkStatus(programObject);
+    reflect();
 
     CHECK_GL_ERRORS;
+
+    if (saveBinary) {
+        saveProgramBinary(getBinaryCachePath(binaryKey), binaryKey);
+    }
+}
+
+//------------------------------------------------------------------------------------
+/*
+* Hashes everything that decides the binary: each stage's source and the driver.
+*/
+uint64_t ShaderProgram::getBinaryKey() const {
+    uint64_t hash = 14695981039346656037ull;
+
+    const Shader * shaders[] = { &vertexShader, &fragmentShader, &geometryShader };
+    for (const Shader * shader : shaders) {
+        if (shader->shaderObject != 0) {
+            hash ^= shader->type;
+            hash *= 1099511628211ull;
+            hashString(hash, shader->source.c_str());
+        }
+    }
+
+    hashString(hash, (const char *)glGetString(GL_VENDOR));
+    hashString(hash, (const char *)glGetString(GL_RENDERER));
+    hashString(hash, (const char *)glGetString(GL_VERSION));
+    hashString(hash, (const char *)glGetString(GL_SHADING_LANGUAGE_VERSION));
+
+    return hash;
+}
+
+//------------------------------------------------------------------------------------
+string ShaderProgram::getBinaryCachePath (
+		uint64_t key
+) const {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+    return getBinaryCacheDirectory() + "/" + name;
+}
+
+//------------------------------------------------------------------------------------
+/*
+* Links the program from a cached binary. Returns false if there is no usable
+* binary, leaving the program to be linked from source.
+*/
+bool ShaderProgram::loadProgramBinary (
+		const string & cachePath,
+		uint64_t key
+) {
+    FILE * file = fopen(cachePath.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    BinaryHeader header;
+    vector<uint8_t> binary;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+            memcmp(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0 &&
+            header.version == BINARY_VERSION && header.key == key && header.length > 0;
+    if (valid) {
+        binary.resize(header.length);
+        valid = fread(binary.data(), 1, binary.size(), file) == binary.size();
+    }
+    fclose(file);
+
+    if (!valid || !isBinaryFormatSupported(header.format)) {
+        return false;
+    }
+
+    glProgramBinary(programObject, header.format, binary.data(), GLsizei(binary.size()));
+
+    // Drivers reject binaries from other builds by failing the link.
+    GLint linkSuccess = GL_FALSE;
+    glGetProgramiv(programObject, GL_LINK_STATUS, &linkSuccess);
+    return linkSuccess == GL_TRUE;
+}
+
+//------------------------------------------------------------------------------------
+/*
+* Writes the linked program to the binary cache. The file is renamed into place
+* so other processes never read part of it.
+*/
+void ShaderProgram::saveProgramBinary (
+		const string & cachePath,
+		uint64_t key
+) {
+    GLint length = 0;
+    glGetProgramiv(programObject, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    vector<uint8_t> binary(length);
+    GLsizei written = 0;
+    GLenum format = 0;
+    glGetProgramBinary(programObject, length, &written, &format, binary.data());
+    if (written <= 0) {
+        return;
+    }
+
+    BinaryHeader header;
+    memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    header.version = BINARY_VERSION;
+    header.key = key;
+    header.format = format;
+    header.length = uint32_t(written);
+
+    makeDirectory(getBinaryCacheDirectory());
+
+    string tempPath = cachePath + ".tmp";
+    FILE * file = fopen(tempPath.c_str(), "wb");
+    bool saved = file != nullptr &&
+            fwrite(&header, sizeof(header), 1, file) == 1 &&
+            fwrite(binary.data(), 1, header.length, file) == header.length;
+    if (file != nullptr) {
+        saved = fclose(file) == 0 && saved;
+    }
+
+    if (!saved || rename(tempPath.c_str(), cachePath.c_str()) != 0) {
+        remove(tempPath.c_str());
+        cerr << "Unable to write shader cache " << cachePath << endl;
+    }
 }
 
 //------------------------------------------------------------------------------------
@@ -144,8 +729,16 @@ ShaderProgram::~ShaderProgram() {
 
 //------------------------------------------------------------------------------------
 void ShaderProgram::deleteShaders() {
+    // Nothing to delete, and maybe no context to delete it with, if the
+    // program was never created.
+    if (programObject == 0) {
+        return;
+    }
+
+    discardRecompile();
     glDeleteShader(vertexShader.shaderObject);
     glDeleteShader(fragmentShader.shaderObject);
+    glDeleteShader(geometryShader.shaderObject);
     glDeleteProgram(programObject);
 }
 
@@ -168,15 +761,13 @@ void ShaderProgram::compileShader (
     glShaderSource(shaderObject, 1, (const GLchar **)&sourceCodeStr, NULL);
 
     glCompileShader(shaderObject);
-    checkCompilationStatus(shaderObject);
-
-    CHECK_GL_ERRORS;
 }
 
 //------------------------------------------------------------------------------------
 void ShaderProgram::checkCompilationStatus (
-		GLuint shaderObject
+		const Shader & shader
 ) {
+    GLuint shaderObject = shader.shaderObject;
     GLint compileSuccess;
 
     glGetShaderiv(shaderObject, GL_COMPILE_STATUS, &compileSuccess);
@@ -189,9 +780,16 @@ void ShaderProgram::checkCompilationStatus (
         GLchar errorMessage[errorMessageLength + 1]; // Add 1 for null terminator
         glGetShaderInfoLog(shaderObject, errorMessageLength, NULL, errorMessage);
 
-        string message = "Error Compiling Shader: ";
+        string message = "Error Compiling Shader " + shader.filePath + ": ";
         message += errorMessage;
 
+        // Errors name files by their index.
+        if (shader.files.size() > 1) {
+            for (size_t idx = 0; idx < shader.files.size(); ++idx) {
+                message += "  " + to_string(idx) + ": " + shader.files[idx] + "\n";
+            }
+        }
+
         throw ShaderException(message);
     }
 }
@@ -209,18 +807,20 @@ void ShaderProgram::disable() const {
 }
 
 //------------------------------------------------------------------------------------
-void ShaderProgram::checkLinkStatus() {
+void ShaderProgram::checkLinkStatus (
+		GLuint program
+) {
     GLint linkSuccess;
 
-    glGetProgramiv(programObject, GL_LINK_STATUS, &linkSuccess);
+    glGetProgramiv(program, GL_LINK_STATUS, &linkSuccess);
     if (linkSuccess == GL_FALSE) {
         GLint errorMessageLength;
         // Get the length in chars of the link error message.
-        glGetProgramiv(programObject, GL_INFO_LOG_LENGTH, &errorMessageLength);
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &errorMessageLength);
 
         // Retrieve the link error message.
         GLchar errorMessage[errorMessageLength];
-        glGetProgramInfoLog(programObject, errorMessageLength, NULL, errorMessage);
+        glGetProgramInfoLog(program, errorMessageLength, NULL, errorMessage);
 
         stringstream strStream;
         strStream << "Error Linking Shaders: " << errorMessage << endl;
@@ -244,7 +844,7 @@ GLuint ShaderProgram::getProgramObject() const {
 GLint ShaderProgram::getUniformLocation (
 		const char * uniformName
 ) const {
-    GLint result = glGetUniformLocation(programObject, (const GLchar *)uniformName);
+    GLint result = findUniformLocation(uniformName);
 
     if (result == -1) {
         stringstream errorMessage;
@@ -262,7 +862,7 @@ GLint ShaderProgram::getUniformLocation (
 GLint ShaderProgram::getAttribLocation (
 		const char * attributeName
 ) const {
-    GLint result = glGetAttribLocation(programObject, (const GLchar *)attributeName);
+    GLint result = findAttribLocation(attributeName);
 
     if (result == -1) {
         stringstream errorMessage;
@@ -273,3 +873,150 @@ GLint ShaderProgram::getAttribLocation (
     return result;
 }
 
+//------------------------------------------------------------------------------------
+GLint ShaderProgram::findUniformLocation (
+		const char * uniformName
+) const {
+    const Variable * uniform = uniforms.find(uniformName);
+    if (uniform != nullptr) {
+        return uniform->location;
+    }
+
+    // Only whole arrays and their first elements are reflected. Other
+    // elements are asked of GL once, and the answer kept, found or not.
+    if (strchr(uniformName, '[') == nullptr) {
+        return -1;
+    }
+    const Variable * element = uniformElements.find(uniformName);
+    if (element == nullptr) {
+        GLint location = glGetUniformLocation(programObject, uniformName);
+        uniformElements.add(uniformName, location, 0, 1);
+        uniformElements.build();
+        element = uniformElements.find(uniformName);
+    }
+    return element->location;
+}
+
+//------------------------------------------------------------------------------------
+GLint ShaderProgram::findAttribLocation (
+		const char * attributeName
+) const {
+    const Variable * attribute = attributes.find(attributeName);
+    return attribute != nullptr ? attribute->location : -1;
+}
+
+//------------------------------------------------------------------------------------
+GLuint ShaderProgram::findUniformBlockIndex (
+		const char * blockName
+) const {
+    const Variable * block = uniformBlocks.find(blockName);
+    return block != nullptr ? GLuint(block->location) : GL_INVALID_INDEX;
+}
+
+//------------------------------------------------------------------------------------
+bool ShaderProgram::updateUniformValue (
+		GLint location,
+		const void * data,
+		size_t bytes
+) {
+    if (location < 0 || size_t(location) >= uniformValues.size()) {
+        return true;
+    }
+
+    UniformValue & value = uniformValues[location];
+    if (!value.tracked) {
+        return true;
+    }
+
+    if (value.known && memcmp(value.data, data, bytes) == 0) {
+        ++skippedUploads;
+        return false;
+    }
+
+    memcpy(value.data, data, bytes);
+    value.known = true;
+    return true;
+}
+
+//------------------------------------------------------------------------------------
+void ShaderProgram::setUniform(GLint location, int value) {
+    if (location >= 0 && updateUniformValue(location, &value, sizeof(value))) {
+        glUniform1i(location, value);
+    }
+}
+
+//------------------------------------------------------------------------------------
+void ShaderProgram::setUniform(GLint location, float value) {
+    if (location >= 0 && updateUniformValue(location, &value, sizeof(value))) {
+        glUniform1f(location, value);
+    }
+}
+
+//------------------------------------------------------------------------------------
+void ShaderProgram::setUniform(GLint location, const glm::vec2 & value) {
+    if (location >= 0 && updateUniformValue(location, value_ptr(value), sizeof(value))) {
+        glUniform2fv(location, 1, value_ptr(value));
+    }
+}
+
+//------------------------------------------------------------------------------------
+void ShaderProgram::setUniform(GLint location, const glm::vec3 & value) {
+    if (location >= 0 && updateUniformValue(location, value_ptr(value), sizeof(value))) {
+        glUniform3fv(location, 1, value_ptr(value));
+    }
+}
+
+//------------------------------------------------------------------------------------
+void ShaderProgram::setUniform(GLint location, const glm::vec4 & value) {
+    if (location >= 0 && updateUniformValue(location, value_ptr(value), sizeof(value))) {
+        glUniform4fv(location, 1, value_ptr(value));
+    }
+}
+
+//------------------------------------------------------------------------------------
+void ShaderProgram::setUniform(GLint location, const glm::mat3 & value) {
+    if (location >= 0 && updateUniformValue(location, value_ptr(value), sizeof(value))) {
+        glUniformMatrix3fv(location, 1, GL_FALSE, value_ptr(value));
+    }
+}
+
+//------------------------------------------------------------------------------------
+void ShaderProgram::setUniform(GLint location, const glm::mat4 & value) {
+    if (location >= 0 && updateUniformValue(location, value_ptr(value), sizeof(value))) {
+        glUniformMatrix4fv(location, 1, GL_FALSE, value_ptr(value));
+    }
+}
+
+//------------------------------------------------------------------------------------
+uint64_t ShaderProgram::getSkippedUploads() const {
+    return skippedUploads;
+}
+
+//------------------------------------------------------------------------------------
+bool ShaderProgram::isLoadedFromCache() const {
+    return loadedFromCache;
+}
+
+//------------------------------------------------------------------------------------
+void ShaderProgram::setBinaryCacheDirectory (
+		const string & directory
+) {
+    binaryCacheDirectory() = directory;
+}
+
+//------------------------------------------------------------------------------------
+const string & ShaderProgram::getBinaryCacheDirectory() {
+    return binaryCacheDirectory();
+}
+
+//------------------------------------------------------------------------------------
+void ShaderProgram::setDefines (
+		const vector<string> & defines
+) {
+    this->defines = defines;
+}
+
+//------------------------------------------------------------------------------------
+const vector<string> & ShaderProgram::getDefines() const {
+    return defines;
+}
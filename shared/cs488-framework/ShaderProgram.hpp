@@ -6,17 +6,51 @@
 
 #include "OpenGLImport.hpp"
 
+#include <glm/glm.hpp>
+
+#include <cstdint>
 #include <string>
+#include <vector>
 
 
+/*
+ * A GLSL program built from shader files.
+ *
+ * Shaders are read when attached and compiled by link(). Linked programs are
+ * kept in a binary cache directory, keyed by a hash of their sources and of
+ * the driver, so later runs can load them with glProgramBinary instead of
+ * compiling. A missing, stale or rejected binary falls back to compiling.
+ *
+ * recompileShaders() rebuilds the program from its files without stalling
+ * the caller. The current program is used until the new one has linked, and
+ * kept if it fails to.
+ *
+ * Each linked program's active uniforms, uniform blocks and attributes are
+ * read once into hashed tables, so lookups by name neither call into GL nor
+ * allocate. The setUniform() overloads remember the last value set at each
+ * location and skip uploads that would not change it.
+ */
 class ShaderProgram {
 public:
+    enum RecompileStatus {
+        RECOMPILE_IDLE,     // No recompile was started.
+        RECOMPILE_PENDING,  // The driver is still compiling.
+        RECOMPILE_DONE,     // The new program replaced the old one.
+        RECOMPILE_FAILED    // The old program was kept. See getRecompileLog().
+    };
+
     ShaderProgram();
 
     ~ShaderProgram();
 
     void generateProgramObject();
 
+    // Sets the #defines added to shaders attached after this, each "NAME" or
+    // "NAME=VALUE". Shader files may also #include others.
+    void setDefines(const std::vector<std::string> & defines);
+
+    const std::vector<std::string> & getDefines() const;
+
     void attachVertexShader(const char * filePath);
     
     void attachFragmentShader(const char * filePath);
@@ -25,23 +59,122 @@ public:
 
     void link();
 
+    // link() in two halves. beginLink() issues the compiles and link and
+    // returns, and finishLink() waits for them and throws any errors, so
+    // several programs can be built at once on drivers that compile in
+    // parallel.
+    void beginLink();
+
+    void finishLink();
+
     void enable() const;
 
     void disable() const;
 
-    void recompileShaders();
+    // Starts compiling and linking the shaders from their files again, on
+    // driver threads where KHR_parallel_shader_compile is available. A
+    // recompile already in progress is abandoned. Returns false if a file
+    // could not be read.
+    bool recompileShaders();
+
+    // Checks on a recompile without waiting for the driver. Call once a
+    // frame. Uniform locations must be looked up again after RECOMPILE_DONE;
+    // attribute locations are kept.
+    RecompileStatus pollRecompile();
+
+    // The errors of the last recompile that failed.
+    const std::string & getRecompileLog() const;
+
+    // True if filePath is one of the shader files, or a file they include.
+    bool usesFile(const std::string & filePath) const;
 
     GLuint getProgramObject() const;
 
+    // Throw a ShaderException if the program has no such active variable.
     GLint getUniformLocation(const char * uniformName) const;
 
     GLint getAttribLocation(const char * attributeName) const;
 
+    // Return -1 if the program has no such active variable.
+    GLint findUniformLocation(const char * uniformName) const;
+
+    GLint findAttribLocation(const char * attributeName) const;
+
+    // Returns GL_INVALID_INDEX if the program has no such block.
+    GLuint findUniformBlockIndex(const char * blockName) const;
+
+    // Set a uniform of this program, which must be the one in use. Values
+    // must only be set through these, or the skipped uploads go wrong.
+    // Location -1 is ignored, as it is by GL.
+    void setUniform(GLint location, int value);
+    void setUniform(GLint location, float value);
+    void setUniform(GLint location, const glm::vec2 & value);
+    void setUniform(GLint location, const glm::vec3 & value);
+    void setUniform(GLint location, const glm::vec4 & value);
+    void setUniform(GLint location, const glm::mat3 & value);
+    void setUniform(GLint location, const glm::mat4 & value);
+
+    // Uploads skipped since the program was linked because the value was
+    // already set.
+    uint64_t getSkippedUploads() const;
+
+    // True if the last link() loaded the program from the binary cache.
+    bool isLoadedFromCache() const;
+
+    // Sets where program binaries are cached. Defaults to the
+    // CS488_SHADER_CACHE environment variable, or "shader-cache" if it is
+    // not set. An empty path disables the cache.
+    static void setBinaryCacheDirectory(const std::string & directory);
+
+    static const std::string & getBinaryCacheDirectory();
+
 
 private:
+    /*
+     * An active variable of the program. For uniform blocks the location is
+     * the block index and the size is the size of its data in bytes.
+     */
+    struct Variable {
+        std::string name;
+        uint64_t hash;
+        GLint location;
+        GLenum type;
+        GLint size;
+    };
+
+    /*
+     * Variables of one kind, found by name through an open addressing table
+     * of indices into them.
+     */
+    struct VariableTable {
+        std::vector<Variable> variables;
+        std::vector<int32_t> slots;
+
+        void clear();
+
+        void add(const std::string & name, GLint location, GLenum type, GLint size);
+
+        // Rebuilds the slots after variables have been added.
+        void build();
+
+        const Variable * find(const char * name) const;
+    };
+
+    // The last value set at a uniform location. Arrays are not tracked.
+    struct UniformValue {
+        bool tracked;
+        bool known;
+        float data[16];
+    };
+
     struct Shader {
         GLuint shaderObject;
+        GLenum type;
         std::string filePath;
+        std::string source;
+
+        // filePath and the files it includes.
+        std::vector<std::string> files;
 
         Shader();
     };
@@ -53,19 +186,57 @@ private:
     GLuint programObject;
     GLuint prevProgramObject;
     GLuint activeProgram;
+    bool loadedFromCache;
+    std::vector<std::string> defines;
 
-    void extractSourceCode(std::string & shaderSource, const std::string & filePath);
-    
-    void extractSourceCodeAndCompile(const Shader &shader);
+    // Set by beginLink() for finishLink().
+    bool linkPending;
+    bool saveBinary;
+    uint64_t binaryKey;
+
+    // The program being recompiled, and the shaders it was built from.
+    GLuint nextProgramObject;
+    Shader nextShaders[3];
+    unsigned recompilePolls;
+    std::string recompileLog;
+
+    VariableTable uniforms;
+    // Array elements such as "lights[2]", looked up as they are asked for.
+    mutable VariableTable uniformElements;
+    VariableTable uniformBlocks;
+    VariableTable attributes;
+    std::vector<UniformValue> uniformValues;
+    uint64_t skippedUploads;
+
+    void attachShader(Shader & shader, GLenum shaderType, const char * filePath);
+
+    void readSource(Shader & shader) const;
 
     GLuint createShader(GLenum shaderType);
 
     void compileShader(GLuint shaderObject, const std::string & shader);
 
-    void checkCompilationStatus(GLuint shaderObject);
+    void checkCompilationStatus(const Shader & shader);
+
+    void checkLinkStatus(GLuint program);
+
+    void bindAttribLocations(GLuint program) const;
+
+    void reflect();
 
-    void checkLinkStatus();
+    // Records a value about to be set, and returns false if it is already set.
+    bool updateUniformValue(GLint location, const void * data, size_t bytes);
+
+    void discardRecompile();
 
     void deleteShaders();
+
+    uint64_t getBinaryKey() const;
+
+    std::string getBinaryCachePath(uint64_t key) const;
+
+    bool loadProgramBinary(const std::string & cachePath, uint64_t key);
+
+    void saveProgramBinary(const std::string & cachePath, uint64_t key);
 };
 
@@ -0,0 +1,279 @@
+#include "TraceExporter.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// Frames waited for after a capture so its GPU zones can be read back.
+const unsigned GPU_LATENCY_FRAMES = 6;
+
+// Longest capture, so the zones of the main thread fit in its ring buffer.
+const unsigned MAX_FRAMES = 1000;
+
+enum CaptureState {
+    CAPTURE_IDLE,
+    CAPTURE_STARTING,
+    CAPTURE_RECORDING,
+    CAPTURE_DRAINING,
+    CAPTURE_WRITING
+};
+
+/*
+ * Everything a trace file is written from, copied out of the profiler on the
+ * main thread and handed to the writer thread.
+ */
+struct Trace {
+    string filePath;
+    uint64_t start;
+    uint64_t end;
+    vector<uint64_t> frameStarts;
+    vector<Profiler::Zone> zones;
+    vector<Profiler::Counter> counters;
+    vector<string> threadNames;
+};
+
+CaptureState state = CAPTURE_IDLE;
+unsigned framesRequested = 0;
+unsigned framesLeft = 0;
+Trace current;
+
+thread writer;
+mutex statusLock;
+string status = "No trace captured";
+bool writing = false;
+
+void setStatus(const string & text, bool stillWriting) {
+    lock_guard<mutex> guard(statusLock);
+    status = text;
+    writing = stillWriting;
+}
+
+// Writes a string as a JSON literal. Zone names are literals, so only
+// quotes, backslashes and control characters need escaping.
+void writeString(FILE * file, const char * text) {
+    fputc('"', file);
+    for (const char * c = text; *c != '\0'; ++c) {
+        if (*c == '"' || *c == '\\') {
+            fputc('\\', file);
+            fputc(*c, file);
+        } else if (uint8_t(*c) < 0x20) {
+            fprintf(file, "\\u%04x", unsigned(uint8_t(*c)));
+        } else {
+            fputc(*c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+// Trace event times are in microseconds from the start of the capture.
+double toMicroseconds(uint64_t time, uint64_t start) {
+    return double(int64_t(time - start)) * 1.0e-3;
+}
+
+bool writeTrace(const Trace & trace) {
+    FILE * file = fopen(trace.filePath.c_str(), "w");
+    if (file == nullptr) {
+        return false;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Stack\"}}");
+
+    for (size_t idx = 0; idx < trace.threadNames.size(); ++idx) {
+        fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":", idx);
+        writeString(file, trace.threadNames[idx].c_str());
+        fprintf(file, "}}");
+    }
+
+    for (size_t idx = 0; idx < trace.frameStarts.size(); ++idx) {
+        fprintf(file, ",\n{\"name\":\"Frame %zu\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":%.3f}",
+                idx, toMicroseconds(trace.frameStarts[idx], trace.start));
+    }
+
+    for (const Profiler::Zone & zone : trace.zones) {
+        fprintf(file, ",\n{\"name\":");
+        writeString(file, zone.name);
+        fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                unsigned(zone.thread), toMicroseconds(zone.start, trace.start),
+                double(zone.end - zone.start) * 1.0e-3);
+    }
+
+    for (const Profiler::Counter & counter : trace.counters) {
+        fprintf(file, ",\n{\"name\":");
+        writeString(file, counter.name);
+        fprintf(file, ",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"value\":%.17g}}",
+                toMicroseconds(counter.time, trace.start), counter.value);
+    }
+
+    fprintf(file, "\n]}\n");
+
+    bool ok = !ferror(file);
+    return fclose(file) == 0 && ok;
+}
+
+// Copies the zones and counters of the captured frames out of the profiler.
+void collectTrace(Trace & trace) {
+    vector<Profiler::Zone> zones;
+    Profiler::collect(trace.start, zones);
+
+    trace.zones.clear();
+    for (const Profiler::Zone & zone : zones) {
+        if (zone.start >= trace.start && zone.start < trace.end) {
+            trace.zones.push_back(zone);
+        }
+    }
+
+    vector<Profiler::Counter> counters;
+    Profiler::collectCounters(trace.start, counters);
+
+    trace.counters.clear();
+    for (const Profiler::Counter & counter : counters) {
+        if (counter.time < trace.end) {
+            trace.counters.push_back(counter);
+        }
+    }
+
+    trace.threadNames.resize(Profiler::getThreadCount());
+    for (size_t idx = 0; idx < trace.threadNames.size(); ++idx) {
+        trace.threadNames[idx] = Profiler::getThreadName(idx);
+    }
+}
+
+string defaultFilePath() {
+    char name[64];
+    time_t now = time(nullptr);
+    strftime(name, sizeof(name), "trace-%Y%m%d-%H%M%S.json", localtime(&now));
+    return name;
+}
+
+}
+
+//------------------------------------------------------------------------------------
+bool TraceExporter::start(const string & filePath, unsigned frames) {
+    if (!Profiler::isEnabled()) {
+        setStatus("Traces need a build with CS488_PROFILE", false);
+        return false;
+    }
+
+    if (isCapturing()) {
+        return false;
+    }
+
+    // A previous trace may have finished writing without being joined.
+    if (writer.joinable()) {
+        writer.join();
+    }
+
+    framesRequested = max(1u, min(frames, MAX_FRAMES));
+    current = Trace();
+    current.filePath = filePath.empty() ? defaultFilePath() : filePath;
+    state = CAPTURE_STARTING;
+
+    char text[256];
+    snprintf(text, sizeof(text), "Capturing %u frames", framesRequested);
+    setStatus(text, false);
+    return true;
+}
+
+//------------------------------------------------------------------------------------
+void TraceExporter::startFromEnvironment() {
+    const char * frames = getenv("CS488_TRACE_FRAMES");
+    if (frames == nullptr) {
+        return;
+    }
+
+    const char * filePath = getenv("CS488_TRACE_FILE");
+    int count = atoi(frames);
+    start(filePath != nullptr ? filePath : "", count > 0 ? unsigned(count) : DEFAULT_FRAMES);
+}
+
+//------------------------------------------------------------------------------------
+void TraceExporter::update() {
+    switch (state) {
+    case CAPTURE_IDLE:
+        break;
+
+    case CAPTURE_STARTING:
+        // Start on a frame boundary, so the first frame is whole.
+        current.start = Profiler::now();
+        current.frameStarts.push_back(current.start);
+        framesLeft = framesRequested;
+        state = CAPTURE_RECORDING;
+        break;
+
+    case CAPTURE_RECORDING:
+        if (--framesLeft > 0) {
+            current.frameStarts.push_back(Profiler::now());
+            break;
+        }
+
+        current.end = Profiler::now();
+        framesLeft = GPU_LATENCY_FRAMES;
+        state = CAPTURE_DRAINING;
+        break;
+
+    case CAPTURE_DRAINING:
+        if (--framesLeft > 0) {
+            break;
+        }
+
+        collectTrace(current);
+        setStatus("Writing " + current.filePath, true);
+        state = CAPTURE_WRITING;
+
+        writer = thread([](Trace trace) {
+            if (writeTrace(trace)) {
+                char text[512];
+                snprintf(text, sizeof(text), "Wrote %zu frames, %zu zones to %s",
+                        trace.frameStarts.size(), trace.zones.size(), trace.filePath.c_str());
+                setStatus(text, false);
+                cout << text << endl;
+            } else {
+                setStatus("Unable to write trace file " + trace.filePath, false);
+                cerr << "Unable to write trace file " << trace.filePath << endl;
+            }
+        }, std::move(current));
+        break;
+
+    case CAPTURE_WRITING:
+        if (!isCapturing()) {
+            writer.join();
+            state = CAPTURE_IDLE;
+        }
+        break;
+    }
+}
+
+//------------------------------------------------------------------------------------
+bool TraceExporter::isCapturing() {
+    if (state == CAPTURE_WRITING) {
+        lock_guard<mutex> guard(statusLock);
+        return writing;
+    }
+    return state != CAPTURE_IDLE;
+}
+
+//------------------------------------------------------------------------------------
+string TraceExporter::getStatus() {
+    lock_guard<mutex> guard(statusLock);
+    return status;
+}
+
+//------------------------------------------------------------------------------------
+void TraceExporter::shutdown() {
+    if (writer.joinable()) {
+        writer.join();
+    }
+    state = CAPTURE_IDLE;
+}
@@ -0,0 +1,45 @@
+/*
+ * TraceExporter
+ */
+
+#pragma once
+
+#include <string>
+
+
+/*
+ * Captures the profiler zones, GPU zones and counters of a number of frames
+ * and writes them as Chrome trace event JSON, which Perfetto and
+ * chrome://tracing can open.
+ *
+ * A capture covers the frames after start() is called. Once they have run,
+ * a few more frames are waited for so the GPU zones are read back, then the
+ * trace is written on a background thread so the frames that follow are not
+ * slowed down by the file output. Captures require CS488_PROFILE.
+ */
+class TraceExporter {
+public:
+    static const unsigned DEFAULT_FRAMES = 120;
+
+    // Captures the next 'frames' frames into 'filePath'. An empty path picks
+    // a time stamped name in the working directory. Returns false if a
+    // capture is already in progress or profiling is compiled out.
+    static bool start(const std::string & filePath, unsigned frames = DEFAULT_FRAMES);
+
+    // Starts a capture of CS488_TRACE_FRAMES frames if that variable is set,
+    // written to CS488_TRACE_FILE if that is set too.
+    static void startFromEnvironment();
+
+    // Advances a capture in progress. Call once per frame, after
+    // PROFILE_FRAME().
+    static void update();
+
+    // Returns true from start() until the trace has been written.
+    static bool isCapturing();
+
+    // Gets a one line description of the last capture.
+    static std::string getStatus();
+
+    // Waits for a trace that is still being written.
+    static void shutdown();
+};
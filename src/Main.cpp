@@ -1,7 +1,19 @@
 #include "Stack.hpp"
+#include "batch.hpp"
 
 int main( int argc, char **argv )
 {
+	// Render grid files to images without a window
+	if( isBatchMode( argc, argv ) ) {
+		BatchOptions options;
+		if( !parseBatchOptions( argc, argv, options ) ) {
+			return 1;
+		}
+
+		CS488Window::setExecutablePath( argv[0] );
+		return runBatch( options );
+	}
+
 	CS488Window::launch( argc, argv, new Stack(), 1024, 768, "Stack OpenGL" );
 	return 0;
 }
@@ -1,14 +1,19 @@
 #include "Stack.hpp"
 
+#include "cs488-framework/AssetPack.hpp"
+#include "cs488-framework/GlCounters.hpp"
 #include "cs488-framework/GlErrorCheck.hpp"
 #include "cs488-framework/OpenGLImport.hpp"
+#include "cs488-framework/Profiler.hpp"
+#include "cs488-framework/TraceExporter.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <thread>
 
 #include <imgui/imgui.h>
 #include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
 
 using namespace glm;
 using namespace std;
@@ -16,9 +21,6 @@ using namespace std;
 // Dimensions of the grid
 static const size_t DIM = 16;
 
-// Height maximum of the grid
-static const size_t MAX_HEIGHT = 5;
-
 // Scale bounds on the scale
 static const float SCALE_LOWER = 0.5f;
 static const float SCALE_UPPER = 2.0f;
@@ -26,8 +28,12 @@ static const float SCALE_UPPER = 2.0f;
 //----------------------------------------------------------------------------------------
 // Constructor
 Stack::Stack()
-: current_col( 0 ),
-m_grid( DIM )
+: m_grid( DIM ),
+m_sceneDirty( true ),
+m_sceneLayerValid( false ),
+m_cacheSceneLayer( true ),
+m_adaptiveResolution( false ),
+current_col( 0 )
 {
     colour[0] = 0.0f;
     colour[1] = 0.0f;
@@ -72,34 +78,27 @@ void Stack::init()
     // Set the background colour.
     glClearColor( 0.3, 0.5, 0.7, 1.0 );
 
-    // Build the shader
-    m_shader.generateProgramObject();
-    m_shader.attachVertexShader( getAssetFilePath( "VertexShader.vs" ).c_str() );
-    m_shader.attachFragmentShader( getAssetFilePath( "FragmentShader.fs" ).c_str() );
-    m_shader.link();
+    // Build the shader and object buffers
+    m_renderer.init( getAssetFilePath( "VertexShader.vs" ), getAssetFilePath( "FragmentShader.fs" ) );
+    m_renderer.setGridDim( m_grid.getDim() );
 
-    // Set up the uniforms
-    P_uni = m_shader.getUniformLocation( "P" );
-    V_uni = m_shader.getUniformLocation( "V" );
-    M_uni = m_shader.getUniformLocation( "M" );
-    col_uni = m_shader.getUniformLocation( "colour" );
+    // Watch the shaders so edits show up without a restart. Packed assets
+    // do not change.
+    if ( !AssetPack::isMounted() ) {
+        std::string assetDirectory = getAssetFilePath( "" );
+        assetDirectory.pop_back();
+        m_assetWatcher.watch( assetDirectory );
+    }
 
-    // Initialize application state and object buffers
+    // Initialize application state
     initState();
-    initGrid();
-    initCube();
+
+    m_sceneTimer.init();
 
     // Set up initial view and projection matrices (need to do this here,
     // since it depends on the GLFW window being set up correctly).
-    view = glm::lookAt(
-      glm::vec3( 0.0f, float(DIM) * 2.0 * M_SQRT1_2, float(DIM) * 2.0 * M_SQRT1_2 ),
-      glm::vec3( 0.0f, 0.0f, 0.0f ),
-      glm::vec3( 0.0f, 1.0f, 0.0f ) );
-
-    proj = glm::perspective(
-      glm::radians( 45.0f ),
-      float( m_framebufferWidth ) / float( m_framebufferHeight ),
-      1.0f, 1000.0f );
+    view = sceneViewTransform( m_grid.getDim() );
+    proj = sceneProjection( m_framebufferWidth, m_framebufferHeight, m_grid.getDim() );
 }
 
 //----------------------------------------------------------------------------------------
@@ -107,15 +106,7 @@ void Stack::init()
 void Stack::initState()
 {
     // Initializes the grid colours (RGB)
-    grid_colours[0] = vec3(1.0f, 0.0f, 0.0f);     // Red
-    grid_colours[1] = vec3(0.0f, 0.74f, 1.0f);    // Blue
-    grid_colours[2] = vec3(0.13f, 0.54f, 0.13f);  // Green
-    grid_colours[3] = vec3(1.0f, 0.54f, 0.0f);    // Orange
-    grid_colours[4] = vec3(1.0f, 1.0f, 0.0f);     // Yellow
-    grid_colours[5] = vec3(0.54f, 0.0f, 0.54f);   // Purple
-    grid_colours[6] = vec3(0.0f, 1.0f, 1.0f);     // Cyan
-    grid_colours[7] = vec3(0.66f, 0.66f, 0.66f);  // Gray
-    grid_colours[8] = vec3(0.72f, 0.52f, 0.04f);   // Brown
+    initDefaultPalette(grid_colours);
 
     // Reset the scale
     current_scale = 1.0f;
@@ -133,123 +124,67 @@ void Stack::initState()
     isShiftDown = false;
     isMouseDown = false;
 
+    m_sceneDirty = true;
+
     glm::vec3 val = grid_colours[current_col];
     colour[0] = val.x;
     colour[1] = val.y;
     colour[2] = val.z;
 }
 
-// Initializes the grid of the application
-void Stack::initGrid()
-{
-    size_t vcount = 3 * 2 * 2 * (DIM + 3);
-
-    float vertices[ vcount ];
-    size_t ct = 0;
-    for( int idx = 0; idx < DIM+3; ++idx ) {
-        vertices[ ct ] = -1;
-        vertices[ ct+1 ] = 0;
-        vertices[ ct+2 ] = idx-1;
-        vertices[ ct+3 ] = DIM+1;
-        vertices[ ct+4 ] = 0;
-        vertices[ ct+5 ] = idx-1;
-        ct += 6;
-
-        vertices[ ct ] = idx-1;
-        vertices[ ct+1 ] = 0;
-        vertices[ ct+2 ] = -1;
-        vertices[ ct+3 ] = idx-1;
-        vertices[ ct+4 ] = 0;
-        vertices[ ct+5 ] = DIM+1;
-        ct += 6;
-    }
-
-    // Create the vertex array to record buffer assignments.
-    glGenVertexArrays( 1, &m_grid_vao );
-    glBindVertexArray( m_grid_vao );
-
-    // Create the cube vertex buffer
-    glGenBuffers( 1, &m_grid_vbo );
-    glBindBuffer( GL_ARRAY_BUFFER, m_grid_vbo );
-    glBufferData( GL_ARRAY_BUFFER, vcount * sizeof(float), vertices, GL_STATIC_DRAW );
-
-    // Specify the means of extracting the position values properly.
-    GLint posAttrib = m_shader.getAttribLocation( "position" );
-    glEnableVertexAttribArray( posAttrib );
-    glVertexAttribPointer( posAttrib, 3, GL_FLOAT, GL_FALSE, 0, nullptr );
-
-    // Reset state
-    glBindVertexArray( 0 );
-    glBindBuffer( GL_ARRAY_BUFFER, 0 );
-    glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
-
-    // Check for errors
-    CHECK_GL_ERRORS;
-}
-
 //----------------------------------------------------------------------------------------
-// Initializes the cube vertex and index data
-void Stack::initCube()
+/*
+* Called once per frame, before guiLogic().
+*/
+void Stack::appLogic()
 {
-    // Vertices that define the cube
-    size_t vcount = 8;
-    glm::vec3 vertices[] = {
-      {  0.0f, 0.0f, 1.0f },
-      {  1.0f, 0.0f, 1.0f },
-      {  1.0f, 1.0f, 1.0f },
-      {  0.0f, 1.0f, 1.0f },
-      {  0.0f, 0.0f, 0.0f },
-      {  1.0f, 0.0f, 0.0f },
-      {  1.0f, 1.0f, 0.0f },
-      {  0.0f, 1.0f, 0.0f },
-    };
-
-    // Indices that define the triangles that construct the cube
-    size_t icount = 12 * 3;
-    m_cube_icount = icount;
-    GLint indices[] = {
-        0, 1, 2, 2, 3, 0,
-        3, 2, 6, 6, 7, 3,
-        7, 6, 5, 5, 4, 7,
-        4, 0, 3, 3, 7, 4,
-        0, 1, 5, 5, 4, 0,
-        1, 5, 6, 6, 2, 1
-    };
-
-    // Setup the vertex array
-    glGenVertexArrays(1, &m_cube_vao);
-    glBindVertexArray(m_cube_vao);
-
-    // Setup the vertices of the cube
-    glGenBuffers(1, &m_cube_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, m_cube_vbo);
-    glBufferData(GL_ARRAY_BUFFER, vcount * sizeof(glm::vec3), &vertices[0], GL_STATIC_DRAW);
-
-    // Specify the means of extracting the position values properly.
-    GLint posAttrib = m_shader.getAttribLocation( "position" );
-    glEnableVertexAttribArray( posAttrib );
-    glVertexAttribPointer( posAttrib, 3, GL_FLOAT, GL_FALSE, 0, nullptr );
-
-    // Setup indices for the cube
-    glGenBuffers( 1, &m_cube_ibo );
-    glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, m_cube_ibo );
-    glBufferData( GL_ELEMENT_ARRAY_BUFFER, icount * sizeof(GLint), &indices[0], GL_STATIC_DRAW);
-
-    // Reset state
-    glBindVertexArray( 0 );
-    glBindBuffer( GL_ARRAY_BUFFER, 0 );
-    glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+    // Shaders rebuild in the background and replace the old ones once ready.
+    m_assetWatcher.poll(m_changedAssets);
+    for (const std::string & path : m_changedAssets) {
+        m_renderer.reloadShader(path);
+    }
+    if (m_renderer.updateShader()) {
+        m_sceneLayerValid = false;
+    }
 
-    CHECK_GL_ERRORS;
+    // Record the scene ahead of draw(), so draw() only replays it.
+    updateDrawList();
 }
 
 //----------------------------------------------------------------------------------------
 /*
-* Called once per frame, before guiLogic().
+* Rebuilds the draw list when the scene has changed since it was last recorded.
 */
-void Stack::appLogic()
+void Stack::updateDrawList()
 {
-    // Place per frame, application logic here ...
+    if (!m_sceneDirty) {
+        return;
+    }
+
+    PROFILE_SCOPE("updateDrawList");
+
+    SceneState scene;
+    scene.grid = &m_grid;
+    scene.palette = grid_colours;
+    scene.proj = proj;
+    scene.view = view;
+    scene.angle = current_angle;
+    scene.scale = current_scale;
+    scene.activeX = grid_pos_x;
+    scene.activeY = grid_pos_y;
+
+    {
+        PROFILE_SCOPE("buildDrawList");
+        buildDrawList(scene, m_drawList, thread::hardware_concurrency());
+    }
+    m_sceneLayerValid = false;
+
+    // Group by pass, shader and mesh, then front to back.
+    {
+        PROFILE_SCOPE("sort");
+        m_renderQueue.sort(m_drawList);
+    }
+    m_sceneDirty = false;
 }
 
 //----------------------------------------------------------------------------------------
@@ -265,13 +200,15 @@ void Stack::guiLogic()
     // this into instance fields of Stack.
     static bool showTestWindow(false);
     static bool showDebugWindow(true);
+    static bool showProfiler(false);
+    static int traceFrames(TraceExporter::DEFAULT_FRAMES);
 
     ImGuiWindowFlags windowFlags(ImGuiWindowFlags_AlwaysAutoResize);
     float opacity(0.5f);
 
     ImGui::Begin("Debug Window", &showDebugWindow, ImVec2(100,100), opacity, windowFlags);
     if( ImGui::Button( "Quit Application" ) ) {
-        glfwSetWindowShouldClose(m_window, GL_TRUE);
+        requestClose();
     }
 
     /// RADIO BUTTON CODE BEGIN
@@ -309,6 +246,7 @@ void Stack::guiLogic()
         if (height > 0)
         {
             m_grid.setColour(grid_pos_x, grid_pos_y, current_col);
+            m_sceneDirty = true;
         }
     }
 
@@ -325,20 +263,66 @@ void Stack::guiLogic()
 
     /// RGB HANDLING CODE BEGIN
 
-    ImGui::SliderFloat("R", &grid_colours[current_col][0], 0.0f, 1.0f);
-    ImGui::SliderFloat("G", &grid_colours[current_col][1], 0.0f, 1.0f);
-    ImGui::SliderFloat("B", &grid_colours[current_col][2], 0.0f, 1.0f);
+    if (ImGui::SliderFloat("R", &grid_colours[current_col][0], 0.0f, 1.0f)) { m_sceneDirty = true; }
+    if (ImGui::SliderFloat("G", &grid_colours[current_col][1], 0.0f, 1.0f)) { m_sceneDirty = true; }
+    if (ImGui::SliderFloat("B", &grid_colours[current_col][2], 0.0f, 1.0f)) { m_sceneDirty = true; }
 
     /// RGB HANDING CODE END
 
+    // Reuse the last rendered scene while only the UI changes
+    if (ImGui::Checkbox("Cache scene layer", &m_cacheSceneLayer)) { m_sceneLayerValid = false; }
+
+    // Scale the scene resolution to hold the frame budget
+    if (ImGui::Checkbox("Adaptive resolution", &m_adaptiveResolution)) {
+        m_resolutionScaler.reset();
+        m_sceneLayerValid = false;
+    }
+
+    if (m_adaptiveResolution) {
+        float budget = m_resolutionScaler.getBudget();
+        if (ImGui::SliderFloat("Budget (ms)", &budget, 4.0f, 50.0f)) {
+            m_resolutionScaler.setBudget(budget);
+        }
+        ImGui::Text( "Scene: %.0f%% at %.2f ms",
+            m_resolutionScaler.getScale() * 100.0f, m_resolutionScaler.getFrameTime() );
+    }
+
+    // Timeline of the CPU zones of the last few frames
+    ImGui::Checkbox("Profiler", &showProfiler);
+
+    // Chrome trace of the next frames, written in the background (also F12)
+    ImGui::SliderInt("Trace frames", &traceFrames, 1, 1000);
+    if (ImGui::Button("Capture trace") && !TraceExporter::isCapturing()) {
+        TraceExporter::start("", unsigned(traceFrames));
+    }
+    ImGui::SameLine();
+    ImGui::Text("%s", TraceExporter::getStatus().c_str());
+
     // Framerate text
     ImGui::Text( "Framerate: %.1f FPS", ImGui::GetIO().Framerate );
 
+    // GL calls of the last frame and GPU memory per label
+    if (ImGui::CollapsingHeader("GL counters")) {
+        GlCounters::drawTable();
+    }
+
+    // Percentiles show the stutters the average framerate hides
+    if (ImGui::CollapsingHeader("Frame times")) {
+        m_frameStats.drawTable();
+        if (ImGui::Button("Reset frame times")) {
+            m_frameStats.reset();
+        }
+    }
+
     ImGui::End();
 
     if( showTestWindow ) {
         ImGui::ShowTestWindow( &showTestWindow );
     }
+
+    if( showProfiler ) {
+        Profiler::drawWindow( &showProfiler );
+    }
 }
 
 //----------------------------------------------------------------------------------------
@@ -347,111 +331,75 @@ void Stack::guiLogic()
 */
 void Stack::draw()
 {
-    // Create a global transformation for the model (centre it).
-    mat4 W;
-    W = glm::rotate( W, glm::radians(current_angle), glm::vec3(0.0f, 1.0f, 0.0f));
-    W = glm::translate( W, vec3( -float(DIM)/2.0f, 0, -float(DIM)/2.0f ) );
-    W = glm::scale( W, vec3( current_scale, current_scale, current_scale ) );
-
-    /// A note on the above:
-    // First we rotate about the Up-axis at the origin
-    // Then we shift the grid to be center from camera view
-    // Thus we will rotate based on the center of the grid (approx)
-    // Then we scale the outcome
-
-    m_shader.enable();
-
-    // Enable the depth test
-    glEnable( GL_DEPTH_TEST );
-
-    // Set the matrix
-    glUniformMatrix4fv( P_uni, 1, GL_FALSE, value_ptr( proj ) );
-    glUniformMatrix4fv( V_uni, 1, GL_FALSE, value_ptr( view ) );
-    glUniformMatrix4fv( M_uni, 1, GL_FALSE, value_ptr( W ) );
-
-    // Draw the grid for now.
-    glBindVertexArray( m_grid_vao );
-    glUniform3f( col_uni, 1, 1, 1 );
-    glDrawArrays( GL_LINES, 0, (3+DIM)*4 );
-
-    /// CUBE CODE BEGIN
-    // A note on drawing code:
-    // Code here uses a very inefficient approach to drawing all the cubes
-    // by sending a call for each cube (+ one for wireframe) to the GPU
-    // when the more ideal solution is to send a matrix (or vector) to GPU
-    // that can be used to define drawing of each cube.  This option was chosen
-    // as this is not a performance critical application
-
-    // Set vertex and index buffer for cubes
-    glBindVertexArray( m_cube_vao );
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_cube_ibo);
-
-    // Iterate through the grid
-    for(int dx = 0; dx < DIM; dx++)
-    {
-      for(int dy = 0; dy < DIM; dy++)
-      {
-        // If height is 0 then no drawing necessary
-        if (m_grid.getHeight(dx, dy) == 0)
-        {
-            continue;
-        }
+    // Pick up any changes made by guiLogic() this frame.
+    updateDrawList();
+
+    if (!m_cacheSceneLayer && !m_adaptiveResolution) {
+        PROFILE_SCOPE("replay");
+        m_renderer.replay(m_drawList);
+        CHECK_GL_ERRORS;
+        return;
+    }
 
-        // Get values from grid
-        int height = m_grid.getHeight(dx, dy);
-        int colour = m_grid.getColour(dx, dy);
-        vec3 vcol = grid_colours[colour];
+    // Size the scene layer to the current resolution scale.
+    float scale = m_adaptiveResolution ? m_resolutionScaler.getScale() : 1.0f;
+    int width = std::max(1, int(m_framebufferWidth * scale + 0.5f));
+    int height = std::max(1, int(m_framebufferHeight * scale + 0.5f));
 
-        // Draw each of the cubes
-        for(int ch = 0; ch < height; ch++)
-        {
-          // Set the local model values
-          mat4 local_w = glm::translate( W, vec3( dx * 1.0f, ch * 1.0f, dy * 1.0f ) );
-          glUniformMatrix4fv( M_uni, 1, GL_FALSE, value_ptr( local_w ) );
-
-          // Set color and draw points
-          glUniform3f( col_uni, vcol.x, vcol.y, vcol.z);
-          glDrawElements(GL_TRIANGLES, m_cube_icount, GL_UNSIGNED_INT, 0);
-
-          glUniform3f( col_uni, 0.0f, 0.0f, 0.0f);
-          glPolygonMode( GL_FRONT_AND_BACK, GL_LINE );
-          glDrawElements(GL_TRIANGLES, m_cube_icount, GL_UNSIGNED_INT, 0);
-          glPolygonMode( GL_FRONT_AND_BACK, GL_FILL );
-        }
-      }
+    // Render into the scene layer only when the scene or its size has
+    // changed, otherwise the previous image is composited as is.
+    if (m_sceneLayer.resize(width, height) || !m_cacheSceneLayer) {
+        m_sceneLayerValid = false;
     }
 
-    /// CUBE CODE END
-
-    // Disable the depth test
-    glDisable( GL_DEPTH_TEST );
+    if (!m_sceneLayerValid) {
+        renderSceneLayer();
+    } else {
+        PROFILE_SCOPE("composite");
+        GL_DEBUG_SCOPE("composite");
+        GLenum filter = scale < 1.0f ? GL_LINEAR : GL_NEAREST;
+        m_sceneLayer.blitTo(0, m_framebufferWidth, m_framebufferHeight, filter);
+    }
 
-    /// MARKER CODE BEGIN
+    // Collect GPU timings of earlier frames without waiting on them.
+    float gpuTime;
+    if (m_sceneTimer.poll(gpuTime) && m_adaptiveResolution) {
+        m_resolutionScaler.addGpuTime(gpuTime);
+    }
 
-    // Set the marker model matrix
-    mat4 local_w;
-    local_w = glm::translate( W, vec3( grid_pos_x * 1.0f, 0.0f, grid_pos_y * 1.0f ) );
-    local_w = glm::scale( local_w, vec3( 1.0f, 6.0f, 1.0f ) );
+    CHECK_GL_ERRORS;
+}
 
-    glUniformMatrix4fv( M_uni, 1, GL_FALSE, value_ptr( local_w ) );
+//----------------------------------------------------------------------------------------
+/*
+* Renders the draw list into the scene layer and upscales it to the window.
+* Only frames that render the scene are timed for the resolution scaler.
+*/
+void Stack::renderSceneLayer()
+{
+    PROFILE_SCOPE("renderSceneLayer");
+    GL_DEBUG_SCOPE("renderSceneLayer");
 
-    // Set color and draw points
-    glUniform3f( col_uni, 0.0f, 0.0f, 0.0f);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    m_sceneTimer.begin();
 
-    // Draw as wireframe
-    glPolygonMode( GL_FRONT_AND_BACK, GL_LINE );
-    glDrawElements(GL_TRIANGLES, m_cube_icount, GL_UNSIGNED_INT, 0);
-    glPolygonMode( GL_FRONT_AND_BACK, GL_FILL );
+    m_sceneLayer.bind();
+    glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+    m_renderer.replay(m_drawList);
 
-    /// MARKER CODE END
+    // Upscale with filtering when rendering below native resolution
+    GLenum filter = m_sceneLayer.getWidth() < m_framebufferWidth ? GL_LINEAR : GL_NEAREST;
+    m_sceneLayer.blitTo(0, m_framebufferWidth, m_framebufferHeight, filter);
 
-    // Highlight the active square.
-    m_shader.disable();
+    m_sceneTimer.end();
+    chrono::duration<float, milli> cpuTime = chrono::steady_clock::now() - start;
 
-    // Restore defaults
-    glBindVertexArray( 0 );
+    m_sceneLayerValid = true;
 
-    CHECK_GL_ERRORS;
+    if (m_adaptiveResolution) {
+        m_resolutionScaler.addCpuTime(cpuTime.count());
+        m_resolutionScaler.update();
+    }
 }
 
 //----------------------------------------------------------------------------------------
@@ -460,10 +408,9 @@ void Stack::draw()
 */
 void Stack::cleanup()
 {
-    glDeleteBuffers(1, &m_grid_vbo);
-
-    glDeleteBuffers(1, &m_cube_vbo);
-    glDeleteBuffers(1, &m_cube_ibo);
+    m_sceneLayer.destroy();
+    m_sceneTimer.destroy();
+    m_renderer.cleanup();
 }
 
 //----------------------------------------------------------------------------------------
@@ -489,6 +436,7 @@ bool Stack::mouseMoveEvent(double xPos, double yPos)
         // Get the change in mouse position
         double xdist = xPos - prev_mouse_x;
         current_angle += xdist * degree;
+        m_sceneDirty = true;
 
         eventHandled = true;
     }
@@ -532,6 +480,7 @@ bool Stack::mouseScrollEvent(double xOffSet, double yOffSet) {
 
     // Set the new current scale
     current_scale = math_clamp(new_scale, SCALE_LOWER, SCALE_UPPER);
+    m_sceneDirty = true;
 
     return eventHandled;
 }
@@ -568,7 +517,7 @@ bool Stack::keyInputEvent(int key, int action, int mods) {
 
         // Quit the application by telling glfw to quit
         if (key == GLFW_KEY_Q) {
-            glfwSetWindowShouldClose(m_window, GL_TRUE);
+            requestClose();
             eventHandled = true;
         }
 
@@ -623,9 +572,10 @@ bool Stack::keyInputEvent(int key, int action, int mods) {
         // Perform actions of the values
         if (moveXAxis != 0 || moveYAxis != 0)
         {
-            // Array is size DIM, so positions are limited to [0, DIM - 1]
-            int newX = math_clamp(grid_pos_x + moveXAxis, 0, DIM - 1);
-            int newY = math_clamp(grid_pos_y + moveYAxis, 0, DIM - 1);
+            // Array is size dim, so positions are limited to [0, dim - 1]
+            int dim = m_grid.getDim();
+            int newX = math_clamp(grid_pos_x + moveXAxis, 0, dim - 1);
+            int newY = math_clamp(grid_pos_y + moveYAxis, 0, dim - 1);
 
             // If the shift key is pressed we must copy the grid
             // copy the current grid to the new position
@@ -654,6 +604,7 @@ void Stack::decrementCell(int cellX, int cellY){
     // Set colour and height
     m_grid.setHeight(cellX, cellY, height);
     m_grid.setColour(cellX, cellY, current_col);
+    m_sceneDirty = true;
 }
 
 //----------------------------------------------------------------------------------------
@@ -668,6 +619,7 @@ void Stack::incrementCell(int cellX, int cellY){
     // Set colour and height
     m_grid.setHeight(cellX, cellY, height);
     m_grid.setColour(cellX, cellY, current_col);
+    m_sceneDirty = true;
 }
 
 //----------------------------------------------------------------------------------------
@@ -682,6 +634,7 @@ void Stack::copyCell(int sourceX, int sourceY, int destX, int destY){
     // Set the height and colour to next cell
     m_grid.setHeight(destX, destY, srcHeight);
     m_grid.setColour(destX, destY, srcColour);
+    m_sceneDirty = true;
 }
 
 //----------------------------------------------------------------------------------------
@@ -691,4 +644,5 @@ void Stack::copyCell(int sourceX, int sourceY, int destX, int destY){
 void Stack::setActiveCell(int cellX, int cellY) {
     grid_pos_x = cellX;
     grid_pos_y = cellY;
+    m_sceneDirty = true;
 }
@@ -3,10 +3,16 @@
 #include <glm/glm.hpp>
 
 #include "cs488-framework/CS488Window.hpp"
+#include "cs488-framework/FileWatcher.hpp"
+#include "cs488-framework/GpuTimer.hpp"
 #include "cs488-framework/OpenGLImport.hpp"
-#include "cs488-framework/ShaderProgram.hpp"
+#include "cs488-framework/RenderTarget.hpp"
 
+#include "drawlist.hpp"
 #include "grid.hpp"
+#include "renderqueue.hpp"
+#include "resolutionscaler.hpp"
+#include "scenerenderer.hpp"
 
 class Stack : public CS488Window {
 public:
@@ -29,8 +35,6 @@ protected:
 
 private:
 	// Initialize the application
-	void initGrid();
-	void initCube();
 	void initState();
 
 	// Increment and decrement of cell heights
@@ -43,25 +47,36 @@ private:
 	// Sets the active cell of the application
 	void setActiveCell(int cellX, int cellY);
 
+	// Records the scene into the draw list if it has changed
+	void updateDrawList();
+
+	// Renders the draw list into the scene layer
+	void renderSceneLayer();
+
 	// Fields related to the grid
 	Grid m_grid;
 
-	// Fields related to the shader and uniforms.
-	ShaderProgram m_shader;
-	GLint P_uni; // Uniform location for Projection matrix.
-	GLint V_uni; // Uniform location for View matrix.
-	GLint M_uni; // Uniform location for Model matrix.
-	GLint col_uni;   // Uniform location for cube colour.
+	// Recorded draw commands for the scene, rebuilt only when dirty.
+	DrawList m_drawList;
+	RenderQueue m_renderQueue;
+	bool m_sceneDirty;
+
+	// Offscreen copy of the rendered scene, reused while the scene is unchanged.
+	RenderTarget m_sceneLayer;
+	bool m_sceneLayerValid;
+	bool m_cacheSceneLayer;
+
+	// Renders the scene layer below native resolution to hold a frame budget.
+	ResolutionScaler m_resolutionScaler;
+	GpuTimer m_sceneTimer;
+	bool m_adaptiveResolution;
 
-	// Fields related to grid geometry.
-	GLuint m_grid_vao; // Vertex Array Object
-	GLuint m_grid_vbo; // Vertex Buffer Object
+	// GL resources of the scene.
+	SceneRenderer m_renderer;
 
-	// Fields related to cube geometry.
-	GLuint m_cube_vao; // Vertex Array Object
-	GLuint m_cube_vbo; // Vertex Buffer Object
-	GLuint m_cube_ibo; // Index Buffer Object
-	GLint m_cube_icount; // Index Buffer Count
+	// Rebuilds the shaders when their files in Assets/ are saved.
+	FileWatcher m_assetWatcher;
+	std::vector<std::string> m_changedAssets;
 
 	// Matrices controlling the camera and projection.
 	glm::mat4 proj;
@@ -84,7 +99,7 @@ private:
 	float current_scale;
 	float current_angle;
 
-	glm::vec3 grid_colours[9];
+	glm::vec3 grid_colours[PALETTE_SIZE];
 	float colour[3];
 	int current_col;
 };
@@ -0,0 +1,357 @@
+#include "batch.hpp"
+
+#include "cs488-framework/CS488Window.hpp"
+#include "cs488-framework/GlCounters.hpp"
+#include "cs488-framework/GlDebug.hpp"
+#include "cs488-framework/GlErrorCheck.hpp"
+#include "cs488-framework/HeadlessContext.hpp"
+#include "cs488-framework/ImageWriter.hpp"
+#include "cs488-framework/RenderTarget.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <thread>
+
+#include "drawlist.hpp"
+#include "grid.hpp"
+#include "raytracer.hpp"
+#include "renderqueue.hpp"
+#include "scenerenderer.hpp"
+#include "softrasteriser.hpp"
+#include "threadpool.hpp"
+
+using namespace std;
+
+//----------------------------------------------------------------------------------------
+// Constructor
+BatchOptions::BatchOptions()
+: width( 1024 ),
+height( 768 ),
+angle( 0.0f ),
+scale( 1.0f ),
+outputDir( "." ),
+renderer( BATCH_GL ),
+threads( 0 ),
+aoSamples( 16 ),
+shadowSamples( 8 )
+{
+
+}
+
+//----------------------------------------------------------------------------------------
+static void printUsage(const char *program)
+{
+    cerr << "Usage: " << program << " --headless [options] grid-file..." << endl
+         << "  --size WxH      image size in pixels (default 1024x768)" << endl
+         << "  --angle DEG     rotation of the grid about the up-axis (default 0)" << endl
+         << "  --scale S       scale of the grid (default 1)" << endl
+         << "  --output DIR    directory images are written to (default .)" << endl
+         << "  --renderer R    gl, software or raytrace (default gl)" << endl
+         << "  --threads N     CPU renderer threads (default: all cores)" << endl
+         << "  --ao-samples N  raytrace ambient occlusion rays per pixel (default 16)" << endl
+         << "  --shadow-samples N  raytrace shadow rays per pixel (default 8)" << endl;
+}
+
+//----------------------------------------------------------------------------------------
+bool isBatchMode(int argc, char **argv)
+{
+    for (int idx = 1; idx < argc; ++idx) {
+        if (strcmp(argv[idx], "--headless") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//----------------------------------------------------------------------------------------
+bool parseBatchOptions(int argc, char **argv, BatchOptions & options)
+{
+    for (int idx = 1; idx < argc; ++idx) {
+        string arg = argv[idx];
+        bool hasValue = idx + 1 < argc;
+
+        if (arg == "--headless") {
+            continue;
+        } else if (arg == "--size" && hasValue) {
+            if (sscanf(argv[++idx], "%dx%d", &options.width, &options.height) != 2
+                    || options.width <= 0 || options.height <= 0) {
+                cerr << "Invalid image size: " << argv[idx] << endl;
+                return false;
+            }
+        } else if (arg == "--angle" && hasValue) {
+            options.angle = float(atof(argv[++idx]));
+        } else if (arg == "--scale" && hasValue) {
+            options.scale = float(atof(argv[++idx]));
+        } else if (arg == "--output" && hasValue) {
+            options.outputDir = argv[++idx];
+        } else if (arg == "--renderer" && hasValue) {
+            string renderer = argv[++idx];
+            if (renderer == "gl") {
+                options.renderer = BATCH_GL;
+            } else if (renderer == "software") {
+                options.renderer = BATCH_SOFTWARE;
+            } else if (renderer == "raytrace") {
+                options.renderer = BATCH_RAYTRACE;
+            } else {
+                cerr << "Unknown renderer: " << renderer << endl;
+                return false;
+            }
+        } else if (arg == "--threads" && hasValue) {
+            options.threads = unsigned(atoi(argv[++idx]));
+        } else if (arg == "--ao-samples" && hasValue) {
+            options.aoSamples = unsigned(atoi(argv[++idx]));
+        } else if (arg == "--shadow-samples" && hasValue) {
+            options.shadowSamples = unsigned(atoi(argv[++idx]));
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            printUsage(argv[0]);
+            return false;
+        } else {
+            options.gridFiles.push_back(arg);
+        }
+    }
+
+    if (options.gridFiles.empty()) {
+        printUsage(argv[0]);
+        return false;
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------------------------
+/*
+* Gets the image path for a grid file: its base name with a .ppm extension.
+*/
+static string imagePath(const string & outputDir, const string & gridFile)
+{
+    size_t slash = gridFile.find_last_of('/');
+    string name = slash == string::npos ? gridFile : gridFile.substr(slash + 1);
+
+    size_t dot = name.find_last_of('.');
+    if (dot != string::npos && dot > 0) {
+        name.resize(dot);
+    }
+    return outputDir + "/" + name + ".ppm";
+}
+
+//----------------------------------------------------------------------------------------
+/*
+* Loads a grid file and records its sorted draw list. Returns false if the
+* file is not a valid grid.
+*/
+static bool loadScene(const BatchOptions & options, const string & gridFile, const glm::vec3 * palette,
+        Grid & grid, DrawList & list, RenderQueue & queue)
+{
+    if (!grid.load(gridFile.c_str())) {
+        cerr << "Skipping " << gridFile << ": not a valid grid file" << endl;
+        return false;
+    }
+
+    SceneState scene;
+    scene.grid = &grid;
+    scene.palette = palette;
+    scene.proj = sceneProjection(options.width, options.height, grid.getDim());
+    scene.view = sceneViewTransform(grid.getDim());
+    scene.angle = options.angle;
+    scene.scale = options.scale;
+    scene.activeX = 0;
+    scene.activeY = 0;
+
+    buildDrawList(scene, list, thread::hardware_concurrency());
+    queue.sort(list);
+    return true;
+}
+
+//----------------------------------------------------------------------------------------
+/*
+* Writes the image of a grid and reports how long it took.
+*/
+static void writeImage(const BatchOptions & options, const string & gridFile,
+        const vector<unsigned char> & pixels, chrono::steady_clock::time_point start)
+{
+    string path = imagePath(options.outputDir, gridFile);
+    ImageWriter::writePPM(path.c_str(), options.width, options.height, pixels.data(), true);
+
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+    cout << gridFile << " -> " << path << " (" << elapsed.count() << " ms)" << endl;
+}
+
+//----------------------------------------------------------------------------------------
+static int runSoftware(const BatchOptions & options)
+{
+    int failures = 0;
+
+    glm::vec3 palette[PALETTE_SIZE];
+    initDefaultPalette(palette);
+
+    Grid grid(1);
+    DrawList list;
+    RenderQueue queue;
+    vector<unsigned char> pixels;
+
+    SoftRasteriser rasteriser;
+    rasteriser.setThreadCount(options.threads);
+    rasteriser.setClearColour(glm::vec3(0.3, 0.5, 0.7));
+
+    cout << "Rendering " << options.gridFiles.size() << " grid(s) at "
+         << options.width << "x" << options.height << " in software" << endl;
+
+    for (const string & gridFile : options.gridFiles) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+        if (!loadScene(options, gridFile, palette, grid, list, queue)) {
+            ++failures;
+            continue;
+        }
+
+        rasteriser.setGridDim(grid.getDim());
+        rasteriser.render(list, options.width, options.height);
+        rasteriser.readPixels(pixels);
+
+        writeImage(options, gridFile, pixels, start);
+    }
+
+    return failures;
+}
+
+//----------------------------------------------------------------------------------------
+static int runRayTracer(const BatchOptions & options)
+{
+    int failures = 0;
+
+    glm::vec3 palette[PALETTE_SIZE];
+    initDefaultPalette(palette);
+
+    Grid grid(1);
+    DrawList list;
+    RenderQueue queue;
+    vector<unsigned char> pixels;
+
+    ThreadPool pool(options.threads);
+
+    RayTraceSettings settings;
+    settings.aoSamples = options.aoSamples;
+    settings.shadowSamples = options.shadowSamples;
+
+    RayTracer tracer;
+    tracer.setSettings(settings);
+
+    cout << "Ray tracing " << options.gridFiles.size() << " grid(s) at "
+         << options.width << "x" << options.height << " on "
+         << pool.getThreadCount() << " thread(s)" << endl;
+
+    for (const string & gridFile : options.gridFiles) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+        // The draw list is only needed for its camera matrices
+        if (!loadScene(options, gridFile, palette, grid, list, queue)) {
+            ++failures;
+            continue;
+        }
+
+        tracer.setScene(grid, palette);
+        tracer.setCamera(list.proj, list.view, list.world, options.width, options.height);
+        tracer.render(pool);
+        tracer.readPixels(pixels);
+
+        writeImage(options, gridFile, pixels, start);
+    }
+
+    return failures;
+}
+
+//----------------------------------------------------------------------------------------
+static int runHardware(const BatchOptions & options)
+{
+    int failures = 0;
+
+    // One context and set of GL resources is reused for every grid.
+    HeadlessContext context;
+    context.create();
+    GlCounters::install();
+    GlDebug::init();
+
+    SceneRenderer renderer;
+    renderer.init( CS488Window::getAssetFilePath( "VertexShader.vs" ),
+                   CS488Window::getAssetFilePath( "FragmentShader.fs" ) );
+
+    RenderTarget target;
+    target.resize(options.width, options.height);
+
+    glm::vec3 palette[PALETTE_SIZE];
+    initDefaultPalette(palette);
+
+    Grid grid(1);
+    DrawList list;
+    RenderQueue queue;
+    vector<unsigned char> pixels;
+
+    glClearColor( 0.3, 0.5, 0.7, 1.0 );
+
+    cout << "Rendering " << options.gridFiles.size() << " grid(s) at "
+         << options.width << "x" << options.height << " on "
+         << HeadlessContext::getRenderer() << endl;
+
+    for (const string & gridFile : options.gridFiles) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+        if (!loadScene(options, gridFile, palette, grid, list, queue)) {
+            ++failures;
+            continue;
+        }
+
+        renderer.setGridDim(grid.getDim());
+
+        target.bind();
+        glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+
+        GlCounters::resetCurrent();
+        renderer.replay(list);
+        GlCounters::Frame counters = GlCounters::getCurrent();
+
+        ImageWriter::readFramebuffer(options.width, options.height, pixels);
+        CHECK_GL_ERRORS;
+
+        writeImage(options, gridFile, pixels, start);
+
+        if (GlCounters::isInstalled()) {
+            cout << "    " << counters.drawCalls << " draw calls, " << counters.triangles << " triangles, "
+                 << counters.stateChanges << " state changes, " << counters.uniformBytes << " uniform bytes" << endl;
+        }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    target.destroy();
+    renderer.cleanup();
+    GlDebug::shutdown();
+
+    return failures;
+}
+
+//----------------------------------------------------------------------------------------
+int runBatch(const BatchOptions & options)
+{
+    int failures = 0;
+
+    try {
+        switch (options.renderer) {
+        case BATCH_SOFTWARE:
+            failures = runSoftware(options);
+            break;
+        case BATCH_RAYTRACE:
+            failures = runRayTracer(options);
+            break;
+        default:
+            failures = runHardware(options);
+            break;
+        }
+    } catch (const std::exception & e) {
+        cerr << "Exception Thrown: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
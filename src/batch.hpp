@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/*
+ * Renderers batch mode can draw with.
+ */
+enum BatchRenderer
+{
+	// SceneRenderer on a headless GL context
+	BATCH_GL,
+
+	// SoftRasteriser, no GL required
+	BATCH_SOFTWARE,
+
+	// RayTracer with ambient occlusion and soft shadows, no GL required
+	BATCH_RAYTRACE
+};
+
+/*
+ * Options for rendering grid files without a window.
+ */
+struct BatchOptions
+{
+	int width;
+	int height;
+
+	// Camera rotation (degrees) and scale, as set interactively in Stack.
+	float angle;
+	float scale;
+
+	// Directory images are written to, named after their grid file.
+	std::string outputDir;
+
+	// Renderer to use. The CPU renderers use 'threads' worker threads (0 for
+	// one per hardware thread).
+	BatchRenderer renderer;
+	unsigned threads;
+
+	// Ray tracer quality.
+	unsigned aoSamples;
+	unsigned shadowSamples;
+
+	std::vector<std::string> gridFiles;
+
+	BatchOptions();
+};
+
+/*
+ * Returns true if the command line asks for batch mode (--headless).
+ */
+bool isBatchMode( int argc, char **argv );
+
+/*
+ * Parses the batch mode command line. Prints usage and returns false on error.
+ */
+bool parseBatchOptions( int argc, char **argv, BatchOptions & options );
+
+/*
+ * Renders every grid file to an image with the chosen renderer. Returns the
+ * process exit code.
+ */
+int runBatch( const BatchOptions & options );
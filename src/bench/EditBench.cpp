@@ -0,0 +1,418 @@
+/*
+ * EditBench
+ *
+ * Measures how fast the grid can be edited, and how long it takes the
+ * structures derived from it to catch up, without a GL context. Edits are
+ * the ones Stack makes (increment, decrement and copy a cell) plus random
+ * single cell writes, region fills and full resets, on grids of up to
+ * 8192x8192. After an edit the draw list (recorded and sorted, as
+ * Stack::updateDrawList does) and the ray tracer's height pyramid are
+ * rebuilt, and the time until they are consistent again is reported.
+ *
+ * Results are written to JSON, one case per line. Passing a previous
+ * result with --baseline prints the change of each case against it; the
+ * reference run is checked in as bench/baseline/EditBench.json.
+ *
+ * Usage: EditBench [--output file] [--baseline file] [--sizes 256,1024,...]
+ *                  [--time ms] [--repeats N] [--max-draw-cells N]
+ */
+
+#include "benchutil.hpp"
+#include "drawlist.hpp"
+#include "grid.hpp"
+#include "raytracer.hpp"
+#include "renderqueue.hpp"
+
+#include "cs488-framework/HdrHistogram.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Side of the square written by each region fill.
+static const int FILL_SIZE = 32;
+
+// Longest rebuild tracked, in microseconds.
+static const uint64_t MAX_REBUILD_US = 600 * 1000 * 1000;
+
+struct Options {
+    string outputFile;
+    string baselineFile;
+    vector<int> sizes;
+
+    // Time spent on each edit case, in milliseconds.
+    double timeMs;
+
+    // Rebuilds timed per size.
+    unsigned repeats;
+
+    // Grids with more cells are not recorded into a draw list, which
+    // needs two commands per column and would not fit in memory.
+    size_t maxDrawCells;
+
+    Options()
+        : outputFile("EditBench.json"),
+          timeMs(250.0),
+          repeats(5),
+          maxDrawCells(size_t(2048) * 2048)
+    { }
+};
+
+/*
+ * One line of the results. Edit cases are in operations per second, higher
+ * is better; rebuild cases are in milliseconds, lower is better.
+ */
+struct Result {
+    string name;
+    int dim;
+    double value;
+    string unit;
+
+    // Extra fields written after the value, already formatted as JSON.
+    string extra;
+};
+
+//----------------------------------------------------------------------------------------
+/*
+ * The edits of Stack::incrementCell, decrementCell and copyCell.
+ */
+static void incrementCell(Grid & grid, int x, int y, int colour)
+{
+    grid.setHeight(x, y, min(grid.getHeight(x, y) + 1, MAX_HEIGHT));
+    grid.setColour(x, y, colour);
+}
+
+static void decrementCell(Grid & grid, int x, int y, int colour)
+{
+    grid.setHeight(x, y, max(grid.getHeight(x, y) - 1, 0));
+    grid.setColour(x, y, colour);
+}
+
+static void copyCell(Grid & grid, int sourceX, int sourceY, int destX, int destY)
+{
+    grid.setHeight(destX, destY, grid.getHeight(sourceX, sourceY));
+    grid.setColour(destX, destY, grid.getColour(sourceX, sourceY));
+}
+
+//----------------------------------------------------------------------------------------
+/*
+ * Runs batches of edits until the time is spent and returns the edits made
+ * per second.
+ */
+static double editsPerSecond(double timeMs, const function<void(unsigned)> & edit)
+{
+    const unsigned BATCH = 1024;
+
+    // One untimed batch to warm the caches.
+    for (unsigned idx = 0; idx < BATCH; ++idx) {
+        edit(idx);
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    double elapsed = 0.0;
+    uint64_t edits = 0;
+
+    do {
+        for (unsigned idx = 0; idx < BATCH; ++idx) {
+            edit(idx);
+        }
+        edits += BATCH;
+        elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    } while (elapsed < timeMs);
+
+    return double(edits) / (elapsed * 1.0e-3);
+}
+
+//----------------------------------------------------------------------------------------
+static void runEdits(const Options & options, Grid & grid, vector<Result> & results)
+{
+    int dim = int(grid.getDim());
+    uint32_t state = 0x9e3779b9u;
+
+    // Random cells, drawn ahead of time so the generator is not timed.
+    const size_t NUM_CELLS = 1 << 16;
+    vector<int> cells(NUM_CELLS * 2);
+    for (int & cell : cells) {
+        cell = int(nextRandom(state) % uint32_t(dim));
+    }
+
+    size_t next = 0;
+    auto cellX = [&]() { return cells[next]; };
+    auto cellY = [&]() { return cells[next + 1]; };
+    auto advance = [&]() { next = (next + 2) % cells.size(); };
+
+    results.push_back({ "increment", dim, editsPerSecond(options.timeMs, [&](unsigned idx) {
+        incrementCell(grid, cellX(), cellY(), int(idx % PALETTE_SIZE));
+        advance();
+    }), "edits/s", "" });
+
+    results.push_back({ "decrement", dim, editsPerSecond(options.timeMs, [&](unsigned idx) {
+        decrementCell(grid, cellX(), cellY(), int(idx % PALETTE_SIZE));
+        advance();
+    }), "edits/s", "" });
+
+    // Stack only copies to a neighbour, so do the same.
+    results.push_back({ "copy", dim, editsPerSecond(options.timeMs, [&](unsigned) {
+        int x = cellX(), y = cellY();
+        copyCell(grid, x, y, min(x + 1, dim - 1), y);
+        advance();
+    }), "edits/s", "" });
+
+    results.push_back({ "random", dim, editsPerSecond(options.timeMs, [&](unsigned idx) {
+        grid.setHeight(cellX(), cellY(), int(idx % (MAX_HEIGHT + 1)));
+        grid.setColour(cellX(), cellY(), int(idx % PALETTE_SIZE));
+        advance();
+    }), "edits/s", "" });
+
+    int fillSize = min(FILL_SIZE, dim);
+    double fills = editsPerSecond(options.timeMs, [&](unsigned idx) {
+        int x0 = min(cellX(), dim - fillSize);
+        int y0 = min(cellY(), dim - fillSize);
+        for (int y = y0; y < y0 + fillSize; ++y) {
+            for (int x = x0; x < x0 + fillSize; ++x) {
+                grid.setHeight(x, y, int(idx % (MAX_HEIGHT + 1)));
+                grid.setColour(x, y, int(idx % PALETTE_SIZE));
+            }
+        }
+        advance();
+    });
+    stringstream extra;
+    extra << ", \"cellsPerSecond\": " << uint64_t(fills * fillSize * fillSize);
+    results.push_back({ "fill", dim, fills, "fills/s", extra.str() });
+
+    // Resets are slow enough on large grids to time one at a time.
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    double elapsed = 0.0;
+    unsigned resets = 0;
+    do {
+        grid.reset(int(resets % PALETTE_SIZE));
+        ++resets;
+        elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    } while (elapsed < options.timeMs);
+    results.push_back({ "reset", dim, double(resets) / (elapsed * 1.0e-3), "resets/s", "" });
+}
+
+//----------------------------------------------------------------------------------------
+static void addRebuild(const string & name, int dim, const HdrHistogram & histogram, vector<Result> & results)
+{
+    stringstream extra;
+    extra.precision(3);
+    extra << fixed << ", \"p50\": " << double(histogram.valueAtPercentile(50.0)) * 1.0e-3
+          << ", \"max\": " << double(histogram.max()) * 1.0e-3;
+    results.push_back({ name, dim, histogram.mean() * 1.0e-3, "ms", extra.str() });
+}
+
+//----------------------------------------------------------------------------------------
+/*
+ * Times how long after a single edit the draw list and ray tracer are
+ * consistent with the grid again. Both are rebuilt in full, as the editor
+ * does today.
+ */
+static void runRebuilds(const Options & options, Grid & grid, vector<Result> & results)
+{
+    int dim = int(grid.getDim());
+    generateGrid(grid);
+
+    glm::vec3 palette[PALETTE_SIZE];
+    initDefaultPalette(palette);
+
+    SceneState scene;
+    scene.grid = &grid;
+    scene.palette = palette;
+    scene.proj = sceneProjection(1024, 768, size_t(dim));
+    scene.view = sceneViewTransform(size_t(dim));
+    scene.angle = 0.0f;
+    scene.scale = 1.0f;
+    scene.activeX = 0;
+    scene.activeY = 0;
+
+    HdrHistogram drawList(MAX_REBUILD_US);
+    HdrHistogram pyramid(MAX_REBUILD_US);
+    bool recordDrawList = size_t(dim) * size_t(dim) <= options.maxDrawCells;
+
+    DrawList list;
+    RenderQueue queue;
+    RayTracer tracer;
+    uint32_t state = 0x85ebca6bu;
+
+    // One untimed rebuild first, so the list and pyramid are allocated.
+    for (unsigned repeat = 0; repeat <= options.repeats; ++repeat) {
+        int x = int(nextRandom(state) % uint32_t(dim));
+        int y = int(nextRandom(state) % uint32_t(dim));
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        if (repeat % 2 == 0) {
+            incrementCell(grid, x, y, 0);
+        } else {
+            decrementCell(grid, x, y, 0);
+        }
+        if (recordDrawList) {
+            buildDrawList(scene, list, thread::hardware_concurrency());
+            queue.sort(list);
+        }
+        chrono::steady_clock::time_point listEnd = chrono::steady_clock::now();
+
+        tracer.setScene(grid, palette);
+        chrono::steady_clock::time_point pyramidEnd = chrono::steady_clock::now();
+
+        if (repeat > 0) {
+            drawList.record(uint64_t(chrono::duration_cast<chrono::microseconds>(listEnd - start).count()));
+            pyramid.record(uint64_t(chrono::duration_cast<chrono::microseconds>(pyramidEnd - listEnd).count()));
+        }
+    }
+
+    if (recordDrawList) {
+        addRebuild("rebuild-drawlist", dim, drawList, results);
+    }
+    addRebuild("rebuild-pyramid", dim, pyramid, results);
+}
+
+//----------------------------------------------------------------------------------------
+static bool writeJson(const string & path, const vector<Result> & results)
+{
+    FILE * file = fopen(path.c_str(), "w");
+    if (file == nullptr) {
+        return false;
+    }
+
+    fprintf(file, "{\n  \"threads\": %u,\n  \"cases\": [",  max(thread::hardware_concurrency(), 1u));
+    for (size_t idx = 0; idx < results.size(); ++idx) {
+        const Result & result = results[idx];
+        fprintf(file, "%s\n    { \"case\": \"%s\", \"dim\": %d, \"value\": %.3f, \"unit\": \"%s\"%s }",
+                idx == 0 ? "" : ",", result.name.c_str(), result.dim, result.value, result.unit.c_str(),
+                result.extra.c_str());
+    }
+    fprintf(file, "\n  ]\n}\n");
+
+    bool ok = !ferror(file);
+    return fclose(file) == 0 && ok;
+}
+
+//----------------------------------------------------------------------------------------
+/*
+ * Reads the cases of a file written by writeJson(), keyed by name and size.
+ */
+static bool readBaseline(const string & path, map<pair<string, int>, double> & baseline)
+{
+    FILE * file = fopen(path.c_str(), "r");
+    if (file == nullptr) {
+        return false;
+    }
+
+    char line[512];
+    while (fgets(line, sizeof(line), file) != nullptr) {
+        char name[64];
+        int dim;
+        double value;
+        if (sscanf(line, " { \"case\": \"%63[^\"]\", \"dim\": %d, \"value\": %lf", name, &dim, &value) == 3) {
+            baseline[make_pair(string(name), dim)] = value;
+        }
+    }
+
+    fclose(file);
+    return true;
+}
+
+//----------------------------------------------------------------------------------------
+static bool parseOptions(int argc, char ** argv, Options & options)
+{
+    options.sizes = { 256, 1024, 4096, 8192 };
+
+    for (int idx = 1; idx < argc; ++idx) {
+        string arg = argv[idx];
+        if (idx + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", arg.c_str());
+            return false;
+        }
+        string value = argv[++idx];
+
+        if (arg == "--output") {
+            options.outputFile = value;
+        } else if (arg == "--baseline") {
+            options.baselineFile = value;
+        } else if (arg == "--sizes") {
+            options.sizes.clear();
+            stringstream list(value);
+            string item;
+            while (getline(list, item, ',')) {
+                int dim = atoi(item.c_str());
+                if (dim <= 0) {
+                    fprintf(stderr, "Invalid size %s\n", item.c_str());
+                    return false;
+                }
+                options.sizes.push_back(dim);
+            }
+        } else if (arg == "--time") {
+            options.timeMs = max(1.0, atof(value.c_str()));
+        } else if (arg == "--repeats") {
+            options.repeats = unsigned(max(1, atoi(value.c_str())));
+        } else if (arg == "--max-draw-cells") {
+            options.maxDrawCells = size_t(atoll(value.c_str()));
+        } else {
+            fprintf(stderr, "Unknown option %s\n", arg.c_str());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//----------------------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return EXIT_FAILURE;
+    }
+
+    map<pair<string, int>, double> baseline;
+    if (!options.baselineFile.empty() && !readBaseline(options.baselineFile, baseline)) {
+        fprintf(stderr, "Unable to read %s\n", options.baselineFile.c_str());
+        return EXIT_FAILURE;
+    }
+
+    vector<Result> results;
+    printf("%-17s %5s %14s %-9s %9s\n", "case", "dim", "value", "unit", "vs base");
+
+    for (int dim : options.sizes) {
+        size_t first = results.size();
+        {
+            Grid grid(static_cast<size_t>(dim));
+            generateGrid(grid);
+            runEdits(options, grid, results);
+            runRebuilds(options, grid, results);
+        }
+
+        for (size_t idx = first; idx < results.size(); ++idx) {
+            const Result & result = results[idx];
+            printf("%-17s %5d %14.2f %-9s", result.name.c_str(), result.dim, result.value, result.unit.c_str());
+
+            // Positive changes are improvements: faster edits, shorter rebuilds.
+            auto found = baseline.find(make_pair(result.name, result.dim));
+            if (found != baseline.end() && found->second > 0.0 && result.value > 0.0) {
+                double ratio = result.unit == "ms" ? found->second / result.value : result.value / found->second;
+                printf(" %+8.1f%%", (ratio - 1.0) * 100.0);
+            }
+            printf("\n");
+        }
+        fflush(stdout);
+    }
+
+    if (!writeJson(options.outputFile, results)) {
+        fprintf(stderr, "Unable to write %s\n", options.outputFile.c_str());
+        return EXIT_FAILURE;
+    }
+
+    printf("\nWrote %s\n", options.outputFile.c_str());
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,405 @@
+/*
+ * ObjBench
+ *
+ * Measures ObjFileDecoder on generated .obj files against the istringstream
+ * and sscanf decoder it replaced, kept here as the reference. Two files of
+ * about the requested size are written, one tessellated sphere with
+ * position/uv/normal faces and one with position//normal faces, each decoded
+ * by both decoders, by ObjFileDecoder on one thread and on --threads, and
+ * indexed. The outputs are checked to describe the same triangles, and the
+ * time and throughput of each decode are printed. MeshConsolidator is then
+ * timed loading each file twice, decoding and writing its mesh cache, then
+ * reading the cache.
+ *
+ * Usage: ObjBench [--mb N] [--repeats N] [--threads N] [--dir path]
+ *                 [--reference 0|1]
+ */
+
+#include "cs488-framework/Exception.hpp"
+#include "cs488-framework/MeshConsolidator.hpp"
+#include "cs488-framework/ObjFileDecoder.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace glm;
+using namespace std;
+
+struct Options {
+    // Approximate size of each generated file.
+    double megabytes;
+
+    // Decodes timed per file; the fastest is reported.
+    unsigned repeats;
+
+    // Threads of the parallel decode, 0 for one per hardware thread.
+    unsigned threads;
+
+    // Where the files are written.
+    string directory;
+
+    // Whether the reference decoder runs. It is slow on large files.
+    bool reference;
+
+    Options() : megabytes(100.0), repeats(3), threads(0), directory("."), reference(true) { }
+};
+
+struct Mesh {
+    string objectName;
+    vector<vec3> positions;
+    vector<vec3> normals;
+    vector<vec2> uvCoords;
+
+    // Empty unless decoded indexed.
+    vector<uint32_t> indices;
+};
+
+//----------------------------------------------------------------------------------------
+// The decoder before it parsed from memory, unchanged.
+static void referenceDecode(
+        const char * objFilePath,
+        std::string & objectName,
+        std::vector<vec3> & positions,
+        std::vector<vec3> & normals,
+        std::vector<vec2> & uvCoords
+) {
+    positions.clear();
+    normals.clear();
+    uvCoords.clear();
+
+    ifstream in(objFilePath, std::ios::in);
+    in.exceptions(std::ifstream::badbit);
+
+    if (!in) {
+        stringstream errorMessage;
+        errorMessage << "Unable to open .obj file " << objFilePath
+            << " within method ObjFileDecoder::decode" << endl;
+
+        throw Exception(errorMessage.str().c_str());
+    }
+
+    string currentLine;
+    int positionIndexA, positionIndexB, positionIndexC;
+    int normalIndexA, normalIndexB, normalIndexC;
+    int uvCoordIndexA, uvCoordIndexB, uvCoordIndexC;
+    vector<vec3> temp_positions;
+    vector<vec3> temp_normals;
+    vector<vec2> temp_uvCoords;
+
+    objectName = "";
+
+    while (!in.eof()) {
+        getline(in, currentLine);
+        if (currentLine.substr(0, 2) == "o ") {
+            istringstream s(currentLine.substr(2));
+            s >> objectName;
+
+        } else if (currentLine.substr(0, 2) == "v ") {
+            istringstream s(currentLine.substr(2));
+            glm::vec3 vertex;
+            s >> vertex.x;
+            s >> vertex.y;
+            s >> vertex.z;
+            temp_positions.push_back(vertex);
+
+        } else if (currentLine.substr(0, 3) == "vn ") {
+            istringstream s(currentLine.substr(2));
+            vec3 normal;
+            s >> normal.x;
+            s >> normal.y;
+            s >> normal.z;
+            temp_normals.push_back(normal);
+
+        } else if (currentLine.substr(0, 3) == "vt ") {
+            istringstream s(currentLine.substr(2));
+            vec2 textureCoord;
+            s >> textureCoord.s;
+            s >> textureCoord.t;
+            temp_uvCoords.push_back(textureCoord);
+
+        } else if (currentLine.substr(0, 2) == "f ") {
+            int index;
+            int numberOfIndexMatches = sscanf(currentLine.c_str(), "f %d/%d/%d",
+                                              &index, &index, &index);
+
+            if (numberOfIndexMatches == 3) {
+                sscanf(currentLine.c_str(), "f %d/%d/%d %d/%d/%d %d/%d/%d",
+                       &positionIndexA, &uvCoordIndexA, &normalIndexA,
+                       &positionIndexB, &uvCoordIndexB, &normalIndexB,
+                       &positionIndexC, &uvCoordIndexC, &normalIndexC);
+
+                uvCoordIndexA--;
+                uvCoordIndexB--;
+                uvCoordIndexC--;
+
+                uvCoords.push_back(temp_uvCoords[uvCoordIndexA]);
+                uvCoords.push_back(temp_uvCoords[uvCoordIndexB]);
+                uvCoords.push_back(temp_uvCoords[uvCoordIndexC]);
+
+            } else {
+                sscanf(currentLine.c_str(), "f %d//%d %d//%d %d//%d",
+                       &positionIndexA, &normalIndexA,
+                       &positionIndexB, &normalIndexB,
+                       &positionIndexC, &normalIndexC);
+            }
+
+            positionIndexA--;
+            positionIndexB--;
+            positionIndexC--;
+            normalIndexA--;
+            normalIndexB--;
+            normalIndexC--;
+
+            positions.push_back(temp_positions[positionIndexA]);
+            positions.push_back(temp_positions[positionIndexB]);
+            positions.push_back(temp_positions[positionIndexC]);
+
+            normals.push_back(temp_normals[normalIndexA]);
+            normals.push_back(temp_normals[normalIndexB]);
+            normals.push_back(temp_normals[normalIndexC]);
+        }
+    }
+}
+
+//----------------------------------------------------------------------------------------
+// Writes a sphere of about 'megabytes', with texture coordinates if 'uvCoords'.
+// Returns the file's size, or 0 if it could not be written.
+static size_t writeSphere(const string & filePath, double megabytes, bool uvCoords)
+{
+    FILE * file = fopen(filePath.c_str(), "w");
+    if (file == nullptr) {
+        return 0;
+    }
+
+    // Roughly the bytes each grid vertex adds: its records and two faces.
+    double bytesPerVertex = uvCoords ? 200.0 : 150.0;
+    int dim = std::max(2, int(sqrt(megabytes * 1024.0 * 1024.0 / bytesPerVertex)));
+
+    const double pi = 3.14159265358979323846;
+    fprintf(file, "# ObjBench sphere, %dx%d vertices\no sphere\n", dim, dim);
+    for (int row = 0; row < dim; ++row) {
+        double theta = pi * (row + 0.5) / dim;
+        for (int col = 0; col < dim; ++col) {
+            double phi = 2.0 * pi * col / dim;
+            double x = sin(theta) * cos(phi), y = cos(theta), z = sin(theta) * sin(phi);
+            fprintf(file, "v %.6f %.6f %.6f\n", x * 12.5, y * 12.5, z * 12.5);
+            fprintf(file, "vn %.6f %.6f %.6f\n", x, y, z);
+            if (uvCoords) {
+                fprintf(file, "vt %.6f %.6f\n", double(col) / dim, double(row) / dim);
+            }
+        }
+    }
+
+    for (int row = 0; row + 1 < dim; ++row) {
+        for (int col = 0; col < dim; ++col) {
+            int a = row * dim + col + 1;
+            int b = row * dim + (col + 1) % dim + 1;
+            int c = a + dim, d = b + dim;
+            if (uvCoords) {
+                fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, c, c, c, b, b, b);
+                fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d\n", b, b, b, c, c, c, d, d, d);
+            } else {
+                fprintf(file, "f %d//%d %d//%d %d//%d\n", a, a, c, c, b, b);
+                fprintf(file, "f %d//%d %d//%d %d//%d\n", b, b, c, c, d, d);
+            }
+        }
+    }
+
+    long size = ftell(file);
+    bool ok = ferror(file) == 0;
+    ok = fclose(file) == 0 && ok;
+    return ok ? size_t(size) : 0;
+}
+
+//----------------------------------------------------------------------------------------
+template <typename T>
+static bool sameBytes(const vector<T> & a, const vector<T> & b)
+{
+    return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+}
+
+static bool sameMesh(const Mesh & a, const Mesh & b)
+{
+    return a.objectName == b.objectName && sameBytes(a.positions, b.positions) &&
+            sameBytes(a.normals, b.normals) && sameBytes(a.uvCoords, b.uvCoords);
+}
+
+// True if an indexed mesh has the corners of an expanded one.
+static bool sameCorners(const Mesh & indexed, const Mesh & expanded)
+{
+    if (indexed.objectName != expanded.objectName || indexed.indices.size() != expanded.positions.size()) {
+        return false;
+    }
+
+    bool uvCoords = !expanded.uvCoords.empty();
+    for (size_t idx = 0; idx < indexed.indices.size(); ++idx) {
+        uint32_t vertex = indexed.indices[idx];
+        if (memcmp(&indexed.positions[vertex], &expanded.positions[idx], sizeof(vec3)) != 0 ||
+                memcmp(&indexed.normals[vertex], &expanded.normals[idx], sizeof(vec3)) != 0 ||
+                (uvCoords && memcmp(&indexed.uvCoords[vertex], &expanded.uvCoords[idx], sizeof(vec2)) != 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------------------------
+// Fastest of 'repeats' decodes, in milliseconds.
+template <typename Decode>
+static double timeDecode(unsigned repeats, Decode decode)
+{
+    double best = 0.0;
+    for (unsigned idx = 0; idx < repeats; ++idx) {
+        auto start = chrono::steady_clock::now();
+        decode();
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        best = idx == 0 ? ms : std::min(best, ms);
+    }
+    return best;
+}
+
+//----------------------------------------------------------------------------------------
+static bool parseOptions(int argc, char ** argv, Options & options)
+{
+    for (int idx = 1; idx < argc; ++idx) {
+        string arg = argv[idx];
+        if (idx + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", arg.c_str());
+            return false;
+        }
+        string value = argv[++idx];
+
+        if (arg == "--mb") {
+            options.megabytes = std::max(0.01, atof(value.c_str()));
+        } else if (arg == "--repeats") {
+            options.repeats = unsigned(std::max(1, atoi(value.c_str())));
+        } else if (arg == "--threads") {
+            options.threads = unsigned(std::max(0, atoi(value.c_str())));
+        } else if (arg == "--dir") {
+            options.directory = value;
+        } else if (arg == "--reference") {
+            options.reference = atoi(value.c_str()) != 0;
+        } else {
+            fprintf(stderr, "Unknown option %s\n", arg.c_str());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//----------------------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return EXIT_FAILURE;
+    }
+
+    printf("%-10s %-10s %9s %10s %9s %9s\n", "file", "decoder", "MB", "ms", "MB/s", "speedup");
+
+    bool identical = true;
+    for (int withUvCoords = 1; withUvCoords >= 0; --withUvCoords) {
+        const char * name = withUvCoords ? "v/vt/vn" : "v//vn";
+        string filePath = options.directory + (withUvCoords ? "/ObjBench-uv.obj" : "/ObjBench.obj");
+
+        size_t bytes = writeSphere(filePath, options.megabytes, withUvCoords != 0);
+        if (bytes == 0) {
+            fprintf(stderr, "Unable to write %s\n", filePath.c_str());
+            return EXIT_FAILURE;
+        }
+        double megabytes = bytes / (1024.0 * 1024.0);
+
+        Mesh mesh;
+        ObjFileDecoder::setThreadCount(1);
+        double ms = timeDecode(options.repeats, [&]() {
+            ObjFileDecoder::decode(filePath.c_str(), mesh.objectName, mesh.positions, mesh.normals,
+                    mesh.uvCoords);
+        });
+        printf("%-10s %-10s %9.1f %10.1f %9.1f\n", name, "serial", megabytes, ms, megabytes * 1000.0 / ms);
+
+        Mesh parallel;
+        ObjFileDecoder::setThreadCount(options.threads);
+        double parallelMs = timeDecode(options.repeats, [&]() {
+            ObjFileDecoder::decode(filePath.c_str(), parallel.objectName, parallel.positions,
+                    parallel.normals, parallel.uvCoords);
+        });
+        printf("%-10s %-10s %9.1f %10.1f %9.1f %8.1fx\n", name, "parallel", megabytes, parallelMs,
+                megabytes * 1000.0 / parallelMs, ms / parallelMs);
+
+        if (!sameMesh(mesh, parallel)) {
+            printf("%-10s serial and parallel decodes disagree\n", name);
+            identical = false;
+        }
+
+        // Shared vertices stored once, and an index per corner.
+        Mesh indexed;
+        double indexedMs = timeDecode(options.repeats, [&]() {
+            ObjFileDecoder::decodeIndexed(filePath.c_str(), indexed.objectName, indexed.positions,
+                    indexed.normals, indexed.uvCoords, indexed.indices);
+        });
+        printf("%-10s %-10s %9.1f %10.1f %9.1f %8.1fx\n", name, "indexed", megabytes, indexedMs,
+                megabytes * 1000.0 / indexedMs, ms / indexedMs);
+
+        size_t vertexBytes = sizeof(vec3) * 2 + (withUvCoords ? sizeof(vec2) : 0);
+        printf("%-10s %zu corners as %zu vertices, %.1f MB of vertices and indices instead of %.1f MB\n",
+                name, mesh.positions.size(), indexed.positions.size(),
+                (indexed.positions.size() * vertexBytes + indexed.indices.size() * sizeof(uint32_t)) / 1048576.0,
+                mesh.positions.size() * vertexBytes / 1048576.0);
+
+        if (!sameCorners(indexed, mesh)) {
+            printf("%-10s indexed and expanded decodes disagree\n", name);
+            identical = false;
+        }
+
+        // The first load writes the cache, the second reads it.
+        string cachePath = filePath + ".meshcache";
+        remove(cachePath.c_str());
+        MeshConsolidator::setCacheEnabled(true);
+        for (int pass = 0; pass < 2; ++pass) {
+            size_t positionBytes = 0;
+            double cacheMs = timeDecode(1, [&]() {
+                MeshConsolidator consolidator{ filePath };
+                positionBytes = consolidator.getNumVertexPositionBytes();
+            });
+            printf("%-10s %-10s %9.1f %10.1f %9.1f %8.1fx\n", name, pass == 0 ? "cache miss" : "cache hit",
+                    megabytes, cacheMs, megabytes * 1000.0 / cacheMs, ms / cacheMs);
+
+            if (positionBytes != indexed.positions.size() * sizeof(vec3)) {
+                printf("%-10s cached mesh differs\n", name);
+                identical = false;
+            }
+        }
+        remove(cachePath.c_str());
+
+        if (options.reference) {
+            Mesh reference;
+            double referenceMs = timeDecode(1, [&]() {
+                referenceDecode(filePath.c_str(), reference.objectName, reference.positions,
+                        reference.normals, reference.uvCoords);
+            });
+            printf("%-10s %-10s %9.1f %10.1f %9.1f %8.1fx\n", name, "reference", megabytes, referenceMs,
+                    megabytes * 1000.0 / referenceMs, referenceMs / ms);
+
+            if (!sameMesh(mesh, reference)) {
+                printf("%-10s decoders disagree\n", name);
+                identical = false;
+            }
+        }
+        fflush(stdout);
+
+        remove(filePath.c_str());
+    }
+
+    return identical ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,347 @@
+/*
+ * RayBench
+ *
+ * Compares the grid specific traversal of RayTracer (max-mip DDA and SSE
+ * packets) against a generic triangle BVH built from the same cubes, then
+ * measures how a full ambient occlusion and soft shadow render scales from
+ * one thread up to N.
+ *
+ * Usage: RayBench [grid-dim] [max-threads]
+ */
+
+#include "benchutil.hpp"
+#include "drawlist.hpp"
+#include "grid.hpp"
+#include "raytracer.hpp"
+#include "threadpool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+static const int WIDTH = 1024;
+static const int HEIGHT = 768;
+
+// Leaves of the BVH hold at most this many triangles.
+static const size_t LEAF_SIZE = 4;
+
+//----------------------------------------------------------------------------------------
+template <typename Fn>
+static double milliseconds(Fn fn)
+{
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    fn();
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+//----------------------------------------------------------------------------------------
+/*
+ * Baseline: a median split BVH over the triangles SceneRenderer draws, with
+ * Moller-Trumbore intersection.
+ */
+class TriangleBVH
+{
+public:
+    void build(const Grid & grid)
+    {
+        static const glm::vec3 corners[8] = {
+            {0, 0, 1}, {1, 0, 1}, {1, 1, 1}, {0, 1, 1},
+            {0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0}
+        };
+        static const int indices[36] = {
+            0, 1, 2, 2, 3, 0,  3, 2, 6, 6, 7, 3,  7, 6, 5, 5, 4, 7,
+            4, 0, 3, 3, 7, 4,  0, 1, 5, 5, 4, 0,  1, 5, 6, 6, 2, 1
+        };
+
+        m_triangles.clear();
+        for (size_t x = 0; x < grid.getDim(); ++x) {
+            for (size_t z = 0; z < grid.getDim(); ++z) {
+                for (int y = 0; y < grid.getHeight(x, z); ++y) {
+                    glm::vec3 offset = glm::vec3(float(x), float(y), float(z));
+                    for (int idx = 0; idx < 36; idx += 3) {
+                        Triangle tri;
+                        tri.a = offset + corners[indices[idx]];
+                        tri.b = offset + corners[indices[idx + 1]];
+                        tri.c = offset + corners[indices[idx + 2]];
+                        m_triangles.push_back(tri);
+                    }
+                }
+            }
+        }
+
+        m_order.resize(m_triangles.size());
+        for (size_t idx = 0; idx < m_order.size(); ++idx) {
+            m_order[idx] = uint32_t(idx);
+        }
+
+        m_nodes.clear();
+        m_nodes.push_back(Node());
+        buildNode(0, 0, m_order.size());
+    }
+
+    size_t getTriangleCount() const
+    {
+        return m_triangles.size();
+    }
+
+    bool intersect(const glm::vec3 & origin, const glm::vec3 & dir, float tMax, bool anyHit, float & tHit) const
+    {
+        glm::vec3 inv(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+        uint32_t stack[64];
+        int depth = 0;
+        stack[depth++] = 0;
+
+        bool found = false;
+        tHit = tMax;
+
+        while (depth > 0) {
+            const Node & node = m_nodes[stack[--depth]];
+            if (!hitsBox(node, origin, inv, tHit)) {
+                continue;
+            }
+
+            if (node.count > 0) {
+                for (uint32_t idx = node.first; idx < node.first + node.count; ++idx) {
+                    float t;
+                    if (hitsTriangle(m_triangles[m_order[idx]], origin, dir, t) && t < tHit) {
+                        tHit = t;
+                        found = true;
+                        if (anyHit) {
+                            return true;
+                        }
+                    }
+                }
+                continue;
+            }
+
+            // Visit the nearer child first
+            bool flip = dir[node.axis] < 0.0f;
+            stack[depth++] = flip ? node.first : node.first + 1;
+            stack[depth++] = flip ? node.first + 1 : node.first;
+        }
+        return found;
+    }
+
+private:
+    struct Triangle
+    {
+        glm::vec3 a, b, c;
+    };
+
+    // Interior nodes have count == 0 and children at first, first + 1.
+    struct Node
+    {
+        glm::vec3 lo, hi;
+        uint32_t first;
+        uint32_t count;
+        int axis;
+    };
+
+    void buildNode(size_t nodeIdx, size_t begin, size_t end)
+    {
+        glm::vec3 lo(1e30f), hi(-1e30f), clo(1e30f), chi(-1e30f);
+        for (size_t idx = begin; idx < end; ++idx) {
+            const Triangle & tri = m_triangles[m_order[idx]];
+            lo = glm::min(lo, glm::min(tri.a, glm::min(tri.b, tri.c)));
+            hi = glm::max(hi, glm::max(tri.a, glm::max(tri.b, tri.c)));
+            glm::vec3 centre = (tri.a + tri.b + tri.c) / 3.0f;
+            clo = glm::min(clo, centre);
+            chi = glm::max(chi, centre);
+        }
+
+        m_nodes[nodeIdx].lo = lo;
+        m_nodes[nodeIdx].hi = hi;
+        m_nodes[nodeIdx].axis = 0;
+
+        if (end - begin <= LEAF_SIZE) {
+            m_nodes[nodeIdx].first = uint32_t(begin);
+            m_nodes[nodeIdx].count = uint32_t(end - begin);
+            return;
+        }
+
+        // Split at the median centroid of the longest axis
+        glm::vec3 extent = chi - clo;
+        int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+        size_t mid = (begin + end) / 2;
+        nth_element(m_order.begin() + begin, m_order.begin() + mid, m_order.begin() + end,
+            [&](uint32_t l, uint32_t r) {
+                const Triangle & a = m_triangles[l];
+                const Triangle & b = m_triangles[r];
+                return a.a[axis] + a.b[axis] + a.c[axis] < b.a[axis] + b.b[axis] + b.c[axis];
+            });
+
+        uint32_t child = uint32_t(m_nodes.size());
+        m_nodes.push_back(Node());
+        m_nodes.push_back(Node());
+        m_nodes[nodeIdx].first = child;
+        m_nodes[nodeIdx].count = 0;
+        m_nodes[nodeIdx].axis = axis;
+
+        buildNode(child, begin, mid);
+        buildNode(child + 1, mid, end);
+    }
+
+    static bool hitsBox(const Node & node, const glm::vec3 & origin, const glm::vec3 & inv, float tMax)
+    {
+        glm::vec3 a = (node.lo - origin) * inv;
+        glm::vec3 b = (node.hi - origin) * inv;
+        glm::vec3 tNear = glm::min(a, b);
+        glm::vec3 tFar = glm::max(a, b);
+        float t0 = max(max(tNear.x, tNear.y), max(tNear.z, 0.0f));
+        float t1 = min(min(tFar.x, tFar.y), min(tFar.z, tMax));
+        return t0 <= t1;
+    }
+
+    static bool hitsTriangle(const Triangle & tri, const glm::vec3 & origin, const glm::vec3 & dir, float & t)
+    {
+        glm::vec3 e1 = tri.b - tri.a;
+        glm::vec3 e2 = tri.c - tri.a;
+        glm::vec3 p = glm::cross(dir, e2);
+        float det = glm::dot(e1, p);
+        if (fabs(det) < 1e-12f) {
+            return false;
+        }
+
+        float inv = 1.0f / det;
+        glm::vec3 s = origin - tri.a;
+        float u = glm::dot(s, p) * inv;
+        if (u < 0.0f || u > 1.0f) {
+            return false;
+        }
+
+        glm::vec3 q = glm::cross(s, e1);
+        float v = glm::dot(dir, q) * inv;
+        if (v < 0.0f || u + v > 1.0f) {
+            return false;
+        }
+
+        t = glm::dot(e2, q) * inv;
+        return t > 0.0f;
+    }
+
+    vector<Triangle> m_triangles;
+    vector<uint32_t> m_order;
+    vector<Node> m_nodes;
+};
+
+//----------------------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    size_t dim = argc > 1 ? size_t(atoi(argv[1])) : 128;
+    unsigned maxThreads = argc > 2 ? unsigned(atoi(argv[2])) : max(thread::hardware_concurrency(), 1u);
+
+    Grid grid(dim);
+    generateGrid(grid);
+
+    glm::vec3 palette[PALETTE_SIZE];
+    initDefaultPalette(palette);
+
+    RayTracer tracer;
+    tracer.setScene(grid, palette);
+    tracer.setCamera(sceneProjection(WIDTH, HEIGHT, dim), sceneViewTransform(dim),
+                     sceneWorldTransform(dim, 30.0f, 1.0f), WIDTH, HEIGHT);
+
+    TriangleBVH bvh;
+    double buildMs = milliseconds([&]() { bvh.build(grid); });
+
+    printf("Grid %zux%zu, %zu triangles, BVH built in %.1f ms\n\n", dim, dim, bvh.getTriangleCount(), buildMs);
+
+    // Primary rays, plus one short occlusion ray per hit like ambient occlusion
+    const size_t count = size_t(WIDTH) * HEIGHT;
+    vector<glm::vec3> origins(count), dirs(count);
+    for (int y = 0; y < HEIGHT; ++y) {
+        for (int x = 0; x < WIDTH; ++x) {
+            tracer.getCameraRay(x, y, origins[y * WIDTH + x], dirs[y * WIDTH + x]);
+        }
+    }
+
+    vector<float> tGrid(count, -1.0f), tPacket(count, -1.0f), tBvh(count, -1.0f);
+
+    double gridMs = milliseconds([&]() {
+        for (size_t idx = 0; idx < count; ++idx) {
+            RayHit hit;
+            if (tracer.intersect(origins[idx], dirs[idx], 1e30f, hit)) {
+                tGrid[idx] = hit.t;
+            }
+        }
+    });
+
+    double packetMs = milliseconds([&]() {
+        RayHit hits[4];
+        for (size_t idx = 0; idx + 4 <= count; idx += 4) {
+            unsigned mask = tracer.intersect4(&origins[idx], &dirs[idx], 1e30f, hits);
+            for (unsigned l = 0; l < 4; ++l) {
+                if (mask & (1u << l)) {
+                    tPacket[idx + l] = hits[l].t;
+                }
+            }
+        }
+    });
+
+    double bvhMs = milliseconds([&]() {
+        for (size_t idx = 0; idx < count; ++idx) {
+            float t;
+            if (bvh.intersect(origins[idx], dirs[idx], 1e30f, false, t)) {
+                tBvh[idx] = t;
+            }
+        }
+    });
+
+    // Occlusion rays leave each hit point in a fixed direction, 4 cells long
+    vector<glm::vec3> aoOrigins;
+    glm::vec3 aoDir = glm::normalize(glm::vec3(0.3f, 1.0f, -0.2f));
+    for (size_t idx = 0; idx < count; ++idx) {
+        if (tGrid[idx] > 0.0f) {
+            aoOrigins.push_back(origins[idx] + dirs[idx] * tGrid[idx] - dirs[idx] * 1e-3f);
+        }
+    }
+
+    size_t gridBlocked = 0, bvhBlocked = 0;
+    double aoGridMs = milliseconds([&]() {
+        for (const glm::vec3 & o : aoOrigins) {
+            gridBlocked += tracer.occluded(o, aoDir, 4.0f) ? 1 : 0;
+        }
+    });
+    double aoBvhMs = milliseconds([&]() {
+        for (const glm::vec3 & o : aoOrigins) {
+            float t;
+            bvhBlocked += bvh.intersect(o, aoDir, 4.0f, true, t) ? 1 : 0;
+        }
+    });
+
+    // The traversals should agree on every hit
+    size_t mismatches = 0;
+    for (size_t idx = 0; idx < count; ++idx) {
+        if (fabs(tGrid[idx] - tBvh[idx]) > 1e-2f || fabs(tPacket[idx] - tBvh[idx]) > 1e-2f) {
+            ++mismatches;
+        }
+    }
+
+    printf("%-28s %10s %10s %9s\n", "single thread", "ms", "Mrays/s", "vs BVH");
+    printf("%-28s %10.1f %10.2f %8.1fx\n", "primary, triangle BVH", bvhMs, count / bvhMs / 1e3, 1.0);
+    printf("%-28s %10.1f %10.2f %8.1fx\n", "primary, grid DDA", gridMs, count / gridMs / 1e3, bvhMs / gridMs);
+    printf("%-28s %10.1f %10.2f %8.1fx\n", "primary, grid SSE packets", packetMs, count / packetMs / 1e3, bvhMs / packetMs);
+    printf("%-28s %10.1f %10.2f %8.1fx\n", "occlusion, triangle BVH", aoBvhMs, aoOrigins.size() / aoBvhMs / 1e3, 1.0);
+    printf("%-28s %10.1f %10.2f %8.1fx\n", "occlusion, grid DDA", aoGridMs, aoOrigins.size() / aoGridMs / 1e3, aoBvhMs / aoGridMs);
+    printf("primary mismatches: %zu of %zu, occluded: grid %zu / BVH %zu\n\n", mismatches, count, gridBlocked, bvhBlocked);
+
+    // Full renders from 1 to maxThreads threads
+    printf("%-8s %10s %8s\n", "threads", "ms", "speedup");
+    double single = 0.0;
+    for (unsigned threads = 1; threads <= maxThreads; threads = threads < maxThreads ? min(threads * 2, maxThreads) : threads + 1) {
+        ThreadPool pool(threads);
+        double ms = milliseconds([&]() { tracer.render(pool); });
+        if (threads == 1) {
+            single = ms;
+        }
+        printf("%-8u %10.1f %7.2fx\n", threads, ms, single / ms);
+    }
+
+    return 0;
+}
@@ -0,0 +1,492 @@
+/*
+ * RenderBench
+ *
+ * Renders deterministic grids (empty, random, checkerboard and full towers)
+ * at sizes from 16 to 4096 offscreen along a fixed camera path, once per
+ * render mode (GL, software rasteriser and ray tracer). Reports the CPU time
+ * per frame of recording the draw list and of rendering it, plus the draw
+ * calls and triangles the GL path issues, and writes everything to a JSON
+ * file that can be diffed between builds.
+ *
+ * Usage: RenderBench [--output file] [--sizes 16,64,...] [--modes gl,software,raytrace]
+ *                    [--frames N] [--size WxH] [--max-draws N] [--budget ms]
+ */
+
+#include "benchutil.hpp"
+#include "drawlist.hpp"
+#include "grid.hpp"
+#include "raytracer.hpp"
+#include "renderqueue.hpp"
+#include "scenerenderer.hpp"
+#include "softrasteriser.hpp"
+#include "threadpool.hpp"
+
+#include "cs488-framework/GlCounters.hpp"
+#include "cs488-framework/HdrHistogram.hpp"
+#include "cs488-framework/HeadlessContext.hpp"
+#include "cs488-framework/RenderTarget.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Longest frame time tracked, in microseconds.
+static const uint64_t MAX_FRAME_US = 600 * 1000 * 1000;
+
+enum Pattern {
+    PATTERN_EMPTY,
+    PATTERN_RANDOM,
+    PATTERN_CHECKERBOARD,
+    PATTERN_TOWERS,
+    NUM_PATTERNS
+};
+
+static const char * const PATTERN_NAMES[NUM_PATTERNS] = { "empty", "random", "checkerboard", "towers" };
+
+enum Mode {
+    MODE_GL,
+    MODE_SOFTWARE,
+    MODE_RAYTRACE,
+    NUM_MODES
+};
+
+static const char * const MODE_NAMES[NUM_MODES] = { "gl", "software", "raytrace" };
+
+struct Options {
+    string outputFile;
+    vector<size_t> sizes;
+    vector<Mode> modes;
+    unsigned frames;
+    int width;
+    int height;
+
+    // Cases that would make more draws than this are skipped by the
+    // rasterising modes, as are any frames once a case runs over budget.
+    size_t maxDraws;
+    double budgetMs;
+
+    Options()
+        : outputFile("RenderBench.json"),
+          frames(8),
+          width(512),
+          height(512),
+          maxDraws(150000),
+          budgetMs(10000.0)
+    { }
+};
+
+/*
+ * Timings and counts of one grid, size and mode.
+ */
+struct Result {
+    Pattern pattern;
+    size_t dim;
+    Mode mode;
+
+    string skipped;
+    unsigned frames;
+    size_t draws;
+
+    // Per frame, in microseconds.
+    HdrHistogram record;
+    HdrHistogram render;
+    HdrHistogram total;
+
+    // Per frame averages, GL only.
+    uint64_t drawCalls;
+    uint64_t triangles;
+
+    Result(Pattern pattern, size_t dim, Mode mode)
+        : pattern(pattern), dim(dim), mode(mode), frames(0), draws(0),
+          record(MAX_FRAME_US), render(MAX_FRAME_US), total(MAX_FRAME_US),
+          drawCalls(0), triangles(0)
+    { }
+};
+
+//----------------------------------------------------------------------------------------
+static void generatePattern(Grid & grid, Pattern pattern)
+{
+    int dim = int(grid.getDim());
+    uint32_t state = 0x2545f491u;
+
+    for (int y = 0; y < dim; ++y) {
+        for (int x = 0; x < dim; ++x) {
+            int height = 0;
+            switch (pattern) {
+            case PATTERN_EMPTY:
+                break;
+            case PATTERN_RANDOM:
+                height = int(nextRandom(state) % (MAX_HEIGHT + 1));
+                break;
+            case PATTERN_CHECKERBOARD:
+                height = ((x + y) & 1) ? MAX_HEIGHT : 0;
+                break;
+            case PATTERN_TOWERS:
+                height = MAX_HEIGHT;
+                break;
+            default:
+                break;
+            }
+
+            grid.setHeight(x, y, height);
+            grid.setColour(x, y, (x + y) % int(PALETTE_SIZE));
+        }
+    }
+}
+
+//----------------------------------------------------------------------------------------
+static SceneState makeScene(const Options & options, const Grid & grid, const glm::vec3 * palette, unsigned frame)
+{
+    SceneState scene;
+    scene.grid = &grid;
+    scene.palette = palette;
+    scene.proj = sceneProjection(options.width, options.height, grid.getDim());
+    scene.view = sceneViewTransform(grid.getDim());
+    scene.angle = 360.0f * float(frame) / float(options.frames);
+    scene.scale = 1.0f;
+    scene.activeX = 0;
+    scene.activeY = 0;
+    return scene;
+}
+
+//----------------------------------------------------------------------------------------
+/*
+ * Gets the number of instances in the draw list, which is the number of
+ * draws either rasteriser makes.
+ */
+static size_t countDraws(const DrawList & list)
+{
+    size_t draws = 0;
+    for (const DrawCommand & cmd : list.getCommands()) {
+        draws += cmd.instanceCount;
+    }
+    return draws;
+}
+
+//----------------------------------------------------------------------------------------
+static uint64_t microsecondsSince(chrono::steady_clock::time_point start)
+{
+    return uint64_t(chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count());
+}
+
+//----------------------------------------------------------------------------------------
+/*
+ * Holds whatever each mode renders with, created on first use.
+ */
+struct Renderers {
+    string assetDir;
+
+    unique_ptr<HeadlessContext> context;
+    unique_ptr<SceneRenderer> gl;
+    unique_ptr<RenderTarget> target;
+    string glError;
+
+    SoftRasteriser software;
+
+    ThreadPool pool;
+    RayTracer tracer;
+
+    bool initGl(int width, int height)
+    {
+        if (gl || !glError.empty()) {
+            return bool(gl);
+        }
+
+        try {
+            context.reset(new HeadlessContext());
+            context->create();
+            GlCounters::install();
+
+            gl.reset(new SceneRenderer());
+            gl->init(assetDir + "VertexShader.vs", assetDir + "FragmentShader.fs");
+
+            target.reset(new RenderTarget());
+            target->resize(width, height);
+            glClearColor(0.3f, 0.5f, 0.7f, 1.0f);
+        } catch (const exception & e) {
+            glError = e.what();
+            gl.reset();
+        }
+        return bool(gl);
+    }
+
+    ~Renderers()
+    {
+        if (gl) {
+            target->destroy();
+            gl->cleanup();
+        }
+    }
+};
+
+//----------------------------------------------------------------------------------------
+static void runCase(const Options & options, Renderers & renderers, const Grid & grid, Result & result)
+{
+    size_t dim = grid.getDim();
+
+    glm::vec3 palette[PALETTE_SIZE];
+    initDefaultPalette(palette);
+
+    DrawList list;
+    RenderQueue queue;
+    buildDrawList(makeScene(options, grid, palette, 0), list);
+    result.draws = countDraws(list);
+
+    if (result.mode != MODE_RAYTRACE && result.draws > options.maxDraws) {
+        stringstream reason;
+        reason << result.draws << " draws exceeds --max-draws";
+        result.skipped = reason.str();
+        return;
+    }
+
+    if (result.mode == MODE_GL && !renderers.initGl(options.width, options.height)) {
+        result.skipped = "no GL context: " + renderers.glError;
+        return;
+    }
+
+    if (result.mode == MODE_GL) {
+        renderers.gl->setGridDim(dim);
+    } else if (result.mode == MODE_SOFTWARE) {
+        renderers.software.setGridDim(dim);
+    } else {
+        renderers.tracer.setScene(grid, palette);
+    }
+
+    chrono::steady_clock::time_point caseStart = chrono::steady_clock::now();
+
+    // One untimed frame first, so allocations and shader compiles are not counted.
+    for (unsigned frame = 0; frame <= options.frames; ++frame) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+        SceneState scene = makeScene(options, grid, palette, frame);
+
+        // The ray tracer works from the grid, so only needs the camera.
+        if (result.mode == MODE_RAYTRACE) {
+            renderers.tracer.setCamera(scene.proj, scene.view, sceneWorldTransform(dim, scene.angle, scene.scale),
+                    options.width, options.height);
+        } else {
+            buildDrawList(scene, list, thread::hardware_concurrency());
+            queue.sort(list);
+        }
+        uint64_t recordUs = microsecondsSince(start);
+
+        chrono::steady_clock::time_point renderStart = chrono::steady_clock::now();
+        if (result.mode == MODE_GL) {
+            renderers.target->bind();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            GlCounters::resetCurrent();
+            renderers.gl->replay(list);
+            const GlCounters::Frame & counters = GlCounters::getCurrent();
+            if (frame > 0) {
+                result.drawCalls += counters.drawCalls;
+                result.triangles += counters.triangles;
+            }
+
+            // Under llvmpipe the frame is rendered on the CPU, so wait for it.
+            glFinish();
+        } else if (result.mode == MODE_SOFTWARE) {
+            renderers.software.render(list, options.width, options.height);
+        } else {
+            renderers.tracer.render(renderers.pool);
+        }
+        uint64_t renderUs = microsecondsSince(renderStart);
+
+        if (frame > 0) {
+            result.record.record(recordUs);
+            result.render.record(renderUs);
+            result.total.record(recordUs + renderUs);
+            ++result.frames;
+        }
+
+        if (frame > 0 && double(microsecondsSince(caseStart)) * 1.0e-3 > options.budgetMs) {
+            break;
+        }
+    }
+
+    if (result.frames > 0 && result.mode == MODE_GL) {
+        result.drawCalls /= result.frames;
+        result.triangles /= result.frames;
+    }
+}
+
+//----------------------------------------------------------------------------------------
+static void writeHistogram(FILE * file, const char * name, const HdrHistogram & histogram)
+{
+    fprintf(file, "\"%s\": { \"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"max\": %.3f }",
+            name, histogram.mean() * 1.0e-3, double(histogram.valueAtPercentile(50.0)) * 1.0e-3,
+            double(histogram.valueAtPercentile(90.0)) * 1.0e-3, double(histogram.max()) * 1.0e-3);
+}
+
+//----------------------------------------------------------------------------------------
+static bool writeJson(const Options & options, const string & renderer, const vector<Result> & results)
+{
+    FILE * file = fopen(options.outputFile.c_str(), "w");
+    if (file == nullptr) {
+        return false;
+    }
+
+    RayTraceSettings settings;
+    fprintf(file, "{\n  \"renderer\": \"%s\",\n  \"width\": %d,\n  \"height\": %d,\n  \"frames\": %u,\n"
+            "  \"threads\": %u,\n  \"aoSamples\": %u,\n  \"shadowSamples\": %u,\n  \"unit\": \"ms\",\n  \"cases\": [",
+            renderer.c_str(), options.width, options.height, options.frames,
+            max(thread::hardware_concurrency(), 1u), settings.aoSamples, settings.shadowSamples);
+
+    for (size_t idx = 0; idx < results.size(); ++idx) {
+        const Result & result = results[idx];
+        fprintf(file, "%s\n    { \"grid\": \"%s\", \"dim\": %zu, \"mode\": \"%s\", \"draws\": %zu, ",
+                idx == 0 ? "" : ",", PATTERN_NAMES[result.pattern], result.dim, MODE_NAMES[result.mode],
+                result.draws);
+
+        if (!result.skipped.empty()) {
+            fprintf(file, "\"skipped\": \"%s\" }", result.skipped.c_str());
+            continue;
+        }
+
+        fprintf(file, "\"frames\": %u, ", result.frames);
+        writeHistogram(file, "record", result.record);
+        fprintf(file, ", ");
+        writeHistogram(file, "render", result.render);
+        fprintf(file, ", ");
+        writeHistogram(file, "total", result.total);
+        if (result.mode == MODE_GL) {
+            fprintf(file, ", \"drawCalls\": %llu, \"triangles\": %llu",
+                    (unsigned long long) result.drawCalls, (unsigned long long) result.triangles);
+        }
+        fprintf(file, " }");
+    }
+
+    fprintf(file, "\n  ]\n}\n");
+
+    bool ok = !ferror(file);
+    return fclose(file) == 0 && ok;
+}
+
+//----------------------------------------------------------------------------------------
+static bool parseOptions(int argc, char ** argv, Options & options)
+{
+    options.sizes = { 16, 64, 256, 1024, 4096 };
+    options.modes = { MODE_GL, MODE_SOFTWARE, MODE_RAYTRACE };
+
+    for (int idx = 1; idx < argc; ++idx) {
+        string arg = argv[idx];
+        if (idx + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", arg.c_str());
+            return false;
+        }
+        string value = argv[++idx];
+
+        if (arg == "--output") {
+            options.outputFile = value;
+        } else if (arg == "--sizes") {
+            options.sizes.clear();
+            stringstream list(value);
+            string item;
+            while (getline(list, item, ',')) {
+                int dim = atoi(item.c_str());
+                if (dim <= 0) {
+                    fprintf(stderr, "Invalid size %s\n", item.c_str());
+                    return false;
+                }
+                options.sizes.push_back(size_t(dim));
+            }
+        } else if (arg == "--modes") {
+            options.modes.clear();
+            stringstream list(value);
+            string item;
+            while (getline(list, item, ',')) {
+                int mode = 0;
+                while (mode < NUM_MODES && item != MODE_NAMES[mode]) {
+                    ++mode;
+                }
+                if (mode == NUM_MODES) {
+                    fprintf(stderr, "Unknown mode %s\n", item.c_str());
+                    return false;
+                }
+                options.modes.push_back(Mode(mode));
+            }
+        } else if (arg == "--frames") {
+            options.frames = unsigned(max(1, atoi(value.c_str())));
+        } else if (arg == "--size") {
+            if (sscanf(value.c_str(), "%dx%d", &options.width, &options.height) != 2 ||
+                    options.width <= 0 || options.height <= 0) {
+                fprintf(stderr, "Invalid image size %s\n", value.c_str());
+                return false;
+            }
+        } else if (arg == "--max-draws") {
+            options.maxDraws = size_t(atoll(value.c_str()));
+        } else if (arg == "--budget") {
+            options.budgetMs = atof(value.c_str());
+        } else {
+            fprintf(stderr, "Unknown option %s\n", arg.c_str());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//----------------------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return EXIT_FAILURE;
+    }
+
+    // Shaders are loaded from next to the executable, as Stack does.
+    Renderers renderers;
+    const char * slash = strrchr(argv[0], '/');
+    renderers.assetDir = (slash == nullptr ? string(".") : string(argv[0], size_t(slash - argv[0]))) + "/Assets/";
+
+    RayTraceSettings settings;
+    settings.aoSamples = 4;
+    settings.shadowSamples = 2;
+    renderers.tracer.setSettings(settings);
+
+    vector<Result> results;
+    printf("%-13s %5s %-9s %7s %10s %10s %10s %10s\n",
+           "grid", "dim", "mode", "frames", "record ms", "render ms", "p90 ms", "draws");
+
+    for (size_t dim : options.sizes) {
+        Grid grid(dim);
+        for (int pattern = 0; pattern < NUM_PATTERNS; ++pattern) {
+            generatePattern(grid, Pattern(pattern));
+
+            for (Mode mode : options.modes) {
+                results.push_back(Result(Pattern(pattern), dim, mode));
+                Result & result = results.back();
+                runCase(options, renderers, grid, result);
+
+                if (!result.skipped.empty()) {
+                    printf("%-13s %5zu %-9s skipped: %s\n", PATTERN_NAMES[pattern], dim, MODE_NAMES[mode],
+                           result.skipped.c_str());
+                } else {
+                    printf("%-13s %5zu %-9s %7u %10.2f %10.2f %10.2f %10zu\n", PATTERN_NAMES[pattern], dim,
+                           MODE_NAMES[mode], result.frames, result.record.mean() * 1.0e-3,
+                           result.render.mean() * 1.0e-3, double(result.total.valueAtPercentile(90.0)) * 1.0e-3,
+                           result.draws);
+                }
+                fflush(stdout);
+            }
+        }
+    }
+
+    string renderer = renderers.gl ? HeadlessContext::getRenderer() : "none";
+    if (!writeJson(options, renderer, results)) {
+        fprintf(stderr, "Unable to write %s\n", options.outputFile.c_str());
+        return EXIT_FAILURE;
+    }
+
+    printf("\nWrote %s\n", options.outputFile.c_str());
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,98 @@
+/*
+ * SortBench
+ *
+ * Measures the cost of ordering render queue keys with radixSort() against
+ * std::stable_sort for queue sizes between 10^5 and 10^6 commands.
+ */
+
+#include "benchutil.hpp"
+#include "renderqueue.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Number of timed runs per size, the median is reported.
+static const int RUNS = 9;
+
+//----------------------------------------------------------------------------------------
+/*
+ * Generates keys shaped like the ones recorded for the Stack scene: a few
+ * passes and meshes, nine materials and random depths.
+ */
+static void generateKeys(vector<uint64_t> & keys, size_t count)
+{
+    uint32_t state = 0x9e3779b9u;
+
+    keys.resize(count);
+    for (size_t idx = 0; idx < count; ++idx) {
+        unsigned pass = nextRandom(state) % 3;
+        unsigned mesh = nextRandom(state) % 2;
+        unsigned material = nextRandom(state) % 10;
+        float depth = float(nextRandom(state) & 0xffffff) / float(0xffffff);
+        keys[idx] = makeSortKey(pass, 0, mesh, depth, material);
+    }
+}
+
+//----------------------------------------------------------------------------------------
+template <typename Fn>
+static double medianMilliseconds(Fn fn)
+{
+    vector<double> times;
+    for (int run = 0; run < RUNS; ++run) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        fn();
+        chrono::steady_clock::time_point end = chrono::steady_clock::now();
+        times.push_back(chrono::duration<double, milli>(end - start).count());
+    }
+    sort(times.begin(), times.end());
+    return times[RUNS / 2];
+}
+
+//----------------------------------------------------------------------------------------
+int main()
+{
+    const size_t sizes[] = { 100000, 250000, 500000, 1000000 };
+
+    printf("%10s %14s %16s %12s %8s\n", "items", "radix (ms)", "stable_sort (ms)", "ns/item", "speedup");
+
+    for (size_t count : sizes) {
+        vector<uint64_t> source;
+        generateKeys(source, count);
+
+        vector<uint64_t> keys(count), tmpKeys(count);
+        vector<uint32_t> values(count), tmpValues(count);
+
+        double radixMs = medianMilliseconds([&]() {
+            keys = source;
+            for (size_t idx = 0; idx < count; ++idx) {
+                values[idx] = uint32_t(idx);
+            }
+            radixSort(keys.data(), values.data(), tmpKeys.data(), tmpValues.data(), count);
+        });
+
+        // Verify the order while the data is at hand.
+        if (!is_sorted(keys.begin(), keys.end())) {
+            fprintf(stderr, "radixSort produced an unsorted result for %zu items\n", count);
+            return EXIT_FAILURE;
+        }
+
+        vector<pair<uint64_t, uint32_t> > pairs(count);
+        double stdMs = medianMilliseconds([&]() {
+            for (size_t idx = 0; idx < count; ++idx) {
+                pairs[idx] = make_pair(source[idx], uint32_t(idx));
+            }
+            stable_sort(pairs.begin(), pairs.end());
+        });
+
+        printf("%10zu %14.3f %16.3f %12.2f %7.2fx\n", count, radixMs, stdMs,
+               radixMs * 1.0e6 / double(count), stdMs / radixMs);
+    }
+
+    return EXIT_SUCCESS;
+}
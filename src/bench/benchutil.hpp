@@ -0,0 +1,38 @@
+#pragma once
+
+/*
+ * Helpers shared by the benchmarks.
+ */
+
+#include "grid.hpp"
+
+#include <cstdint>
+
+//----------------------------------------------------------------------------------------
+/*
+ * Small deterministic generator so runs are comparable between builds.
+ */
+inline uint32_t nextRandom(uint32_t & state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+//----------------------------------------------------------------------------------------
+/*
+ * Fills a grid with random heights up to MAX_HEIGHT and random colours, the
+ * same for every run.
+ */
+inline void generateGrid(Grid & grid)
+{
+    uint32_t state = 0x2545f491u;
+    int dim = int(grid.getDim());
+    for (int y = 0; y < dim; ++y) {
+        for (int x = 0; x < dim; ++x) {
+            grid.setHeight(x, y, int(nextRandom(state) % (MAX_HEIGHT + 1)));
+            grid.setColour(x, y, int(nextRandom(state) % PALETTE_SIZE));
+        }
+    }
+}
@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "drawlist.hpp"
+#include "renderqueue.hpp"
+
+// Minimum number of grid rows given to a worker when building in parallel.
+static const size_t ROWS_PER_THREAD = 64;
+
+DrawList::DrawList()
+{
+}
+
+void DrawList::clear()
+{
+	m_commands.clear();
+}
+
+DrawCommand & DrawList::add( uint16_t mesh, uint16_t flags, const glm::vec3 & colour )
+{
+	m_commands.push_back( DrawCommand() );
+
+	DrawCommand & cmd = m_commands.back();
+	cmd.key = 0;
+	cmd.offset = glm::vec3( 0.0f );
+	cmd.scale = glm::vec3( 1.0f );
+	cmd.colour = colour;
+	cmd.mesh = mesh;
+	cmd.flags = flags;
+	cmd.firstInstance = 0;
+	cmd.instanceCount = 1;
+
+	return cmd;
+}
+
+void DrawList::append( const DrawList & other )
+{
+	m_commands.insert( m_commands.end(), other.m_commands.begin(), other.m_commands.end() );
+}
+
+glm::mat4 DrawList::getInstanceTransform( const DrawCommand & cmd, uint32_t instance ) const
+{
+	glm::vec3 pos = cmd.offset + glm::vec3( 0.0f, float( cmd.firstInstance + instance ), 0.0f );
+
+	glm::mat4 M = glm::translate( world, pos );
+	return glm::scale( M, cmd.scale );
+}
+
+size_t DrawList::size() const
+{
+	return m_commands.size();
+}
+
+bool DrawList::empty() const
+{
+	return m_commands.empty();
+}
+
+std::vector<DrawCommand> & DrawList::getCommands()
+{
+	return m_commands;
+}
+
+const std::vector<DrawCommand> & DrawList::getCommands() const
+{
+	return m_commands;
+}
+
+glm::mat4 sceneWorldTransform( size_t dim, float angle, float scale )
+{
+	// First we rotate about the Up-axis at the origin
+	// Then we shift the grid to be center from camera view
+	// Thus we will rotate based on the center of the grid (approx)
+	// Then we scale the outcome
+	glm::mat4 W;
+	W = glm::rotate( W, glm::radians( angle ), glm::vec3( 0.0f, 1.0f, 0.0f ) );
+	W = glm::translate( W, glm::vec3( -float( dim ) / 2.0f, 0, -float( dim ) / 2.0f ) );
+	W = glm::scale( W, glm::vec3( scale, scale, scale ) );
+	return W;
+}
+
+glm::mat4 sceneViewTransform( size_t dim )
+{
+	return glm::lookAt(
+		glm::vec3( 0.0f, float( dim ) * 2.0 * M_SQRT1_2, float( dim ) * 2.0 * M_SQRT1_2 ),
+		glm::vec3( 0.0f, 0.0f, 0.0f ),
+		glm::vec3( 0.0f, 1.0f, 0.0f ) );
+}
+
+glm::mat4 sceneProjection( int width, int height, size_t dim )
+{
+	// The camera sits 2 * dim from the centre of the grid, and the far
+	// corners of the grid, even at twice the scale, are within another
+	// 2 * dim of that.
+	float zFar = std::max( 1000.0f, 4.0f * float( dim ) + 100.0f );
+	return glm::perspective(
+		glm::radians( 45.0f ),
+		float( width ) / float( height ),
+		1.0f, zFar );
+}
+
+void initDefaultPalette( glm::vec3 * palette )
+{
+	palette[0] = glm::vec3( 1.0f, 0.0f, 0.0f );     // Red
+	palette[1] = glm::vec3( 0.0f, 0.74f, 1.0f );    // Blue
+	palette[2] = glm::vec3( 0.13f, 0.54f, 0.13f );  // Green
+	palette[3] = glm::vec3( 1.0f, 0.54f, 0.0f );    // Orange
+	palette[4] = glm::vec3( 1.0f, 1.0f, 0.0f );     // Yellow
+	palette[5] = glm::vec3( 0.54f, 0.0f, 0.54f );   // Purple
+	palette[6] = glm::vec3( 0.0f, 1.0f, 1.0f );     // Cyan
+	palette[7] = glm::vec3( 0.66f, 0.66f, 0.66f );  // Gray
+	palette[8] = glm::vec3( 0.72f, 0.52f, 0.04f );  // Brown
+}
+
+// Gets the window space depth in [0, 1] of a model space point.
+static float windowDepth( const glm::mat4 & clip, const glm::vec3 & pos )
+{
+	glm::vec4 p = clip * glm::vec4( pos, 1.0f );
+	if( p.w <= 0.0f ) {
+		return 0.0f;
+	}
+	return 0.5f * ( p.z / p.w ) + 0.5f;
+}
+
+// Records a fill and a wireframe command for every non-empty column in
+// the rows [rowBegin, rowEnd). 'clip' maps model space to clip space and is
+// used to key the columns front to back.
+static void buildColumns( const SceneState & scene, const glm::mat4 & clip, DrawList & list, size_t rowBegin, size_t rowEnd )
+{
+	const Grid & grid = *scene.grid;
+	const size_t dim = grid.getDim();
+	const glm::vec3 black( 0.0f, 0.0f, 0.0f );
+
+	for( size_t dx = rowBegin; dx < rowEnd; ++dx ) {
+		for( size_t dy = 0; dy < dim; ++dy ) {
+			int height = grid.getHeight( dx, dy );
+			if( height <= 0 ) {
+				continue;
+			}
+
+			int colourIdx = grid.getColour( dx, dy );
+			glm::vec3 offset( float( dx ), 0.0f, float( dy ) );
+			glm::vec3 colour = scene.palette[ colourIdx ];
+			float depth = windowDepth( clip, offset + glm::vec3( 0.5f, 0.5f * height, 0.5f ) );
+
+			DrawCommand & fill = list.add( MESH_CUBE, DRAW_FILL, colour );
+			fill.key = makeSortKey( getRenderPass( fill.flags ), 0, MESH_CUBE, depth, colourIdx + 1 );
+			fill.offset = offset;
+			fill.instanceCount = height;
+
+			DrawCommand & wire = list.add( MESH_CUBE, DRAW_WIREFRAME, black );
+			wire.key = makeSortKey( getRenderPass( wire.flags ), 0, MESH_CUBE, depth, 0 );
+			wire.offset = offset;
+			wire.instanceCount = height;
+		}
+	}
+}
+
+void buildDrawList( const SceneState & scene, DrawList & list, unsigned threads )
+{
+	const size_t dim = scene.grid->getDim();
+
+	list.clear();
+	list.proj = scene.proj;
+	list.view = scene.view;
+	list.world = sceneWorldTransform( dim, scene.angle, scene.scale );
+
+	glm::mat4 clip = list.proj * list.view * list.world;
+
+	// Grid lines
+	DrawCommand & lines = list.add( MESH_GRID_LINES, DRAW_FILL, glm::vec3( 1.0f, 1.0f, 1.0f ) );
+	lines.key = makeSortKey( getRenderPass( lines.flags ), 0, MESH_GRID_LINES, 0.0f, 0 );
+
+	// Cubes, split into row ranges when the grid is large enough to benefit.
+	size_t workers = std::min<size_t>( std::max( threads, 1u ), ( dim + ROWS_PER_THREAD - 1 ) / ROWS_PER_THREAD );
+	if( workers <= 1 ) {
+		buildColumns( scene, clip, list, 0, dim );
+	} else {
+		std::vector<DrawList> partial( workers );
+		std::vector<std::thread> pool;
+
+		size_t rows = ( dim + workers - 1 ) / workers;
+		for( size_t idx = 0; idx < workers; ++idx ) {
+			size_t begin = std::min( dim, idx * rows );
+			size_t end = std::min( dim, begin + rows );
+			pool.push_back( std::thread( buildColumns, std::cref( scene ), std::cref( clip ), std::ref( partial[ idx ] ), begin, end ) );
+		}
+
+		for( size_t idx = 0; idx < workers; ++idx ) {
+			pool[ idx ].join();
+			list.append( partial[ idx ] );
+		}
+	}
+
+	// Active cell marker, drawn over everything.
+	DrawCommand & marker = list.add( MESH_CUBE, DRAW_WIREFRAME | DRAW_NO_DEPTH, glm::vec3( 0.0f, 0.0f, 0.0f ) );
+	marker.offset = glm::vec3( float( scene.activeX ), 0.0f, float( scene.activeY ) );
+	marker.scale = glm::vec3( 1.0f, 6.0f, 1.0f );
+	marker.key = makeSortKey( getRenderPass( marker.flags ), 0, MESH_CUBE, 0.0f, 0 );
+}
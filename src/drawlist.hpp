@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "grid.hpp"
+
+/*
+ * Geometry a draw command refers to. The renderer maps these onto its
+ * vertex arrays, so the list itself never touches GL.
+ */
+enum DrawMesh
+{
+	MESH_GRID_LINES = 0,
+	MESH_CUBE = 1
+};
+
+/*
+ * Fixed function state a command is drawn with.
+ */
+enum DrawFlags
+{
+	DRAW_FILL = 0,
+	DRAW_WIREFRAME = 1 << 0,
+	DRAW_NO_DEPTH = 1 << 1
+};
+
+/*
+ * A single recorded draw. Instances are stacked one unit apart along +y
+ * starting at offset, so a whole column of cubes is one command.
+ */
+struct DrawCommand
+{
+	// Ordering key, see makeSortKey(). Commands are replayed in list order,
+	// so the list is sorted by key before it is drawn.
+	uint64_t key;
+
+	// Model space position and scale of instance zero.
+	glm::vec3 offset;
+	glm::vec3 scale;
+
+	// Value of the colour uniform.
+	glm::vec3 colour;
+
+	uint16_t mesh;
+	uint16_t flags;
+
+	// Range of instances to draw.
+	uint32_t firstInstance;
+	uint32_t instanceCount;
+};
+
+/*
+ * Everything needed to describe one frame of the Stack scene.
+ */
+struct SceneState
+{
+	const Grid * grid;
+	const glm::vec3 * palette;
+
+	glm::mat4 proj;
+	glm::mat4 view;
+
+	// Rotation about the up-axis (degrees) and uniform scale of the grid.
+	float angle;
+	float scale;
+
+	// Active cell marker.
+	int activeX;
+	int activeY;
+};
+
+/*
+ * Compact list of draw commands recorded from a SceneState. Building the
+ * list does not require a GL context, so it may be done on any thread;
+ * replaying it is left to the renderer.
+ */
+class DrawList
+{
+public:
+	DrawList();
+
+	/* Removes all commands. Capacity is kept for the next frame. */
+	void clear();
+
+	/* Appends a command and returns it for further setup. */
+	DrawCommand & add( uint16_t mesh, uint16_t flags, const glm::vec3 & colour );
+
+	/* Appends all of the commands of another list. */
+	void append( const DrawList & other );
+
+	/* Gets the model matrix of an instance of a command. */
+	glm::mat4 getInstanceTransform( const DrawCommand & cmd, uint32_t instance ) const;
+
+	size_t size() const;
+	bool empty() const;
+
+	std::vector<DrawCommand> & getCommands();
+	const std::vector<DrawCommand> & getCommands() const;
+
+	// Per frame uniforms shared by all commands.
+	glm::mat4 proj;
+	glm::mat4 view;
+	glm::mat4 world;
+
+private:
+	std::vector<DrawCommand> m_commands;
+};
+
+/*
+ * Gets the world transform of the grid (rotate, centre then scale).
+ */
+glm::mat4 sceneWorldTransform( size_t dim, float angle, float scale );
+
+/*
+ * Gets the camera transform that frames a grid of the specified dimension.
+ */
+glm::mat4 sceneViewTransform( size_t dim );
+
+/*
+ * Gets the projection for a viewport of the specified size, with a far
+ * plane that covers a grid of the specified dimension.
+ */
+glm::mat4 sceneProjection( int width, int height, size_t dim );
+
+/*
+ * Fills a palette of PALETTE_SIZE entries with the default grid colours.
+ */
+void initDefaultPalette( glm::vec3 * palette );
+
+/*
+ * Records the draw commands for a scene into the list. Rows of large grids
+ * are split across up to 'threads' worker threads.
+ */
+void buildDrawList( const SceneState & scene, DrawList & list, unsigned threads = 1 );
@@ -1,4 +1,9 @@
 #include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
 
 #include "grid.hpp"
 
@@ -55,3 +60,81 @@ void Grid::setColour( int x, int y, int c )
 {
 	m_cols[ y * m_dim + x ] = c;
 }
+
+// Reads the next value of a grid file, skipping comment lines.
+static bool readToken( std::istream & in, std::string & token )
+{
+	while( in >> token ) {
+		if( token[0] != '#' ) {
+			return true;
+		}
+		std::getline( in, token );
+	}
+	return false;
+}
+
+bool Grid::load( const char * path )
+{
+	std::ifstream in( path );
+	std::string token;
+	if( !in || !readToken( in, token ) ) {
+		return false;
+	}
+
+	long dim = std::strtol( token.c_str(), nullptr, 10 );
+	if( dim <= 0 || size_t( dim ) > MAX_GRID_DIM ) {
+		return false;
+	}
+
+	// The header may promise more cells than memory holds, or than the file
+	// goes on to give.
+	size_t sz = size_t( dim ) * size_t( dim );
+	int *heights = new ( std::nothrow ) int[ sz ];
+	int *cols = new ( std::nothrow ) int[ sz ];
+	if( heights == nullptr || cols == nullptr ) {
+		delete [] heights;
+		delete [] cols;
+		return false;
+	}
+
+	bool ok = true;
+	for( size_t idx = 0; idx < sz && ok; ++idx ) {
+		int h = 0;
+		int c = 0;
+		ok = readToken( in, token )
+			&& std::sscanf( token.c_str(), "%d:%d", &h, &c ) == 2
+			&& h >= 0 && c >= 0 && size_t( c ) < PALETTE_SIZE;
+		heights[ idx ] = h;
+		cols[ idx ] = c;
+	}
+
+	if( !ok ) {
+		delete [] heights;
+		delete [] cols;
+		return false;
+	}
+
+	delete [] m_heights;
+	delete [] m_cols;
+	m_dim = dim;
+	m_heights = heights;
+	m_cols = cols;
+	return true;
+}
+
+bool Grid::save( const char * path ) const
+{
+	std::ofstream out( path );
+	if( !out ) {
+		return false;
+	}
+
+	out << m_dim << "\n";
+	for( size_t y = 0; y < m_dim; ++y ) {
+		for( size_t x = 0; x < m_dim; ++x ) {
+			out << ( x == 0 ? "" : " " ) << getHeight( x, y ) << ":" << getColour( x, y );
+		}
+		out << "\n";
+	}
+	return bool( out );
+}
@@ -1,7 +1,27 @@
 #pragma once
 
+#include <cstddef>
+
+// Number of colours a grid cell can index.
+const size_t PALETTE_SIZE = 9;
+
+// Tallest column the editor allows.
+const int MAX_HEIGHT = 5;
+
+// Largest dimension a grid file may have, so that every cell can be
+// addressed with int coordinates and an int index.
+const size_t MAX_GRID_DIM = 16384;
+
 /*
  * Defines the grid.
+ *
+ * Grid files are plain text. Lines starting with '#' are comments. The first
+ * value is the dimension, followed by one line per row y holding a
+ * "height:colour" pair for each x, e.g.
+ *
+ *     2
+ *     0:0 3:1
+ *     1:4 0:0
  */
 class Grid
 {
@@ -30,6 +50,16 @@ public:
 	/*  Sets the colour of a grid at the specified position. */
 	void setColour( int x, int y, int c );
 
+	/*
+	 * Loads a grid file, replacing the dimension and contents. Returns false,
+	 * leaving the grid as it was, if the file is malformed, its dimension is
+	 * above MAX_GRID_DIM or a colour is not below PALETTE_SIZE.
+	 */
+	bool load( const char * path );
+
+	/* Writes the grid to a grid file. */
+	bool save( const char * path ) const;
+
 private:
 	size_t m_dim;
 	int *m_heights;
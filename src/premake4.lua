@@ -28,6 +28,7 @@ if os.get() == "linux" then
         "imgui",
         "glfw3",
         "GL",
+        "EGL",
         "Xinerama",
         "Xcursor",
         "Xxf86vm",
@@ -47,9 +48,41 @@ end
 
 buildOptions = {"-std=c++11"}
 
+-- Compiles in the PROFILE_SCOPE zones of the CPU profiler. Pass the same
+-- option to both builds, e.g. "premake4 --profile gmake".
+newoption {
+    trigger = "profile",
+    description = "Record CPU profiler zones (CS488_PROFILE)"
+}
+
+-- Overrides the GL error checking level, 0 to 2, described in
+-- shared/cs488-framework/GlDebug.hpp. Pass the same option to both builds.
+newoption {
+    trigger = "gl-debug",
+    value = "LEVEL",
+    description = "GL error checking level (CS488_GL_DEBUG_LEVEL)"
+}
+
 solution "CS488-Projects"
     configurations { "Debug", "Release" }
 
+    configuration "Debug"
+        defines { "DEBUG" }
+        flags { "Symbols" }
+
+    configuration "Release"
+        defines { "NDEBUG" }
+        flags { "Optimize" }
+
+    configuration "profile"
+        defines { "CS488_PROFILE" }
+
+    configuration {}
+
+    if _OPTIONS["gl-debug"] then
+        defines { "CS488_GL_DEBUG_LEVEL=" .. _OPTIONS["gl-debug"] }
+    end
+
     project "Stack"
         kind "ConsoleApp"
         language "C++"
@@ -63,10 +96,78 @@ solution "CS488-Projects"
         includedirs (includeDirList)
         files { "*.cpp" }
 
-    configuration "Debug"
-        defines { "DEBUG" }
-        flags { "Symbols" }
+    -- Benchmarks
+    project "SortBench"
+        kind "ConsoleApp"
+        language "C++"
+        location "build"
+        objdir "build/SortBench"
+        targetdir "."
+        buildoptions (buildOptions)
+        includedirs (includeDirList)
+        includedirs { "." }
+        links { "pthread" }
+        files { "bench/SortBench.cpp", "renderqueue.cpp", "drawlist.cpp", "grid.cpp" }
 
-    configuration "Release"
-        defines { "NDEBUG" }
-        flags { "Optimize" }
+    project "RayBench"
+        kind "ConsoleApp"
+        language "C++"
+        location "build"
+        objdir "build/RayBench"
+        targetdir "."
+        buildoptions (buildOptions)
+        includedirs (includeDirList)
+        includedirs { "." }
+        links { "pthread" }
+        files { "bench/RayBench.cpp", "raytracer.cpp", "threadpool.cpp", "drawlist.cpp", "renderqueue.cpp", "grid.cpp" }
+
+    project "EditBench"
+        kind "ConsoleApp"
+        language "C++"
+        location "build"
+        objdir "build/EditBench"
+        targetdir "."
+        buildoptions (buildOptions)
+        libdirs (libDirectories)
+        includedirs (includeDirList)
+        includedirs { "." }
+        links { "cs488-framework", "pthread" }
+        files { "bench/EditBench.cpp", "raytracer.cpp", "threadpool.cpp", "drawlist.cpp", "renderqueue.cpp", "grid.cpp" }
+
+    project "RenderBench"
+        kind "ConsoleApp"
+        language "C++"
+        location "build"
+        objdir "build/RenderBench"
+        targetdir "."
+        buildoptions (buildOptions)
+        libdirs (libDirectories)
+        includedirs (includeDirList)
+        includedirs { "." }
+        links { "cs488-framework", "imgui", "GL", "EGL", "dl", "pthread" }
+        files { "bench/RenderBench.cpp", "scenerenderer.cpp", "softrasteriser.cpp", "raytracer.cpp", "threadpool.cpp", "drawlist.cpp", "renderqueue.cpp", "grid.cpp" }
+
+    project "ObjBench"
+        kind "ConsoleApp"
+        language "C++"
+        location "build"
+        objdir "build/ObjBench"
+        targetdir "."
+        buildoptions (buildOptions)
+        libdirs (libDirectories)
+        includedirs (includeDirList)
+        links { "cs488-framework", "pthread" }
+        files { "bench/ObjBench.cpp" }
+
+    -- Tools
+    project "AssetPacker"
+        kind "ConsoleApp"
+        language "C++"
+        location "build"
+        objdir "build/AssetPacker"
+        targetdir "."
+        buildoptions (buildOptions)
+        libdirs (libDirectories)
+        includedirs (includeDirList)
+        links { "cs488-framework" }
+        files { "tools/AssetPacker.cpp" }
@@ -0,0 +1,609 @@
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "drawlist.hpp"
+#include "raytracer.hpp"
+#include "threadpool.hpp"
+
+// Image tiles handed to the thread pool, in pixels. Tiles are split into
+// 2x2 pixel packets.
+static const int TILE_SIZE = 16;
+
+// Distance rays start from a surface, to avoid hitting it again.
+static const float SURFACE_OFFSET = 1e-3f;
+
+// Half width of the dark edges drawn where cube faces meet, in cells.
+static const float EDGE_WIDTH = 0.02f;
+
+// Lighting
+static const float AMBIENT = 0.45f;
+static const float SUN = 0.7f;
+
+// Directions closer to zero than this are nudged to keep slabs finite.
+static const float MIN_DIRECTION = 1e-8f;
+
+//---------------------------------------------------------------------------
+// Four wide float maths, SSE2 or scalar.
+
+#if defined(__SSE2__)
+struct Float4
+{
+	__m128 v;
+
+	Float4() {}
+	Float4( __m128 value ) : v( value ) {}
+	explicit Float4( float value ) : v( _mm_set1_ps( value ) ) {}
+	Float4( float a, float b, float c, float d ) : v( _mm_setr_ps( a, b, c, d ) ) {}
+};
+
+static inline Float4 operator+( Float4 a, Float4 b ) { return _mm_add_ps( a.v, b.v ); }
+static inline Float4 operator-( Float4 a, Float4 b ) { return _mm_sub_ps( a.v, b.v ); }
+static inline Float4 operator*( Float4 a, Float4 b ) { return _mm_mul_ps( a.v, b.v ); }
+static inline Float4 vmin( Float4 a, Float4 b ) { return _mm_min_ps( a.v, b.v ); }
+static inline Float4 vmax( Float4 a, Float4 b ) { return _mm_max_ps( a.v, b.v ); }
+static inline Float4 operator<=( Float4 a, Float4 b ) { return _mm_cmple_ps( a.v, b.v ); }
+static inline Float4 operator<( Float4 a, Float4 b ) { return _mm_cmplt_ps( a.v, b.v ); }
+static inline Float4 operator==( Float4 a, Float4 b ) { return _mm_cmpeq_ps( a.v, b.v ); }
+static inline Float4 operator&( Float4 a, Float4 b ) { return _mm_and_ps( a.v, b.v ); }
+static inline Float4 andNot( Float4 a, Float4 b ) { return _mm_andnot_ps( b.v, a.v ); }
+static inline unsigned mask( Float4 a ) { return unsigned( _mm_movemask_ps( a.v ) ); }
+static inline Float4 select( Float4 m, Float4 a, Float4 b ) { return _mm_or_ps( _mm_and_ps( m.v, a.v ), _mm_andnot_ps( m.v, b.v ) ); }
+static inline float lane( Float4 a, unsigned idx ) { float out[ 4 ]; _mm_storeu_ps( out, a.v ); return out[ idx ]; }
+#else
+struct Float4
+{
+	float v[ 4 ];
+
+	Float4() {}
+	explicit Float4( float value ) { v[ 0 ] = v[ 1 ] = v[ 2 ] = v[ 3 ] = value; }
+	Float4( float a, float b, float c, float d ) { v[ 0 ] = a; v[ 1 ] = b; v[ 2 ] = c; v[ 3 ] = d; }
+};
+
+// Comparisons give all bits set (as a float) for true lanes, like SSE.
+static inline float maskBits( bool value ) { union { uint32_t u; float f; } bits; bits.u = value ? ~0u : 0u; return bits.f; }
+static inline uint32_t floatBits( float value ) { union { uint32_t u; float f; } bits; bits.f = value; return bits.u; }
+
+#define FLOAT4_OP( name, expr ) \
+	static inline Float4 name( Float4 a, Float4 b ) { Float4 r; for( int i = 0; i < 4; ++i ) { float x = a.v[ i ], y = b.v[ i ]; r.v[ i ] = ( expr ); } return r; }
+FLOAT4_OP( operator+, x + y )
+FLOAT4_OP( operator-, x - y )
+FLOAT4_OP( operator*, x * y )
+FLOAT4_OP( vmin, std::min( x, y ) )
+FLOAT4_OP( vmax, std::max( x, y ) )
+FLOAT4_OP( operator<=, maskBits( x <= y ) )
+FLOAT4_OP( operator<, maskBits( x < y ) )
+FLOAT4_OP( operator==, maskBits( x == y ) )
+FLOAT4_OP( operator&, maskBits( ( floatBits( x ) & floatBits( y ) ) != 0 ) )
+FLOAT4_OP( andNot, maskBits( ( floatBits( x ) & ~floatBits( y ) ) != 0 ) )
+#undef FLOAT4_OP
+
+static inline unsigned mask( Float4 a ) { unsigned m = 0; for( int i = 0; i < 4; ++i ) { m |= ( floatBits( a.v[ i ] ) >> 31 ) << i; } return m; }
+static inline Float4 select( Float4 m, Float4 a, Float4 b ) { Float4 r; for( int i = 0; i < 4; ++i ) { r.v[ i ] = floatBits( m.v[ i ] ) ? a.v[ i ] : b.v[ i ]; } return r; }
+static inline float lane( Float4 a, unsigned idx ) { return a.v[ idx ]; }
+#endif
+
+//---------------------------------------------------------------------------
+
+// Small, fast hash based generator. Seeded per pixel so images do not
+// depend on the thread count.
+struct Random
+{
+	uint32_t state;
+
+	explicit Random( uint32_t seed ) : state( seed * 747796405u + 2891336453u ) {}
+
+	float next()
+	{
+		state = state * 747796405u + 2891336453u;
+		uint32_t word = ( ( state >> ( ( state >> 28u ) + 4u ) ) ^ state ) * 277803737u;
+		word = ( word >> 22u ) ^ word;
+		return float( word >> 8 ) * ( 1.0f / 16777216.0f );
+	}
+};
+
+// Keeps slab maths finite for axis aligned rays
+static float safeInverse( float d )
+{
+	if( std::fabs( d ) < MIN_DIRECTION ) {
+		d = d < 0.0f ? -MIN_DIRECTION : MIN_DIRECTION;
+	}
+	return 1.0f / d;
+}
+
+// Builds two tangents perpendicular to a unit vector
+static void makeBasis( const glm::vec3 & n, glm::vec3 & t, glm::vec3 & b )
+{
+	glm::vec3 up = std::fabs( n.y ) < 0.9f ? glm::vec3( 0.0f, 1.0f, 0.0f ) : glm::vec3( 1.0f, 0.0f, 0.0f );
+	t = glm::normalize( glm::cross( up, n ) );
+	b = glm::cross( n, t );
+}
+
+// Distance from the fractional part of v to the nearest integer
+static float edgeDistance( float v )
+{
+	float f = v - std::floor( v );
+	return std::min( f, 1.0f - f );
+}
+
+static uint32_t packColour( const glm::vec3 & colour )
+{
+	uint32_t rgba = 0xff000000u;
+	for( int c = 0; c < 3; ++c ) {
+		float v = std::min( std::max( colour[ c ], 0.0f ), 1.0f );
+		rgba |= uint32_t( std::lrint( v * 255.0f ) ) << ( c * 8 );
+	}
+	return rgba;
+}
+
+RayTraceSettings::RayTraceSettings()
+	: aoSamples( 16 ),
+	aoDistance( 4.0f ),
+	shadowSamples( 8 ),
+	lightDir( glm::normalize( glm::vec3( -0.4f, 1.0f, 0.3f ) ) ),
+	lightRadius( 0.05f ),
+	background( 0.3f, 0.5f, 0.7f )
+{
+}
+
+RayTracer::RayTracer()
+	: m_dim( 0 ),
+	m_lightDir( 0.0f, 1.0f, 0.0f ),
+	m_width( 0 ),
+	m_height( 0 )
+{
+}
+
+void RayTracer::setSettings( const RayTraceSettings & settings )
+{
+	m_settings = settings;
+}
+
+const RayTraceSettings & RayTracer::getSettings() const
+{
+	return m_settings;
+}
+
+int RayTracer::getWidth() const
+{
+	return m_width;
+}
+
+int RayTracer::getHeight() const
+{
+	return m_height;
+}
+
+void RayTracer::setScene( const Grid & grid, const glm::vec3 * palette )
+{
+	m_dim = int( grid.getDim() );
+	m_palette.assign( palette, palette + PALETTE_SIZE );
+
+	m_levels.clear();
+	m_levelDims.clear();
+
+	std::vector<float> heights( size_t( m_dim ) * m_dim );
+	m_colours.resize( heights.size() );
+	for( int z = 0; z < m_dim; ++z ) {
+		for( int x = 0; x < m_dim; ++x ) {
+			heights[ z * m_dim + x ] = float( std::max( grid.getHeight( x, z ), 0 ) );
+			m_colours[ z * m_dim + x ] = uint8_t( std::min<size_t>( grid.getColour( x, z ), PALETTE_SIZE - 1 ) );
+		}
+	}
+	m_levels.push_back( heights );
+	m_levelDims.push_back( m_dim );
+
+	// Each level keeps the maximum of 2x2 cells of the one below
+	while( m_levelDims.back() > 1 ) {
+		const std::vector<float> & below = m_levels.back();
+		int belowDim = m_levelDims.back();
+		int dim = ( belowDim + 1 ) / 2;
+
+		std::vector<float> level( size_t( dim ) * dim, 0.0f );
+		for( int z = 0; z < belowDim; ++z ) {
+			for( int x = 0; x < belowDim; ++x ) {
+				float & cell = level[ ( z / 2 ) * dim + x / 2 ];
+				cell = std::max( cell, below[ z * belowDim + x ] );
+			}
+		}
+
+		m_levels.push_back( level );
+		m_levelDims.push_back( dim );
+	}
+}
+
+void RayTracer::setCamera( const glm::mat4 & proj, const glm::mat4 & view, const glm::mat4 & world, int width, int height )
+{
+	m_invClip = glm::inverse( proj * view * world );
+	m_width = width;
+	m_height = height;
+
+	// The sun is given in world space, shading happens in grid space
+	m_lightDir = glm::normalize( glm::inverse( glm::mat3( world ) ) * m_settings.lightDir );
+}
+
+void RayTracer::getCameraRay( int x, int y, glm::vec3 & origin, glm::vec3 & dir ) const
+{
+	float nx = ( float( x ) + 0.5f ) / float( m_width ) * 2.0f - 1.0f;
+	float ny = ( float( y ) + 0.5f ) / float( m_height ) * 2.0f - 1.0f;
+
+	glm::vec4 nearPoint = m_invClip * glm::vec4( nx, ny, -1.0f, 1.0f );
+	glm::vec4 farPoint = m_invClip * glm::vec4( nx, ny, 1.0f, 1.0f );
+
+	origin = glm::vec3( nearPoint ) / nearPoint.w;
+	dir = glm::normalize( glm::vec3( farPoint ) / farPoint.w - origin );
+}
+
+float RayTracer::getHeight( int level, int x, int z ) const
+{
+	return m_levels[ level ][ z * m_levelDims[ level ] + x ];
+}
+
+bool RayTracer::intersect( const glm::vec3 & origin, const glm::vec3 & dir, float tMax, RayHit & hit ) const
+{
+	return traverse( origin, dir, tMax, &hit );
+}
+
+bool RayTracer::occluded( const glm::vec3 & origin, const glm::vec3 & dir, float tMax ) const
+{
+	return traverse( origin, dir, tMax, nullptr );
+}
+
+unsigned RayTracer::intersect4( const glm::vec3 * origin, const glm::vec3 * dir, float tMax, RayHit * hit ) const
+{
+	return traverse4( origin, dir, tMax, hit );
+}
+
+unsigned RayTracer::occluded4( const glm::vec3 * origin, const glm::vec3 * dir, float tMax ) const
+{
+	return traverse4( origin, dir, tMax, nullptr );
+}
+
+bool RayTracer::traverse( const glm::vec3 & origin, const glm::vec3 & dir, float tMax, RayHit * hit ) const
+{
+	if( m_dim == 0 ) {
+		return false;
+	}
+
+	const int top = int( m_levels.size() ) - 1;
+	const float maxHeight = m_levels[ top ][ 0 ];
+	const glm::vec3 inv( safeInverse( dir.x ), safeInverse( dir.y ), safeInverse( dir.z ) );
+
+	// Clip the ray to the bounds of the grid
+	glm::vec3 lo = ( glm::vec3( 0.0f ) - origin ) * inv;
+	glm::vec3 hi = ( glm::vec3( float( m_dim ), maxHeight, float( m_dim ) ) - origin ) * inv;
+	glm::vec3 tNear = glm::min( lo, hi );
+	glm::vec3 tFar = glm::max( lo, hi );
+
+	float t = std::max( std::max( tNear.x, tNear.z ), std::max( tNear.y, 0.0f ) );
+	float tEnd = std::min( std::min( tFar.x, tFar.z ), std::min( tFar.y, tMax ) );
+	if( t > tEnd ) {
+		return false;
+	}
+
+	// Axis of the last boundary crossed, for the normal of the hit
+	int axis = t == tNear.y ? 1 : ( t == tNear.x ? 0 : 2 );
+
+	int level = 0;
+	while( t < tEnd ) {
+		// Cell containing the ray just past t, at the current level. The
+		// step must stay above float precision at the distance of t.
+		float epsilon = 1e-5f + t * 1e-6f;
+		float probe = t + epsilon;
+		int size = 1 << level;
+		int cx = std::min( std::max( int( std::floor( origin.x + dir.x * probe ) ), 0 ), m_dim - 1 ) >> level;
+		int cz = std::min( std::max( int( std::floor( origin.z + dir.z * probe ) ), 0 ), m_dim - 1 ) >> level;
+
+		// Where the ray leaves the cell
+		float bx = float( dir.x > 0.0f ? ( cx + 1 ) * size : cx * size );
+		float bz = float( dir.z > 0.0f ? ( cz + 1 ) * size : cz * size );
+		float tx = ( bx - origin.x ) * inv.x;
+		float tz = ( bz - origin.z ) * inv.z;
+		float tExit = std::min( std::min( tx, tz ), tEnd );
+		if( tExit <= t ) {
+			tExit = probe;
+		}
+
+		float height = getHeight( level, cx, cz );
+		float y0 = origin.y + dir.y * t;
+		float y1 = origin.y + dir.y * tExit;
+
+		if( std::min( y0, y1 ) >= height ) {
+			// Clear of the whole block: move on and try a coarser level
+			t = tExit;
+			axis = tx <= tz ? 0 : 2;
+			level = std::min( level + 1, top );
+			continue;
+		}
+
+		if( level > 0 ) {
+			--level;
+			continue;
+		}
+
+		// The ray dips below the column top within this cell
+		float tHit = t;
+		glm::vec3 normal;
+		if( y0 <= height ) {
+			if( axis == 0 ) {
+				normal = glm::vec3( dir.x > 0.0f ? -1.0f : 1.0f, 0.0f, 0.0f );
+			} else if( axis == 1 ) {
+				normal = glm::vec3( 0.0f, 1.0f, 0.0f );
+			} else {
+				normal = glm::vec3( 0.0f, 0.0f, dir.z > 0.0f ? -1.0f : 1.0f );
+			}
+		} else {
+			tHit = ( height - origin.y ) * inv.y;
+			normal = glm::vec3( 0.0f, 1.0f, 0.0f );
+		}
+
+		if( hit != nullptr ) {
+			hit->t = tHit;
+			hit->normal = normal;
+			hit->x = cx;
+			hit->z = cz;
+		}
+		return true;
+	}
+
+	return false;
+}
+
+unsigned RayTracer::traverse4( const glm::vec3 * origin, const glm::vec3 * dir, float tMax, RayHit * hit ) const
+{
+	if( m_dim == 0 ) {
+		return 0;
+	}
+
+	Float4 ox( origin[ 0 ].x, origin[ 1 ].x, origin[ 2 ].x, origin[ 3 ].x );
+	Float4 oy( origin[ 0 ].y, origin[ 1 ].y, origin[ 2 ].y, origin[ 3 ].y );
+	Float4 oz( origin[ 0 ].z, origin[ 1 ].z, origin[ 2 ].z, origin[ 3 ].z );
+	Float4 ix( safeInverse( dir[ 0 ].x ), safeInverse( dir[ 1 ].x ), safeInverse( dir[ 2 ].x ), safeInverse( dir[ 3 ].x ) );
+	Float4 iy( safeInverse( dir[ 0 ].y ), safeInverse( dir[ 1 ].y ), safeInverse( dir[ 2 ].y ), safeInverse( dir[ 3 ].y ) );
+	Float4 iz( safeInverse( dir[ 0 ].z ), safeInverse( dir[ 1 ].z ), safeInverse( dir[ 2 ].z ), safeInverse( dir[ 3 ].z ) );
+
+	const Float4 zero( 0.0f );
+	Float4 best( tMax );
+	Float4 activeMask = zero == zero;
+	unsigned active = 0xf;
+	unsigned hits = 0;
+
+	// Children are visited nearest first, going by the first ray
+	const int nearX = dir[ 0 ].x >= 0.0f ? 0 : 1;
+	const int nearZ = dir[ 0 ].z >= 0.0f ? 0 : 1;
+
+	struct Node
+	{
+		int level, x, z;
+	};
+	Node stack[ 4 * 32 ];
+	int depth = 0;
+	stack[ depth++ ] = { int( m_levels.size() ) - 1, 0, 0 };
+	if( m_levels.back()[ 0 ] <= 0.0f ) {
+		return 0;
+	}
+
+	while( depth > 0 ) {
+		Node node = stack[ --depth ];
+		float height = getHeight( node.level, node.x, node.z );
+
+		// Bounds of the block: every column under it fits in [0, height]
+		float x0 = float( node.x << node.level );
+		float z0 = float( node.z << node.level );
+		float x1 = std::min( float( ( node.x + 1 ) << node.level ), float( m_dim ) );
+		float z1 = std::min( float( ( node.z + 1 ) << node.level ), float( m_dim ) );
+
+		Float4 ax = ( Float4( x0 ) - ox ) * ix, bx = ( Float4( x1 ) - ox ) * ix;
+		Float4 ay = ( zero - oy ) * iy, by = ( Float4( height ) - oy ) * iy;
+		Float4 az = ( Float4( z0 ) - oz ) * iz, bz = ( Float4( z1 ) - oz ) * iz;
+
+		Float4 nx = vmin( ax, bx ), ny = vmin( ay, by ), nz = vmin( az, bz );
+		Float4 tNear = vmax( vmax( nx, nz ), vmax( ny, zero ) );
+		Float4 tFar = vmin( vmin( vmax( ax, bx ), vmax( az, bz ) ), vmin( vmax( ay, by ), best ) );
+
+		unsigned inside = mask( tNear <= tFar ) & active;
+		if( inside == 0 ) {
+			continue;
+		}
+
+		if( node.level > 0 ) {
+			int level = node.level - 1;
+			int dim = m_levelDims[ level ];
+
+			// Push far to near so the nearest child is visited first
+			for( int idx = 3; idx >= 0; --idx ) {
+				int cx = node.x * 2 + ( ( idx & 1 ) ^ nearX );
+				int cz = node.z * 2 + ( ( idx >> 1 ) ^ nearZ );
+				if( cx < dim && cz < dim && getHeight( level, cx, cz ) > 0.0f ) {
+					stack[ depth++ ] = { level, cx, cz };
+				}
+			}
+			continue;
+		}
+
+		// A column: the entry point is the hit
+		Float4 entered = ( tNear <= tFar ) & activeMask;
+		hits |= inside;
+
+		if( hit == nullptr ) {
+			active &= ~inside;
+			activeMask = andNot( activeMask, entered );
+			if( active == 0 ) {
+				break;
+			}
+			continue;
+		}
+
+		best = select( entered, tNear, best );
+
+		unsigned onX = mask( tNear == nx );
+		unsigned onY = mask( tNear == ny );
+		for( unsigned l = 0; l < 4; ++l ) {
+			if( ( inside & ( 1u << l ) ) == 0 ) {
+				continue;
+			}
+
+			RayHit & h = hit[ l ];
+			h.t = lane( tNear, l );
+			h.x = node.x;
+			h.z = node.z;
+			if( onY & ( 1u << l ) ) {
+				h.normal = glm::vec3( 0.0f, dir[ l ].y > 0.0f ? -1.0f : 1.0f, 0.0f );
+			} else if( onX & ( 1u << l ) ) {
+				h.normal = glm::vec3( dir[ l ].x > 0.0f ? -1.0f : 1.0f, 0.0f, 0.0f );
+			} else {
+				h.normal = glm::vec3( 0.0f, 0.0f, dir[ l ].z > 0.0f ? -1.0f : 1.0f );
+			}
+		}
+	}
+
+	return hits;
+}
+
+void RayTracer::render( ThreadPool & pool )
+{
+	m_image.resize( size_t( m_width ) * size_t( m_height ) );
+
+	int tilesX = ( m_width + TILE_SIZE - 1 ) / TILE_SIZE;
+	int tilesY = ( m_height + TILE_SIZE - 1 ) / TILE_SIZE;
+
+	pool.run( size_t( tilesX * tilesY ), [this]( size_t tile ) {
+		renderTile( tile );
+	} );
+}
+
+void RayTracer::readPixels( std::vector<unsigned char> & rgb ) const
+{
+	rgb.resize( m_image.size() * 3 );
+
+	unsigned char * out = rgb.data();
+	for( uint32_t pixel : m_image ) {
+		*out++ = pixel & 0xff;
+		*out++ = ( pixel >> 8 ) & 0xff;
+		*out++ = ( pixel >> 16 ) & 0xff;
+	}
+}
+
+void RayTracer::renderTile( size_t tile )
+{
+	int tilesX = ( m_width + TILE_SIZE - 1 ) / TILE_SIZE;
+	int x0 = int( tile % tilesX ) * TILE_SIZE;
+	int y0 = int( tile / tilesX ) * TILE_SIZE;
+	int x1 = std::min( x0 + TILE_SIZE, m_width );
+	int y1 = std::min( y0 + TILE_SIZE, m_height );
+
+	glm::vec3 origin[ 4 ], dir[ 4 ];
+	RayHit hit[ 4 ];
+
+	// Trace 2x2 pixel packets. Lanes past the edge of the image repeat the
+	// last pixel and are not written.
+	for( int y = y0; y < y1; y += 2 ) {
+		for( int x = x0; x < x1; x += 2 ) {
+			int px[ 4 ], py[ 4 ];
+			for( unsigned l = 0; l < 4; ++l ) {
+				px[ l ] = std::min( x + int( l & 1 ), x1 - 1 );
+				py[ l ] = std::min( y + int( l >> 1 ), y1 - 1 );
+				getCameraRay( px[ l ], py[ l ], origin[ l ], dir[ l ] );
+			}
+
+			unsigned hits = intersect4( origin, dir, 1e30f, hit );
+
+			for( unsigned l = 0; l < 4; ++l ) {
+				if( px[ l ] != x + int( l & 1 ) || py[ l ] != y + int( l >> 1 ) ) {
+					continue;
+				}
+
+				uint32_t seed = uint32_t( py[ l ] * m_width + px[ l ] );
+				glm::vec3 colour = shade( seed, origin[ l ], dir[ l ], ( hits & ( 1u << l ) ) ? &hit[ l ] : nullptr );
+				m_image[ size_t( py[ l ] ) * m_width + px[ l ] ] = packColour( colour );
+			}
+		}
+	}
+}
+
+glm::vec3 RayTracer::shade( uint32_t seed, const glm::vec3 & origin, const glm::vec3 & dir, const RayHit * hit ) const
+{
+	glm::vec3 base;
+	glm::vec3 normal( 0.0f, 1.0f, 0.0f );
+	glm::vec3 p;
+
+	if( hit != nullptr ) {
+		p = origin + dir * hit->t;
+		normal = hit->normal;
+		base = m_palette[ m_colours[ hit->z * m_dim + hit->x ] ];
+
+		// Outline each cube like the wireframe pass does
+		float u = normal.x != 0.0f ? p.z : p.x;
+		float v = normal.y != 0.0f ? p.z : p.y;
+		if( edgeDistance( u ) < EDGE_WIDTH || edgeDistance( v ) < EDGE_WIDTH ) {
+			return glm::vec3( 0.0f );
+		}
+	} else if( dir.y < 0.0f ) {
+		// Ground plane, with the grid lines around the cells
+		p = origin - dir * ( origin.y / dir.y );
+		float limit = float( m_dim + 1 );
+		if( p.x < -1.0f || p.z < -1.0f || p.x > limit || p.z > limit ) {
+			return m_settings.background;
+		}
+
+		bool line = edgeDistance( p.x ) < EDGE_WIDTH || edgeDistance( p.z ) < EDGE_WIDTH;
+		base = line ? glm::vec3( 1.0f ) : m_settings.background;
+	} else {
+		return m_settings.background;
+	}
+
+	Random random( seed );
+	glm::vec3 start = p + normal * SURFACE_OFFSET;
+	glm::vec3 tangent, bitangent;
+
+	// Ambient occlusion, cosine weighted and stratified over the hemisphere
+	float ambient = 1.0f;
+	if( m_settings.aoSamples > 0 ) {
+		makeBasis( normal, tangent, bitangent );
+
+		unsigned open = 0;
+		for( unsigned idx = 0; idx < m_settings.aoSamples; ++idx ) {
+			float u = ( float( idx ) + random.next() ) / float( m_settings.aoSamples );
+			float phi = 6.28318531f * random.next();
+			float r = std::sqrt( u );
+
+			glm::vec3 d = tangent * ( r * std::cos( phi ) ) + bitangent * ( r * std::sin( phi ) ) + normal * std::sqrt( 1.0f - u );
+			if( !occluded( start, d, m_settings.aoDistance ) ) {
+				++open;
+			}
+		}
+		ambient = float( open ) / float( m_settings.aoSamples );
+	}
+
+	// Soft shadows: rays to random points on the sun's disc, four at a time
+	float direct = std::max( glm::dot( normal, m_lightDir ), 0.0f );
+	if( direct > 0.0f && m_settings.shadowSamples > 0 ) {
+		makeBasis( m_lightDir, tangent, bitangent );
+
+		glm::vec3 origins[ 4 ] = { start, start, start, start };
+		glm::vec3 dirs[ 4 ];
+		unsigned lit = 0;
+
+		for( unsigned idx = 0; idx < m_settings.shadowSamples; idx += 4 ) {
+			unsigned count = std::min( 4u, m_settings.shadowSamples - idx );
+			for( unsigned l = 0; l < 4; ++l ) {
+				float r = m_settings.lightRadius * std::sqrt( random.next() );
+				float phi = 6.28318531f * random.next();
+				dirs[ l ] = glm::normalize( m_lightDir + tangent * ( r * std::cos( phi ) ) + bitangent * ( r * std::sin( phi ) ) );
+			}
+
+			unsigned blocked = occluded4( origins, dirs, 1e30f );
+			for( unsigned l = 0; l < count; ++l ) {
+				lit += ( blocked & ( 1u << l ) ) ? 0 : 1;
+			}
+		}
+		direct *= float( lit ) / float( m_settings.shadowSamples );
+	}
+
+	return base * ( AMBIENT * ambient + SUN * direct );
+}
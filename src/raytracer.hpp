@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "grid.hpp"
+
+class ThreadPool;
+
+/*
+ * Quality settings of a ray traced image.
+ */
+struct RayTraceSettings
+{
+	// Ambient occlusion rays per pixel and how far they look for occluders,
+	// in cells.
+	unsigned aoSamples;
+	float aoDistance;
+
+	// Shadow rays per pixel, towards a sun of angular radius lightRadius
+	// (radians) in world space direction lightDir.
+	unsigned shadowSamples;
+	glm::vec3 lightDir;
+	float lightRadius;
+
+	glm::vec3 background;
+
+	RayTraceSettings();
+};
+
+/*
+ * Closest intersection of a ray with the grid columns.
+ */
+struct RayHit
+{
+	float t;
+
+	// Outward normal of the face that was hit
+	glm::vec3 normal;
+
+	// Column that was hit
+	int x;
+	int z;
+};
+
+/*
+ * Ray tracer specialised for the Grid heightfield, for offline renders with
+ * ambient occlusion and soft shadows.
+ *
+ * Rays are traced in grid space, where column (x, z) is the box
+ * [x, x+1] x [0, height] x [z, z+1]. A max-mip pyramid stores the tallest
+ * column under each 2^n x 2^n block of cells. Primary and shadow rays are
+ * traced four at a time with SSE2, descending the pyramid as a quadtree and
+ * skipping any block all four rays pass over. Ambient occlusion rays are
+ * short and incoherent, so they walk the pyramid one ray at a time with a
+ * 2D DDA that climbs a level whenever a block is cleared and descends when
+ * the ray dips below the block's height.
+ */
+class RayTracer
+{
+public:
+	RayTracer();
+
+	void setSettings( const RayTraceSettings & settings );
+	const RayTraceSettings & getSettings() const;
+
+	/* Copies the heights and colours of a grid and builds the max-mip pyramid. */
+	void setScene( const Grid & grid, const glm::vec3 * palette );
+
+	/* Sets the camera from the same matrices the draw list uses. */
+	void setCamera( const glm::mat4 & proj, const glm::mat4 & view, const glm::mat4 & world, int width, int height );
+
+	/* Gets the grid space ray through the centre of a pixel. */
+	void getCameraRay( int x, int y, glm::vec3 & origin, glm::vec3 & dir ) const;
+
+	/* Renders the image, splitting it into tiles across the pool. */
+	void render( ThreadPool & pool );
+
+	/* Gets the image as RGB bytes, rows bottom to top like glReadPixels. */
+	void readPixels( std::vector<unsigned char> & rgb ) const;
+
+	/* Finds the closest column hit within (0, tMax] one ray at a time. */
+	bool intersect( const glm::vec3 & origin, const glm::vec3 & dir, float tMax, RayHit & hit ) const;
+
+	/* Finds the closest column hits of four rays at once. Returns a bit mask
+	 * of the rays that hit something. */
+	unsigned intersect4( const glm::vec3 * origin, const glm::vec3 * dir, float tMax, RayHit * hit ) const;
+
+	/* Returns true if anything lies within (0, tMax] along the ray. */
+	bool occluded( const glm::vec3 & origin, const glm::vec3 & dir, float tMax ) const;
+
+	/* Returns a bit mask of which of four rays are occluded within tMax. */
+	unsigned occluded4( const glm::vec3 * origin, const glm::vec3 * dir, float tMax ) const;
+
+	int getWidth() const;
+	int getHeight() const;
+
+private:
+	bool traverse( const glm::vec3 & origin, const glm::vec3 & dir, float tMax, RayHit * hit ) const;
+	unsigned traverse4( const glm::vec3 * origin, const glm::vec3 * dir, float tMax, RayHit * hit ) const;
+
+	float getHeight( int level, int x, int z ) const;
+
+	void renderTile( size_t tile );
+	glm::vec3 shade( uint32_t seed, const glm::vec3 & origin, const glm::vec3 & dir, const RayHit * hit ) const;
+
+	RayTraceSettings m_settings;
+
+	// Grid
+	int m_dim;
+	std::vector<uint8_t> m_colours;
+	std::vector<glm::vec3> m_palette;
+
+	// Max-mip pyramid, level 0 being the column heights. Level n has
+	// m_levelDims[ n ] cells per side; the last level is a single cell.
+	std::vector<std::vector<float> > m_levels;
+	std::vector<int> m_levelDims;
+
+	// Camera, and the sun direction in grid space
+	glm::mat4 m_invClip;
+	glm::vec3 m_lightDir;
+	int m_width;
+	int m_height;
+
+	std::vector<uint32_t> m_image;
+};
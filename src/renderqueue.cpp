@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <cstring>
+
+#include "renderqueue.hpp"
+
+// Bits available to each key field.
+static const unsigned PASS_BITS = 4;
+static const unsigned PROGRAM_BITS = 8;
+static const unsigned MESH_BITS = 8;
+static const unsigned DEPTH_BITS = 24;
+static const unsigned MATERIAL_BITS = 20;
+
+static const unsigned MATERIAL_SHIFT = 0;
+static const unsigned DEPTH_SHIFT = MATERIAL_SHIFT + MATERIAL_BITS;
+static const unsigned MESH_SHIFT = DEPTH_SHIFT + DEPTH_BITS;
+static const unsigned PROGRAM_SHIFT = MESH_SHIFT + MESH_BITS;
+static const unsigned PASS_SHIFT = PROGRAM_SHIFT + PROGRAM_BITS;
+
+static uint64_t field( uint64_t value, unsigned bits, unsigned shift )
+{
+	return ( value & ( ( uint64_t( 1 ) << bits ) - 1 ) ) << shift;
+}
+
+uint64_t makeSortKey( unsigned pass, unsigned program, unsigned mesh, float depth, unsigned material )
+{
+	// Depth is expected in [0, 1], anything outside is clamped.
+	depth = std::min( std::max( depth, 0.0f ), 1.0f );
+	uint64_t quantised = uint64_t( depth * float( ( 1u << DEPTH_BITS ) - 1 ) );
+
+	return field( pass, PASS_BITS, PASS_SHIFT )
+		| field( program, PROGRAM_BITS, PROGRAM_SHIFT )
+		| field( mesh, MESH_BITS, MESH_SHIFT )
+		| field( quantised, DEPTH_BITS, DEPTH_SHIFT )
+		| field( material, MATERIAL_BITS, MATERIAL_SHIFT );
+}
+
+unsigned getRenderPass( unsigned flags )
+{
+	if( flags & DRAW_NO_DEPTH ) {
+		return PASS_OVERLAY;
+	}
+	if( flags & DRAW_WIREFRAME ) {
+		return PASS_WIREFRAME;
+	}
+	return PASS_OPAQUE;
+}
+
+void radixSort( uint64_t * keys, uint32_t * values, uint64_t * tmpKeys, uint32_t * tmpValues, size_t count )
+{
+	const unsigned DIGITS = 8;
+	const unsigned RADIX = 256;
+
+	// Histogram every digit in a single pass over the keys.
+	size_t counts[ DIGITS ][ RADIX ];
+	std::memset( counts, 0, sizeof( counts ) );
+
+	for( size_t idx = 0; idx < count; ++idx ) {
+		uint64_t key = keys[ idx ];
+		for( unsigned d = 0; d < DIGITS; ++d ) {
+			++counts[ d ][ ( key >> ( d * 8 ) ) & 0xff ];
+		}
+	}
+
+	uint64_t * srcKeys = keys;
+	uint32_t * srcValues = values;
+	uint64_t * dstKeys = tmpKeys;
+	uint32_t * dstValues = tmpValues;
+
+	for( unsigned d = 0; d < DIGITS; ++d ) {
+		size_t * hist = counts[ d ];
+
+		// A digit shared by every key would not move anything.
+		if( count == 0 || hist[ ( srcKeys[ 0 ] >> ( d * 8 ) ) & 0xff ] == count ) {
+			continue;
+		}
+
+		// Exclusive prefix sum gives the first output slot of each bucket.
+		size_t offset = 0;
+		for( unsigned b = 0; b < RADIX; ++b ) {
+			size_t n = hist[ b ];
+			hist[ b ] = offset;
+			offset += n;
+		}
+
+		for( size_t idx = 0; idx < count; ++idx ) {
+			uint64_t key = srcKeys[ idx ];
+			size_t slot = hist[ ( key >> ( d * 8 ) ) & 0xff ]++;
+			dstKeys[ slot ] = key;
+			dstValues[ slot ] = srcValues[ idx ];
+		}
+
+		std::swap( srcKeys, dstKeys );
+		std::swap( srcValues, dstValues );
+	}
+
+	// An odd number of scatter passes leaves the result in the tmp arrays.
+	if( srcKeys != keys ) {
+		std::memcpy( keys, srcKeys, count * sizeof( uint64_t ) );
+		std::memcpy( values, srcValues, count * sizeof( uint32_t ) );
+	}
+}
+
+RenderQueue::RenderQueue()
+{
+}
+
+void RenderQueue::sort( DrawList & list )
+{
+	std::vector<DrawCommand> & commands = list.getCommands();
+	const size_t count = commands.size();
+
+	m_keys.resize( count );
+	m_tmpKeys.resize( count );
+	m_values.resize( count );
+	m_tmpValues.resize( count );
+
+	for( size_t idx = 0; idx < count; ++idx ) {
+		m_keys[ idx ] = commands[ idx ].key;
+		m_values[ idx ] = uint32_t( idx );
+	}
+
+	radixSort( m_keys.data(), m_values.data(), m_tmpKeys.data(), m_tmpValues.data(), count );
+
+	m_sorted.resize( count );
+	for( size_t idx = 0; idx < count; ++idx ) {
+		m_sorted[ idx ] = commands[ m_values[ idx ] ];
+	}
+
+	commands.swap( m_sorted );
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "drawlist.hpp"
+
+/*
+ * Render passes, in the order they are drawn.
+ */
+enum RenderPass
+{
+	PASS_OPAQUE = 0,
+	PASS_WIREFRAME = 1,
+	PASS_OVERLAY = 2
+};
+
+/*
+ * Layout of a 64-bit sort key, most significant field first:
+ *
+ *   63..60  pass
+ *   59..52  program
+ *   51..44  mesh
+ *   43..20  depth, quantised front to back
+ *   19..0   material
+ *
+ * Sorting by the key groups commands by pass, then shader and vertex array
+ * (minimising state changes) and draws front to back within each group so
+ * early depth rejection can skip hidden fragments.
+ */
+uint64_t makeSortKey( unsigned pass, unsigned program, unsigned mesh, float depth, unsigned material );
+
+/* Gets the pass a command with the specified DrawFlags belongs to. */
+unsigned getRenderPass( unsigned flags );
+
+/*
+ * Sorts keys (and the values that travel with them) in ascending order with
+ * an LSD radix sort using 8-bit digits. Digits that are identical for every
+ * key are skipped. The tmp arrays must hold count elements; the result is
+ * always left in keys/values.
+ */
+void radixSort( uint64_t * keys, uint32_t * values, uint64_t * tmpKeys, uint32_t * tmpValues, size_t count );
+
+/*
+ * Orders the commands of a draw list by their sort keys. Scratch storage is
+ * kept between frames so sorting does not allocate in steady state.
+ */
+class RenderQueue
+{
+public:
+	RenderQueue();
+
+	/* Sorts the commands of the list by key. The sort is stable. */
+	void sort( DrawList & list );
+
+private:
+	std::vector<uint64_t> m_keys;
+	std::vector<uint64_t> m_tmpKeys;
+	std::vector<uint32_t> m_values;
+	std::vector<uint32_t> m_tmpValues;
+	std::vector<DrawCommand> m_sorted;
+};
@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <cmath>
+
+#include "resolutionscaler.hpp"
+
+// Range and granularity of the scale.
+static const float SCALE_MIN = 0.5f;
+static const float SCALE_MAX = 1.0f;
+static const float SCALE_STEP = 0.05f;
+
+// Weight of a new sample in the moving averages.
+static const float SMOOTHING = 0.2f;
+
+// Scale up once the frame time drops below this fraction of the budget.
+static const float HEADROOM = 0.75f;
+
+// Frames to wait after a change, so the averages reflect the new scale.
+static const int COOLDOWN_FRAMES = 8;
+
+ResolutionScaler::ResolutionScaler()
+	: m_budget( 16.0f )
+{
+	reset();
+}
+
+void ResolutionScaler::reset()
+{
+	m_scale = SCALE_MAX;
+	m_cpuTime = 0.0f;
+	m_gpuTime = 0.0f;
+	m_cooldown = COOLDOWN_FRAMES;
+}
+
+void ResolutionScaler::setBudget( float ms )
+{
+	m_budget = std::max( ms, 1.0f );
+}
+
+float ResolutionScaler::getBudget() const
+{
+	return m_budget;
+}
+
+static float smooth( float average, float sample )
+{
+	if( average <= 0.0f ) {
+		return sample;
+	}
+	return average + SMOOTHING * ( sample - average );
+}
+
+void ResolutionScaler::addCpuTime( float ms )
+{
+	m_cpuTime = smooth( m_cpuTime, ms );
+}
+
+void ResolutionScaler::addGpuTime( float ms )
+{
+	m_gpuTime = smooth( m_gpuTime, ms );
+}
+
+bool ResolutionScaler::update()
+{
+	if( m_cooldown > 0 ) {
+		--m_cooldown;
+		return false;
+	}
+
+	float frameTime = getFrameTime();
+	if( frameTime <= 0.0f ) {
+		return false;
+	}
+
+	float scale = m_scale;
+	if( frameTime > m_budget ) {
+		// Cost is roughly proportional to the pixel count, which goes with
+		// the square of the scale.
+		scale = m_scale * std::sqrt( m_budget / frameTime );
+		scale = std::floor( scale / SCALE_STEP ) * SCALE_STEP;
+	} else if( frameTime < m_budget * HEADROOM ) {
+		scale = m_scale + SCALE_STEP;
+	}
+	scale = std::min( std::max( scale, SCALE_MIN ), SCALE_MAX );
+
+	if( std::fabs( scale - m_scale ) < 0.5f * SCALE_STEP ) {
+		return false;
+	}
+
+	m_scale = scale;
+	m_cooldown = COOLDOWN_FRAMES;
+	return true;
+}
+
+float ResolutionScaler::getScale() const
+{
+	return m_scale;
+}
+
+float ResolutionScaler::getFrameTime() const
+{
+	return std::max( m_cpuTime, m_gpuTime );
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+/*
+ * Chooses the resolution scale of the 3D scene so that rendering it stays
+ * within a frame time budget. The scale is kept in [0.5, 1] and moves in
+ * fixed steps so the offscreen target is not reallocated every frame.
+ */
+class ResolutionScaler
+{
+public:
+	ResolutionScaler();
+
+	/* Returns to full resolution and forgets all timings. */
+	void reset();
+
+	/* Sets the frame time budget in milliseconds. */
+	void setBudget( float ms );
+	float getBudget() const;
+
+	/* Records the CPU or GPU time of a frame that rendered the scene. */
+	void addCpuTime( float ms );
+	void addGpuTime( float ms );
+
+	/* Picks the scale for the next frame. Returns true if it changed. */
+	bool update();
+
+	/* Gets the current resolution scale. */
+	float getScale() const;
+
+	/* Gets the smoothed frame time the scale is chosen from. */
+	float getFrameTime() const;
+
+private:
+	float m_budget;
+	float m_scale;
+
+	// Exponential moving averages of the recent timings.
+	float m_cpuTime;
+	float m_gpuTime;
+
+	// Frames left before the next scale change is considered.
+	int m_cooldown;
+};
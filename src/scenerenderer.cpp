@@ -0,0 +1,303 @@
+#include <iostream>
+#include <vector>
+
+#include "cs488-framework/GlCounters.hpp"
+#include "cs488-framework/GlErrorCheck.hpp"
+#include "cs488-framework/GpuProfiler.hpp"
+#include "cs488-framework/ShaderException.hpp"
+
+#include "scenerenderer.hpp"
+
+/*
+ * Gets the name of the GPU profiler zone a command is timed in.
+ */
+static const char * getPassName( const DrawCommand & cmd )
+{
+	if( cmd.mesh == MESH_GRID_LINES ) {
+		return "Grid lines";
+	} else if( cmd.flags & DRAW_NO_DEPTH ) {
+		return "Marker";
+	} else if( cmd.flags & DRAW_WIREFRAME ) {
+		return "Wireframe";
+	}
+	return "Cubes";
+}
+
+SceneRenderer::SceneRenderer()
+	: m_shader( nullptr ),
+	pos_attr( -1 ),
+	P_uni( -1 ),
+	V_uni( -1 ),
+	M_uni( -1 ),
+	col_uni( -1 ),
+	m_grid_vao( 0 ),
+	m_grid_vbo( 0 ),
+	m_grid_vcount( 0 ),
+	m_grid_dim( 0 ),
+	m_cube_vao( 0 ),
+	m_cube_vbo( 0 ),
+	m_cube_ibo( 0 ),
+	m_cube_icount( 0 )
+{
+}
+
+SceneRenderer::~SceneRenderer()
+{
+}
+
+void SceneRenderer::init( const std::string & vertexShaderPath, const std::string & fragmentShaderPath )
+{
+	GL_DEBUG_SCOPE( "SceneRenderer::init" );
+
+	// Build the shader
+	m_shaders.setSources( vertexShaderPath, fragmentShaderPath );
+	m_shader = &m_shaders.get( ShaderPermutations::Defines() );
+
+	// Reloaded shaders keep the attribute locations of the first.
+	pos_attr = m_shader->getAttribLocation( "position" );
+	initUniforms();
+	initCube();
+}
+
+void SceneRenderer::initUniforms()
+{
+	P_uni = m_shader->getUniformLocation( "P" );
+	V_uni = m_shader->getUniformLocation( "V" );
+	M_uni = m_shader->getUniformLocation( "M" );
+	col_uni = m_shader->getUniformLocation( "colour" );
+}
+
+bool SceneRenderer::reloadShader( const std::string & filePath )
+{
+	std::string log;
+	bool started = m_shaders.recompile( filePath, log );
+	std::cerr << log;
+	return started;
+}
+
+bool SceneRenderer::updateShader()
+{
+	std::string log;
+	bool replaced = m_shaders.pollRecompile( log );
+	if( !log.empty() ) {
+		std::cerr << log << "Keeping the previous shader." << std::endl;
+	}
+	if( !replaced ) {
+		return false;
+	}
+
+	// A shader being edited may not use every uniform yet. GL ignores
+	// uploads to location -1.
+	try {
+		initUniforms();
+	} catch( const ShaderException & e ) {
+		std::cerr << e.what() << std::endl;
+		P_uni = V_uni = M_uni = col_uni = -1;
+	}
+
+	std::cout << "Reloaded shaders" << std::endl;
+	return true;
+}
+
+void SceneRenderer::setGridDim( size_t dim )
+{
+	if( m_grid_vao != 0 && dim == m_grid_dim ) {
+		return;
+	}
+
+	// Two lines per row and column, plus a border of one cell
+	size_t vcount = 3 * 2 * 2 * (dim + 3);
+
+	std::vector<float> vertices( vcount );
+	size_t ct = 0;
+	for( int idx = 0; idx < int(dim)+3; ++idx ) {
+		vertices[ ct ] = -1;
+		vertices[ ct+1 ] = 0;
+		vertices[ ct+2 ] = idx-1;
+		vertices[ ct+3 ] = dim+1;
+		vertices[ ct+4 ] = 0;
+		vertices[ ct+5 ] = idx-1;
+		ct += 6;
+
+		vertices[ ct ] = idx-1;
+		vertices[ ct+1 ] = 0;
+		vertices[ ct+2 ] = -1;
+		vertices[ ct+3 ] = idx-1;
+		vertices[ ct+4 ] = 0;
+		vertices[ ct+5 ] = dim+1;
+		ct += 6;
+	}
+
+	// Create the vertex array to record buffer assignments.
+	if( m_grid_vao == 0 ) {
+		glGenVertexArrays( 1, &m_grid_vao );
+		glGenBuffers( 1, &m_grid_vbo );
+	}
+	glBindVertexArray( m_grid_vao );
+
+	// Create the grid vertex buffer
+	glBindBuffer( GL_ARRAY_BUFFER, m_grid_vbo );
+	glBufferData( GL_ARRAY_BUFFER, vcount * sizeof(float), vertices.data(), GL_STATIC_DRAW );
+	GlCounters::setLabel( GL_BUFFER, m_grid_vbo, "Grid lines" );
+
+	// Specify the means of extracting the position values properly.
+	glEnableVertexAttribArray( pos_attr );
+	glVertexAttribPointer( pos_attr, 3, GL_FLOAT, GL_FALSE, 0, nullptr );
+
+	// Reset state
+	glBindVertexArray( 0 );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+	m_grid_vcount = GLsizei( vcount / 3 );
+	m_grid_dim = dim;
+
+	// Check for errors
+	CHECK_GL_ERRORS;
+}
+
+void SceneRenderer::initCube()
+{
+	// Vertices that define the cube
+	size_t vcount = 8;
+	glm::vec3 vertices[] = {
+		{  0.0f, 0.0f, 1.0f },
+		{  1.0f, 0.0f, 1.0f },
+		{  1.0f, 1.0f, 1.0f },
+		{  0.0f, 1.0f, 1.0f },
+		{  0.0f, 0.0f, 0.0f },
+		{  1.0f, 0.0f, 0.0f },
+		{  1.0f, 1.0f, 0.0f },
+		{  0.0f, 1.0f, 0.0f },
+	};
+
+	// Indices that define the triangles that construct the cube
+	size_t icount = 12 * 3;
+	m_cube_icount = icount;
+	GLint indices[] = {
+		0, 1, 2, 2, 3, 0,
+		3, 2, 6, 6, 7, 3,
+		7, 6, 5, 5, 4, 7,
+		4, 0, 3, 3, 7, 4,
+		0, 1, 5, 5, 4, 0,
+		1, 5, 6, 6, 2, 1
+	};
+
+	// Setup the vertex array
+	glGenVertexArrays( 1, &m_cube_vao );
+	glBindVertexArray( m_cube_vao );
+
+	// Setup the vertices of the cube
+	glGenBuffers( 1, &m_cube_vbo );
+	glBindBuffer( GL_ARRAY_BUFFER, m_cube_vbo );
+	glBufferData( GL_ARRAY_BUFFER, vcount * sizeof(glm::vec3), &vertices[0], GL_STATIC_DRAW );
+	GlCounters::setLabel( GL_BUFFER, m_cube_vbo, "Cube vertices" );
+
+	// Specify the means of extracting the position values properly.
+	glEnableVertexAttribArray( pos_attr );
+	glVertexAttribPointer( pos_attr, 3, GL_FLOAT, GL_FALSE, 0, nullptr );
+
+	// Setup indices for the cube
+	glGenBuffers( 1, &m_cube_ibo );
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, m_cube_ibo );
+	glBufferData( GL_ELEMENT_ARRAY_BUFFER, icount * sizeof(GLint), &indices[0], GL_STATIC_DRAW );
+	GlCounters::setLabel( GL_BUFFER, m_cube_ibo, "Cube indices" );
+
+	// Reset state
+	glBindVertexArray( 0 );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+
+	CHECK_GL_ERRORS;
+}
+
+void SceneRenderer::replay( const DrawList & list )
+{
+	m_shader->enable();
+
+	// Enable the depth test
+	glEnable( GL_DEPTH_TEST );
+
+	// Set the per frame matrices. Unchanged uniforms are not uploaded again.
+	m_shader->setUniform( P_uni, list.proj );
+	m_shader->setUniform( V_uni, list.view );
+
+	int boundMesh = -1;
+	uint16_t flags = DRAW_FILL;
+
+	// Commands of a pass are contiguous once sorted, so each pass is one
+	// GPU zone.
+	const char * pass = nullptr;
+
+	for( const DrawCommand & cmd : list.getCommands() ) {
+		const char * cmdPass = getPassName( cmd );
+		if( cmdPass != pass ) {
+			if( pass != nullptr ) {
+				GL_DEBUG_POP();
+				GPU_PROFILE_LEAVE();
+			}
+			GPU_PROFILE_ENTER( cmdPass );
+			GL_DEBUG_PUSH( cmdPass );
+			pass = cmdPass;
+		}
+
+		// Bind the geometry for the command
+		if( cmd.mesh != boundMesh ) {
+			glBindVertexArray( cmd.mesh == MESH_GRID_LINES ? m_grid_vao : m_cube_vao );
+			boundMesh = cmd.mesh;
+		}
+
+		// Toggle the fixed function state that changed
+		if( ( cmd.flags ^ flags ) & DRAW_WIREFRAME ) {
+			glPolygonMode( GL_FRONT_AND_BACK, ( cmd.flags & DRAW_WIREFRAME ) ? GL_LINE : GL_FILL );
+		}
+
+		if( ( cmd.flags ^ flags ) & DRAW_NO_DEPTH ) {
+			if( cmd.flags & DRAW_NO_DEPTH ) {
+				glDisable( GL_DEPTH_TEST );
+			} else {
+				glEnable( GL_DEPTH_TEST );
+			}
+		}
+
+		flags = cmd.flags;
+
+		// Set color and draw each instance
+		m_shader->setUniform( col_uni, cmd.colour );
+
+		for( uint32_t idx = 0; idx < cmd.instanceCount; ++idx ) {
+			glm::mat4 M = list.getInstanceTransform( cmd, idx );
+			m_shader->setUniform( M_uni, M );
+
+			if( cmd.mesh == MESH_GRID_LINES ) {
+				glDrawArrays( GL_LINES, 0, m_grid_vcount );
+			} else {
+				glDrawElements( GL_TRIANGLES, m_cube_icount, GL_UNSIGNED_INT, 0 );
+			}
+		}
+	}
+
+	if( pass != nullptr ) {
+		GL_DEBUG_POP();
+		GPU_PROFILE_LEAVE();
+	}
+
+	// Restore defaults
+	glPolygonMode( GL_FRONT_AND_BACK, GL_FILL );
+	glDisable( GL_DEPTH_TEST );
+
+	m_shader->disable();
+	glBindVertexArray( 0 );
+}
+
+void SceneRenderer::cleanup()
+{
+	glDeleteBuffers( 1, &m_grid_vbo );
+	glDeleteVertexArrays( 1, &m_grid_vao );
+
+	glDeleteBuffers( 1, &m_cube_vbo );
+	glDeleteBuffers( 1, &m_cube_ibo );
+	glDeleteVertexArrays( 1, &m_cube_vao );
+
+	m_grid_vao = m_grid_vbo = 0;
+	m_cube_vao = m_cube_vbo = m_cube_ibo = 0;
+}
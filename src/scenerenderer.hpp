@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+
+#include "cs488-framework/OpenGLImport.hpp"
+#include "cs488-framework/ShaderPermutations.hpp"
+
+#include "drawlist.hpp"
+
+/*
+ * Owns the GL resources of the Stack scene (shader, grid lines and cube
+ * geometry) and replays draw lists with them. Requires a current context.
+ */
+class SceneRenderer
+{
+public:
+	SceneRenderer();
+	~SceneRenderer();
+
+	/* Builds the shader and the cube geometry. */
+	void init( const std::string & vertexShaderPath, const std::string & fragmentShaderPath );
+
+	/* Builds the grid line geometry for a grid of the specified dimension. */
+	void setGridDim( size_t dim );
+
+	/* Starts rebuilding the shader in the background if filePath is one of
+	   its source files. Returns true if a rebuild was started. */
+	bool reloadShader( const std::string & filePath );
+
+	/* Swaps in a rebuilt shader once the driver has compiled it. Returns
+	   true if the shader changed, so the scene should be drawn again. A
+	   shader that fails to build is reported and the old one kept. */
+	bool updateShader();
+
+	/* Executes each command of a recorded draw list. */
+	void replay( const DrawList & list );
+
+	/* Releases all GL resources. */
+	void cleanup();
+
+private:
+	void initUniforms();
+	void initCube();
+
+	// Fields related to the shader and uniforms.
+	// The scene shader is built through ShaderPermutations so passes can be
+	// given compile time variants; all use the one without defines for now.
+	ShaderPermutations m_shaders;
+	ShaderProgram * m_shader;
+	GLint pos_attr; // Attribute location for vertex positions.
+	GLint P_uni; // Uniform location for Projection matrix.
+	GLint V_uni; // Uniform location for View matrix.
+	GLint M_uni; // Uniform location for Model matrix.
+	GLint col_uni;   // Uniform location for cube colour.
+
+	// Fields related to grid geometry.
+	GLuint m_grid_vao; // Vertex Array Object
+	GLuint m_grid_vbo; // Vertex Buffer Object
+	GLsizei m_grid_vcount; // Vertex Count
+	size_t m_grid_dim;
+
+	// Fields related to cube geometry.
+	GLuint m_cube_vao; // Vertex Array Object
+	GLuint m_cube_vbo; // Vertex Buffer Object
+	GLuint m_cube_ibo; // Index Buffer Object
+	GLint m_cube_icount; // Index Buffer Count
+};
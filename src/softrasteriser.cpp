@@ -0,0 +1,701 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "softrasteriser.hpp"
+
+// Tile size in pixels. Tiles are square and a multiple of the SIMD width.
+static const int TILE_SIZE = 64;
+static_assert( TILE_SIZE % 4 == 0, "Tiles must hold whole groups of 4 pixels" );
+
+// Bits of sub-pixel precision of the fixed point vertex positions.
+static const int SUBPIXEL_BITS = 4;
+static const int SUBPIXEL_ONE = 1 << SUBPIXEL_BITS;
+
+// Edge values are clamped to this before stepping across a tile. The most a
+// step can change them by is well under the margin to INT32_MAX, so the
+// clamp keeps the sign of every pixel's edge value without 64-bit maths.
+static const int64_t EDGE_CLAMP = int64_t( 1 ) << 30;
+
+// Primitives are clipped to a guard band this many viewports wide, which
+// bounds the fixed point coordinates.
+static const float GUARD_BAND = 4.0f;
+
+// Command chunks binned per thread, for load balancing.
+static const size_t CHUNKS_PER_THREAD = 4;
+
+// Unit cube, matching the vertex buffer of SceneRenderer.
+static const glm::vec3 CUBE_VERTICES[ 8 ] = {
+	glm::vec3( 0.0f, 0.0f, 1.0f ),
+	glm::vec3( 1.0f, 0.0f, 1.0f ),
+	glm::vec3( 1.0f, 1.0f, 1.0f ),
+	glm::vec3( 0.0f, 1.0f, 1.0f ),
+	glm::vec3( 0.0f, 0.0f, 0.0f ),
+	glm::vec3( 1.0f, 0.0f, 0.0f ),
+	glm::vec3( 1.0f, 1.0f, 0.0f ),
+	glm::vec3( 0.0f, 1.0f, 0.0f ),
+};
+
+// Triangles of each face, matching the index buffer of SceneRenderer. The
+// bottom face is wound inwards, so its facing is flipped.
+static const int CUBE_FACES[ 6 ][ 6 ] = {
+	{ 0, 1, 2, 2, 3, 0 },
+	{ 3, 2, 6, 6, 7, 3 },
+	{ 7, 6, 5, 5, 4, 7 },
+	{ 4, 0, 3, 3, 7, 4 },
+	{ 0, 1, 5, 5, 4, 0 },
+	{ 1, 5, 6, 6, 2, 1 },
+};
+static const float CUBE_FACE_WINDING[ 6 ] = { 1.0f, 1.0f, 1.0f, 1.0f, -1.0f, 1.0f };
+static const int FACE_TOP = 1;
+static const int FACE_BOTTOM = 4;
+
+// Unique edges of the cube triangles, and the faces (bit mask) using each.
+static const int CUBE_EDGES[ 18 ][ 3 ] = {
+	{ 0, 1, 0x11 }, { 1, 2, 0x21 }, { 2, 3, 0x03 }, { 3, 0, 0x09 },
+	{ 4, 5, 0x14 }, { 5, 6, 0x24 }, { 6, 7, 0x06 }, { 7, 4, 0x0c },
+	{ 0, 4, 0x18 }, { 1, 5, 0x30 }, { 2, 6, 0x22 }, { 3, 7, 0x0a },
+	{ 0, 2, 0x01 }, { 3, 6, 0x02 }, { 7, 5, 0x04 },
+	{ 4, 3, 0x08 }, { 0, 5, 0x10 }, { 1, 6, 0x20 },
+};
+
+// Converts a colour to RGBA8. Ties round to even, as llvmpipe and most GPUs
+// do for the unorm conversion.
+static uint32_t packColour( const glm::vec3 & colour )
+{
+	uint32_t rgba = 0xff000000u;
+	for( int c = 0; c < 3; ++c ) {
+		float v = std::min( std::max( colour[ c ], 0.0f ), 1.0f );
+		rgba |= uint32_t( std::lrint( v * 255.0f ) ) << ( c * 8 );
+	}
+	return rgba;
+}
+
+// Returns true if a clip space point is inside the near, far and guard band
+// planes.
+static bool insideClipVolume( const glm::vec4 & p )
+{
+	float g = GUARD_BAND * p.w;
+	return p.z >= -p.w && p.z <= p.w
+		&& p.x >= -g && p.x <= g
+		&& p.y >= -g && p.y <= g;
+}
+
+// Signed distance of a clip space point to clip plane 'plane' (>= 0 inside).
+static float clipDistance( const glm::vec4 & p, int plane )
+{
+	float g = GUARD_BAND * p.w;
+	switch( plane ) {
+	case 0: return p.z + p.w;
+	case 1: return p.w - p.z;
+	case 2: return p.x + g;
+	case 3: return g - p.x;
+	case 4: return p.y + g;
+	default: return g - p.y;
+	}
+}
+
+// Runs 'work' on 'threads' threads, the calling thread included.
+template<typename Work>
+static void runParallel( unsigned threads, Work work )
+{
+	std::vector<std::thread> pool;
+	for( unsigned idx = 1; idx < threads; ++idx ) {
+		pool.push_back( std::thread( work ) );
+	}
+	work();
+	for( std::thread & t : pool ) {
+		t.join();
+	}
+}
+
+SoftRasteriser::SoftRasteriser()
+	: m_threads( 0 ),
+	m_clearColour( 0xff000000u ),
+	m_width( 0 ),
+	m_height( 0 ),
+	m_stride( 0 ),
+	m_tilesX( 0 ),
+	m_tilesY( 0 ),
+	m_chunkCount( 0 )
+{
+}
+
+void SoftRasteriser::setThreadCount( unsigned threads )
+{
+	m_threads = threads;
+}
+
+void SoftRasteriser::setClearColour( const glm::vec3 & colour )
+{
+	m_clearColour = packColour( colour );
+}
+
+void SoftRasteriser::setGridDim( size_t dim )
+{
+	// Two lines per row and column, plus a border of one cell
+	m_gridLines.clear();
+	for( int idx = 0; idx < int(dim)+3; ++idx ) {
+		m_gridLines.push_back( glm::vec3( -1, 0, idx-1 ) );
+		m_gridLines.push_back( glm::vec3( dim+1, 0, idx-1 ) );
+		m_gridLines.push_back( glm::vec3( idx-1, 0, -1 ) );
+		m_gridLines.push_back( glm::vec3( idx-1, 0, dim+1 ) );
+	}
+}
+
+int SoftRasteriser::getWidth() const
+{
+	return m_width;
+}
+
+int SoftRasteriser::getHeight() const
+{
+	return m_height;
+}
+
+void SoftRasteriser::render( const DrawList & list, int width, int height )
+{
+	m_width = width;
+	m_height = height;
+	m_tilesX = ( width + TILE_SIZE - 1 ) / TILE_SIZE;
+	m_tilesY = ( height + TILE_SIZE - 1 ) / TILE_SIZE;
+	m_stride = m_tilesX * TILE_SIZE;
+	m_viewProj = list.proj * list.view;
+
+	// Buffers are padded to whole tiles so SIMD rows never run off the end.
+	size_t pixels = size_t( m_stride ) * size_t( m_tilesY * TILE_SIZE );
+	m_colour.resize( pixels );
+	m_depth.resize( pixels );
+
+	unsigned threads = m_threads != 0 ? m_threads : std::max( std::thread::hardware_concurrency(), 1u );
+	const size_t tileCount = size_t( m_tilesX * m_tilesY );
+
+	m_chunkCount = std::max<size_t>( 1, std::min( list.size(), threads * CHUNKS_PER_THREAD ) );
+	m_bins.resize( std::max( m_bins.size(), m_chunkCount * tileCount ) );
+	for( size_t idx = 0; idx < m_chunkCount * tileCount; ++idx ) {
+		m_bins[ idx ].clear();
+	}
+
+	// Bin the commands, then rasterise the tiles. Each stage hands out work
+	// one chunk or tile at a time.
+	std::atomic<size_t> next( 0 );
+	runParallel( threads, [&]() {
+		for( size_t chunk = next++; chunk < m_chunkCount; chunk = next++ ) {
+			binCommands( list, chunk );
+		}
+	} );
+
+	next = 0;
+	runParallel( threads, [&]() {
+		for( size_t tile = next++; tile < tileCount; tile = next++ ) {
+			rasteriseTile( list, tile );
+		}
+	} );
+}
+
+void SoftRasteriser::readPixels( std::vector<unsigned char> & rgb ) const
+{
+	rgb.resize( size_t( m_width ) * size_t( m_height ) * 3 );
+
+	unsigned char * out = rgb.data();
+	for( int y = 0; y < m_height; ++y ) {
+		const uint32_t * row = &m_colour[ size_t( y ) * m_stride ];
+		for( int x = 0; x < m_width; ++x ) {
+			*out++ = row[ x ] & 0xff;
+			*out++ = ( row[ x ] >> 8 ) & 0xff;
+			*out++ = ( row[ x ] >> 16 ) & 0xff;
+		}
+	}
+}
+
+glm::vec3 SoftRasteriser::toWindow( const glm::vec4 & clip ) const
+{
+	float inv = 1.0f / clip.w;
+	return glm::vec3(
+		( clip.x * inv * 0.5f + 0.5f ) * float( m_width ),
+		( clip.y * inv * 0.5f + 0.5f ) * float( m_height ),
+		clip.z * inv * 0.5f + 0.5f );
+}
+
+void SoftRasteriser::binCommands( const DrawList & list, size_t chunk )
+{
+	const std::vector<DrawCommand> & commands = list.getCommands();
+	const size_t tileCount = size_t( m_tilesX * m_tilesY );
+
+	size_t begin = chunk * commands.size() / m_chunkCount;
+	size_t end = ( chunk + 1 ) * commands.size() / m_chunkCount;
+
+	std::vector<BinEntry> * bins = &m_bins[ chunk * tileCount ];
+
+	for( size_t idx = begin; idx < end; ++idx ) {
+		const DrawCommand & cmd = commands[ idx ];
+
+		for( uint32_t inst = 0; inst < cmd.instanceCount; ++inst ) {
+			BinEntry entry = { uint32_t( idx ), inst };
+
+			// Grid lines span the whole grid, so they go in every tile.
+			int tx0 = 0, ty0 = 0, tx1 = m_tilesX - 1, ty1 = m_tilesY - 1;
+
+			if( cmd.mesh == MESH_CUBE ) {
+				glm::mat4 MVP = m_viewProj * list.getInstanceTransform( cmd, inst );
+
+				float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f;
+				bool clipped = false;
+				unsigned outside = 0x3f;
+				for( int v = 0; v < 8; ++v ) {
+					glm::vec4 p = MVP * glm::vec4( CUBE_VERTICES[ v ], 1.0f );
+					if( !insideClipVolume( p ) ) {
+						clipped = true;
+						unsigned planes = 0;
+						for( int plane = 0; plane < 6; ++plane ) {
+							if( clipDistance( p, plane ) < 0.0f ) {
+								planes |= 1u << plane;
+							}
+						}
+						outside &= planes;
+						continue;
+					}
+					outside = 0;
+					glm::vec3 w = toWindow( p );
+					minX = std::min( minX, w.x );
+					minY = std::min( minY, w.y );
+					maxX = std::max( maxX, w.x );
+					maxY = std::max( maxY, w.y );
+				}
+
+				// Cubes wholly outside one plane draw nothing. Partially
+				// clipped cubes are binned everywhere and left to the clipper.
+				if( outside != 0 ) {
+					continue;
+				}
+				if( !clipped ) {
+					if( maxX < 0.0f || maxY < 0.0f || minX >= float( m_width ) || minY >= float( m_height ) ) {
+						continue;
+					}
+					tx0 = std::max( 0, int( minX ) / TILE_SIZE );
+					ty0 = std::max( 0, int( minY ) / TILE_SIZE );
+					tx1 = std::min( m_tilesX - 1, int( maxX ) / TILE_SIZE );
+					ty1 = std::min( m_tilesY - 1, int( maxY ) / TILE_SIZE );
+				}
+			}
+
+			for( int ty = ty0; ty <= ty1; ++ty ) {
+				for( int tx = tx0; tx <= tx1; ++tx ) {
+					bins[ ty * m_tilesX + tx ].push_back( entry );
+				}
+			}
+		}
+	}
+}
+
+void SoftRasteriser::rasteriseTile( const DrawList & list, size_t tile )
+{
+	const size_t tileCount = size_t( m_tilesX * m_tilesY );
+
+	Tile rect;
+	rect.x0 = int( tile % m_tilesX ) * TILE_SIZE;
+	rect.y0 = int( tile / m_tilesX ) * TILE_SIZE;
+	rect.x1 = std::min( rect.x0 + TILE_SIZE, m_width );
+	rect.y1 = std::min( rect.y0 + TILE_SIZE, m_height );
+
+	// Clear the tile
+	for( int y = rect.y0; y < rect.y0 + TILE_SIZE; ++y ) {
+		size_t row = size_t( y ) * m_stride + rect.x0;
+		std::fill_n( &m_colour[ row ], TILE_SIZE, m_clearColour );
+		std::fill_n( &m_depth[ row ], TILE_SIZE, 1.0f );
+	}
+
+	const std::vector<DrawCommand> & commands = list.getCommands();
+
+	for( size_t chunk = 0; chunk < m_chunkCount; ++chunk ) {
+		for( const BinEntry & entry : m_bins[ chunk * tileCount + tile ] ) {
+			const DrawCommand & cmd = commands[ entry.command ];
+			if( cmd.mesh == MESH_GRID_LINES ) {
+				drawGridLines( list, cmd, entry.instance, rect );
+			} else {
+				drawCube( list, cmd, entry.instance, rect );
+			}
+		}
+	}
+}
+
+void SoftRasteriser::drawCube( const DrawList & list, const DrawCommand & cmd, uint32_t instance, const Tile & tile )
+{
+	glm::mat4 MVP = m_viewProj * list.getInstanceTransform( cmd, instance );
+	uint32_t colour = packColour( cmd.colour );
+	bool depthTest = ( cmd.flags & DRAW_NO_DEPTH ) == 0;
+
+	glm::vec4 clip[ 8 ];
+	glm::vec3 window[ 8 ];
+	bool clipped = false;
+	for( int v = 0; v < 8; ++v ) {
+		clip[ v ] = MVP * glm::vec4( CUBE_VERTICES[ v ], 1.0f );
+		clipped = clipped || !insideClipVolume( clip[ v ] );
+	}
+
+	// Find the faces that point towards the camera. Facing is unreliable
+	// once vertices need clipping, so then every face is kept.
+	unsigned frontFaces = 0x3f;
+	if( !clipped ) {
+		for( int v = 0; v < 8; ++v ) {
+			window[ v ] = toWindow( clip[ v ] );
+		}
+
+		frontFaces = 0;
+		for( int f = 0; f < 6; ++f ) {
+			const glm::vec3 & a = window[ CUBE_FACES[ f ][ 0 ] ];
+			const glm::vec3 & b = window[ CUBE_FACES[ f ][ 1 ] ];
+			const glm::vec3 & c = window[ CUBE_FACES[ f ][ 2 ] ];
+			float area = ( b.x - a.x ) * ( c.y - a.y ) - ( b.y - a.y ) * ( c.x - a.x );
+			if( area * CUBE_FACE_WINDING[ f ] > 0.0f ) {
+				frontFaces |= 1u << f;
+			}
+		}
+	}
+
+	// Faces between stacked instances are inside the column
+	if( instance + 1 < cmd.instanceCount ) {
+		frontFaces &= ~( 1u << FACE_TOP );
+	}
+	if( instance > 0 ) {
+		frontFaces &= ~( 1u << FACE_BOTTOM );
+	}
+
+	if( cmd.flags & DRAW_WIREFRAME ) {
+		// Edges only on back faces are hidden by the cube itself, unless
+		// drawn without the depth test.
+		unsigned visible = depthTest ? frontFaces : 0x3f;
+		for( int e = 0; e < 18; ++e ) {
+			if( ( CUBE_EDGES[ e ][ 2 ] & visible ) == 0 ) {
+				continue;
+			}
+			int a = CUBE_EDGES[ e ][ 0 ];
+			int b = CUBE_EDGES[ e ][ 1 ];
+			if( clipped ) {
+				drawLine( clip[ a ], clip[ b ], colour, depthTest, tile );
+			} else {
+				fillLine( window[ a ], window[ b ], colour, depthTest, tile );
+			}
+		}
+		return;
+	}
+
+	for( int f = 0; f < 6; ++f ) {
+		if( ( frontFaces & ( 1u << f ) ) == 0 ) {
+			continue;
+		}
+		for( int t = 0; t < 6; t += 3 ) {
+			const int * idx = &CUBE_FACES[ f ][ t ];
+			if( clipped ) {
+				glm::vec4 tri[ 3 ] = { clip[ idx[ 0 ] ], clip[ idx[ 1 ] ], clip[ idx[ 2 ] ] };
+				drawTriangle( tri, colour, depthTest, tile );
+			} else {
+				glm::vec3 tri[ 3 ] = { window[ idx[ 0 ] ], window[ idx[ 1 ] ], window[ idx[ 2 ] ] };
+				fillTriangle( tri, colour, depthTest, tile );
+			}
+		}
+	}
+}
+
+void SoftRasteriser::drawGridLines( const DrawList & list, const DrawCommand & cmd, uint32_t instance, const Tile & tile )
+{
+	glm::mat4 MVP = m_viewProj * list.getInstanceTransform( cmd, instance );
+	uint32_t colour = packColour( cmd.colour );
+	bool depthTest = ( cmd.flags & DRAW_NO_DEPTH ) == 0;
+
+	for( size_t idx = 0; idx + 1 < m_gridLines.size(); idx += 2 ) {
+		glm::vec4 a = MVP * glm::vec4( m_gridLines[ idx ], 1.0f );
+		glm::vec4 b = MVP * glm::vec4( m_gridLines[ idx + 1 ], 1.0f );
+		drawLine( a, b, colour, depthTest, tile );
+	}
+}
+
+void SoftRasteriser::drawTriangle( const glm::vec4 * clip, uint32_t colour, bool depthTest, const Tile & tile )
+{
+	// Sutherland-Hodgman against each plane. Six planes add at most six
+	// vertices to the triangle.
+	glm::vec4 buffers[ 2 ][ 9 ];
+	int count = 3;
+	std::copy( clip, clip + 3, buffers[ 0 ] );
+
+	int src = 0;
+	for( int plane = 0; plane < 6 && count > 0; ++plane ) {
+		const glm::vec4 * in = buffers[ src ];
+		glm::vec4 * out = buffers[ 1 - src ];
+		int outCount = 0;
+
+		for( int idx = 0; idx < count; ++idx ) {
+			const glm::vec4 & a = in[ idx ];
+			const glm::vec4 & b = in[ ( idx + 1 ) % count ];
+			float da = clipDistance( a, plane );
+			float db = clipDistance( b, plane );
+
+			if( da >= 0.0f ) {
+				out[ outCount++ ] = a;
+			}
+			if( ( da >= 0.0f ) != ( db >= 0.0f ) ) {
+				out[ outCount++ ] = a + ( b - a ) * ( da / ( da - db ) );
+			}
+		}
+
+		count = outCount;
+		src = 1 - src;
+	}
+
+	if( count < 3 ) {
+		return;
+	}
+
+	// Fan the clipped polygon into triangles
+	glm::vec3 window[ 9 ];
+	for( int idx = 0; idx < count; ++idx ) {
+		window[ idx ] = toWindow( buffers[ src ][ idx ] );
+	}
+	for( int idx = 1; idx + 1 < count; ++idx ) {
+		glm::vec3 tri[ 3 ] = { window[ 0 ], window[ idx ], window[ idx + 1 ] };
+		fillTriangle( tri, colour, depthTest, tile );
+	}
+}
+
+void SoftRasteriser::drawLine( const glm::vec4 & a, const glm::vec4 & b, uint32_t colour, bool depthTest, const Tile & tile )
+{
+	float t0 = 0.0f;
+	float t1 = 1.0f;
+
+	for( int plane = 0; plane < 6; ++plane ) {
+		float da = clipDistance( a, plane );
+		float db = clipDistance( b, plane );
+		if( da < 0.0f && db < 0.0f ) {
+			return;
+		}
+		if( da < 0.0f ) {
+			t0 = std::max( t0, da / ( da - db ) );
+		} else if( db < 0.0f ) {
+			t1 = std::min( t1, da / ( da - db ) );
+		}
+	}
+
+	if( t0 >= t1 ) {
+		return;
+	}
+
+	fillLine( toWindow( a + ( b - a ) * t0 ), toWindow( a + ( b - a ) * t1 ), colour, depthTest, tile );
+}
+
+void SoftRasteriser::fillTriangle( const glm::vec3 * v, uint32_t colour, bool depthTest, const Tile & tile )
+{
+	// Snap to fixed point
+	int32_t X[ 3 ], Y[ 3 ];
+	for( int idx = 0; idx < 3; ++idx ) {
+		X[ idx ] = int32_t( std::floor( v[ idx ].x * SUBPIXEL_ONE + 0.5f ) );
+		Y[ idx ] = int32_t( std::floor( v[ idx ].y * SUBPIXEL_ONE + 0.5f ) );
+	}
+
+	int64_t area = int64_t( X[ 1 ] - X[ 0 ] ) * ( Y[ 2 ] - Y[ 0 ] ) - int64_t( Y[ 1 ] - Y[ 0 ] ) * ( X[ 2 ] - X[ 0 ] );
+	if( area == 0 ) {
+		return;
+	}
+
+	// Make the triangle counter-clockwise so inside is positive
+	int order[ 3 ] = { 0, 1, 2 };
+	if( area < 0 ) {
+		std::swap( order[ 1 ], order[ 2 ] );
+		area = -area;
+	}
+
+	// Pixels whose centres may be covered, limited to the tile
+	int minX = std::min( std::min( X[ 0 ], X[ 1 ] ), X[ 2 ] );
+	int minY = std::min( std::min( Y[ 0 ], Y[ 1 ] ), Y[ 2 ] );
+	int maxX = std::max( std::max( X[ 0 ], X[ 1 ] ), X[ 2 ] );
+	int maxY = std::max( std::max( Y[ 0 ], Y[ 1 ] ), Y[ 2 ] );
+
+	int x0 = std::max( tile.x0, ( minX >> SUBPIXEL_BITS ) );
+	int y0 = std::max( tile.y0, ( minY >> SUBPIXEL_BITS ) );
+	int x1 = std::min( tile.x1 - 1, ( maxX >> SUBPIXEL_BITS ) );
+	int y1 = std::min( tile.y1 - 1, ( maxY >> SUBPIXEL_BITS ) );
+	if( x0 > x1 || y0 > y1 ) {
+		return;
+	}
+
+	// The SIMD loop covers aligned groups of 4 pixels. Tiles start on a
+	// multiple of 4 and are a multiple of 4 wide, so the groups never reach
+	// into a neighbouring tile, which another thread may be drawing.
+#if defined(__SSE2__)
+	int xStart = x0 & ~3;
+#else
+	int xStart = x0;
+#endif
+
+	// Edge functions E(p) = (b - a) x (p - a), evaluated at the first pixel
+	// centre, and their steps per pixel in x and y.
+	int32_t E[ 3 ], stepX[ 3 ], stepY[ 3 ];
+	int64_t px = ( int64_t( xStart ) << SUBPIXEL_BITS ) + SUBPIXEL_ONE / 2;
+	int64_t py = ( int64_t( y0 ) << SUBPIXEL_BITS ) + SUBPIXEL_ONE / 2;
+
+	for( int e = 0; e < 3; ++e ) {
+		int a = order[ e ];
+		int b = order[ ( e + 1 ) % 3 ];
+		int64_t dx = X[ b ] - X[ a ];
+		int64_t dy = Y[ b ] - Y[ a ];
+
+		int64_t value = dx * ( py - Y[ a ] ) - dy * ( px - X[ a ] );
+
+		// Top-left rule: pixels exactly on an edge belong to left edges and
+		// horizontal top edges only.
+		bool topLeft = dy < 0 || ( dy == 0 && dx < 0 );
+		if( !topLeft ) {
+			value -= 1;
+		}
+
+		E[ e ] = int32_t( std::min( std::max( value, -EDGE_CLAMP ), EDGE_CLAMP ) );
+		stepX[ e ] = int32_t( -dy * SUBPIXEL_ONE );
+		stepY[ e ] = int32_t( dx * SUBPIXEL_ONE );
+	}
+
+	// Window depth is affine in screen space: z = z0 + dzdx * x + dzdy * y
+	const glm::vec3 & a = v[ 0 ];
+	const glm::vec3 & b = v[ 1 ];
+	const glm::vec3 & c = v[ 2 ];
+	float det = ( b.x - a.x ) * ( c.y - a.y ) - ( b.y - a.y ) * ( c.x - a.x );
+	if( det == 0.0f ) {
+		return;
+	}
+	float dzdx = ( ( b.z - a.z ) * ( c.y - a.y ) - ( b.y - a.y ) * ( c.z - a.z ) ) / det;
+	float dzdy = ( ( b.x - a.x ) * ( c.z - a.z ) - ( b.z - a.z ) * ( c.x - a.x ) ) / det;
+	float zRow = a.z + dzdx * ( float( x0 ) + 0.5f - a.x ) + dzdy * ( float( y0 ) + 0.5f - a.y );
+
+#if defined(__SSE2__)
+	const __m128i lane = _mm_set_epi32( 3, 2, 1, 0 );
+	__m128i stepX4[ 3 ];
+	__m128i rowE[ 3 ];
+	for( int e = 0; e < 3; ++e ) {
+		int32_t step = stepX[ e ];
+		rowE[ e ] = _mm_add_epi32( _mm_set1_epi32( E[ e ] ), _mm_set_epi32( 3 * step, 2 * step, step, 0 ) );
+		stepX4[ e ] = _mm_set1_epi32( 4 * step );
+	}
+
+	// zRow is at x0, which may be part way into the first group, so depth is
+	// evaluated per group from the offset to x0 rather than stepped.
+	const __m128 zLane = _mm_set_ps( 3.0f, 2.0f, 1.0f, 0.0f );
+	const __m128 dzdx4 = _mm_set1_ps( dzdx );
+	const __m128i colour4 = _mm_set1_epi32( int( colour ) );
+
+	for( int y = y0; y <= y1; ++y ) {
+		__m128i e0 = rowE[ 0 ], e1 = rowE[ 1 ], e2 = rowE[ 2 ];
+		const __m128 z0 = _mm_set1_ps( zRow );
+
+		size_t row = size_t( y ) * m_stride;
+		for( int x = xStart; x <= x1; x += 4 ) {
+			// Inside where no edge value is negative, and within [x0, x1]
+			__m128i outside = _mm_srai_epi32( _mm_or_si128( _mm_or_si128( e0, e1 ), e2 ), 31 );
+			__m128i span = _mm_and_si128( _mm_cmplt_epi32( lane, _mm_set1_epi32( x1 - x + 1 ) ),
+				_mm_cmpgt_epi32( lane, _mm_set1_epi32( x0 - x - 1 ) ) );
+			__m128i mask = _mm_andnot_si128( outside, span );
+
+			if( _mm_movemask_epi8( mask ) != 0 ) {
+				float * depth = &m_depth[ row + x ];
+				uint32_t * pixel = &m_colour[ row + x ];
+
+				__m128 z = _mm_add_ps( z0, _mm_mul_ps( _mm_add_ps( zLane, _mm_set1_ps( float( x - x0 ) ) ), dzdx4 ) );
+				__m128 zOld = _mm_loadu_ps( depth );
+				if( depthTest ) {
+					mask = _mm_and_si128( mask, _mm_castps_si128( _mm_cmplt_ps( z, zOld ) ) );
+					__m128 fmask = _mm_castsi128_ps( mask );
+					_mm_storeu_ps( depth, _mm_or_ps( _mm_and_ps( fmask, z ), _mm_andnot_ps( fmask, zOld ) ) );
+				}
+
+				__m128i cOld = _mm_loadu_si128( reinterpret_cast<__m128i *>( pixel ) );
+				_mm_storeu_si128( reinterpret_cast<__m128i *>( pixel ),
+					_mm_or_si128( _mm_and_si128( mask, colour4 ), _mm_andnot_si128( mask, cOld ) ) );
+			}
+
+			e0 = _mm_add_epi32( e0, stepX4[ 0 ] );
+			e1 = _mm_add_epi32( e1, stepX4[ 1 ] );
+			e2 = _mm_add_epi32( e2, stepX4[ 2 ] );
+		}
+
+		for( int e = 0; e < 3; ++e ) {
+			rowE[ e ] = _mm_add_epi32( rowE[ e ], _mm_set1_epi32( stepY[ e ] ) );
+		}
+		zRow += dzdy;
+	}
+#else
+	for( int y = y0; y <= y1; ++y ) {
+		int32_t e0 = E[ 0 ], e1 = E[ 1 ], e2 = E[ 2 ];
+		float z = zRow;
+
+		size_t row = size_t( y ) * m_stride;
+		for( int x = x0; x <= x1; ++x ) {
+			if( ( e0 | e1 | e2 ) >= 0 && ( !depthTest || z < m_depth[ row + x ] ) ) {
+				if( depthTest ) {
+					m_depth[ row + x ] = z;
+				}
+				m_colour[ row + x ] = colour;
+			}
+			e0 += stepX[ 0 ];
+			e1 += stepX[ 1 ];
+			e2 += stepX[ 2 ];
+			z += dzdx;
+		}
+
+		for( int e = 0; e < 3; ++e ) {
+			E[ e ] += stepY[ e ];
+		}
+		zRow += dzdy;
+	}
+#endif
+}
+
+void SoftRasteriser::fillLine( const glm::vec3 & a, const glm::vec3 & b, uint32_t colour, bool depthTest, const Tile & tile )
+{
+	// Step along the major axis, lighting one pixel per column (or row) whose
+	// centre lies in [start, end). This follows the GL diamond-exit rule
+	// closely enough for thin, single pixel lines.
+	float dx = b.x - a.x;
+	float dy = b.y - a.y;
+	bool xMajor = std::fabs( dx ) >= std::fabs( dy );
+
+	float start = xMajor ? std::min( a.x, b.x ) : std::min( a.y, b.y );
+	float end = xMajor ? std::max( a.x, b.x ) : std::max( a.y, b.y );
+	float length = xMajor ? dx : dy;
+	if( length == 0.0f ) {
+		return;
+	}
+
+	// Whole pixel range along the major axis, limited to the tile
+	int lo = xMajor ? tile.x0 : tile.y0;
+	int hi = xMajor ? tile.x1 : tile.y1;
+	int first = std::max( lo, int( std::ceil( start - 0.5f ) ) );
+	int last = std::min( hi - 1, int( std::ceil( end - 0.5f ) ) - 1 );
+
+	const float origin = xMajor ? a.x : a.y;
+	const float minor = xMajor ? a.y : a.x;
+	const float slope = ( xMajor ? dy : dx ) / length;
+	const float dz = ( b.z - a.z ) / length;
+
+	for( int major = first; major <= last; ++major ) {
+		float t = float( major ) + 0.5f - origin;
+		int other = int( std::floor( minor + slope * t ) );
+
+		int x = xMajor ? major : other;
+		int y = xMajor ? other : major;
+		if( x < tile.x0 || x >= tile.x1 || y < tile.y0 || y >= tile.y1 ) {
+			continue;
+		}
+
+		size_t idx = size_t( y ) * m_stride + x;
+		float z = a.z + dz * t;
+		if( depthTest ) {
+			if( !( z < m_depth[ idx ] ) ) {
+				continue;
+			}
+			m_depth[ idx ] = z;
+		}
+		m_colour[ idx ] = colour;
+	}
+}
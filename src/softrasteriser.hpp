@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "drawlist.hpp"
+
+/*
+ * CPU renderer for draw lists, producing the same image as SceneRenderer
+ * without a GL context.
+ *
+ * Each frame the commands are transformed and binned by screen bounds into
+ * 64x64 pixel tiles, then the tiles are rasterised in parallel. Triangles
+ * use fixed point half-space edge functions (4 pixels at a time with SSE2
+ * where available), the top-left fill rule and a float depth buffer with
+ * GL_LESS semantics. Back faces of cubes are skipped as they are always
+ * hidden; wireframes draw the triangle edges GL_LINE polygon mode would.
+ */
+class SoftRasteriser
+{
+public:
+	SoftRasteriser();
+
+	/* Sets the number of worker threads, 0 uses one per hardware thread. */
+	void setThreadCount( unsigned threads );
+
+	/* Sets the colour the image is cleared to. */
+	void setClearColour( const glm::vec3 & colour );
+
+	/* Builds the grid line geometry for a grid of the specified dimension. */
+	void setGridDim( size_t dim );
+
+	/* Renders a draw list into a width x height image. */
+	void render( const DrawList & list, int width, int height );
+
+	/* Gets the image as RGB bytes, rows bottom to top like glReadPixels. */
+	void readPixels( std::vector<unsigned char> & rgb ) const;
+
+	int getWidth() const;
+	int getHeight() const;
+
+private:
+	// A binned draw: one instance of a command.
+	struct BinEntry
+	{
+		uint32_t command;
+		uint32_t instance;
+	};
+
+	// Screen rectangle of a tile, max exclusive.
+	struct Tile
+	{
+		int x0, y0, x1, y1;
+	};
+
+	void binCommands( const DrawList & list, size_t chunk );
+	void rasteriseTile( const DrawList & list, size_t tile );
+
+	void drawCube( const DrawList & list, const DrawCommand & cmd, uint32_t instance, const Tile & tile );
+	void drawGridLines( const DrawList & list, const DrawCommand & cmd, uint32_t instance, const Tile & tile );
+
+	void drawTriangle( const glm::vec4 * clip, uint32_t colour, bool depthTest, const Tile & tile );
+	void drawLine( const glm::vec4 & a, const glm::vec4 & b, uint32_t colour, bool depthTest, const Tile & tile );
+
+	void fillTriangle( const glm::vec3 * v, uint32_t colour, bool depthTest, const Tile & tile );
+	void fillLine( const glm::vec3 & a, const glm::vec3 & b, uint32_t colour, bool depthTest, const Tile & tile );
+
+	glm::vec3 toWindow( const glm::vec4 & clip ) const;
+
+	unsigned m_threads;
+	uint32_t m_clearColour;
+
+	// Image size and padded buffer stride (a whole number of tiles).
+	int m_width;
+	int m_height;
+	int m_stride;
+	int m_tilesX;
+	int m_tilesY;
+
+	std::vector<uint32_t> m_colour;
+	std::vector<float> m_depth;
+
+	// Bins indexed by [chunk * tile count + tile]. Chunks are contiguous
+	// command ranges, so walking chunks in order preserves draw order.
+	size_t m_chunkCount;
+	std::vector<std::vector<BinEntry> > m_bins;
+
+	// Grid line end points in model space.
+	std::vector<glm::vec3> m_gridLines;
+
+	// Projection * view of the frame being rendered.
+	glm::mat4 m_viewProj;
+};
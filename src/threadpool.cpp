@@ -0,0 +1,132 @@
+#include <algorithm>
+
+#include "threadpool.hpp"
+
+ThreadPool::ThreadPool( unsigned threads )
+	: m_task( nullptr ),
+	m_busy( 0 ),
+	m_generation( 0 ),
+	m_stop( false )
+{
+	if( threads == 0 ) {
+		threads = std::max( std::thread::hardware_concurrency(), 1u );
+	}
+
+	for( unsigned idx = 0; idx < threads; ++idx ) {
+		m_queues.push_back( std::unique_ptr<Queue>( new Queue() ) );
+	}
+
+	for( unsigned idx = 1; idx < threads; ++idx ) {
+		m_threads.push_back( std::thread( &ThreadPool::workerMain, this, idx ) );
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> guard( m_lock );
+		m_stop = true;
+	}
+	m_start.notify_all();
+
+	for( std::thread & t : m_threads ) {
+		t.join();
+	}
+}
+
+unsigned ThreadPool::getThreadCount() const
+{
+	return unsigned( m_queues.size() );
+}
+
+void ThreadPool::run( size_t count, const std::function<void( size_t )> & task )
+{
+	const size_t workers = m_queues.size();
+
+	// Contiguous blocks keep neighbouring tasks on one worker until stolen
+	for( size_t idx = 0; idx < workers; ++idx ) {
+		Queue & queue = *m_queues[ idx ];
+		std::lock_guard<std::mutex> guard( queue.lock );
+
+		size_t begin = idx * count / workers;
+		size_t end = ( idx + 1 ) * count / workers;
+		for( size_t t = begin; t < end; ++t ) {
+			queue.tasks.push_back( t );
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> guard( m_lock );
+		m_task = &task;
+		m_busy = unsigned( m_threads.size() );
+		++m_generation;
+	}
+	m_start.notify_all();
+
+	drain( 0 );
+
+	// Wait for the other workers to finish their last task
+	std::unique_lock<std::mutex> guard( m_lock );
+	m_done.wait( guard, [this]() { return m_busy == 0; } );
+	m_task = nullptr;
+}
+
+void ThreadPool::workerMain( unsigned worker )
+{
+	unsigned generation = 0;
+
+	for( ;; ) {
+		{
+			std::unique_lock<std::mutex> guard( m_lock );
+			m_start.wait( guard, [&]() { return m_stop || m_generation != generation; } );
+			if( m_stop ) {
+				return;
+			}
+			generation = m_generation;
+		}
+
+		drain( worker );
+
+		if( --m_busy == 0 ) {
+			std::lock_guard<std::mutex> guard( m_lock );
+			m_done.notify_all();
+		}
+	}
+}
+
+void ThreadPool::drain( unsigned worker )
+{
+	size_t task;
+	while( pop( worker, task ) ) {
+		( *m_task )( task );
+	}
+}
+
+bool ThreadPool::pop( unsigned worker, size_t & task )
+{
+	const size_t workers = m_queues.size();
+
+	// Own queue first, from the front
+	{
+		Queue & own = *m_queues[ worker ];
+		std::lock_guard<std::mutex> guard( own.lock );
+		if( !own.tasks.empty() ) {
+			task = own.tasks.front();
+			own.tasks.pop_front();
+			return true;
+		}
+	}
+
+	// Then steal from the back of the others
+	for( size_t offset = 1; offset < workers; ++offset ) {
+		Queue & victim = *m_queues[ ( worker + offset ) % workers ];
+		std::lock_guard<std::mutex> guard( victim.lock );
+		if( !victim.tasks.empty() ) {
+			task = victim.tasks.back();
+			victim.tasks.pop_back();
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Fixed set of worker threads that run indexed tasks with work stealing.
+ *
+ * run() splits the index range into contiguous blocks, one per worker
+ * queue. Workers take tasks from the front of their own queue and, once it
+ * is empty, steal from the back of the others, so uneven tasks (e.g. image
+ * tiles of varying cost) balance out. The calling thread takes part as
+ * worker 0, so a pool of one thread spawns nothing.
+ */
+class ThreadPool
+{
+public:
+	/* Starts 'threads' workers, 0 uses one per hardware thread. */
+	explicit ThreadPool( unsigned threads = 0 );
+	~ThreadPool();
+
+	unsigned getThreadCount() const;
+
+	/* Runs task( i ) for every i in [0, count) and waits for all of them. */
+	void run( size_t count, const std::function<void( size_t )> & task );
+
+private:
+	ThreadPool( const ThreadPool & );
+	ThreadPool & operator=( const ThreadPool & );
+
+	struct Queue
+	{
+		std::mutex lock;
+		std::deque<size_t> tasks;
+	};
+
+	void workerMain( unsigned worker );
+	void drain( unsigned worker );
+	bool pop( unsigned worker, size_t & task );
+
+	std::vector<std::thread> m_threads;
+	std::vector<std::unique_ptr<Queue> > m_queues;
+
+	// Task of the current run() and the workers still busy with it.
+	const std::function<void( size_t )> * m_task;
+	std::atomic<unsigned> m_busy;
+
+	// Incremented to start a run; workers sleep until it changes.
+	std::mutex m_lock;
+	std::condition_variable m_start;
+	std::condition_variable m_done;
+	unsigned m_generation;
+	bool m_stop;
+};
@@ -0,0 +1,125 @@
+/*
+ * AssetPacker
+ *
+ * Packs a directory of assets into one file for AssetPack, e.g. Assets/
+ * into the Assets.pack that Stack mounts from next to its executable. Files
+ * in subdirectories are named by their path below the directory, with '/'
+ * separators. --list prints the assets of an existing pack, and --verify
+ * also checks each one against its hash.
+ *
+ * Usage: AssetPacker <pack> <directory>
+ *        AssetPacker --list <pack>
+ *        AssetPacker --verify <pack>
+ */
+
+#include "cs488-framework/AssetPack.hpp"
+#include "cs488-framework/Exception.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+static void usage()
+{
+    fprintf(stderr, "Usage: AssetPacker <pack> <directory>\n"
+                    "       AssetPacker --list <pack>\n"
+                    "       AssetPacker --verify <pack>\n");
+}
+
+// Adds the regular files below 'directory', skipping hidden files and editor
+// backups. 'prefix' is the name of 'directory' within the pack.
+static bool findFiles(const string & directory, const string & prefix,
+        vector<string> & names, vector<string> & filePaths)
+{
+    DIR * dir = opendir(directory.c_str());
+    if (dir == nullptr) {
+        fprintf(stderr, "Unable to read %s\n", directory.c_str());
+        return false;
+    }
+
+    bool ok = true;
+    while (dirent * entry = readdir(dir)) {
+        string name = entry->d_name;
+        if (name.empty() || name[0] == '.' || name.back() == '~') {
+            continue;
+        }
+
+        string path = directory + "/" + name;
+        struct stat status;
+        if (stat(path.c_str(), &status) != 0) {
+            continue;
+        }
+
+        if (S_ISDIR(status.st_mode)) {
+            ok = findFiles(path, prefix + name + "/", names, filePaths) && ok;
+        } else if (S_ISREG(status.st_mode)) {
+            names.push_back(prefix + name);
+            filePaths.push_back(path);
+        }
+    }
+    closedir(dir);
+    return ok;
+}
+
+static int listPack(const char * packPath, bool verify)
+{
+    AssetPack pack;
+    if (!pack.open(packPath)) {
+        fprintf(stderr, "%s is not an asset pack\n", packPath);
+        return EXIT_FAILURE;
+    }
+
+    size_t failures = 0;
+    for (size_t idx = 0; idx < pack.getAssetCount(); ++idx) {
+        string name = pack.getAssetName(idx);
+        AssetPack::Asset asset;
+        pack.find(name.c_str(), asset);
+
+        bool ok = !verify || AssetPack::verify(asset);
+        failures += ok ? 0 : 1;
+        printf("%10zu %016llx %s%s\n", asset.size, (unsigned long long) asset.hash, name.c_str(),
+                ok ? "" : "  CORRUPT");
+    }
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 3 && strcmp(argv[1], "--list") == 0) {
+        return listPack(argv[2], false);
+    }
+    if (argc == 3 && strcmp(argv[1], "--verify") == 0) {
+        return listPack(argv[2], true);
+    }
+    if (argc != 3 || argv[1][0] == '-') {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    string directory = argv[2];
+    while (directory.size() > 1 && directory.back() == '/') {
+        directory.pop_back();
+    }
+
+    vector<string> names, filePaths;
+    if (!findFiles(directory, "", names, filePaths)) {
+        return EXIT_FAILURE;
+    }
+
+    try {
+        AssetPack::write(argv[1], names, filePaths);
+    } catch (const Exception & e) {
+        fprintf(stderr, "%s\n", e.what());
+        return EXIT_FAILURE;
+    }
+
+    printf("Packed %zu assets from %s into %s\n", names.size(), directory.c_str(), argv[1]);
+    return EXIT_SUCCESS;
+}